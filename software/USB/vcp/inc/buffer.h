@@ -2,13 +2,46 @@
 #define __BUFFER_H
 
 #include "stdint.h"
+#include "string.h"
+
+/*
+ * Byte ring buffers shared between one producer and one consumer
+ * (interrupt and main loop).  Only the producer moves _Tail and only the
+ * consumer moves _Head; one byte is always left free so that
+ * _Head == _Tail means empty.
+ *
+ * Besides the byte-count Put()/Get(), data can be moved in place:
+ *	producer:	_Reserve() up to two free spans, fill them, _Commit()
+ *	consumer:	_Peek() up to two data spans, use them, _Consume()
+ * The second span is only non-empty when the region wraps.
+ */
+
+typedef struct
+{
+	uint8_t *data;
+	uint16_t length;
+} _BUFFER_span;
+
+typedef struct
+{
+	_BUFFER_span span[2];
+	uint16_t length;				// span[0].length + span[1].length
+} _BUFFER_spans;
+
+// Keeps the compiler from moving buffer accesses across a pointer update;
+//	a single Cortex-M3 core needs no hardware barrier for this
+#define BUFFER_BARRIER()	__asm volatile("" ::: "memory")
 
 #define EXTERN_BUFFER(name, size)										\
 extern uint8_t name##_Buffer[size];										\
 extern uint8_t *name##_Head, *name##_Tail;								\
 extern const uint16_t name##_Size;										\
 extern uint32_t name##_BytesRead, name##_BytesWritten;					\
-uint16_t name##_Put(uint8_t* buffer, uint16_t length);					\
+uint16_t name##_Reserve(_BUFFER_spans* spans, uint16_t length);			\
+void name##_Commit(uint16_t length);									\
+uint16_t name##_Peek(_BUFFER_spans* spans, uint16_t length);			\
+void name##_Consume(uint16_t length);									\
+uint16_t name##_Put(const uint8_t* buffer, uint16_t length);			\
 uint16_t name##_Get(uint8_t* buffer, uint16_t length);
 
 #define BUFFER(name, size)												\
@@ -17,50 +50,91 @@ uint8_t name##_Buffer[size];											\
 uint8_t *name##_Head = name##_Buffer, *name##_Tail = name##_Buffer;		\
 uint32_t name##_BytesRead, name##_BytesWritten;							\
 																		\
-uint16_t name##_Put(uint8_t* buffer, uint16_t length)					\
+uint16_t name##_Reserve(_BUFFER_spans* spans, uint16_t length)			\
 {																		\
-	uint16_t count;														\
-	uint8_t *next;														\
+	uint8_t *head = *(uint8_t * volatile *)&name##_Head;				\
+	uint8_t *tail = name##_Tail;										\
+	uint16_t free, toEnd;												\
 																		\
-	count = 0;															\
-	while(count < length)												\
-	{																	\
-		next = name##_Tail + 1;											\
-		if(next - name##_Buffer >= name##_Size)							\
-			next = name##_Buffer;										\
-		if(next == name##_Head)											\
-		{																\
-			name##_BytesWritten += count;								\
-			return count;												\
-		}																\
-		*name##_Tail = *(buffer + count);								\
-		name##_Tail = next;												\
-		count++;														\
-	}																	\
-	name##_BytesWritten += count;										\
-	return count;														\
+	free = (head > tail) ? head - tail - 1								\
+			: name##_Size - (tail - head) - 1;							\
+	if(length > free)													\
+		length = free;													\
+																		\
+	toEnd = name##_Buffer + name##_Size - tail;							\
+	spans->span[0].data = tail;											\
+	spans->span[0].length = (length < toEnd) ? length : toEnd;			\
+	spans->span[1].data = name##_Buffer;								\
+	spans->span[1].length = length - spans->span[0].length;				\
+	spans->length = length;												\
+	return length;														\
+}																		\
+																		\
+void name##_Commit(uint16_t length)										\
+{																		\
+	uint8_t *tail = name##_Tail + length;								\
+																		\
+	if(tail - name##_Buffer >= name##_Size)								\
+		tail -= name##_Size;											\
+	BUFFER_BARRIER();													\
+	name##_Tail = tail;													\
+	name##_BytesWritten += length;										\
+}																		\
+																		\
+uint16_t name##_Peek(_BUFFER_spans* spans, uint16_t length)				\
+{																		\
+	uint8_t *head = name##_Head;										\
+	uint8_t *tail = *(uint8_t * volatile *)&name##_Tail;				\
+	uint16_t used, toEnd;												\
+																		\
+	used = (tail >= head) ? tail - head									\
+			: name##_Size - (head - tail);								\
+	if(length > used)													\
+		length = used;													\
+																		\
+	BUFFER_BARRIER();													\
+	toEnd = name##_Buffer + name##_Size - head;							\
+	spans->span[0].data = head;											\
+	spans->span[0].length = (length < toEnd) ? length : toEnd;			\
+	spans->span[1].data = name##_Buffer;								\
+	spans->span[1].length = length - spans->span[0].length;				\
+	spans->length = length;												\
+	return length;														\
+}																		\
+																		\
+void name##_Consume(uint16_t length)									\
+{																		\
+	uint8_t *head = name##_Head + length;								\
+																		\
+	if(head - name##_Buffer >= name##_Size)								\
+		head -= name##_Size;											\
+	BUFFER_BARRIER();													\
+	name##_Head = head;													\
+	name##_BytesRead += length;											\
+}																		\
+																		\
+uint16_t name##_Put(const uint8_t* buffer, uint16_t length)			\
+{																		\
+	_BUFFER_spans spans;												\
+																		\
+	length = name##_Reserve(&spans, length);							\
+	memcpy(spans.span[0].data, buffer, spans.span[0].length);			\
+	memcpy(spans.span[1].data, buffer + spans.span[0].length,			\
+			spans.span[1].length);										\
+	name##_Commit(length);												\
+	return length;														\
 }																		\
 																		\
 uint16_t name##_Get(uint8_t* buffer, uint16_t length)					\
 {																		\
-	uint16_t count;														\
+	_BUFFER_spans spans;												\
 																		\
-	count = 0;															\
-	while(count < length)												\
-	{																	\
-		if(name##_Head == name##_Tail)									\
-		{																\
-			name##_BytesRead += count;									\
-			return count;												\
-		}																\
-		*(buffer + count) = *name##_Head;								\
-		name##_Head++;													\
-		if(name##_Head - name##_Buffer >= name##_Size)					\
-			name##_Head = name##_Buffer;								\
-		count++;														\
-	}																	\
-	name##_BytesRead += count;											\
-	return count;														\
+	length = name##_Peek(&spans, length);								\
+	memcpy(buffer, spans.span[0].data, spans.span[0].length);			\
+	memcpy(buffer + spans.span[0].length, spans.span[1].data,			\
+			spans.span[1].length);										\
+	name##_Consume(length);												\
+	return length;														\
 }
 
 #define EXTERN_BUFFER_COPY(source, dest)								\
@@ -69,47 +143,143 @@ uint16_t source##_##dest##_Copy(uint16_t length);
 #define BUFFER_COPY(source, dest)										\
 uint16_t source##_##dest##_Copy(uint16_t length)						\
 {																		\
+	_BUFFER_spans spans;												\
 	uint16_t count;														\
-	uint8_t *next;														\
 																		\
-	count = 0;															\
-	while(count < length)												\
-	{																	\
-		if(source##_Head == source##_Tail)								\
-			return count;												\
-		next = dest##_Tail + 1;											\
-		if(next - dest##_Buffer >= dest##_Size)							\
-			next = dest##_Buffer;										\
-		if(next == dest##_Head)											\
-		{																\
-			source##_BytesRead += count;								\
-			dest##_BytesWritten += count;								\
-			return count;												\
-		}																\
-		*dest##_Tail = *source##_Head;									\
-		dest##_Tail = next;												\
-		source##_Head++;												\
-		if(source##_Head - source##_Buffer >= source##_Size)			\
-			source##_Head = source##_Buffer;							\
-		count++;														\
-	}																	\
-	source##_BytesRead += count;										\
-	dest##_BytesWritten += count;										\
+	source##_Peek(&spans, length);										\
+	count = dest##_Put(spans.span[0].data, spans.span[0].length);		\
+	if(count == spans.span[0].length)									\
+		count += dest##_Put(spans.span[1].data, spans.span[1].length);	\
+	source##_Consume(count);											\
 	return count;														\
 }
 
 
 #define BUFFER_IS_EMPTY(name)	(name##_BytesRead == name##_BytesWritten)
-#define BUFFER_IS_FULL(name)	({uint8_t* next = name##_Tail + 1; ((next - name##_Buffer > name##_Size) ? next - name##_Size : next) == name##_Head; })
-#define BUFFER_DATA_LENGTH(name)	({int16_t _length = name##_Tail - name##_Head; BUFFER_IS_EMPTY(name) ? 0 : (_length <= 0 ? _length + name##_Size : _length); })
-#define BUFFER_CONTIGUOUS_DATA_LENGTH(name)	({int16_t _length = name##_Tail - name##_Head; BUFFER_IS_EMPTY(name) ? 0 : (_length <= 0 ? name##_Buffer + name##_Size - name##_Head : _length); })
+#define BUFFER_IS_FULL(name)	({uint8_t* next = name##_Tail + 1; ((next - name##_Buffer >= name##_Size) ? next - name##_Size : next) == name##_Head; })
+#define BUFFER_DATA_LENGTH(name)	({int16_t _length = name##_Tail - name##_Head; _length < 0 ? _length + name##_Size : _length; })
+#define BUFFER_CONTIGUOUS_DATA_LENGTH(name)	({int16_t _length = name##_Tail - name##_Head; _length < 0 ? name##_Buffer + name##_Size - name##_Head : _length; })
 
 #define BUFFER_SIZE(name)	(name##_Size)
-#define BUFFER_FREE_SPACE(name)	({int16_t _length = name##_Tail - name##_Head; _length < 0 ? -_length : name##_Size - _length; })
-#define BUFFER_CONTIGUOUS_FREE_SPACE(name)	({name##_Tail >= name##_Head ? name##_Buffer - name##_Tail + name##_Size : name##_Head - name##_Tail; })
+#define BUFFER_FREE_SPACE(name)	({int16_t _length = name##_Head - name##_Tail - 1; _length < 0 ? _length + name##_Size : _length; })
+
+#define BUFFER_MOVE_HEAD(name, length)	name##_Consume(length)
+#define BUFFER_MOVE_TAIL(name, length)	name##_Commit(length)
+
+
+#ifdef __cplusplus
+
+#include <atomic>
+
+/*
+ * Header-only single-producer/single-consumer ring for C++ code, with the
+ * same reserve/commit and peek/consume spans as the C macros above.
+ *
+ * The size is a power of two, so the producer and consumer indices run
+ * freely and are masked on access: all size bytes are usable and no
+ * compare-and-wrap is needed.  Each index is written by one side only.
+ * The producer publishes _tail with release ordering after filling the
+ * data and the consumer reads it with acquire ordering before touching
+ * the data (and the other way round for _head), which on Cortex-M3 is a
+ * DMB around the plain word access; interrupt and thread context can
+ * therefore be either side.
+ */
+template<uint16_t size>
+class Buffer
+{
+	static_assert(size != 0 && (size & (size - 1)) == 0, "Buffer size must be a power of two");
+
+public:
+	static constexpr uint16_t Size = size;
+
+	Buffer() : _head(0), _tail(0) {}
+
+	/* Producer side */
+	uint16_t Reserve(_BUFFER_spans& spans, uint16_t length)
+	{
+		uint16_t tail = _tail.load(std::memory_order_relaxed);
+		uint16_t free = size - (uint16_t)(tail - _head.load(std::memory_order_acquire));
+
+		if(length > free)
+			length = free;
+		return Spans(spans, tail, length);
+	}
+
+	void Commit(uint16_t length)
+	{
+		_tail.store((uint16_t)(_tail.load(std::memory_order_relaxed) + length), std::memory_order_release);
+	}
+
+	uint16_t Put(const uint8_t* buffer, uint16_t length)
+	{
+		_BUFFER_spans spans;
+
+		length = Reserve(spans, length);
+		memcpy(spans.span[0].data, buffer, spans.span[0].length);
+		memcpy(spans.span[1].data, buffer + spans.span[0].length, spans.span[1].length);
+		Commit(length);
+		return length;
+	}
+
+	/* Consumer side */
+	uint16_t Peek(_BUFFER_spans& spans, uint16_t length)
+	{
+		uint16_t head = _head.load(std::memory_order_relaxed);
+		uint16_t used = (uint16_t)(_tail.load(std::memory_order_acquire) - head);
+
+		if(length > used)
+			length = used;
+		return Spans(spans, head, length);
+	}
+
+	void Consume(uint16_t length)
+	{
+		_head.store((uint16_t)(_head.load(std::memory_order_relaxed) + length), std::memory_order_release);
+	}
+
+	uint16_t Get(uint8_t* buffer, uint16_t length)
+	{
+		_BUFFER_spans spans;
+
+		length = Peek(spans, length);
+		memcpy(buffer, spans.span[0].data, spans.span[0].length);
+		memcpy(buffer + spans.span[0].length, spans.span[1].data, spans.span[1].length);
+		Consume(length);
+		return length;
+	}
+
+	/* Either side; the answer may be stale by the time it is used */
+	uint16_t DataLength() const
+	{
+		return (uint16_t)(_tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire));
+	}
+
+	uint16_t FreeSpace() const { return size - DataLength(); }
+	bool IsEmpty() const { return DataLength() == 0; }
+	bool IsFull() const { return DataLength() == size; }
+
+private:
+	static constexpr uint16_t Mask = size - 1;
+
+	uint16_t Spans(_BUFFER_spans& spans, uint16_t index, uint16_t length)
+	{
+		uint16_t offset = index & Mask;
+		uint16_t toEnd = size - offset;
+
+		spans.span[0].data = _buffer + offset;
+		spans.span[0].length = (length < toEnd) ? length : toEnd;
+		spans.span[1].data = _buffer;
+		spans.span[1].length = length - spans.span[0].length;
+		spans.length = length;
+		return length;
+	}
 
-#define BUFFER_MOVE_HEAD(name, length) ({ name##_Head += length; name##_BytesRead += length; if(name##_Head - name##_Buffer >= name##_Size) name##_Head -= name##_Size; })
-#define BUFFER_MOVE_TAIL(name, length) ({ name##_Tail += length; name##_BytesWritten += length; if(name##_Tail - name##_Buffer >= name##_Size) name##_Tail -= name##_Size; })
+	// Free-running; uint16_t wraps cleanly because size divides 65536
+	std::atomic<uint16_t> _head;
+	std::atomic<uint16_t> _tail;
+	uint8_t _buffer[size];
+};
 
+#endif /* __cplusplus */
 
 #endif
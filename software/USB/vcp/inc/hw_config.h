@@ -43,7 +43,6 @@
 #define LED_ON                0xF0
 #define LED_OFF               0xFF
 
-#define USART_RX_DATA_SIZE   2048
 /* Exported functions ------------------------------------------------------- */
 void Set_System(void);
 void Set_USBClock(void);
@@ -51,11 +50,11 @@ void Enter_LowPowerMode(void);
 void Leave_LowPowerMode(void);
 void USB_Interrupts_Config(void);
 void USB_Cable_Config (FunctionalState NewState);
-void USART_Config_Default(void);
-bool USART_Config(void);
-void USB_To_USART_Send_Data(uint8_t* data_buffer, uint8_t Nb_bytes);
-void USART_To_USB_Send_Data(void);
 void Handle_USBAsynchXfer (void);
+void EP1_ResetTx(void);
+void EP1_FillBuffers(void);
+uint32_t EP1_GetThroughput(void);
+void EP3_ResumeRx(void);
 void Get_SerialNum(void);
 
 /* External variables --------------------------------------------------------*/
@@ -59,8 +59,9 @@
 #define ENDP0_TXADDR        (0x80)
 
 /* EP1  */
-/* tx buffer base address */
-#define ENDP1_TXADDR        (0xC0)
+/* double-buffered tx, buffer 0 and buffer 1 base addresses */
+#define ENDP1_BUF0ADDR      (0xC0)
+#define ENDP1_BUF1ADDR      (0x150)
 #define ENDP2_TXADDR        (0x100)
 #define ENDP3_RXADDR        (0x110)
 
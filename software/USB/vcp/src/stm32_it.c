@@ -32,6 +32,7 @@
 #include "stm32_it.h"
 #include "usb_lib.h"
 #include "usb_istr.h"
+#include "perfMon.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -58,34 +59,26 @@ void USB_LP_IRQHandler(void)
 void USB_LP_CAN1_RX0_IRQHandler(void)
 #endif
 {
+  PERF_isrEnter();
   USB_Istr();
+  PERF_isrExit();
 }
-#endif /* STM32F10X_CL */
+
 /*******************************************************************************
-* Function Name  : EVAL_COM1_IRQHandler
-* Description    : This function handles EVAL_COM1 global interrupt request.
+* Function Name  : USB_HP_CAN1_TX_IRQHandler
+* Description    : This function handles USB High Priority interrupts
+*                  requests (correct transfers on double-buffered endpoints).
 * Input          : None
 * Output         : None
 * Return         : None
 *******************************************************************************/
-void EVAL_COM1_IRQHandler(void)
+void USB_HP_CAN1_TX_IRQHandler(void)
 {
-#ifdef USART
-  if (USART_GetITStatus(EVAL_COM1, USART_IT_RXNE) != RESET)
-  {
-    /* Send the received data to the PC Host*/
-    USART_To_USB_Send_Data();
-  }
-
-  /* If overrun condition occurs, clear the ORE flag and recover communication */
-  if (USART_GetFlagStatus(EVAL_COM1, USART_FLAG_ORE) != RESET)
-  {
-    (void)USART_ReceiveData(EVAL_COM1);
-  }
-#endif
+  PERF_isrEnter();
+  CTR_HP();
+  PERF_isrExit();
 }
-
-
+#endif /* STM32F10X_CL */
 #ifdef STM32F10X_CL
 /*******************************************************************************
 * Function Name  : OTG_FS_IRQHandler
@@ -34,28 +34,180 @@
 #include "usb_istr.h"
 #include "usb_pwr.h"
 #include "buffer.h"
+#include "uart.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
 
-/* Interval between sending IN packets in frame number (1 frame = 1ms) */
-#define VCOMPORT_IN_FRAME_INTERVAL             5
+/* Frames (1 frame = 1ms) per device-to-host throughput measurement */
+#define VCOMPORT_THROUGHPUT_FRAMES             1000
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
-extern uint8_t  USB_Tx_State;
+
+/* EP1 buffer filled and not yet sent to the host (0-1) */
+uint8_t EP1_Queued = 0;
+
+/* Bytes sent in the last VCOMPORT_THROUGHPUT_FRAMES frames */
+uint32_t EP1_Throughput = 0;
+
+/* EP3 is left NAKing while USB_RX cannot take another full packet */
+uint8_t EP3_Paused = 0;
 
 BUFFER(USB_RX, 256);
-BUFFER(USB_TX, 256);
+BUFFER(USB_TX, 512);
 
 BUFFER_COPY(USB_RX, USB_TX);
 
 /* Private function prototypes -----------------------------------------------*/
+void SpansToPMABufferCopy(const _BUFFER_spans *spans, uint16_t wPMABufAddr);
+void PMAToSpansCopy(const _BUFFER_spans *spans, uint16_t wPMABufAddr);
+
 /* Private functions ---------------------------------------------------------*/
 
+/*******************************************************************************
+* Function Name  : SpansToPMABufferCopy
+* Description    : Copy up to two ring buffer spans to packet memory (PMA).
+*                  PMA is written a half-word at a time, so when the first
+*                  span has an odd length its last byte is paired with the
+*                  first byte of the second span.
+* Input          : - spans: spans to copy, spans->length bytes in total.
+*                  - wPMABufAddr: address into PMA (even).
+* Output         : None.
+* Return         : None.
+*******************************************************************************/
+void SpansToPMABufferCopy(const _BUFFER_spans *spans, uint16_t wPMABufAddr)
+{
+  uint16_t first = spans->span[0].length;
+  const _BUFFER_span *second = &spans->span[1];
+
+  UserToPMABufferCopy(spans->span[0].data, wPMABufAddr, first & ~1);
+
+  if(first & 1)
+  {
+    uint16_t pair = spans->span[0].data[first - 1];
+
+    if(second->length > 0)
+      pair |= (uint16_t)second->data[0] << 8;
+    *(uint16_t *)((wPMABufAddr + first - 1) * 2 + PMAAddr) = pair;
+
+    if(second->length > 1)
+      UserToPMABufferCopy(second->data + 1, wPMABufAddr + first + 1, second->length - 1);
+  }
+  else if(second->length > 0)
+  {
+    UserToPMABufferCopy(second->data, wPMABufAddr + first, second->length);
+  }
+}
+
+/*******************************************************************************
+* Function Name  : PMAToSpansCopy
+* Description    : Copy packet memory (PMA) into up to two ring buffer spans,
+*                  the counterpart of SpansToPMABufferCopy().
+* Input          : - spans: spans to fill, spans->length bytes in total.
+*                  - wPMABufAddr: address into PMA (even).
+* Output         : None.
+* Return         : None.
+*******************************************************************************/
+void PMAToSpansCopy(const _BUFFER_spans *spans, uint16_t wPMABufAddr)
+{
+  uint16_t first = spans->span[0].length;
+  const _BUFFER_span *second = &spans->span[1];
+
+  PMAToUserBufferCopy(spans->span[0].data, wPMABufAddr, first & ~1);
+
+  if(first & 1)
+  {
+    uint16_t pair = *(uint16_t *)((wPMABufAddr + first - 1) * 2 + PMAAddr);
+
+    spans->span[0].data[first - 1] = (uint8_t)pair;
+    if(second->length > 0)
+      second->data[0] = (uint8_t)(pair >> 8);
+
+    if(second->length > 1)
+      PMAToUserBufferCopy(second->data + 1, wPMABufAddr + first + 1, second->length - 1);
+  }
+  else if(second->length > 0)
+  {
+    PMAToUserBufferCopy(second->data, wPMABufAddr + first, second->length);
+  }
+}
+
+/*******************************************************************************
+* Function Name  : EP1_ResetTx
+* Description    : Forget the EP1 buffers, called when the endpoint is reset.
+* Input          : None.
+* Output         : None.
+* Return         : None.
+*******************************************************************************/
+void EP1_ResetTx(void)
+{
+  EP1_Queued = 0;
+}
+
+/*******************************************************************************
+* Function Name  : EP1_FillBuffers
+* Description    : Move a packet from USB_TX into the free EP1 buffer.  EP1 is
+*                  double buffered: SW_BUF (DTOG_RX for an IN endpoint) picks
+*                  the buffer the application fills, toggling it hands that
+*                  buffer to the USB cell, which sends it on the next IN token.
+*                  Only one buffer is handed over at a time: a second toggle
+*                  would make SW_BUF equal DTOG_TX again, which the cell reads
+*                  as "application owns the buffer" and NAKs, so nothing
+*                  would ever be sent.  The next buffer is filled from
+*                  EP1_IN_Callback(), once DTOG_TX has moved on.  A packet may
+*                  span the wrap of the ring.
+*                  Runs in the USB interrupts, or with them masked.
+* Input          : None.
+* Output         : None.
+* Return         : None.
+*******************************************************************************/
+void EP1_FillBuffers(void)
+{
+  _BUFFER_spans spans;
+
+  /* USB_TX is being sent on the UART until that hands it over */
+  if(UART_isActive())
+    return;
+
+  if(EP1_Queued != 0)
+    return;
+
+  if(USB_TX_Peek(&spans, VIRTUAL_COM_PORT_DATA_SIZE) == 0)
+    return;
+
+  if(GetENDPOINT(ENDP1) & EP_DTOG_RX)
+  {
+    SpansToPMABufferCopy(&spans, ENDP1_BUF1ADDR);
+    SetEPDblBuf1Count(ENDP1, EP_DBUF_IN, spans.length);
+  }
+  else
+  {
+    SpansToPMABufferCopy(&spans, ENDP1_BUF0ADDR);
+    SetEPDblBuf0Count(ENDP1, EP_DBUF_IN, spans.length);
+  }
+
+  USB_TX_Consume(spans.length);
+  EP1_Queued = 1;
+  FreeUserBuffer(ENDP1, EP_DBUF_IN);
+}
+
+/*******************************************************************************
+* Function Name  : EP1_GetThroughput
+* Description    : Device-to-host payload rate measured over the last second.
+* Input          : None.
+* Output         : None.
+* Return         : Bytes per second.
+*******************************************************************************/
+uint32_t EP1_GetThroughput(void)
+{
+  return EP1_Throughput;
+}
+
 /*******************************************************************************
 * Function Name  : EP1_IN_Callback
-* Description    :
+* Description    : The EP1 buffer has been sent and DTOG_TX has moved on, so
+*                  the other buffer can be filled and handed over.
 * Input          : None.
 * Output         : None.
 * Return         : None.
@@ -63,31 +215,9 @@ BUFFER_COPY(USB_RX, USB_TX);
 // write to USB
 void EP1_IN_Callback (void)
 {
-	//uint16_t USB_Tx_ptr;
-	uint16_t USB_TX_Length;
-  
-	if (USB_Tx_State == 1)
-	{
-		if(BUFFER_IS_EMPTY(USB_TX))
-		{
-			USB_Tx_State = 0;
-		}
-		else
-		{
-			USB_TX_Length = BUFFER_CONTIGUOUS_DATA_LENGTH(USB_TX);
-			if (USB_TX_Length > VIRTUAL_COM_PORT_DATA_SIZE)
-				USB_TX_Length = VIRTUAL_COM_PORT_DATA_SIZE;
-      
-#ifdef USE_STM3210C_EVAL
-			USB_SIL_Write(EP1_IN, &USART_Rx_Buffer[USB_Tx_ptr], USB_TX_Length);
-#else
-			UserToPMABufferCopy(USB_TX_Head, ENDP1_TXADDR, USB_TX_Length);
-			BUFFER_MOVE_HEAD(USB_TX, USB_TX_Length);
-			SetEPTxCount(ENDP1, USB_TX_Length);
-			SetEPTxValid(ENDP1);
-#endif  
-		}
-	}
+  EP1_Queued = 0;
+
+  EP1_FillBuffers();
 }
 
 /*******************************************************************************
@@ -99,29 +229,49 @@ void EP1_IN_Callback (void)
 *******************************************************************************/
 void EP3_OUT_Callback(void)
 {
-  uint32_t USB_RX_DataLength = 0, USB_RX_TotalLength, USB_RX_DataLength2 = 0;
+  _BUFFER_spans spans;
 
-  /* Get the received data buffer and update the counter */
-  USB_RX_DataLength = USB_SIL_Read(EP3_OUT, USB_RX_Tail, BUFFER_CONTIGUOUS_FREE_SPACE(USB_RX), &USB_RX_TotalLength, 0);
-  BUFFER_MOVE_TAIL(USB_RX, USB_RX_DataLength);
-  
-  if(USB_RX_TotalLength > USB_RX_DataLength)
+  /* Read the packet straight into the free space of USB_RX; whatever does
+  not fit is dropped */
+  USB_RX_Reserve(&spans, GetEPRxCount(ENDP3));
+  PMAToSpansCopy(&spans, GetEPRxAddr(ENDP3));
+  USB_RX_Commit(spans.length);
+
+  /* USB_RX is emptied by the command-line interface in the main loop; the
+  host is NAKed until there is room for another packet, see EP3_ResumeRx() */
+  if(BUFFER_FREE_SPACE(USB_RX) >= VIRTUAL_COM_PORT_DATA_SIZE)
   {
-	  USB_RX_DataLength2 = USB_SIL_Read(EP3_OUT, USB_RX_Tail, BUFFER_CONTIGUOUS_FREE_SPACE(USB_RX), &USB_RX_TotalLength, USB_RX_DataLength);
-	  BUFFER_MOVE_TAIL(USB_RX, USB_RX_DataLength2);
+    /* Enable the receive of data on EP3 */
+    SetEPRxValid(ENDP3);
   }
+  else
+  {
+    EP3_Paused = 1;
+  }
+}
 
-  /* USB data will be immediately processed, this allow next USB traffic being 
-  NAKed till the end of the USART Xfer */
-  
-  // send back to USB
-  uint16_t RXLen = BUFFER_DATA_LENGTH(USB_RX);
-  uint16_t TXLen = USB_RX_USB_TX_Copy(RXLen);
+/*******************************************************************************
+* Function Name  : EP3_ResumeRx
+* Description    : Accept OUT packets again once USB_RX has room for one.
+*                  Call from the main loop after consuming USB_RX.
+* Input          : None.
+* Output         : None.
+* Return         : None.
+*******************************************************************************/
+void EP3_ResumeRx(void)
+{
+  if(EP3_Paused == 0)
+    return;
 
-#ifndef STM32F10X_CL
-  /* Enable the receive of data on EP3 */
-#endif /* STM32F10X_CL */
-  SetEPRxValid(ENDP3);
+  NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
+
+  if(BUFFER_FREE_SPACE(USB_RX) >= VIRTUAL_COM_PORT_DATA_SIZE)
+  {
+    EP3_Paused = 0;
+    SetEPRxValid(ENDP3);
+  }
+
+  NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
 }
 
 
@@ -139,16 +289,21 @@ void SOF_Callback(void)
 #endif /* STM32F10X_CL */
 {
   static uint32_t FrameCount = 0;
+  static uint32_t BytesSent = 0;
   
   if(bDeviceState == CONFIGURED)
   {
-    if (FrameCount++ == VCOMPORT_IN_FRAME_INTERVAL)
+    /* Data is normally sent as soon as it is queued (Handle_USBAsynchXfer)
+    and from EP1_IN_Callback, this only catches anything left over */
+    EP1_FillBuffers();
+
+    if (++FrameCount == VCOMPORT_THROUGHPUT_FRAMES)
     {
       /* Reset the frame counter */
       FrameCount = 0;
       
-      /* Check the data to be sent through IN pipe */
-      Handle_USBAsynchXfer();
+      EP1_Throughput = USB_TX_BytesRead - BytesSent;
+      BytesSent = USB_TX_BytesRead;
     }
   }  
 }
@@ -133,9 +133,6 @@ void Virtual_Com_Port_init(void)
   /* Perform basic device initialization operations */
   USB_SIL_Init();
 
-  /* configure the USART to the default settings */
-  USART_Config_Default();
-
   bDeviceState = UNCONNECTED;
 }
 
@@ -183,9 +180,16 @@ void Virtual_Com_Port_Reset(void)
 
   /* Initialize Endpoint 1 */
   SetEPType(ENDP1, EP_BULK);
-  SetEPTxAddr(ENDP1, ENDP1_TXADDR);
-  SetEPTxStatus(ENDP1, EP_TX_NAK);
+  SetEPDoubleBuff(ENDP1);
+  SetEPDblBuffAddr(ENDP1, ENDP1_BUF0ADDR, ENDP1_BUF1ADDR);
+  SetEPDblBuffCount(ENDP1, EP_DBUF_IN, 0);
+  ClearDTOG_RX(ENDP1);
+  ClearDTOG_TX(ENDP1);
   SetEPRxStatus(ENDP1, EP_RX_DIS);
+  /* Flow control is done with SW_BUF, the endpoint NAKs while both
+  buffers belong to the application */
+  SetEPTxStatus(ENDP1, EP_TX_VALID);
+  EP1_ResetTx();
 
   /* Initialize Endpoint 2 */
   SetEPType(ENDP2, EP_INTERRUPT);
@@ -246,9 +250,10 @@ void Virtual_Com_Port_SetDeviceAddress (void)
 *******************************************************************************/
 void Virtual_Com_Port_Status_In(void)
 {
+  /* The line coding is only stored for GET_LINE_CODING: the virtual port
+  has no physical UART behind it */
   if (Request == SET_LINE_CODING)
   {
-    USART_Config();
     Request = 0;
   }
 }
@@ -11,6 +11,11 @@
 #include <stdbool.h>
 #include "stm32f10x_adc.h"
 #include "adc.h"
+#include "fault.h"
+#include "perfMon.h"
+#include "pinMap.h"
+#include "telemetry.h"
+#include "scope.h"
 
 #define NULL 0
 
@@ -30,7 +35,8 @@ void (*adc2InterruptPtr)(void) = NULL;
 /***************************************************************************
  * Function:	void initAdc(void)
  *
- * Purpose:		This function is called to initialize the ADC for operation
+ * Purpose:		This function is called to initialize the ADC for operation.
+ * 				Call after FLT_initFault().
  *
  * Parameters:	none
  *
@@ -72,14 +78,19 @@ ADC_initAdc1(void)
 							+ (0b111 << 12));	// ADC1 conversion triggered on setting of SWSTART
 
 	ADC1->JSQR |= (uint32_t)((0b10 << 20)			// ADC1 3 conversions to complete
-							+ (0 << 5)				// in0 first
-							+ (1 << 10)				// in1 second
-							+ (2 << 15));			// in2 third
+							+ (PIN_PHA_FBK_ADC_CH << 5)		// phase A first
+							+ (PIN_PHB_FBK_ADC_CH << 10)	// phase B second
+							+ (PIN_PHC_FBK_ADC_CH << 15));	// phase C third
 
 	ADC1->CR2 |= (uint32_t)(1);			// ADC1 on
 
-	ADC1->CR2 |= (uint32_t)(1 << 2);	// start calibration of the ADC
-	while((ADC1->CR2 & (1 << 2)) > 0);	// wait for calibration to complete
+	// RM0008 asks for a calibration after power-up, which a warm
+	//	restart (FLT_warmRestart()) is not
+	if(!FLT_isWarmRestart())
+	{
+		ADC1->CR2 |= (uint32_t)(1 << 2);	// start calibration of the ADC
+		while((ADC1->CR2 & (1 << 2)) > 0);	// wait for calibration to complete
+	}
 
 	return;
 } // END ADC_initAdc1()
@@ -104,16 +115,19 @@ ADC_initAdc2(void)
 							+ (1 << 15)			// ADC2 conversion on external event enabled
 							+ (0b111 << 12));	// ADC2 conversion triggered on setting of SWSTART
 
-	ADC2->JSQR |= (uint32_t)((0b10 << 20)			// ADC2 2 conversions to complete
-							+ (4 << 5)				// in4 first
-							+ (3 << 10)				// in3 first
-							+ (7 << 15));			// in7 second
+	ADC2->JSQR |= (uint32_t)((0b10 << 20)			// ADC2 3 conversions to complete
+							+ (PIN_CONTROL_IN_ADC_CH << 5)	// control input first
+							+ (PIN_VBUS_FBK_ADC_CH << 10)	// bus voltage second
+							+ (PIN_I_FBK_ADC_CH << 15));	// bus current third
 
 
 	ADC2->CR2 |= (uint32_t)(1);			// ADC2 on
 
-	ADC2->CR2 |= (uint32_t)(1 << 2);	// start calibration of the ADC
-	while((ADC2->CR2 & (1 << 2)) > 0);	// wait for calibration to complete
+	if(!FLT_isWarmRestart())				// see ADC_initAdc1()
+	{
+		ADC2->CR2 |= (uint32_t)(1 << 2);	// start calibration of the ADC
+		while((ADC2->CR2 & (1 << 2)) > 0);	// wait for calibration to complete
+	}
 
 	return;
 } // END ADC_initAdc2()
@@ -293,6 +307,8 @@ ADC_deinitAdc2Interrupt(void)
 void
 ADC1_2_IRQHandler(void)
 {
+	PERF_controlIsrStart();
+
 	bool adc1IntEnabled = (ADC1->CR1 & (uint32_t)(0b1 << 7)) >> 7;
 	bool adc1IntTriggered = (ADC1->SR & (uint32_t)(0b1 << 2)) >> 2;
 
@@ -302,6 +318,9 @@ ADC1_2_IRQHandler(void)
 		ADC1->SR &= (uint32_t)~(0b1 << 2);		// clear the interrupt flag
 
 		(*adc1InterruptPtr)();				// call the function that was assigned to this pointer
+
+		TLM_capture();						// telemetry sample after the control step
+		SCP_capture();						// scope sample, same point
 	}
 
 	bool adc2IntEnabled = (ADC2->CR1 & (uint32_t)(0b1 << 7)) >> 7;
@@ -315,6 +334,8 @@ ADC1_2_IRQHandler(void)
 		(*adc2InterruptPtr)();				// call the function that was assigned to this pointer
 	}
 
+	PERF_controlIsrEnd();
+
 	return;
 }
 
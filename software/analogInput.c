@@ -0,0 +1,171 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* User-generated libs */
+#include "analogInput.h"
+#include "adc.h"
+
+/* Global variables */
+typedef struct
+{
+	_AIN_config config;
+	uint32_t scale;						// (65535 << 16) / (counts above the deadband)
+
+	uint32_t accumulator;				// filtered value << AIN_FILTER_SHIFT
+	uint16_t held;						// filtered value last used for the demand
+	uint16_t demand;
+} _analogInput;
+
+_analogInput analogInput =
+{
+	.config = {.minCounts = 200, .maxCounts = 3900, .deadband = 100, .hysteresis = 16}
+};
+
+/* Private function declarations */
+void AIN_updateDemand(void);
+
+/***************************************************************
+ * Function:	void AIN_initAnalogInput(void)
+ *
+ * Purpose:		To start the filter at the present input, so the
+ * 					demand does not ramp up from 0 at start-up
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	analogInput
+ **************************************************************/
+void
+AIN_initAnalogInput(void)
+{
+	uint16_t counts = ADC_getVoltage(ADC_CONTROL_VOLTAGE);
+
+	analogInput.accumulator = (uint32_t)counts << AIN_FILTER_SHIFT;
+	analogInput.held = counts;
+	AIN_configure(&analogInput.config);
+
+	return;
+} // END AIN_initAnalogInput()
+
+const _AIN_config*
+AIN_getConfig(void)
+{
+	return &analogInput.config;
+}
+
+/***************************************************************
+ * Function:	bool AIN_configure(const _AIN_config *config)
+ *
+ * Purpose:		To change the travel, deadband or hysteresis
+ *
+ * Parameters:	const _AIN_config *config
+ *
+ * Returns:		false if the deadband leaves no travel; nothing
+ * 					changes
+ *
+ * Globals affected:	analogInput.config, analogInput.scale
+ **************************************************************/
+bool
+AIN_configure(const _AIN_config *config)
+{
+	if((config->maxCounts > AIN_MAX_COUNTS)
+			|| (config->maxCounts <= (uint32_t)config->minCounts + config->deadband))
+	{
+		return false;
+	}
+
+	analogInput.config = *config;
+	analogInput.scale = (65535ul << 16) / (config->maxCounts - config->minCounts - config->deadband);
+	AIN_updateDemand();
+
+	return true;
+} // END AIN_configure()
+
+/***************************************************************
+ * Function:	void AIN_process(void)
+ *
+ * Purpose:		To filter one sample of the control voltage.
+ * 					Called every millisecond.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	analogInput
+ **************************************************************/
+void
+AIN_process(void)
+{
+	uint16_t filtered;
+	uint16_t change;
+
+	analogInput.accumulator += ADC_getVoltage(ADC_CONTROL_VOLTAGE)
+			- (analogInput.accumulator >> AIN_FILTER_SHIFT);
+	filtered = analogInput.accumulator >> AIN_FILTER_SHIFT;
+
+	if(filtered > analogInput.held)
+		change = filtered - analogInput.held;
+	else
+		change = analogInput.held - filtered;
+
+	if(change > analogInput.config.hysteresis)
+	{
+		analogInput.held = filtered;
+		AIN_updateDemand();
+	}
+
+	return;
+} // END AIN_process()
+
+/***************************************************************
+ * Function:	bool AIN_getSpeedDemand(uint16_t *speedDemand)
+ *
+ * Purpose:		To get the duty demand set by the control voltage
+ *
+ * Parameters:	uint16_t *speedDemand
+ *
+ * Returns:		true; the input is converted every PWM period,
+ * 					so it never goes stale
+ *
+ * Globals affected:	none
+ **************************************************************/
+bool
+AIN_getSpeedDemand(uint16_t *speedDemand)
+{
+	*speedDemand = analogInput.demand;
+	return true;
+} // END AIN_getSpeedDemand()
+
+uint16_t
+AIN_getFiltered(void)
+{
+	return analogInput.accumulator >> AIN_FILTER_SHIFT;
+}
+
+void
+AIN_updateDemand(void)
+{
+	uint32_t start = (uint32_t)analogInput.config.minCounts + analogInput.config.deadband;
+	uint32_t travel = analogInput.config.maxCounts - start;
+	uint32_t counts;
+
+	if(analogInput.held <= start)
+	{
+		analogInput.demand = 0;
+		return;
+	}
+
+	counts = analogInput.held - start;
+	if(counts > travel)
+		counts = travel;
+
+	analogInput.demand = (uint16_t)((counts * analogInput.scale) >> 16);
+
+	return;
+}
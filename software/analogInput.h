@@ -0,0 +1,43 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef ANALOGINPUT_H
+#define ANALOGINPUT_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Analog control input (ADC_CONTROL_VOLTAGE, 12-bit counts)
+ *
+ * Sampled every millisecond and low-pass filtered (time constant
+ *	2^AIN_FILTER_SHIFT ms).  The filtered value only moves the demand
+ *	once it is more than the hysteresis away from the value last used,
+ *	so a noisy pot does not make the duty dither.  Up to minCounts +
+ *	deadband the demand is 0; from there to maxCounts it rises to 100%.
+ */
+#define AIN_FILTER_SHIFT			3
+#define AIN_MAX_COUNTS				4095
+
+typedef struct
+{
+	uint16_t minCounts;					// 0% end of the travel
+	uint16_t maxCounts;					// 100% end of the travel
+	uint16_t deadband;					// counts above minCounts still read as 0
+	uint16_t hysteresis;				// counts the input must move to count
+} _AIN_config;
+
+void AIN_initAnalogInput(void);
+const _AIN_config* AIN_getConfig(void);
+bool AIN_configure(const _AIN_config *config);
+void AIN_process(void);
+bool AIN_getSpeedDemand(uint16_t *speedDemand);
+uint16_t AIN_getFiltered(void);
+
+#endif
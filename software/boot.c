@@ -0,0 +1,65 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include "stm32f10x.h"
+#include "stm32f10x_bkp.h"
+
+/* User-generated libs */
+#include "boot.h"
+
+/***************************************************************
+ * Function:	void BOOT_initBoot(void)
+ *
+ * Purpose:		To tell the bootloader that this image starts:
+ * 					clears the count of starts that did not get
+ * 					this far.  Call once the drive is initialized,
+ * 					after FLT_initFault() opened the backup domain.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	BOOT_BKP_ATTEMPTS
+ **************************************************************/
+void
+BOOT_initBoot(void)
+{
+	BKP_WriteBackupRegister(BOOT_BKP_ATTEMPTS, 0);
+
+	return;
+} // END BOOT_initBoot()
+
+/***************************************************************
+ * Function:	void BOOT_enterBootloader(void)
+ *
+ * Purpose:		To restart into the bootloader for a firmware
+ * 					update.  The bridge is switched off first, as
+ * 					in FLT_warmRestart().
+ *
+ * Parameters:	none
+ *
+ * Returns:		does not return
+ *
+ * Globals affected:	BOOT_BKP_REQUEST
+ **************************************************************/
+void
+BOOT_enterBootloader(void)
+{
+	__disable_irq();
+
+	TIM1->BDTR &= (uint16_t)~TIM_BDTR_MOE;
+
+	RCC->APB1ENR |= RCC_APB1ENR_PWREN | RCC_APB1ENR_BKPEN;
+	PWR->CR |= PWR_CR_DBP;
+	BKP_WriteBackupRegister(BOOT_BKP_REQUEST, BOOT_REQUEST_MAGIC);
+
+	NVIC_SystemReset();
+
+	while(1);
+} // END BOOT_enterBootloader()
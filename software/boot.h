@@ -0,0 +1,62 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef BOOT_H
+#define BOOT_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Flash map of the 32KB part, 1KB pages
+ *
+ *	0x08000000	bootloader (bootloader.coproj), 7 pages
+ *	0x08001C00	image record, written by the bootloader once an
+ *				image is verified
+ *	0x08002000	application (lowVoltageDrive.coproj, its vector
+ *				table at VECT_TAB_OFFSET 0x2000), 22 pages
+ *	0x08007800	parameter store, see paramStore.h, 2 pages
+ *
+ * The bootloader starts the application at once unless it was asked
+ *	to stay (BOOT_enterBootloader()), there is no verified image, or
+ *	the application was started BOOT_MAX_ATTEMPTS times without
+ *	calling BOOT_initBoot().  The request and the attempt count are
+ *	kept in backup registers, which survive a reset.
+ */
+#define BOOT_PAGE_SIZE				1024
+#define BOOT_LOADER_ADDRESS			0x08000000
+#define BOOT_RECORD_ADDRESS			0x08001C00
+#define BOOT_APP_ADDRESS			0x08002000
+#define BOOT_APP_END				0x08007800
+#define BOOT_APP_PAGES				((BOOT_APP_END - BOOT_APP_ADDRESS) / BOOT_PAGE_SIZE)
+
+// The application's initial stack pointer must point into SRAM
+#define BOOT_RAM_START				0x20000000
+#define BOOT_RAM_END				0x20002800
+
+#define BOOT_RECORD_MAGIC			0x424F4F54		// "BOOT"
+#define BOOT_REQUEST_MAGIC			0xB007
+#define BOOT_MAX_ATTEMPTS			3
+
+// Backup registers (stm32f10x_bkp.h), fault.c has DR1-DR7
+#define BOOT_BKP_REQUEST			BKP_DR8		// BOOT_REQUEST_MAGIC to stay in the bootloader
+#define BOOT_BKP_ATTEMPTS			BKP_DR9		// starts without BOOT_initBoot()
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t pages;						// image length, whole pages from BOOT_APP_ADDRESS
+	uint32_t crc;						// CRC-32/MPEG-2 of those pages, see frame.h
+	uint32_t check;						// ~crc
+} _BOOT_record;
+
+void BOOT_initBoot(void);
+void BOOT_enterBootloader(void) __attribute__((noreturn));
+
+#endif
@@ -0,0 +1,126 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include "stm32f10x.h"
+#include "stm32f10x_crc.h"
+#include "stm32f10x_flash.h"
+#include "stm32f10x_rcc.h"
+
+/* User-generated libs */
+#include "bootFlash.h"
+
+/***************************************************************
+ * Function:	void BFL_initFlash(void)
+ *
+ * Purpose:		To clock the CRC unit
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+BFL_initFlash(void)
+{
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_CRC, ENABLE);
+
+	return;
+} // END BFL_initFlash()
+
+/***************************************************************
+ * Function:	uint32_t BFL_crc(const uint32_t *words, uint16_t count)
+ *
+ * Purpose:		To calculate the CRC of a block of words with the
+ * 					hardware CRC unit, one word per AHB cycle
+ *
+ * Parameters:	const uint32_t *words	RAM or flash
+ * 				uint16_t count			in words
+ *
+ * Returns:		CRC
+ *
+ * Globals affected:	CRC unit
+ **************************************************************/
+uint32_t
+BFL_crc(const uint32_t *words, uint16_t count)
+{
+	CRC_ResetDR();
+	return CRC_CalcBlockCRC((uint32_t *)words, count);
+} // END BFL_crc()
+
+uint32_t
+BFL_crcFlash(uint32_t address, uint16_t count)
+{
+	return BFL_crc((const uint32_t *)address, count);
+}
+
+uint32_t
+BFL_readWord(uint32_t address)
+{
+	return *(const volatile uint32_t *)address;
+}
+
+/***************************************************************
+ * Function:	bool BFL_erasePage(uint32_t address)
+ *
+ * Purpose:		To erase one 1KB page.  The CPU stalls on flash
+ * 					reads until the erase (about 20ms) is done.
+ *
+ * Parameters:	uint32_t address		start of the page
+ *
+ * Returns:		true when the controller reports no error
+ *
+ * Globals affected:	flash
+ **************************************************************/
+bool
+BFL_erasePage(uint32_t address)
+{
+	FLASH_Status status;
+
+	FLASH_Unlock();
+	FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
+	status = FLASH_ErasePage(address);
+	FLASH_Lock();
+
+	return status == FLASH_COMPLETE;
+} // END BFL_erasePage()
+
+/***************************************************************
+ * Function:	bool BFL_programWords(uint32_t address, const uint32_t *words,
+ * 						uint16_t count)
+ *
+ * Purpose:		To program erased flash and check it back
+ *
+ * Parameters:	uint32_t address		word aligned
+ * 				const uint32_t *words
+ * 				uint16_t count			in words
+ *
+ * Returns:		true when every word programmed and reads back
+ *
+ * Globals affected:	flash
+ **************************************************************/
+bool
+BFL_programWords(uint32_t address, const uint32_t *words, uint16_t count)
+{
+	bool ok = true;
+	uint16_t i;
+
+	FLASH_Unlock();
+	FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
+
+	for(i = 0; (i < count) && ok; i++)
+	{
+		ok = (FLASH_ProgramWord(address + (i * sizeof(uint32_t)), words[i]) == FLASH_COMPLETE)
+				&& (BFL_readWord(address + (i * sizeof(uint32_t))) == words[i]);
+	}
+
+	FLASH_Lock();
+
+	return ok;
+} // END BFL_programWords()
@@ -0,0 +1,31 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef BOOTFLASH_H
+#define BOOTFLASH_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Flash controller and CRC unit access for the bootloader, and for
+ *	the application's parameter store (paramStore.c).  The protocol in
+ *	bootloader.c only reaches the flash through these, so tools/bootSim
+ *	can run it against a simulated flash controller.
+ *
+ * CRCs are CRC-32/MPEG-2 over little-endian words, as frame.h.
+ */
+void BFL_initFlash(void);
+uint32_t BFL_crc(const uint32_t *words, uint16_t count);
+uint32_t BFL_crcFlash(uint32_t address, uint16_t count);
+uint32_t BFL_readWord(uint32_t address);
+bool BFL_erasePage(uint32_t address);
+bool BFL_programWords(uint32_t address, const uint32_t *words, uint16_t count);
+
+#endif
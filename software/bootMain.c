@@ -0,0 +1,107 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/*
+ * Resident bootloader, built by bootloader.coproj into the first
+ *	pages of flash (see boot.h).  It shares the USB serial port, the
+ *	frames and the oscillator set-up with the application; the update
+ *	protocol itself is in bootloader.c.
+ */
+#include "stm32f10x.h"
+#include "stm32f10x_bkp.h"
+#include "stm32f10x_pwr.h"
+#include "stm32f10x_rcc.h"
+#include "hw_config.h"
+#include "usb_lib.h"
+#include "usb_pwr.h"
+#include "buffer.h"
+
+#include "boot.h"
+#include "bootloader.h"
+#include "osc.h"
+#include "perfMon.h"
+#include "uart.h"
+
+// Time for the last response to leave before the reset drops USB
+#define BOOT_RUN_DELAY_LOOPS	100000
+
+EXTERN_BUFFER(USB_TX, 512);
+
+void startApplication(void) __attribute__((noreturn));
+
+int
+main(void)
+{
+	uint16_t attempts;
+	bool requested;
+	volatile uint32_t i;
+
+	// Decide before anything is started, so the application gets the
+	//	part as it comes out of reset
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR | RCC_APB1Periph_BKP, ENABLE);
+	PWR_BackupAccessCmd(ENABLE);
+
+	requested = (BKP_ReadBackupRegister(BOOT_BKP_REQUEST) == BOOT_REQUEST_MAGIC);
+	attempts = BKP_ReadBackupRegister(BOOT_BKP_ATTEMPTS);
+	BKP_WriteBackupRegister(BOOT_BKP_REQUEST, 0);
+
+	if(!requested && (attempts < BOOT_MAX_ATTEMPTS) && BTL_isImageValid())
+	{
+		// Cleared by BOOT_initBoot() once the application is up
+		BKP_WriteBackupRegister(BOOT_BKP_ATTEMPTS, attempts + 1);
+		startApplication();
+	}
+
+	OSC_initClock();
+
+	Set_USBClock();
+	USB_Interrupts_Config();
+	USB_Init();
+
+	BTL_initBootloader();
+
+	while(1)
+	{
+		BTL_process();
+
+		if(BTL_isRunRequested() && BUFFER_IS_EMPTY(USB_TX))
+		{
+			for(i = 0; i < BOOT_RUN_DELAY_LOOPS; i++);
+
+			// A new image gets a fresh set of attempts
+			BKP_WriteBackupRegister(BOOT_BKP_ATTEMPTS, 0);
+			NVIC_SystemReset();
+		}
+	}
+
+	return 0;
+}
+
+void
+startApplication(void)
+{
+	const uint32_t *vectors = (const uint32_t *)BOOT_APP_ADDRESS;
+	uint32_t stack = vectors[0];
+	void (*reset)(void) = (void (*)(void))vectors[1];
+
+	// Only the backup domain was touched
+	PWR_BackupAccessCmd(DISABLE);
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR | RCC_APB1Periph_BKP, DISABLE);
+
+	SCB->VTOR = BOOT_APP_ADDRESS;
+	__set_MSP(stack);
+	reset();
+
+	while(1);
+}
+
+/* The USB port calls into these application modules */
+void PERF_isrEnter(void) {}
+void PERF_isrExit(void) {}
+bool UART_isActive(void) { return false; }
+void UART_startTransmit(void) {}
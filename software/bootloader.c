@@ -0,0 +1,470 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <string.h>
+#include "buffer.h"
+#include "hw_config.h"
+
+/* User-generated libs */
+#include "bootloader.h"
+#include "boot.h"
+#include "bootFlash.h"
+#include "frame.h"
+
+#define BTL_RESPONSE_HEADER		3			// seq, op, status
+#define BTL_PAGE_WORDS			(BOOT_PAGE_SIZE / sizeof(uint32_t))
+#define BTL_BYTES_PER_PASS		64
+
+EXTERN_BUFFER(USB_RX, 256);
+EXTERN_BUFFER(USB_TX, 512);
+
+/* Global variables */
+typedef struct
+{
+	uint32_t page[BTL_PAGE_WORDS];		// filled by BTL_OP_WRITE
+
+	// Frame being received, between the delimiters
+	uint8_t frame[FRM_MAX_ENCODED - 2];
+	uint8_t frameLength;
+	bool inFrame;
+	bool frameOverflow;
+
+	bool run;
+} _bootloader;
+
+_bootloader bootloader;
+
+/* Private function declarations */
+bool BTL_receiveFrameByte(uint8_t byte);
+uint8_t BTL_programPage(uint8_t page, uint32_t crc);
+uint8_t BTL_verifyImage(uint8_t pages, uint32_t crc);
+bool BTL_readRecord(_BOOT_record *record);
+uint32_t BTL_readWord(const uint8_t *data);
+void BTL_writeWord(uint8_t *data, uint32_t value);
+
+/***************************************************************
+ * Function:	void BTL_initBootloader(void)
+ *
+ * Purpose:		To get ready for the update protocol
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	bootloader
+ **************************************************************/
+void
+BTL_initBootloader(void)
+{
+	memset(bootloader.page, 0xFF, sizeof(bootloader.page));
+	bootloader.frameLength = 0;
+	bootloader.inFrame = false;
+	bootloader.run = false;
+
+	FRM_initFrame();
+	BFL_initFlash();
+
+	return;
+} // END BTL_initBootloader()
+
+/***************************************************************
+ * Function:	void BTL_process(void)
+ *
+ * Purpose:		To handle the requests received on USB.  Stops
+ * 					after a request that was answered, so USB_TX
+ * 					always has room for the next response.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	bootloader, flash
+ **************************************************************/
+void
+BTL_process(void)
+{
+	_BUFFER_spans spans;
+	uint16_t used = 0;
+	bool replied = false;
+	uint8_t s;
+	uint16_t i;
+
+	if(BUFFER_FREE_SPACE(USB_TX) < FRM_MAX_ENCODED)
+	{
+		return;
+	}
+
+	if(USB_RX_Peek(&spans, BTL_BYTES_PER_PASS) == 0)
+	{
+		return;
+	}
+
+	for(s = 0; (s < 2) && !replied; s++)
+	{
+		for(i = 0; (i < spans.span[s].length) && !replied; i++)
+		{
+			used++;
+			replied = BTL_receiveFrameByte(spans.span[s].data[i]);
+		}
+	}
+
+	USB_RX_Consume(used);
+	EP3_ResumeRx();
+
+	return;
+} // END BTL_process()
+
+bool
+BTL_isRunRequested(void)
+{
+	return bootloader.run;
+}
+
+/***************************************************************
+ * Function:	bool BTL_isImageValid(void)
+ *
+ * Purpose:		To check that a verified image is in place.  Only
+ * 					the record is read, not the image, so the
+ * 					application starts without delay: the record
+ * 					is erased before any page of the image is.
+ *
+ * Parameters:	none
+ *
+ * Returns:		true when the record is intact and the image's
+ * 					initial stack pointer lies in SRAM
+ *
+ * Globals affected:	none
+ **************************************************************/
+bool
+BTL_isImageValid(void)
+{
+	_BOOT_record record;
+	uint32_t stack = BFL_readWord(BOOT_APP_ADDRESS);
+
+	return BTL_readRecord(&record)
+			&& (stack > BOOT_RAM_START) && (stack <= BOOT_RAM_END);
+} // END BTL_isImageValid()
+
+/***************************************************************
+ * Function:	void BTL_handleRequest(const uint8_t *request, uint16_t length)
+ *
+ * Purpose:		To answer one binary request, see bootloader.h.
+ * 					The caller makes sure USB_TX has room for the
+ * 					response frame.
+ *
+ * Parameters:	const uint8_t *request		payload of a FRM_TYPE_BOOT_REQUEST
+ * 				uint16_t length
+ *
+ * Returns:		none
+ *
+ * Globals affected:	bootloader, flash
+ **************************************************************/
+void
+BTL_handleRequest(const uint8_t *request, uint16_t length)
+{
+	uint8_t response[FRM_MAX_PAYLOAD];
+	uint8_t *data = &response[BTL_RESPONSE_HEADER];
+	uint8_t size = BTL_RESPONSE_HEADER;
+	uint8_t status = BTL_OK;
+	const uint8_t *arguments = &request[2];
+	uint16_t argumentLength = length - 2;
+	_BOOT_record record;
+	uint16_t offset;
+	uint8_t i;
+
+	if(length < 2)
+	{
+		return;
+	}
+
+	response[0] = request[0];
+	response[1] = request[1];
+
+	switch(request[1])
+	{
+		case BTL_OP_INFO:
+			data[0] = BTL_PROTOCOL_VERSION;
+			data[1] = (uint8_t)BOOT_PAGE_SIZE;
+			data[2] = (uint8_t)(BOOT_PAGE_SIZE >> 8);
+			data[3] = BOOT_APP_PAGES;
+
+			if(!BTL_isImageValid())
+			{
+				record.pages = 0;
+				record.crc = 0;
+			}
+			else
+			{
+				BTL_readRecord(&record);
+			}
+
+			data[4] = (uint8_t)record.pages;
+			BTL_writeWord(&data[5], record.crc);
+			size += 9;
+			break;
+
+		case BTL_OP_CRCS:
+			if((argumentLength != 2) || (arguments[1] == 0) || (arguments[1] > BTL_MAX_CRCS))
+			{
+				status = BTL_ERR_LENGTH;
+				break;
+			}
+
+			if((arguments[0] + arguments[1]) > BOOT_APP_PAGES)
+			{
+				status = BTL_ERR_PAGE;
+				break;
+			}
+
+			for(i = 0; i < arguments[1]; i++)
+			{
+				BTL_writeWord(&response[size], BFL_crcFlash(BOOT_APP_ADDRESS
+						+ ((arguments[0] + i) * BOOT_PAGE_SIZE), BTL_PAGE_WORDS));
+				size += 4;
+			}
+			break;
+
+		case BTL_OP_WRITE:
+			// Not answered; a write that does not fit is dropped and
+			//	shows up as a CRC error on BTL_OP_PROGRAM
+			if((argumentLength <= 2) || ((argumentLength - 2) > BTL_MAX_WRITE))
+			{
+				return;
+			}
+
+			offset = (uint16_t)arguments[0] | ((uint16_t)arguments[1] << 8);
+			if((offset + argumentLength - 2) <= BOOT_PAGE_SIZE)
+			{
+				memcpy((uint8_t *)bootloader.page + offset, &arguments[2], argumentLength - 2);
+			}
+			return;
+
+		case BTL_OP_PROGRAM:
+			if(argumentLength != 5)
+				status = BTL_ERR_LENGTH;
+			else if(arguments[0] >= BOOT_APP_PAGES)
+				status = BTL_ERR_PAGE;
+			else
+				status = BTL_programPage(arguments[0], BTL_readWord(&arguments[1]));
+			break;
+
+		case BTL_OP_VERIFY:
+			if(argumentLength != 5)
+				status = BTL_ERR_LENGTH;
+			else if((arguments[0] == 0) || (arguments[0] > BOOT_APP_PAGES))
+				status = BTL_ERR_PAGE;
+			else
+				status = BTL_verifyImage(arguments[0], BTL_readWord(&arguments[1]));
+			break;
+
+		case BTL_OP_RUN:
+			bootloader.run = true;
+			break;
+
+		default:
+			status = BTL_ERR_OP;
+			break;
+	}
+
+	response[2] = status;
+	FRM_sendFrame(FRM_TYPE_BOOT_RESPONSE, response, size);
+
+	return;
+} // END BTL_handleRequest()
+
+/***************************************************************
+ * Function:	bool BTL_receiveFrameByte(uint8_t byte)
+ *
+ * Purpose:		To collect a binary frame from the host and pass
+ * 					a request to BTL_handleRequest().  Text, broken
+ * 					frames and other types are dropped; the host
+ * 					times out and retries.
+ *
+ * Parameters:	uint8_t byte
+ *
+ * Returns:		true when the frame ended and was handled
+ *
+ * Globals affected:	bootloader
+ **************************************************************/
+bool
+BTL_receiveFrameByte(uint8_t byte)
+{
+	uint8_t raw[FRM_MAX_ENCODED - 2];
+	int16_t length;
+
+	if(byte != FRM_DELIMITER)
+	{
+		// Anything outside a frame is ignored
+		if(bootloader.inFrame)
+		{
+			if(bootloader.frameLength < sizeof(bootloader.frame))
+				bootloader.frame[bootloader.frameLength++] = byte;
+			else
+				bootloader.frameOverflow = true;
+		}
+
+		return false;
+	}
+
+	// An opening delimiter, or back to back ones between frames
+	if(!bootloader.inFrame || (bootloader.frameLength == 0))
+	{
+		bootloader.inFrame = true;
+		bootloader.frameLength = 0;
+		bootloader.frameOverflow = false;
+		return false;
+	}
+
+	bootloader.inFrame = false;
+	if(bootloader.frameOverflow)
+	{
+		return false;
+	}
+
+	length = FRM_unpackFrame(bootloader.frame, bootloader.frameLength, raw);
+	if((length < 0) || (raw[0] != FRM_TYPE_BOOT_REQUEST))
+	{
+		return false;
+	}
+
+	BTL_handleRequest(&raw[1], length);
+
+	return true;
+} // END BTL_receiveFrameByte()
+
+/***************************************************************
+ * Function:	uint8_t BTL_programPage(uint8_t page, uint32_t crc)
+ *
+ * Purpose:		To program the page buffer into one page of the
+ * 					image, and to clear the buffer for the next.
+ * 					A page that already holds the data is left
+ * 					alone, so a retried request costs no erase.
+ *
+ * Parameters:	uint8_t page		0 to BOOT_APP_PAGES - 1
+ * 				uint32_t crc		of the page buffer
+ *
+ * Returns:		_BTL_status
+ *
+ * Globals affected:	bootloader.page, flash
+ **************************************************************/
+uint8_t
+BTL_programPage(uint8_t page, uint32_t crc)
+{
+	uint32_t address = BOOT_APP_ADDRESS + (page * BOOT_PAGE_SIZE);
+	_BOOT_record record;
+
+	if(BFL_crc(bootloader.page, BTL_PAGE_WORDS) != crc)
+	{
+		return BTL_ERR_CRC;
+	}
+
+	if(BFL_crcFlash(address, BTL_PAGE_WORDS) != crc)
+	{
+		// The image is no longer the verified one
+		if(BTL_readRecord(&record) && !BFL_erasePage(BOOT_RECORD_ADDRESS))
+		{
+			return BTL_ERR_FLASH;
+		}
+
+		if(!BFL_erasePage(address)
+				|| !BFL_programWords(address, bootloader.page, BTL_PAGE_WORDS)
+				|| (BFL_crcFlash(address, BTL_PAGE_WORDS) != crc))
+		{
+			return BTL_ERR_FLASH;
+		}
+	}
+
+	memset(bootloader.page, 0xFF, sizeof(bootloader.page));
+
+	return BTL_OK;
+} // END BTL_programPage()
+
+/***************************************************************
+ * Function:	uint8_t BTL_verifyImage(uint8_t pages, uint32_t crc)
+ *
+ * Purpose:		To check the whole image and record it as the
+ * 					one to start
+ *
+ * Parameters:	uint8_t pages		image length in pages
+ * 				uint32_t crc		of those pages
+ *
+ * Returns:		_BTL_status
+ *
+ * Globals affected:	flash
+ **************************************************************/
+uint8_t
+BTL_verifyImage(uint8_t pages, uint32_t crc)
+{
+	_BOOT_record record;
+	uint32_t stack = BFL_readWord(BOOT_APP_ADDRESS);
+
+	if(BFL_crcFlash(BOOT_APP_ADDRESS, pages * BTL_PAGE_WORDS) != crc)
+	{
+		return BTL_ERR_CRC;
+	}
+
+	if((stack <= BOOT_RAM_START) || (stack > BOOT_RAM_END))
+	{
+		return BTL_ERR_IMAGE;
+	}
+
+	record.magic = BOOT_RECORD_MAGIC;
+	record.pages = pages;
+	record.crc = crc;
+	record.check = ~crc;
+
+	if(!BFL_erasePage(BOOT_RECORD_ADDRESS)
+			|| !BFL_programWords(BOOT_RECORD_ADDRESS, (const uint32_t *)&record,
+					sizeof(record) / sizeof(uint32_t)))
+	{
+		return BTL_ERR_FLASH;
+	}
+
+	return BTL_OK;
+} // END BTL_verifyImage()
+
+/***************************************************************
+ * Function:	bool BTL_readRecord(_BOOT_record *record)
+ *
+ * Purpose:		To read the image record
+ *
+ * Parameters:	_BOOT_record *record
+ *
+ * Returns:		true when it is intact
+ *
+ * Globals affected:	none
+ **************************************************************/
+bool
+BTL_readRecord(_BOOT_record *record)
+{
+	record->magic = BFL_readWord(BOOT_RECORD_ADDRESS);
+	record->pages = BFL_readWord(BOOT_RECORD_ADDRESS + 4);
+	record->crc = BFL_readWord(BOOT_RECORD_ADDRESS + 8);
+	record->check = BFL_readWord(BOOT_RECORD_ADDRESS + 12);
+
+	return (record->magic == BOOT_RECORD_MAGIC) && (record->check == ~record->crc)
+			&& (record->pages != 0) && (record->pages <= BOOT_APP_PAGES);
+} // END BTL_readRecord()
+
+uint32_t
+BTL_readWord(const uint8_t *data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8)
+		| ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void
+BTL_writeWord(uint8_t *data, uint32_t value)
+{
+	data[0] = (uint8_t)value;
+	data[1] = (uint8_t)(value >> 8);
+	data[2] = (uint8_t)(value >> 16);
+	data[3] = (uint8_t)(value >> 24);
+	return;
+}
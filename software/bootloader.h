@@ -0,0 +1,75 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef BOOTLOADER_H
+#define BOOTLOADER_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Firmware update protocol of the bootloader, see boot.h for the flash
+ *	map.  One FRM_TYPE_BOOT_REQUEST frame from the host gets one
+ *	FRM_TYPE_BOOT_RESPONSE frame back, except BTL_OP_WRITE, which is
+ *	streamed without one.  All fields little-endian; pages count from
+ *	BOOT_APP_ADDRESS.
+ *
+ *	request:	seq u8 | op u8 | arguments
+ *	response:	seq u8 | op u8 | status u8 | data
+ *
+ *	BTL_OP_INFO		-					version u8 | pageSize u16 | appPages u8 |
+ *										imagePages u8 | imageCrc u32
+ *										(imagePages 0 without a verified image)
+ *	BTL_OP_CRCS		first u8 | count u8	crc u32 of each page, count at most
+ *										BTL_MAX_CRCS
+ *	BTL_OP_WRITE	offset u16 | data	copied into the page buffer
+ *	BTL_OP_PROGRAM	page u8 | crc u32	-
+ *	BTL_OP_VERIFY	pages u8 | crc u32	-
+ *	BTL_OP_RUN		-					-, then the application starts
+ *
+ * The host pads its image with 0xFF to whole pages, compares the page
+ *	CRCs and only sends the pages that differ: WRITEs fill the page
+ *	buffer, PROGRAM checks the buffer against crc (so a lost WRITE is
+ *	caught there) and erases and programs the page.  The first page
+ *	programmed erases the image record, so an interrupted update
+ *	leaves the drive in the bootloader; VERIFY checks the CRC of the
+ *	whole image and writes a new record.
+ */
+#define BTL_PROTOCOL_VERSION		1
+#define BTL_MAX_CRCS				15		// pages per BTL_OP_CRCS
+#define BTL_MAX_WRITE				56		// data bytes per BTL_OP_WRITE
+
+typedef enum
+{
+	BTL_OP_INFO,
+	BTL_OP_CRCS,
+	BTL_OP_WRITE,
+	BTL_OP_PROGRAM,
+	BTL_OP_VERIFY,
+	BTL_OP_RUN
+} _BTL_op;
+
+typedef enum
+{
+	BTL_OK,
+	BTL_ERR_OP,
+	BTL_ERR_LENGTH,
+	BTL_ERR_PAGE,
+	BTL_ERR_CRC,						// page buffer or image does not match crc
+	BTL_ERR_FLASH,						// erase or program failed
+	BTL_ERR_IMAGE						// no valid vector table
+} _BTL_status;
+
+void BTL_initBootloader(void);
+void BTL_process(void);
+bool BTL_isRunRequested(void);
+bool BTL_isImageValid(void);
+void BTL_handleRequest(const uint8_t *request, uint16_t length);
+
+#endif
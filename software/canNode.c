@@ -0,0 +1,291 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* User-generated libs */
+#include "canNode.h"
+#include "canPort.h"
+#include "adc.h"
+#include "fault.h"
+#include "milliSecTimer.h"
+#include "motor.h"
+
+/* Global variables */
+typedef struct
+{
+	_CANN_config config;
+	bool started;
+
+	// Written by the CAN receive ISR, read by the main loop
+	volatile bool active;				// a setpoint has arrived
+	volatile uint16_t setpoint;
+	volatile uint32_t setpointTime;
+
+	bool timedOut;
+	uint32_t lastTelemetry;
+	uint32_t lastStatus;
+	uint16_t sequence;
+	uint32_t dropped;					// frames with no free mailbox
+} _canNode;
+
+_canNode canNode =
+{
+	.config = {.node = 1, .group = 0, .slot = 0, .timeoutMs = 100, .telemetryMs = 10, .statusMs = 100}
+};
+
+/* Private function declarations */
+void CANN_updateFilters(void);
+uint8_t CANN_getStatus(void);
+void CANN_put16(uint8_t *data, uint16_t value);
+
+/***************************************************************
+ * Function:	void CANN_initCanNode(void)
+ *
+ * Purpose:		To start the CAN port and accept the frames for
+ * 					the configured node and group
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	canNode
+ **************************************************************/
+void
+CANN_initCanNode(void)
+{
+	canNode.active = false;
+	canNode.timedOut = false;
+
+	CANP_initPort(CANN_BITRATE_KBPS);
+	canNode.started = true;
+	CANN_updateFilters();
+
+	return;
+} // END CANN_initCanNode()
+
+const _CANN_config*
+CANN_getConfig(void)
+{
+	return &canNode.config;
+}
+
+/***************************************************************
+ * Function:	bool CANN_configure(const _CANN_config *config)
+ *
+ * Purpose:		To change the node, group or message rates.  The
+ * 					filters follow a new node or group at once.
+ *
+ * Parameters:	const _CANN_config *config
+ *
+ * Returns:		false if a field is out of range; nothing changes
+ *
+ * Globals affected:	canNode.config, CAN filters
+ **************************************************************/
+bool
+CANN_configure(const _CANN_config *config)
+{
+	if((config->node == 0) || (config->node > CANN_MAX_NODE)
+			|| (config->group > CANN_MAX_GROUP) || (config->slot >= CANN_GROUP_SLOTS))
+	{
+		return false;
+	}
+
+	canNode.config = *config;
+	CANN_updateFilters();
+
+	return true;
+} // END CANN_configure()
+
+/***************************************************************
+ * Function:	bool CANN_getSpeedDemand(uint16_t *speedDemand)
+ *
+ * Purpose:		To get the duty demand received over CAN
+ *
+ * Parameters:	uint16_t *speedDemand	set while CAN is in control
+ *
+ * Returns:		true once a setpoint has arrived, until the
+ * 					setpoint timeout expires; the demand is then 0
+ *
+ * Globals affected:	canNode.timedOut
+ **************************************************************/
+bool
+CANN_getSpeedDemand(uint16_t *speedDemand)
+{
+	uint16_t timeoutMs = canNode.config.timeoutMs;
+
+	if(!canNode.active)
+	{
+		return false;
+	}
+
+	canNode.timedOut = (timeoutMs != 0)
+			&& ((MSTMR_getMilliSeconds() - canNode.setpointTime) > timeoutMs);
+
+	*speedDemand = canNode.timedOut ? 0 : canNode.setpoint;
+
+	return !canNode.timedOut;
+} // END CANN_getSpeedDemand()
+
+/***************************************************************
+ * Function:	void CANN_process(uint32_t now)
+ *
+ * Purpose:		To send the telemetry and status frames when due.
+ * 					A frame that finds no free mailbox is dropped
+ * 					and counted; the next period sends fresh data.
+ *
+ * Parameters:	uint32_t now		milliseconds
+ *
+ * Returns:		none
+ *
+ * Globals affected:	canNode
+ **************************************************************/
+void
+CANN_process(uint32_t now)
+{
+	uint8_t data[8];
+
+	if(!canNode.started)
+	{
+		return;
+	}
+
+	if((canNode.config.telemetryMs != 0) && ((now - canNode.lastTelemetry) >= canNode.config.telemetryMs))
+	{
+		canNode.lastTelemetry = now;
+
+		CANN_put16(&data[0], MOT_getDutyCycle());
+		CANN_put16(&data[2], ADC_getVoltage(ADC_V_BUS));
+		CANN_put16(&data[4], ADC_getVoltage(ADC_I_BUS));
+		CANN_put16(&data[6], canNode.sequence++);
+
+		if(!CANP_transmit(CANN_ID_TELEMETRY + canNode.config.node, data, 8))
+		{
+			canNode.dropped++;
+		}
+	}
+
+	if((canNode.config.statusMs != 0) && ((now - canNode.lastStatus) >= canNode.config.statusMs))
+	{
+		canNode.lastStatus = now;
+
+		data[0] = MOT_getMotorState();
+		data[1] = (uint8_t)MOT_getSector();
+		data[2] = CANN_getStatus();
+
+		if(!CANP_transmit(CANN_ID_STATUS + canNode.config.node, data, 3))
+		{
+			canNode.dropped++;
+		}
+	}
+
+	return;
+} // END CANN_process()
+
+uint32_t
+CANN_getDropped(void)
+{
+	return canNode.dropped;
+}
+
+/***************************************************************
+ * Function:	void CANN_receive(uint16_t id, const uint8_t *data,
+ * 						uint8_t length)
+ *
+ * Purpose:		To take a setpoint from an accepted frame.  Runs
+ * 					in the CAN receive ISR; frames that are too
+ * 					short are ignored.
+ *
+ * Parameters:	uint16_t id
+ * 				const uint8_t *data
+ * 				uint8_t length
+ *
+ * Returns:		none
+ *
+ * Globals affected:	canNode.setpoint, canNode.setpointTime, canNode.active
+ **************************************************************/
+void
+CANN_receive(uint16_t id, const uint8_t *data, uint8_t length)
+{
+	uint8_t offset;
+
+	if(id == CANN_ID_STOP)
+	{
+		canNode.setpoint = 0;
+	}
+	else if(id == (CANN_ID_GROUP + canNode.config.group))
+	{
+		offset = canNode.config.slot * 2;
+		if(length < (offset + 2))
+		{
+			return;
+		}
+
+		canNode.setpoint = data[offset] | (data[offset + 1] << 8);
+	}
+	else if(id == (CANN_ID_SETPOINT + canNode.config.node))
+	{
+		if(length < 2)
+		{
+			return;
+		}
+
+		canNode.setpoint = data[0] | (data[1] << 8);
+	}
+	else
+	{
+		return;
+	}
+
+	canNode.setpointTime = MSTMR_getMilliSeconds();
+	canNode.active = true;
+
+	return;
+} // END CANN_receive()
+
+void
+CANN_updateFilters(void)
+{
+	uint16_t ids[CANP_FILTER_IDS];
+
+	if(!canNode.started)
+	{
+		return;
+	}
+
+	ids[0] = CANN_ID_STOP;
+	ids[1] = CANN_ID_GROUP + canNode.config.group;
+	ids[2] = CANN_ID_SETPOINT + canNode.config.node;
+	ids[3] = CANN_ID_SETPOINT + canNode.config.node;
+	CANP_setFilters(ids);
+
+	return;
+}
+
+uint8_t
+CANN_getStatus(void)
+{
+	uint8_t status = 0;
+
+	if(FLT_isSafeMode())
+		status |= CANN_STATUS_SAFE_MODE;
+	if(FLT_hasRecord())
+		status |= CANN_STATUS_FAULT_RECORD;
+	if(canNode.active && !canNode.timedOut)
+		status |= CANN_STATUS_IN_CONTROL;
+	if(canNode.timedOut)
+		status |= CANN_STATUS_TIMED_OUT;
+
+	return status;
+}
+
+void
+CANN_put16(uint8_t *data, uint16_t value)
+{
+	data[0] = (uint8_t)value;
+	data[1] = (uint8_t)(value >> 8);
+	return;
+}
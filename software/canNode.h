@@ -0,0 +1,75 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef CANNODE_H
+#define CANNODE_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+// bxCAN and USB share the 512-byte packet memory and cannot run at
+//	the same time: a CAN build starts the CAN node instead of USB
+#ifndef CANN_ENABLED
+#define CANN_ENABLED				0
+#endif
+
+#define CANN_BITRATE_KBPS			500
+
+/*
+ * CAN protocol, standard ids, little-endian data; a lower id wins
+ *	arbitration
+ *
+ *	CANN_ID_STOP				all drives: duty demand 0 until the next setpoint
+ *	CANN_ID_GROUP + group		4 x u16 duty setpoints, one per slot, so
+ *								four drives update from one frame
+ *	CANN_ID_SETPOINT + node		u16 duty setpoint
+ *	CANN_ID_TELEMETRY + node	duty u16 | vBus u16 | iBus u16 | sequence u16
+ *	CANN_ID_STATUS + node		state u8 | sector i8 | CANN_STATUS_* u8
+ *
+ * The first three are the only ids the hardware filters let in.  A
+ *	drive takes its demand from CAN once a setpoint has arrived; if
+ *	none arrives for timeoutMs CAN goes stale and the next source in
+ *	the demand order (demand.h) takes over.
+ */
+#define CANN_ID_STOP				0x000
+#define CANN_ID_GROUP				0x100
+#define CANN_ID_SETPOINT			0x200
+#define CANN_ID_TELEMETRY			0x300
+#define CANN_ID_STATUS				0x380
+
+#define CANN_MAX_NODE				127
+#define CANN_MAX_GROUP				15
+#define CANN_GROUP_SLOTS			4
+
+#define CANN_STATUS_SAFE_MODE		0x01
+#define CANN_STATUS_FAULT_RECORD	0x02
+#define CANN_STATUS_IN_CONTROL		0x04
+#define CANN_STATUS_TIMED_OUT		0x08
+
+typedef struct
+{
+	uint8_t node;						// 1-CANN_MAX_NODE
+	uint8_t group;						// 0-CANN_MAX_GROUP
+	uint8_t slot;						// 0-3, setpoint used from a group frame
+	uint16_t timeoutMs;					// 0 disables the setpoint timeout
+	uint16_t telemetryMs;				// period of the telemetry frame, 0 off
+	uint16_t statusMs;					// period of the status frame, 0 off
+} _CANN_config;
+
+void CANN_initCanNode(void);
+const _CANN_config* CANN_getConfig(void);
+bool CANN_configure(const _CANN_config *config);
+bool CANN_getSpeedDemand(uint16_t *speedDemand);
+void CANN_process(uint32_t now);
+uint32_t CANN_getDropped(void);
+
+// Called by the CAN port for every accepted frame
+void CANN_receive(uint16_t id, const uint8_t *data, uint8_t length);
+
+#endif
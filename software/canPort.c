@@ -0,0 +1,166 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <string.h>
+#include "stm32f10x.h"
+#include "stm32f10x_can.h"
+#include "stm32f10x_gpio.h"
+#include "stm32f10x_rcc.h"
+
+/* User-generated libs */
+#include "canPort.h"
+#include "canNode.h"
+#include "gpio.h"
+#include "perfMon.h"
+#include "pinMap.h"
+
+// 18 time quanta per bit, sampled at 15/18 (83%)
+#define CANP_QUANTA_PER_BIT		18
+
+/***************************************************************
+ * Function:	void CANP_initPort(uint16_t bitrateKbps)
+ *
+ * Purpose:		To start bxCAN on PB8 (RX) and PB9 (TX), with
+ * 					all filtering done in hardware: only frames
+ * 					passed by CANP_setFilters() reach FIFO 1 and
+ * 					its interrupt.  FIFO 0 and the TX interrupt
+ * 					share their vectors with USB and are not used.
+ *
+ * Parameters:	uint16_t bitrateKbps		125, 250, 500 or 1000
+ *
+ * Returns:		none
+ *
+ * Globals affected:	CAN1, AFIO->MAPR
+ **************************************************************/
+void
+CANP_initPort(uint16_t bitrateKbps)
+{
+	CAN_InitTypeDef canInit;
+	uint16_t filterReject[CANP_FILTER_IDS] = {0x7FF, 0x7FF, 0x7FF, 0x7FF};
+
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_CAN1, ENABLE);
+
+	// PA11/PA12 belong to USB, so CAN is remapped
+	GPIO_PinRemapConfig(GPIO_Remap1_CAN1, ENABLE);
+	GPIO_pinSetup(PIN_CAN_RX_PORT, PIN_CAN_RX_PIN, GPIO_INPUT_PU_OR_PD);
+	GPIO_setPins(PIN_CAN_RX_GPIO, 1 << PIN_CAN_RX_PIN);		// pull-up
+	GPIO_pinSetup(PIN_CAN_TX_PORT, PIN_CAN_TX_PIN, GPIO_OUTPUT_ALT_PP);
+
+	// APB1 @36MHz
+	CAN_StructInit(&canInit);
+	canInit.CAN_ABOM = ENABLE;								// recover from bus-off
+	canInit.CAN_TXFP = ENABLE;								// send in request order
+	canInit.CAN_SJW = CAN_SJW_1tq;
+	canInit.CAN_BS1 = CAN_BS1_14tq;
+	canInit.CAN_BS2 = CAN_BS2_3tq;
+	canInit.CAN_Prescaler = 36000 / (CANP_QUANTA_PER_BIT * (uint32_t)bitrateKbps);
+	CAN_Init(CAN1, &canInit);
+
+	CANP_setFilters(filterReject);
+
+	CAN_ITConfig(CAN1, CAN_IT_FMP1, ENABLE);
+	NVIC_SetPriority(CAN1_RX1_IRQn, 8);
+	NVIC_EnableIRQ(CAN1_RX1_IRQn);
+
+	return;
+} // END CANP_initPort()
+
+/***************************************************************
+ * Function:	void CANP_setFilters(const uint16_t ids[CANP_FILTER_IDS])
+ *
+ * Purpose:		To accept exactly these standard ids into FIFO 1
+ *
+ * Parameters:	const uint16_t ids[]		repeat an id to fill unused slots
+ *
+ * Returns:		none
+ *
+ * Globals affected:	CAN1 filter bank 0
+ **************************************************************/
+void
+CANP_setFilters(const uint16_t ids[CANP_FILTER_IDS])
+{
+	CAN_FilterInitTypeDef filterInit;
+
+	// 16-bit filter format: STID[10:0] RTR IDE EXID[17:15]
+	filterInit.CAN_FilterNumber = 0;
+	filterInit.CAN_FilterMode = CAN_FilterMode_IdList;
+	filterInit.CAN_FilterScale = CAN_FilterScale_16bit;
+	filterInit.CAN_FilterIdLow = ids[0] << 5;
+	filterInit.CAN_FilterMaskIdLow = ids[1] << 5;
+	filterInit.CAN_FilterIdHigh = ids[2] << 5;
+	filterInit.CAN_FilterMaskIdHigh = ids[3] << 5;
+	filterInit.CAN_FilterFIFOAssignment = CAN_Filter_FIFO1;
+	filterInit.CAN_FilterActivation = ENABLE;
+	CAN_FilterInit(&filterInit);
+
+	return;
+} // END CANP_setFilters()
+
+/***************************************************************
+ * Function:	bool CANP_transmit(uint16_t id, const uint8_t *data,
+ * 						uint8_t length)
+ *
+ * Purpose:		To queue a data frame in a free TX mailbox
+ *
+ * Parameters:	uint16_t id		standard id
+ * 				const uint8_t *data
+ * 				uint8_t length	0-8
+ *
+ * Returns:		false when all three mailboxes are busy
+ *
+ * Globals affected:	CAN1 TX mailboxes
+ **************************************************************/
+bool
+CANP_transmit(uint16_t id, const uint8_t *data, uint8_t length)
+{
+	CanTxMsg message;
+
+	message.StdId = id;
+	message.ExtId = 0;
+	message.IDE = CAN_Id_Standard;
+	message.RTR = CAN_RTR_Data;
+	message.DLC = length;
+	memcpy(message.Data, data, length);
+
+	return CAN_Transmit(CAN1, &message) != CAN_TxStatus_NoMailBox;
+} // END CANP_transmit()
+
+/***************************************************************
+ * Function:	void CAN1_RX1_IRQHandler(void)
+ *
+ * Purpose:		To hand every frame in FIFO 1 to CANN_receive()
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	CAN1 FIFO 1
+ **************************************************************/
+void
+CAN1_RX1_IRQHandler(void)
+{
+	CanRxMsg message;
+
+	PERF_isrEnter();
+
+	while(CAN_MessagePending(CAN1, CAN_FIFO1) > 0)
+	{
+		CAN_Receive(CAN1, CAN_FIFO1, &message);
+
+		if((message.IDE == CAN_Id_Standard) && (message.RTR == CAN_RTR_Data))
+		{
+			CANN_receive(message.StdId, message.Data, message.DLC);
+		}
+	}
+
+	PERF_isrExit();
+
+	return;
+} // END CAN1_RX1_IRQHandler()
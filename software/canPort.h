@@ -0,0 +1,28 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef CANPORT_H
+#define CANPORT_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * The CAN controller as seen by canNode.c: standard 11-bit data frames
+ *	only.  canPort.c drives bxCAN; the host simulator in tools/canSim
+ *	implements the same calls on Linux SocketCAN.  Accepted frames are
+ *	passed to CANN_receive(), from the receive interrupt on the drive.
+ */
+#define CANP_FILTER_IDS				4		// one filter bank in 16-bit list mode
+
+void CANP_initPort(uint16_t bitrateKbps);
+void CANP_setFilters(const uint16_t ids[CANP_FILTER_IDS]);
+bool CANP_transmit(uint16_t id, const uint8_t *data, uint8_t length);
+
+#endif
@@ -0,0 +1,1143 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <stdio.h>
+#include <string.h>
+#include "stm32f10x.h"
+#include "buffer.h"
+#include "hw_config.h"
+
+/* User-generated libs */
+#include "boot.h"
+#include "cli.h"
+#include "demand.h"
+#include "fault.h"
+#include "frame.h"
+#include "memMon.h"
+#include "motor.h"
+#include "motorProfile.h"
+#include "param.h"
+#include "paramStore.h"
+#include "perfMon.h"
+#include "rcPwm.h"
+#include "scope.h"
+#include "telemetry.h"
+#include "uart.h"
+
+#define CLI_PROMPT			"> "
+
+EXTERN_BUFFER(USB_RX, 256);
+EXTERN_BUFFER(USB_TX, 512);
+
+/* Global variables */
+typedef struct
+{
+	// The line is split into words while it is typed: separators are
+	//	stored as '\0' and each word's start is kept in wordStart
+	char line[CLI_MAX_LINE + 1];
+	uint8_t length;
+	uint8_t wordStart[CLI_MAX_ARGS];
+	uint8_t wordCount;
+	bool overflow;
+	uint8_t lastByte;
+
+	// A 0x00 switches from text to a binary frame, which runs to the
+	//	next 0x00; text never contains 0x00
+	uint8_t frame[FRM_MAX_ENCODED - 2];
+	uint8_t frameLength;
+	bool inFrame;
+	bool frameOverflow;
+
+	bool overrideActive;
+	uint16_t overrideDemand;
+} _cli;
+
+_cli cli;
+
+/* Private function declarations */
+void CLI_receiveByte(uint8_t byte);
+bool CLI_receiveFrameByte(uint8_t byte);
+void CLI_echo(const char *text, uint16_t length);
+void CLI_clearLine(void);
+void CLI_executeLine(void);
+const _CLI_command* CLI_findCommand(const char *name);
+void CLI_printParam(uint8_t id);
+bool CLI_parseNumber(const char *text, bool allowSign, _CLI_arg *value);
+int8_t CLI_parseOnOff(const char *text);
+int8_t CLI_findName(const char *text, const char *const *names, uint8_t count);
+
+void CLI_boot(uint8_t argc, const _CLI_arg *argv);
+void CLI_duty(uint8_t argc, const _CLI_arg *argv);
+void CLI_fault(uint8_t argc, const _CLI_arg *argv);
+void CLI_get(uint8_t argc, const _CLI_arg *argv);
+void CLI_help(uint8_t argc, const _CLI_arg *argv);
+void CLI_mem(uint8_t argc, const _CLI_arg *argv);
+void CLI_motor(uint8_t argc, const _CLI_arg *argv);
+void CLI_perf(uint8_t argc, const _CLI_arg *argv);
+void CLI_profile(uint8_t argc, const _CLI_arg *argv);
+void CLI_rc(uint8_t argc, const _CLI_arg *argv);
+void CLI_reset(uint8_t argc, const _CLI_arg *argv);
+void CLI_scope(uint8_t argc, const _CLI_arg *argv);
+void CLI_set(uint8_t argc, const _CLI_arg *argv);
+void CLI_stop(uint8_t argc, const _CLI_arg *argv);
+void CLI_store(uint8_t argc, const _CLI_arg *argv);
+void CLI_tlm(uint8_t argc, const _CLI_arg *argv);
+void CLI_uart(uint8_t argc, const _CLI_arg *argv);
+void CLI_usb(uint8_t argc, const _CLI_arg *argv);
+
+// Sorted by name for the binary search in CLI_findCommand(),
+//	checked by CLI_initCli()
+const _CLI_command cliCommands[] =
+{
+	{"boot",	CLI_boot,	"",		0,	"restart into the bootloader for a firmware update"},
+	{"duty",	CLI_duty,	"u",	1,	"<0-65535> override the RC duty demand"},
+	{"fault",	CLI_fault,	"w",	0,	"[clear] show or clear the fault record"},
+	{"get",		CLI_get,	"w",	0,	"[param] read one or all parameters"},
+	{"help",	CLI_help,	"w",	0,	"[command] list commands or show usage"},
+	{"mem",		CLI_mem,	"",		0,	"RAM and stack usage"},
+	{"motor",	CLI_motor,	"",		0,	"motor state, sector and duty"},
+	{"perf",	CLI_perf,	"w",	0,	"[on|off] jitter/CPU load report"},
+	{"profile",	CLI_profile,"w",	0,	"[name] list the motor profiles, or switch to one while stopped"},
+	{"rc",		CLI_rc,		"w",	0,	"[cal|save|cancel] return the duty demand to RC input, or learn its endpoints"},
+	{"reset",	CLI_reset,	"",		0,	"warm restart"},
+	{"scope",	CLI_scope,	"wwwww",0,	"[arm|stop|fire|dump|ch <ch>..|trig <type> [ch] [level]|pre <n>|dec <n>]"},
+	{"set",		CLI_set,	"ww",	2,	"<param> <value> write a parameter, stored once the motor is idle"},
+	{"stop",	CLI_stop,	"",		0,	"override the duty demand with 0"},
+	{"store",	CLI_store,	"w",	0,	"[clear] parameter store state, or forget the stored values"},
+	{"tlm",		CLI_tlm,	"wu",	0,	"[on|off] [decimation] binary telemetry"},
+	{"uart",	CLI_uart,	"",		0,	"UART link state and dropped bytes"},
+	{"usb",		CLI_usb,	"",		0,	"USB IN throughput"},
+};
+
+#define CLI_COMMAND_COUNT	(sizeof(cliCommands) / sizeof(cliCommands[0]))
+
+// Indexed by _SCP_channel, _SCP_triggerType and _SCP_status
+const char *const scopeChannelNames[SCP_CH_COUNT] = {"a", "b", "c", "vbus", "ibus", "duty", "sector", "state"};
+const char *const scopeTriggerNames[SCP_TRIG_COUNT] = {"manual", "rising", "falling", "state", "fault"};
+const char *const scopeStatusNames[] = {"idle", "armed", "triggered", "done"};
+
+/***************************************************************
+ * Function:	void CLI_initCli(void)
+ *
+ * Purpose:		To initialize the command-line interface on the
+ * 					USB serial link (or the UART, see uart.h).
+ * 					Traps if the command table is
+ * 					not sorted, as lookups would silently fail.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	cli
+ **************************************************************/
+void
+CLI_initCli(void)
+{
+	uint8_t i;
+
+	for(i = 1; i < CLI_COMMAND_COUNT; i++)
+	{
+		if(strcmp(cliCommands[i - 1].name, cliCommands[i].name) >= 0)
+		{
+			FLT_trap(FLT_TRAP_CLI_TABLE);
+		}
+	}
+
+	CLI_clearLine();
+	cli.lastByte = 0;
+	cli.inFrame = false;
+	cli.overrideActive = false;
+	cli.overrideDemand = 0;
+
+	return;
+} // END CLI_initCli()
+
+/***************************************************************
+ * Function:	void CLI_process(void)
+ *
+ * Purpose:		To handle bytes received on the USB link.  Call
+ * 					from the main loop; at most CLI_BYTES_PER_PASS
+ * 					bytes are handled per call so that a long paste
+ * 					cannot stall the loop.  Nothing is read while
+ * 					USB_TX could not take a reply frame, and a pass
+ * 					ends after each binary request, so the host is
+ * 					held back (EP3 NAKs) instead of replies dropped.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	cli, USB_RX
+ **************************************************************/
+void
+CLI_process(void)
+{
+	_BUFFER_spans spans;
+	uint16_t count;
+	uint16_t used = 0;
+	bool replied = false;
+	uint8_t byte;
+	uint8_t s;
+	uint16_t i;
+
+	if(BUFFER_FREE_SPACE(USB_TX) < FRM_MAX_ENCODED)
+	{
+		return;
+	}
+
+	count = USB_RX_Peek(&spans, CLI_BYTES_PER_PASS);
+	if(count == 0)
+	{
+		return;
+	}
+
+	for(s = 0; (s < 2) && !replied; s++)
+	{
+		for(i = 0; (i < spans.span[s].length) && !replied; i++)
+		{
+			byte = spans.span[s].data[i];
+			used++;
+
+			if(cli.inFrame || (byte == FRM_DELIMITER))
+				replied = CLI_receiveFrameByte(byte);
+			else
+				CLI_receiveByte(byte);
+		}
+	}
+
+	USB_RX_Consume(used);
+	EP3_ResumeRx();
+	Handle_USBAsynchXfer();
+
+	return;
+} // END CLI_process()
+
+/***************************************************************
+ * Function:	bool CLI_getSpeedDemand(uint16_t *speedDemand)
+ *
+ * Purpose:		To get the duty demand set with "duty" or "stop"
+ *
+ * Parameters:	uint16_t *speedDemand	set when the CLI overrides
+ *
+ * Returns:		true while the CLI overrides the RC input
+ *
+ * Globals affected:	none
+ **************************************************************/
+bool
+CLI_getSpeedDemand(uint16_t *speedDemand)
+{
+	if(cli.overrideActive)
+	{
+		*speedDemand = cli.overrideDemand;
+	}
+
+	return cli.overrideActive;
+} // END CLI_getSpeedDemand()
+
+/***************************************************************
+ * Function:	void CLI_receiveByte(uint8_t byte)
+ *
+ * Purpose:		To add one received byte to the line, splitting
+ * 					words as they arrive, and execute the line on
+ * 					CR or LF
+ *
+ * Parameters:	uint8_t byte
+ *
+ * Returns:		none
+ *
+ * Globals affected:	cli
+ **************************************************************/
+void
+CLI_receiveByte(uint8_t byte)
+{
+	uint8_t previous = cli.lastByte;
+	cli.lastByte = byte;
+
+	if((byte == '\r') || (byte == '\n'))
+	{
+		// CR LF is one line end
+		if((byte == '\n') && (previous == '\r'))
+		{
+			return;
+		}
+
+		CLI_echo("\r\n", 2);
+		CLI_executeLine();
+		CLI_clearLine();
+		CLI_echo(CLI_PROMPT, sizeof(CLI_PROMPT) - 1);
+	}
+	else if((byte == '\b') || (byte == 0x7F))
+	{
+		if(cli.length == 0)
+		{
+			return;
+		}
+
+		cli.length--;
+
+		// Removing the first character of a word removes the word
+		if((cli.wordCount > 0) && (cli.wordStart[cli.wordCount - 1] == cli.length))
+		{
+			cli.wordCount--;
+		}
+
+		cli.line[cli.length] = '\0';
+		CLI_echo("\b \b", 3);
+	}
+	else if((byte == ' ') || (byte == '\t'))
+	{
+		// Collapse repeated separators
+		if((cli.length == 0) || (cli.line[cli.length - 1] == '\0'))
+		{
+			return;
+		}
+
+		if(cli.length >= CLI_MAX_LINE)
+		{
+			cli.overflow = true;
+			return;
+		}
+
+		cli.line[cli.length++] = '\0';
+		CLI_echo(" ", 1);
+	}
+	else if((byte > ' ') && (byte < 0x7F))
+	{
+		if(cli.length >= CLI_MAX_LINE)
+		{
+			cli.overflow = true;
+			return;
+		}
+
+		if((cli.length == 0) || (cli.line[cli.length - 1] == '\0'))
+		{
+			if(cli.wordCount >= CLI_MAX_ARGS)
+			{
+				cli.overflow = true;
+				return;
+			}
+
+			cli.wordStart[cli.wordCount++] = cli.length;
+		}
+
+		cli.line[cli.length++] = (char)byte;
+		CLI_echo((const char *)&byte, 1);
+	}
+
+	return;
+} // END CLI_receiveByte()
+
+/***************************************************************
+ * Function:	bool CLI_receiveFrameByte(uint8_t byte)
+ *
+ * Purpose:		To collect a binary frame from the host and pass
+ * 					a parameter request to PRM_handleRequest().
+ * 					Broken frames and other types are dropped; the
+ * 					host times out and retries.
+ *
+ * Parameters:	uint8_t byte
+ *
+ * Returns:		true when the frame ended and was handled
+ *
+ * Globals affected:	cli
+ **************************************************************/
+bool
+CLI_receiveFrameByte(uint8_t byte)
+{
+	uint8_t raw[FRM_MAX_ENCODED - 2];
+	int16_t length;
+
+	if(byte != FRM_DELIMITER)
+	{
+		if(cli.frameLength < sizeof(cli.frame))
+			cli.frame[cli.frameLength++] = byte;
+		else
+			cli.frameOverflow = true;
+
+		return false;
+	}
+
+	// An opening delimiter, or back to back ones between frames
+	if(!cli.inFrame || (cli.frameLength == 0))
+	{
+		cli.inFrame = true;
+		cli.frameLength = 0;
+		cli.frameOverflow = false;
+		return false;
+	}
+
+	cli.inFrame = false;
+	if(cli.frameOverflow)
+	{
+		return false;
+	}
+
+	length = FRM_unpackFrame(cli.frame, cli.frameLength, raw);
+	if((length < 0) || (raw[0] != FRM_TYPE_PARAM_REQUEST))
+	{
+		return false;
+	}
+
+	PRM_handleRequest(&raw[1], length);
+
+	return true;
+} // END CLI_receiveFrameByte()
+
+void
+CLI_echo(const char *text, uint16_t length)
+{
+	USB_TX_Put((const uint8_t *)text, length);
+	return;
+}
+
+void
+CLI_clearLine(void)
+{
+	memset(cli.line, 0, sizeof(cli.line));
+	cli.length = 0;
+	cli.wordCount = 0;
+	cli.overflow = false;
+	return;
+}
+
+/***************************************************************
+ * Function:	void CLI_executeLine(void)
+ *
+ * Purpose:		To look up the command, convert its arguments to
+ * 					the types in its table entry and call it
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+CLI_executeLine(void)
+{
+	_CLI_arg argv[CLI_MAX_ARGS - 1];
+	const _CLI_command *command;
+	uint8_t argc;
+	uint8_t maxArgs;
+	uint8_t i;
+
+	if(cli.overflow)
+	{
+		printf("ERR line too long\r\n");
+		return;
+	}
+
+	if(cli.wordCount == 0)
+	{
+		return;
+	}
+
+	command = CLI_findCommand(&cli.line[cli.wordStart[0]]);
+	if(command == NULL)
+	{
+		printf("ERR unknown command, try help\r\n");
+		return;
+	}
+
+	argc = cli.wordCount - 1;
+	maxArgs = strlen(command->args);
+	if((argc < command->minArgs) || (argc > maxArgs))
+	{
+		printf("ERR usage: %s %s\r\n", command->name, command->help);
+		return;
+	}
+
+	for(i = 0; i < argc; i++)
+	{
+		const char *word = &cli.line[cli.wordStart[i + 1]];
+
+		switch(command->args[i])
+		{
+			case CLI_ARG_UNSIGNED:
+			case CLI_ARG_SIGNED:
+				if(!CLI_parseNumber(word, command->args[i] == CLI_ARG_SIGNED, &argv[i]))
+				{
+					printf("ERR bad number '%s'\r\n", word);
+					return;
+				}
+				break;
+
+			default:
+				argv[i].w = word;
+				break;
+		}
+	}
+
+	command->handler(argc, argv);
+
+	return;
+} // END CLI_executeLine()
+
+const _CLI_command*
+CLI_findCommand(const char *name)
+{
+	uint8_t low = 0;
+	uint8_t high = CLI_COMMAND_COUNT;
+
+	while(low < high)
+	{
+		uint8_t middle = (low + high) / 2;
+		int compare = strcmp(name, cliCommands[middle].name);
+
+		if(compare == 0)
+			return &cliCommands[middle];
+		else if(compare < 0)
+			high = middle;
+		else
+			low = middle + 1;
+	}
+
+	return NULL;
+}
+
+void
+CLI_printParam(uint8_t id)
+{
+	const _PRM_param *param = PRM_getParam(id);
+	uint32_t value;
+
+	PRM_read(id, &value);
+
+	switch(param->type)
+	{
+		case PRM_TYPE_I8:
+		case PRM_TYPE_I16:
+		case PRM_TYPE_I32:
+			printf("%s=%ld\r\n", param->name, (long)(int32_t)value);
+			break;
+
+		case PRM_TYPE_FLOAT:
+			printf("%s=0x%08lx (float)\r\n", param->name, (unsigned long)value);
+			break;
+
+		default:
+			printf("%s=%lu\r\n", param->name, (unsigned long)value);
+			break;
+	}
+
+	return;
+}
+
+/***************************************************************
+ * Function:	bool CLI_parseNumber(const char *text, bool allowSign,
+ * 						_CLI_arg *value)
+ *
+ * Purpose:		To convert a decimal or 0x-prefixed hex word
+ *
+ * Parameters:	const char *text
+ * 				bool allowSign		accept a leading '-'
+ * 				_CLI_arg *value		set to .u or .i
+ *
+ * Returns:		false if the word is not a number or overflows
+ *
+ * Globals affected:	none
+ **************************************************************/
+bool
+CLI_parseNumber(const char *text, bool allowSign, _CLI_arg *value)
+{
+	bool negative = false;
+	uint32_t base = 10;
+	uint32_t result = 0;
+	uint32_t digit;
+
+	if(allowSign && (*text == '-'))
+	{
+		negative = true;
+		text++;
+	}
+
+	if((text[0] == '0') && ((text[1] == 'x') || (text[1] == 'X')))
+	{
+		base = 16;
+		text += 2;
+	}
+
+	if(*text == '\0')
+	{
+		return false;
+	}
+
+	while(*text != '\0')
+	{
+		if((*text >= '0') && (*text <= '9'))
+			digit = *text - '0';
+		else if((base == 16) && (*text >= 'a') && (*text <= 'f'))
+			digit = *text - 'a' + 10;
+		else if((base == 16) && (*text >= 'A') && (*text <= 'F'))
+			digit = *text - 'A' + 10;
+		else
+			return false;
+
+		if(result > (0xFFFFFFFF - digit) / base)
+		{
+			return false;
+		}
+
+		result = result * base + digit;
+		text++;
+	}
+
+	if(allowSign)
+	{
+		if(result > (negative ? 0x80000000 : 0x7FFFFFFF))
+		{
+			return false;
+		}
+
+		value->i = negative ? (int32_t)(0 - result) : (int32_t)result;
+	}
+	else
+	{
+		value->u = result;
+	}
+
+	return true;
+} // END CLI_parseNumber()
+
+// Returns 1 for "on", 0 for "off", -1 for anything else
+int8_t
+CLI_parseOnOff(const char *text)
+{
+	if(strcmp(text, "on") == 0)
+		return 1;
+	else if(strcmp(text, "off") == 0)
+		return 0;
+	else
+		return -1;
+}
+
+// Returns the index of text in names, -1 if it is not there
+int8_t
+CLI_findName(const char *text, const char *const *names, uint8_t count)
+{
+	uint8_t i;
+
+	for(i = 0; i < count; i++)
+	{
+		if(strcmp(text, names[i]) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+/* Command handlers */
+void
+CLI_boot(uint8_t argc, const _CLI_arg *argv)
+{
+	BOOT_enterBootloader();
+}
+
+void
+CLI_duty(uint8_t argc, const _CLI_arg *argv)
+{
+	if(argv[0].u > 0xFFFF)
+	{
+		printf("ERR duty is 0-65535\r\n");
+		return;
+	}
+
+	cli.overrideDemand = (uint16_t)argv[0].u;
+	cli.overrideActive = true;
+	printf("OK\r\n");
+
+	return;
+}
+
+void
+CLI_fault(uint8_t argc, const _CLI_arg *argv)
+{
+	if(argc > 0)
+	{
+		if(strcmp(argv[0].w, "clear") != 0)
+		{
+			printf("ERR usage: fault [clear]\r\n");
+			return;
+		}
+
+		FLT_clearRecord();
+		printf("OK\r\n");
+	}
+	else if(FLT_hasRecord())
+	{
+		FLT_printRecord();
+	}
+	else
+	{
+		printf("no fault recorded\r\n");
+	}
+
+	return;
+}
+
+void
+CLI_get(uint8_t argc, const _CLI_arg *argv)
+{
+	int16_t id;
+	uint8_t i;
+
+	if(argc == 0)
+	{
+		for(i = 0; i < PRM_getCount(); i++)
+		{
+			CLI_printParam(i);
+		}
+
+		return;
+	}
+
+	id = PRM_findParam(argv[0].w);
+	if(id < 0)
+	{
+		printf("ERR unknown parameter\r\n");
+		return;
+	}
+
+	CLI_printParam(id);
+
+	return;
+}
+
+void
+CLI_help(uint8_t argc, const _CLI_arg *argv)
+{
+	const _CLI_command *command;
+	uint8_t i;
+
+	if(argc > 0)
+	{
+		command = CLI_findCommand(argv[0].w);
+		if(command == NULL)
+		{
+			printf("ERR unknown command\r\n");
+			return;
+		}
+
+		printf("%s %s\r\n", command->name, command->help);
+		return;
+	}
+
+	for(i = 0; i < CLI_COMMAND_COUNT; i++)
+	{
+		printf("%s ", cliCommands[i].name);
+	}
+	printf("\r\n");
+
+	return;
+}
+
+void
+CLI_mem(uint8_t argc, const _CLI_arg *argv)
+{
+	MEM_printUsage();
+	return;
+}
+
+void
+CLI_motor(uint8_t argc, const _CLI_arg *argv)
+{
+	uint16_t speedDemand;
+	_DMD_source source = DMD_getDemand(&speedDemand);
+
+	printf("state=%u sector=%d duty=%u demand=%s:%u rc=%s\r\n",
+			MOT_getMotorState(), MOT_getSector(), MOT_getDutyCycle(),
+			DMD_getSourceName(source), speedDemand, RCPWM_getProtocolName(RCPWM_getProtocol()));
+	return;
+}
+
+void
+CLI_perf(uint8_t argc, const _CLI_arg *argv)
+{
+	int8_t enable;
+
+	if(argc == 0)
+	{
+		PERF_printReport();
+		return;
+	}
+
+	enable = CLI_parseOnOff(argv[0].w);
+	if(enable < 0)
+	{
+		printf("ERR usage: perf [on|off]\r\n");
+		return;
+	}
+
+	PERF_enableReporting(enable);
+	printf("OK\r\n");
+
+	return;
+}
+
+void
+CLI_profile(uint8_t argc, const _CLI_arg *argv)
+{
+	const _MPRF_profile *profile;
+	_MPRF_status status;
+	uint32_t cycles;
+	uint8_t changed;
+	int8_t index;
+
+	if(argc == 0)
+	{
+		for(index = 0; index < MPRF_getCount(); index++)
+		{
+			profile = MPRF_getProfile(index);
+			printf("%c%s type=%u hall=%u pwm=%u dead=%uns start=%u comm=%ums max=%u\r\n",
+					MPRF_isInUse(index) ? '*' : ' ', profile->name, profile->motorType,
+					profile->hallTable, profile->pwmFrequency, profile->deadTimeNs,
+					profile->startDutyCycle, profile->forcedCommutationMs, profile->maxDutyCycle);
+		}
+		return;
+	}
+
+	index = MPRF_findProfile(argv[0].w);
+	if(index < 0)
+	{
+		printf("ERR unknown profile\r\n");
+		return;
+	}
+
+	cycles = PERF_getCycles();
+	status = MPRF_applyProfile(index, &changed);
+	cycles = PERF_getCycles() - cycles;
+
+	switch(status)
+	{
+		case MPRF_OK:
+			printf("OK %s: %u changed in %luus\r\n", argv[0].w, changed,
+					(unsigned long)(cycles / (SystemCoreClock / 1000000)));
+			break;
+		case MPRF_ERR_RUNNING:
+			printf("ERR stop the motor first\r\n");
+			break;
+		default:
+			printf("ERR a value is out of range\r\n");
+			break;
+	}
+
+	return;
+}
+
+void
+CLI_rc(uint8_t argc, const _CLI_arg *argv)
+{
+	uint16_t shortest;
+	uint16_t longest;
+
+	if(argc == 0)
+	{
+		cli.overrideActive = false;
+	}
+	else if(strcmp(argv[0].w, "cal") == 0)
+	{
+		if(!RCPWM_startCalibration())
+		{
+			printf("ERR rc input is not pulse width\r\n");
+			return;
+		}
+	}
+	else if(strcmp(argv[0].w, "save") == 0)
+	{
+		if(!RCPWM_saveCalibration())
+		{
+			RCPWM_getEndpoints(&shortest, &longest);
+			printf("ERR range too small: %u-%u\r\n", shortest, longest);
+			return;
+		}
+	}
+	else if(strcmp(argv[0].w, "cancel") == 0)
+	{
+		RCPWM_cancelCalibration();
+	}
+	else
+	{
+		printf("ERR usage: rc [cal|save|cancel]\r\n");
+		return;
+	}
+
+	RCPWM_getEndpoints(&shortest, &longest);
+	printf("OK %s %u-%u\r\n", RCPWM_isCalibrating() ? "learning" : "endpoints", shortest, longest);
+
+	return;
+}
+
+void
+CLI_reset(uint8_t argc, const _CLI_arg *argv)
+{
+	FLT_warmRestart();
+}
+
+void
+CLI_scope(uint8_t argc, const _CLI_arg *argv)
+{
+	_SCP_config config = *SCP_getConfig();
+	_CLI_arg number;
+	bool reconfigure = true;
+	int8_t index;
+	uint8_t i;
+
+	if(argc == 0)
+	{
+		printf("scope %s depth=%u count=%u pre=%u dec=%u trig=%s ch=",
+				scopeStatusNames[SCP_getStatus()], SCP_getDepth(), SCP_getCount(),
+				config.preTrigger, config.decimation, scopeTriggerNames[config.triggerType]);
+		for(i = 0; (i < SCP_MAX_CHANNELS) && (config.channels[i] < SCP_CH_COUNT); i++)
+		{
+			printf("%s%s", (i == 0) ? "" : ",", scopeChannelNames[config.channels[i]]);
+		}
+		printf(" isr=%lu cycles\r\n", (unsigned long)SCP_getMaxCycles());
+		return;
+	}
+
+	if(strcmp(argv[0].w, "arm") == 0)
+	{
+		reconfigure = false;
+		if(!SCP_arm())
+		{
+			printf("ERR already armed\r\n");
+			return;
+		}
+	}
+	else if(strcmp(argv[0].w, "stop") == 0)
+	{
+		reconfigure = false;
+		SCP_stop();
+	}
+	else if(strcmp(argv[0].w, "fire") == 0)
+	{
+		reconfigure = false;
+		SCP_trigger();
+	}
+	else if(strcmp(argv[0].w, "dump") == 0)
+	{
+		reconfigure = false;
+		if(!SCP_startDump())
+		{
+			printf("ERR no capture\r\n");
+			return;
+		}
+	}
+	else if((strcmp(argv[0].w, "ch") == 0) && (argc > 1))
+	{
+		memset(config.channels, SCP_NO_CHANNEL, SCP_MAX_CHANNELS);
+		for(i = 1; i < argc; i++)
+		{
+			index = CLI_findName(argv[i].w, scopeChannelNames, SCP_CH_COUNT);
+			if(index < 0)
+			{
+				printf("ERR channels: a b c vbus ibus duty sector state\r\n");
+				return;
+			}
+			config.channels[i - 1] = index;
+		}
+	}
+	else if((strcmp(argv[0].w, "trig") == 0) && (argc > 1))
+	{
+		index = CLI_findName(argv[1].w, scopeTriggerNames, SCP_TRIG_COUNT);
+		if(index < 0)
+		{
+			printf("ERR triggers: manual rising falling state fault\r\n");
+			return;
+		}
+		config.triggerType = index;
+
+		if(argc > 2)
+		{
+			index = CLI_findName(argv[2].w, scopeChannelNames, SCP_CH_COUNT);
+			if(index < 0)
+			{
+				printf("ERR unknown channel\r\n");
+				return;
+			}
+			config.triggerChannel = index;
+		}
+
+		if(argc > 3)
+		{
+			if(!CLI_parseNumber(argv[3].w, false, &number) || (number.u > 0xFFFF))
+			{
+				printf("ERR level is 0-65535\r\n");
+				return;
+			}
+			config.triggerLevel = number.u;
+		}
+	}
+	else if(((strcmp(argv[0].w, "pre") == 0) || (strcmp(argv[0].w, "dec") == 0)) && (argc == 2))
+	{
+		if(!CLI_parseNumber(argv[1].w, false, &number) || (number.u > 0xFFFF))
+		{
+			printf("ERR bad number '%s'\r\n", argv[1].w);
+			return;
+		}
+
+		if(argv[0].w[0] == 'p')
+			config.preTrigger = number.u;
+		else
+			config.decimation = number.u;
+	}
+	else
+	{
+		printf("ERR usage: scope %s\r\n", CLI_findCommand("scope")->help);
+		return;
+	}
+
+	// Configuration changes drop the frozen capture
+	if(reconfigure && !SCP_configure(&config))
+	{
+		printf("ERR stop the scope first\r\n");
+		return;
+	}
+
+	printf("OK\r\n");
+
+	return;
+}
+
+void
+CLI_set(uint8_t argc, const _CLI_arg *argv)
+{
+	int16_t id = PRM_findParam(argv[0].w);
+	const _PRM_param *param;
+	_CLI_arg value;
+	bool isSigned;
+
+	if(id < 0)
+	{
+		printf("ERR unknown parameter\r\n");
+		return;
+	}
+
+	param = PRM_getParam(id);
+	if(param->type == PRM_TYPE_FLOAT)
+	{
+		printf("ERR float parameters are set with tools/params.py\r\n");
+		return;
+	}
+
+	isSigned = (param->type == PRM_TYPE_I8) || (param->type == PRM_TYPE_I16) || (param->type == PRM_TYPE_I32);
+	if(!CLI_parseNumber(argv[1].w, isSigned, &value))
+	{
+		printf("ERR bad number '%s'\r\n", argv[1].w);
+		return;
+	}
+
+	switch(PRM_write(id, value.u))
+	{
+		case PRM_OK:
+			printf("OK\r\n");
+			break;
+
+		case PRM_ERR_READ_ONLY:
+			printf("ERR %s is read-only\r\n", param->name);
+			break;
+
+		default:
+			if(isSigned)
+				printf("ERR %s is %ld-%ld\r\n", param->name, (long)(int32_t)param->min, (long)(int32_t)param->max);
+			else
+				printf("ERR %s is %lu-%lu\r\n", param->name, (unsigned long)param->min, (unsigned long)param->max);
+			break;
+	}
+
+	return;
+}
+
+void
+CLI_stop(uint8_t argc, const _CLI_arg *argv)
+{
+	cli.overrideDemand = 0;
+	cli.overrideActive = true;
+	printf("OK\r\n");
+	return;
+}
+
+void
+CLI_store(uint8_t argc, const _CLI_arg *argv)
+{
+	_PST_stats stats;
+
+	if(argc > 0)
+	{
+		if(strcmp(argv[0].w, "clear") != 0)
+		{
+			printf("ERR usage: store [clear]\r\n");
+			return;
+		}
+
+		// The defaults come back with the next reset
+		PST_clear();
+		printf("OK\r\n");
+		return;
+	}
+
+	PST_getStats(&stats);
+	printf("store page=%d seq=%lu used=%u/%u keys=%u pending=%u%s\r\n", stats.page,
+			(unsigned long)stats.sequence, stats.used, (unsigned)PST_SLOTS, stats.keys,
+			stats.pending, stats.failed ? " FAILED" : "");
+
+	return;
+}
+
+void
+CLI_tlm(uint8_t argc, const _CLI_arg *argv)
+{
+	int8_t enable;
+
+	if(argc == 0)
+	{
+		printf("tlm %s decimation=%u dropped=%lu\r\n",
+				TLM_isEnabled() ? "on" : "off", TLM_getDecimation(),
+				(unsigned long)TLM_getDropped());
+		return;
+	}
+
+	enable = CLI_parseOnOff(argv[0].w);
+	if(enable < 0)
+	{
+		printf("ERR usage: tlm [on|off] [decimation]\r\n");
+		return;
+	}
+
+	if(argc > 1)
+	{
+		if((argv[1].u == 0) || (argv[1].u > 0xFFFF))
+		{
+			printf("ERR decimation is 1-65535\r\n");
+			return;
+		}
+
+		TLM_setDecimation((uint16_t)argv[1].u);
+	}
+
+	TLM_enable(enable);
+	printf("OK\r\n");
+
+	return;
+}
+
+void
+CLI_usb(uint8_t argc, const _CLI_arg *argv)
+{
+	printf("usb in=%luB/s\r\n", (unsigned long)EP1_GetThroughput());
+	return;
+}
+
+void
+CLI_uart(uint8_t argc, const _CLI_arg *argv)
+{
+	printf("uart %s dropped=%lu\r\n", UART_isActive() ? "active" : "idle",
+			(unsigned long)UART_getDropped());
+	return;
+}
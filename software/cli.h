@@ -0,0 +1,48 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef CLI_H
+#define CLI_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CLI_MAX_LINE			64		// characters per command line
+#define CLI_MAX_ARGS			6		// words per line, command included
+#define CLI_BYTES_PER_PASS		64		// received bytes handled per CLI_process()
+
+// Argument types, one character per argument in _CLI_command.args
+#define CLI_ARG_UNSIGNED		'u'		// decimal or 0x hex
+#define CLI_ARG_SIGNED			'i'
+#define CLI_ARG_WORD			'w'		// any text without spaces
+
+typedef union
+{
+	uint32_t u;
+	int32_t i;
+	const char *w;
+} _CLI_arg;
+
+// argc counts the arguments after the command name
+typedef void (*_CLI_handler)(uint8_t argc, const _CLI_arg *argv);
+
+typedef struct
+{
+	const char *name;
+	_CLI_handler handler;
+	const char *args;					// argument types, e.g. "wu"
+	uint8_t minArgs;					// the rest of args is optional
+	const char *help;
+} _CLI_command;
+
+void CLI_initCli(void);
+void CLI_process(void);
+bool CLI_getSpeedDemand(uint16_t *speedDemand);
+
+#endif
@@ -18,9 +18,16 @@
  
 
 /*----------Stack Configuration-----------------------------------------------*/  
-#define STACK_SIZE       0x00000100      /*!< Stack size (in Words)           */
+/* main() runs on the process stack (PSP); the main stack (MSP) is only used by
+   exception and interrupt handlers.  Both are painted and checked by memMon.c */
+#define STACK_SIZE       0x00000080      /*!< Exception stack size (in Words) */
+#define PROCESS_STACK_SIZE 0x000000C0    /*!< main() stack size (in Words)    */
 __attribute__ ((section(".co_stack")))
 unsigned long pulStack[STACK_SIZE];      
+__attribute__ ((section(".co_stack"), aligned(8)))
+unsigned long pulProcessStack[PROCESS_STACK_SIZE];
+const unsigned long ulStackWords = STACK_SIZE;
+const unsigned long ulProcessStackWords = PROCESS_STACK_SIZE;
 
 
 /*----------Macro definition--------------------------------------------------*/  
@@ -203,6 +210,12 @@ void Default_Reset_Handler(void)
   
   /* Setup the microcontroller system. */
   SystemInit();
+
+  /* Switch thread mode to the process stack */
+  __asm("  msr     psp, %0\n"
+        "  mov     r0, #2\n"
+        "  msr     control, r0\n"
+        "  isb" : : "r" (&pulProcessStack[PROCESS_STACK_SIZE]) : "r0");
     
   /* Call the application's entry point.*/
   main();
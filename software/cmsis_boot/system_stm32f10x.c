@@ -63,6 +63,7 @@
   */
 
 #include "stm32f10x.h"
+#include "fault.h"
 
 /**
   * @}
@@ -125,8 +126,10 @@
 /*!< Uncomment the following line if you need to relocate your vector Table in
      Internal SRAM. */ 
 /* #define VECT_TAB_SRAM */
+#ifndef VECT_TAB_OFFSET
 #define VECT_TAB_OFFSET  0x0 /*!< Vector Table base offset field. 
                                   This value must be a multiple of 0x200. */
+#endif
 
 
 /**
@@ -174,6 +177,7 @@ __I uint8_t AHBPrescTable[16] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9}
   */
 
 static void SetSysClock(void);
+static uint32_t SystemIsWarmStart(void);
 
 #ifdef SYSCLK_FREQ_HSE
   static void SetSysClockToHSE(void);
@@ -211,6 +215,20 @@ static void SetSysClock(void);
   */
 void SystemInit (void)
 {
+#ifdef VECT_TAB_SRAM
+  SCB->VTOR = SRAM_BASE | VECT_TAB_OFFSET; /* Vector Table Relocation in Internal SRAM. */
+#else
+  SCB->VTOR = FLASH_BASE | VECT_TAB_OFFSET; /* Vector Table Relocation in Internal FLASH. */
+#endif 
+
+  /* A warm restart passes through the bootloader, which has the HSE PLL
+     running at 72MHz already: keep it rather than stop it and wait for HSE
+     and PLL to be ready again */
+  if (SystemIsWarmStart())
+  {
+    return;
+  }
+
   /* Reset the RCC clock configuration to the default reset state(for debug purpose) */
   /* Set HSION bit */
   RCC->CR |= (uint32_t)0x00000001;
@@ -260,12 +278,27 @@ void SystemInit (void)
   /* Configure the System clock frequency, HCLK, PCLK2 and PCLK1 prescalers */
   /* Configure the Flash Latency cycles and enable prefetch buffer */
   SetSysClock();
+}
 
-#ifdef VECT_TAB_SRAM
-  SCB->VTOR = SRAM_BASE | VECT_TAB_OFFSET; /* Vector Table Relocation in Internal SRAM. */
-#else
-  SCB->VTOR = FLASH_BASE | VECT_TAB_OFFSET; /* Vector Table Relocation in Internal FLASH. */
-#endif 
+/**
+  * @brief  Tells whether this start follows a warm restart (FLT_warmRestart())
+  *         with the HSE PLL still driving SYSCLK.  A cold start and the
+  *         bootloader's own start find SYSCLK on HSI and set the clock up.
+  * @param  None
+  * @retval 1 when the clock can be kept as it is, 0 otherwise
+  */
+static uint32_t SystemIsWarmStart(void)
+{
+  if (((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL) || ((RCC->CFGR & RCC_CFGR_PLLSRC) == 0))
+  {
+    return 0;
+  }
+
+  /* The backup registers are read through the PWR and BKP clocks, which
+     FLT_initFault() turns on again anyway */
+  RCC->APB1ENR |= RCC_APB1ENR_PWREN | RCC_APB1ENR_BKPEN;
+
+  return ((RCC->CSR & RCC_CSR_SFTRSTF) != 0) && (BKP->DR1 == FLT_BKP_WARM_FLAG);
 }
 
 /**
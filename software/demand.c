@@ -0,0 +1,214 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <stddef.h>
+
+/* User-generated libs */
+#include "demand.h"
+#include "analogInput.h"
+#include "canNode.h"
+#include "cli.h"
+#include "i2cSlave.h"
+#include "log.h"
+#include "rcPwm.h"
+
+#define DMD_RANKS					8		// nibbles in the order
+
+/* Global variables */
+typedef struct
+{
+	uint32_t order;
+	_DMD_setpoint setpoints[DMD_SOURCE_COUNT];
+
+	// source << 16 | demand, written in one store so that any
+	//	context reads a matching pair without a lock
+	volatile uint32_t published;
+} _demand;
+
+_demand demand =
+{
+	.order = DMD_DEFAULT_ORDER,
+	.published = (uint32_t)DMD_SOURCE_NONE << 16
+};
+
+// Indexed by _DMD_source
+bool (*const dmdSources[DMD_SOURCE_COUNT])(uint16_t *speedDemand) =
+{
+	CLI_getSpeedDemand,
+	I2CS_getSpeedDemand,
+	CANN_getSpeedDemand,
+	RCPWM_getSpeedDemand,
+	AIN_getSpeedDemand
+};
+
+const char *const dmdSourceNames[DMD_SOURCE_COUNT] = {"cli", "i2c", "can", "rc", "analog"};
+
+/***************************************************************
+ * Function:	void DMD_initDemand(void)
+ *
+ * Purpose:		To start with no source selected and a demand of 0
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	demand
+ **************************************************************/
+void
+DMD_initDemand(void)
+{
+	uint8_t source;
+
+	for(source = 0; source < DMD_SOURCE_COUNT; source++)
+	{
+		demand.setpoints[source].setpoint = 0;
+		demand.setpoints[source].fresh = false;
+	}
+
+	demand.published = (uint32_t)DMD_SOURCE_NONE << 16;
+
+	return;
+} // END DMD_initDemand()
+
+/***************************************************************
+ * Function:	bool DMD_setOrder(uint32_t order)
+ *
+ * Purpose:		To set which sources are enabled and their priority
+ *
+ * Parameters:	uint32_t order		see demand.h
+ *
+ * Returns:		false if a nibble is not a source or a source is
+ * 					listed twice; nothing changes
+ *
+ * Globals affected:	demand.order
+ **************************************************************/
+bool
+DMD_setOrder(uint32_t order)
+{
+	uint8_t listed = 0;
+	uint8_t rank;
+
+	for(rank = 0; rank < DMD_RANKS; rank++)
+	{
+		uint8_t source = (order >> (rank * 4)) & 0xF;
+
+		if(source == DMD_SOURCE_NONE)
+		{
+			continue;
+		}
+
+		if((source >= DMD_SOURCE_COUNT) || (listed & (1 << source)))
+		{
+			return false;
+		}
+
+		listed |= 1 << source;
+	}
+
+	demand.order = order;
+
+	return true;
+} // END DMD_setOrder()
+
+uint32_t
+DMD_getOrder(void)
+{
+	return demand.order;
+}
+
+/***************************************************************
+ * Function:	void DMD_process(uint32_t now)
+ *
+ * Purpose:		To collect the enabled sources' setpoints and
+ * 					publish the one with the highest priority that
+ * 					is fresh.  A change of source is logged.
+ *
+ * Parameters:	uint32_t now		milliseconds
+ *
+ * Returns:		none
+ *
+ * Globals affected:	demand.setpoints, demand.published
+ **************************************************************/
+void
+DMD_process(uint32_t now)
+{
+	_DMD_source selected = DMD_SOURCE_NONE;
+	_DMD_source previous = demand.published >> 16;
+	uint16_t speedDemand = 0;
+	uint8_t rank;
+
+	for(rank = 0; rank < DMD_RANKS; rank++)
+	{
+		_DMD_source source = (demand.order >> (rank * 4)) & 0xF;
+		_DMD_setpoint *setpoint;
+
+		if(source >= DMD_SOURCE_COUNT)
+		{
+			continue;
+		}
+
+		setpoint = &demand.setpoints[source];
+		setpoint->fresh = dmdSources[source](&setpoint->setpoint);
+		if(!setpoint->fresh)
+		{
+			continue;
+		}
+
+		setpoint->freshTime = now;
+		if(selected == DMD_SOURCE_NONE)
+		{
+			selected = source;
+			speedDemand = setpoint->setpoint;
+		}
+	}
+
+	demand.published = ((uint32_t)selected << 16) | speedDemand;
+
+	if(selected != previous)
+	{
+		LOG("demand: %s -> %s", DMD_getSourceName(previous), DMD_getSourceName(selected));
+	}
+
+	return;
+} // END DMD_process()
+
+/***************************************************************
+ * Function:	_DMD_source DMD_getDemand(uint16_t *speedDemand)
+ *
+ * Purpose:		To read the published demand.  Safe from any
+ * 					context.
+ *
+ * Parameters:	uint16_t *speedDemand	Q16, 0 with no source
+ *
+ * Returns:		_DMD_source that set it, DMD_SOURCE_NONE if none
+ * 					is fresh
+ *
+ * Globals affected:	none
+ **************************************************************/
+_DMD_source
+DMD_getDemand(uint16_t *speedDemand)
+{
+	uint32_t published = demand.published;
+
+	*speedDemand = (uint16_t)published;
+
+	return published >> 16;
+} // END DMD_getDemand()
+
+const _DMD_setpoint*
+DMD_getSetpoint(_DMD_source source)
+{
+	return (source < DMD_SOURCE_COUNT) ? &demand.setpoints[source] : NULL;
+}
+
+const char*
+DMD_getSourceName(_DMD_source source)
+{
+	return (source < DMD_SOURCE_COUNT) ? dmdSourceNames[source] : "none";
+}
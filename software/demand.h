@@ -0,0 +1,58 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef DEMAND_H
+#define DEMAND_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Demand arbitration
+ *
+ * Every millisecond each enabled source is asked for its setpoint and
+ *	whether it is fresh (it has one and its own timeout has not
+ *	expired).  The first fresh source in the priority order wins; when
+ *	it goes stale the next fresh one takes over, and with none fresh
+ *	the demand is 0.
+ *
+ * The order is one nibble per rank, highest priority in the lowest
+ *	nibble, DMD_SOURCE_NONE ending the list.  A source that is not in
+ *	the order is disabled.  The default leaves the analog input out,
+ *	since its pin floats when nothing is connected.
+ */
+typedef enum
+{
+	DMD_SOURCE_CLI,						// USB command line override
+	DMD_SOURCE_I2C,
+	DMD_SOURCE_CAN,
+	DMD_SOURCE_RC,						// pulse width or DShot
+	DMD_SOURCE_ANALOG,
+	DMD_SOURCE_COUNT,
+	DMD_SOURCE_NONE = 0xF
+} _DMD_source;
+
+#define DMD_DEFAULT_ORDER			0xFFFF3210		// cli, i2c, can, rc
+
+typedef struct
+{
+	uint16_t setpoint;
+	bool fresh;
+	uint32_t freshTime;					// ms, last time the source was fresh
+} _DMD_setpoint;
+
+void DMD_initDemand(void);
+bool DMD_setOrder(uint32_t order);
+uint32_t DMD_getOrder(void);
+void DMD_process(uint32_t now);
+_DMD_source DMD_getDemand(uint16_t *speedDemand);
+const _DMD_setpoint* DMD_getSetpoint(_DMD_source source);
+const char* DMD_getSourceName(_DMD_source source);
+
+#endif
@@ -0,0 +1,472 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include "stm32f10x.h"
+#include "stm32f10x_rcc.h"
+
+/* User-generated libs */
+#include "dshot.h"
+#include "rcPwm.h"
+#include "gpio.h"
+#include "log.h"
+#include "motor.h"
+#include "perfMon.h"
+#include "pinMap.h"
+
+// Ring of captured high times, a power of two
+#define DSHOT_RING_SIZE			32
+
+// 21 GCR bits, then the line is released high
+#define DSHOT_REPLY_BITS		21
+#define DSHOT_REPLY_WORDS		(DSHOT_REPLY_BITS + 1)
+#define DSHOT_REPLY_DELAY_US	30
+
+#define DSHOT_PIN				PIN_RC_IN_PIN
+#define DSHOT_PIN_HIGH			(1 << DSHOT_PIN)
+#define DSHOT_PIN_LOW			(1 << (DSHOT_PIN + 16))
+
+// TIM3 register bits
+#define DSHOT_CR1_CEN			(1 << 0)
+#define DSHOT_CR1_ARPE			(1 << 7)
+#define DSHOT_SMCR_RESET_TI1	((0b101 << 4) | 0b100)	// reset mode, trigger TI1FP1
+#define DSHOT_DIER_CC3IE		(1 << 3)
+#define DSHOT_DIER_UDE			(1 << 8)
+#define DSHOT_CCMR1_IC1_IC2_TI1	((0b10 << 8) | 0b01)	// both captures on TI1
+#define DSHOT_CCER_CC1E			(1 << 0)
+#define DSHOT_CCER_CC1P			(1 << 1)
+#define DSHOT_CCER_CC2E			(1 << 4)
+#define DSHOT_CCER_CC2P			(1 << 5)
+#define DSHOT_EGR_UG			(1 << 0)
+
+// DMA1 channel CCR bits; TIM3 update is channel 3
+#define DSHOT_DMA_EN			(1 << 0)
+#define DSHOT_DMA_TCIE			(1 << 1)
+#define DSHOT_DMA_FROM_MEMORY	(1 << 4)
+#define DSHOT_DMA_CIRC			(1 << 5)
+#define DSHOT_DMA_MINC			(1 << 7)
+#define DSHOT_DMA_16BIT			((0b01 << 10) | (0b01 << 8))
+#define DSHOT_DMA_32BIT			((0b10 << 10) | (0b10 << 8))
+#define DSHOT_DMA_PRIORITY_HIGH	(0b10 << 12)
+
+// Bit periods in TIM3 counts: 600 -> 40, 300 -> 80, 150 -> 160
+#define DSHOT_SLOWEST_BIT		(RCPWM_TICKS_PER_US * 20 / 3)
+
+/* Global variables */
+typedef struct
+{
+	bool bidirectional;
+	uint8_t ringPosition;				// ring index at the last frame end
+	uint16_t ring[DSHOT_RING_SIZE];		// high times, written by DMA
+	uint32_t reply[DSHOT_REPLY_WORDS];	// RC input pin BSRR words, read by DMA
+
+	uint16_t lastCommand;
+	uint8_t commandCount;
+	volatile bool reversed;
+	volatile uint32_t crcErrors;
+} _dshot;
+
+_dshot dshot;
+
+// 4-bit nibble to 5-bit GCR code
+const uint8_t dshotGcr[16] =
+{
+	0x19, 0x1B, 0x12, 0x13, 0x1D, 0x15, 0x16, 0x17,
+	0x1A, 0x09, 0x0A, 0x0B, 0x1E, 0x0D, 0x0E, 0x0F
+};
+
+/* Private function declarations */
+void DSHOT_startCapture(void);
+void DSHOT_startReply(uint16_t bitPeriod);
+void DSHOT_command(uint16_t command);
+
+/***************************************************************
+ * Function:	void DSHOT_initDshot(bool bidirectional)
+ *
+ * Purpose:		To take over TIM3 and the RC input pin for DShot.
+ * 					RCPWM_setInput() calls this with TIM3 stopped
+ * 					and reset.
+ *
+ * Parameters:	bool bidirectional	inverted line, eRPM replies
+ *
+ * Returns:		none
+ *
+ * Globals affected:	dshot, TIM3, DMA1 channel 3
+ **************************************************************/
+void
+DSHOT_initDshot(bool bidirectional)
+{
+	dshot.bidirectional = bidirectional;
+	dshot.commandCount = 0;
+	dshot.crcErrors = 0;
+
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+	// The reply completes in the DMA interrupt
+	NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+
+	DSHOT_startCapture();
+
+	return;
+} // END DSHOT_initDshot()
+
+/***************************************************************
+ * Function:	void DSHOT_stopDshot(void)
+ *
+ * Purpose:		To give TIM3 and the pin back before the RC input
+ * 					changes to another mode
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	TIM3, DMA1 channel 3
+ **************************************************************/
+void
+DSHOT_stopDshot(void)
+{
+	TIM3->CR1 = 0;
+	TIM3->DIER = 0;
+	DMA1_Channel3->CCR = 0;
+	NVIC_DisableIRQ(DMA1_Channel3_IRQn);
+	GPIO_pinSetup(PIN_RC_IN_PORT, DSHOT_PIN, GPIO_FLOATING_INPUT);
+
+	return;
+} // END DSHOT_stopDshot()
+
+bool
+DSHOT_isReversed(void)
+{
+	return dshot.reversed;
+}
+
+uint32_t
+DSHOT_getCrcErrors(void)
+{
+	return dshot.crcErrors;
+}
+
+/***************************************************************
+ * Function:	void DSHOT_startCapture(void)
+ *
+ * Purpose:		To make the pin an input and capture every bit
+ * 					into the ring
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	dshot.ringPosition, TIM3, DMA1 channel 3
+ **************************************************************/
+void
+DSHOT_startCapture(void)
+{
+	GPIO_pinSetup(PIN_RC_IN_PORT, DSHOT_PIN, GPIO_FLOATING_INPUT);
+
+	TIM3->CR1 = 0;
+	TIM3->DIER = 0;
+	DMA1_Channel3->CCR = 0;
+
+	// 24MHz, as for the pulse protocols
+	TIM3->PSC = 2;
+	TIM3->ARR = 0xFFFF;
+	TIM3->CCMR1 = DSHOT_CCMR1_IC1_IC2_TI1;
+	TIM3->CCMR2 = 0;
+
+	// Bits start on the rising edge, or on the falling edge of the
+	//	inverted bidirectional line
+	if(dshot.bidirectional)
+		TIM3->CCER = DSHOT_CCER_CC2E | DSHOT_CCER_CC1P | DSHOT_CCER_CC1E;
+	else
+		TIM3->CCER = DSHOT_CCER_CC2P | DSHOT_CCER_CC2E | DSHOT_CCER_CC1E;
+
+	TIM3->SMCR = DSHOT_SMCR_RESET_TI1;
+	TIM3->CCR3 = 2 * DSHOT_SLOWEST_BIT;
+	TIM3->EGR = DSHOT_EGR_UG;
+	TIM3->SR = 0;
+
+	DMA1_Channel3->CPAR = (uint32_t)&TIM3->CCR2;
+	DMA1_Channel3->CMAR = (uint32_t)dshot.ring;
+	DMA1_Channel3->CNDTR = DSHOT_RING_SIZE;
+	DMA1_Channel3->CCR = DSHOT_DMA_PRIORITY_HIGH | DSHOT_DMA_16BIT | DSHOT_DMA_MINC
+			| DSHOT_DMA_CIRC | DSHOT_DMA_EN;
+	dshot.ringPosition = 0;
+
+	TIM3->DIER = DSHOT_DIER_UDE | DSHOT_DIER_CC3IE;
+	TIM3->CR1 = DSHOT_CR1_CEN;
+
+	return;
+} // END DSHOT_startCapture()
+
+/***************************************************************
+ * Function:	void DSHOT_frameInterrupt(void)
+ *
+ * Purpose:		To decode a frame once the line has gone quiet.
+ * 					Called from TIM3_IRQHandler() on CC3.  The
+ * 					counter also passes CC3 each time it wraps on an
+ * 					idle line; those find fewer than 16 new edges.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	dshot, TIM3->CCR3
+ **************************************************************/
+void
+DSHOT_frameInterrupt(void)
+{
+	// Read the last bit before the next frame can overwrite it
+	uint16_t lastHigh = TIM3->CCR2;
+	uint16_t bitPeriod = TIM3->CCR1;
+	uint8_t position = (DSHOT_RING_SIZE - DMA1_Channel3->CNDTR) & (DSHOT_RING_SIZE - 1);
+	uint8_t edges = (position - dshot.ringPosition) & (DSHOT_RING_SIZE - 1);
+	_RCPWM_protocol protocol;
+	uint16_t threshold;
+	uint16_t frame;
+	uint16_t check;
+	uint8_t i;
+
+	dshot.ringPosition = position;
+
+	// One ring entry per bit start, the first holds the previous frame
+	if(edges < DSHOT_FRAME_BITS)
+	{
+		return;
+	}
+
+	if(bitPeriod < (DSHOT_SLOWEST_BIT * 3 / 8))
+		protocol = RCPWM_DSHOT600;
+	else if(bitPeriod < (DSHOT_SLOWEST_BIT * 3 / 4))
+		protocol = RCPWM_DSHOT300;
+	else if(bitPeriod < (DSHOT_SLOWEST_BIT * 3 / 2))
+		protocol = RCPWM_DSHOT150;
+	else
+		return;
+
+	// Halfway between the 3/8 and 3/4 high times
+	threshold = (bitPeriod * 9) >> 4;
+
+	frame = 0;
+	for(i = DSHOT_FRAME_BITS - 1; i > 0; i--)
+	{
+		frame = (frame << 1) | (dshot.ring[(position - i) & (DSHOT_RING_SIZE - 1)] > threshold);
+	}
+	frame = (frame << 1) | (lastHigh > threshold);
+
+	check = (frame >> 4) ^ (frame >> 8) ^ (frame >> 12);
+	if(dshot.bidirectional)
+	{
+		check = ~check;
+	}
+
+	if(((check ^ frame) & 0x0F) != 0)
+	{
+		dshot.crcErrors++;
+		return;
+	}
+
+	// A frame may follow after two bit periods of this rate
+	TIM3->CCR3 = 2 * bitPeriod;
+
+	if(dshot.bidirectional)
+	{
+		DSHOT_startReply(bitPeriod);
+	}
+
+	frame >>= 5;
+	if(frame < DSHOT_MIN_THROTTLE)
+	{
+		DSHOT_command(frame);
+		RCPWM_receiveDemand(protocol, 0);
+	}
+	else
+	{
+		dshot.commandCount = 0;
+
+		// 0-1999 scaled to 0-65535: x * 65535 / 1999 ~= (x * 33570) >> 10
+		RCPWM_receiveDemand(protocol, ((uint32_t)(frame - DSHOT_MIN_THROTTLE) * 33570) >> 10);
+	}
+
+	return;
+} // END DSHOT_frameInterrupt()
+
+/***************************************************************
+ * Function:	void DSHOT_command(uint16_t command)
+ *
+ * Purpose:		To act on a special command once it has arrived
+ * 					DSHOT_COMMAND_REPEATS times in a row with the
+ * 					motor stopped.  Commands without a meaning for
+ * 					this drive (beacons, LEDs, 3D mode) are ignored.
+ *
+ * Parameters:	uint16_t command	0-47
+ *
+ * Returns:		none
+ *
+ * Globals affected:	dshot.lastCommand, dshot.commandCount, dshot.reversed
+ **************************************************************/
+void
+DSHOT_command(uint16_t command)
+{
+	if(command != dshot.lastCommand)
+	{
+		dshot.lastCommand = command;
+		dshot.commandCount = 0;
+	}
+
+	if((command == DSHOT_CMD_MOTOR_STOP) || (dshot.commandCount >= DSHOT_COMMAND_REPEATS))
+	{
+		return;
+	}
+
+	if((++dshot.commandCount < DSHOT_COMMAND_REPEATS) || (MOT_getDutyCycle() != 0))
+	{
+		return;
+	}
+
+	switch(command)
+	{
+		case DSHOT_CMD_SPIN_DIRECTION_1:
+		case DSHOT_CMD_SPIN_NORMAL:
+			dshot.reversed = false;
+			LOG("dshot: spin direction normal");
+			break;
+
+		case DSHOT_CMD_SPIN_DIRECTION_2:
+		case DSHOT_CMD_SPIN_REVERSED:
+			dshot.reversed = true;
+			LOG("dshot: spin direction reversed");
+			break;
+
+		default:
+			break;
+	}
+
+	return;
+} // END DSHOT_command()
+
+/***************************************************************
+ * Function:	void DSHOT_startReply(uint16_t bitPeriod)
+ *
+ * Purpose:		To answer a bidirectional frame with the
+ * 					electrical period.  The period in microseconds
+ * 					is sent as exponent (3) | mantissa (9) and an
+ * 					inverted CRC, each nibble as a 5-bit GCR code,
+ * 					behind a start bit; a 1 is sent as a change of
+ * 					level.  0xFFF means stopped, and is also sent
+ * 					for periods of 0x1FF << 7 and longer.
+ *
+ * Parameters:	uint16_t bitPeriod	of the frame, TIM3 counts
+ *
+ * Returns:		none
+ *
+ * Globals affected:	dshot.reply, TIM3, DMA1 channel 3
+ **************************************************************/
+void
+DSHOT_startReply(uint16_t bitPeriod)
+{
+	uint32_t period = MOT_getElectricalPeriod();
+	uint16_t value;
+	uint32_t gcr;
+	uint32_t pinLevel = DSHOT_PIN_HIGH;
+	uint16_t delay;
+	uint8_t exponent = 0;
+	int8_t i;
+
+	if((period == 0) || (period >= (0x1FFul << 7)))
+	{
+		value = 0xFFF;
+	}
+	else
+	{
+		while(period > 0x1FF)
+		{
+			period >>= 1;
+			exponent++;
+		}
+		value = (exponent << 9) | period;
+	}
+
+	value = (value << 4) | (~(value ^ (value >> 4) ^ (value >> 8)) & 0x0F);
+
+	gcr = 1;						// start bit
+	for(i = 12; i >= 0; i -= 4)
+	{
+		gcr = (gcr << 5) | dshotGcr[(value >> i) & 0x0F];
+	}
+
+	// The line changes level on every 1 of the GCR bits
+	for(i = 0; i < DSHOT_REPLY_BITS; i++)
+	{
+		if(gcr & (1ul << (DSHOT_REPLY_BITS - 1 - i)))
+		{
+			pinLevel = (pinLevel == DSHOT_PIN_HIGH) ? DSHOT_PIN_LOW : DSHOT_PIN_HIGH;
+		}
+		dshot.reply[i] = pinLevel;
+	}
+	dshot.reply[DSHOT_REPLY_BITS] = DSHOT_PIN_HIGH;
+
+	// The counter restarted at the start of the last bit
+	delay = (DSHOT_REPLY_DELAY_US * RCPWM_TICKS_PER_US) + bitPeriod - TIM3->CNT;
+	if(delay > (DSHOT_REPLY_DELAY_US * RCPWM_TICKS_PER_US))
+	{
+		delay = bitPeriod;
+	}
+
+	TIM3->CR1 = 0;
+	TIM3->DIER = 0;
+	TIM3->SMCR = 0;
+	TIM3->CCER = 0;
+	DMA1_Channel3->CCR = 0;
+
+	GPIO_setPins(PIN_RC_IN_GPIO, 1 << DSHOT_PIN);
+	GPIO_pinSetup(PIN_RC_IN_PORT, DSHOT_PIN, GPIO_OUTPUT_PP);
+
+	// The first update comes after the delay, the rest at 5/4 of
+	//	the frame's bit rate
+	TIM3->CR1 = DSHOT_CR1_ARPE;
+	TIM3->ARR = delay - 1;
+	TIM3->EGR = DSHOT_EGR_UG;
+	TIM3->ARR = ((bitPeriod * 4) / 5) - 1;
+	TIM3->SR = 0;
+
+	DMA1_Channel3->CPAR = (uint32_t)&PIN_RC_IN_GPIO->BSRR;
+	DMA1_Channel3->CMAR = (uint32_t)dshot.reply;
+	DMA1_Channel3->CNDTR = DSHOT_REPLY_WORDS;
+	DMA1_Channel3->CCR = DSHOT_DMA_PRIORITY_HIGH | DSHOT_DMA_32BIT | DSHOT_DMA_MINC
+			| DSHOT_DMA_FROM_MEMORY | DSHOT_DMA_TCIE | DSHOT_DMA_EN;
+
+	TIM3->DIER = DSHOT_DIER_UDE;
+	TIM3->CR1 |= DSHOT_CR1_CEN;
+
+	return;
+} // END DSHOT_startReply()
+
+/***************************************************************
+ * Function:	void DMA1_Channel3_IRQHandler(void)
+ *
+ * Purpose:		To release the line once the reply is out and
+ * 					listen for the next frame
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	TIM3, DMA1 channel 3
+ **************************************************************/
+void
+DMA1_Channel3_IRQHandler(void)
+{
+	PERF_isrEnter();
+
+	DMA1->IFCR = DMA_IFCR_CGIF3;
+	DSHOT_startCapture();
+
+	PERF_isrExit();
+
+	return;
+} // END DMA1_Channel3_IRQHandler()
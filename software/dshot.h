@@ -0,0 +1,62 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef DSHOT_H
+#define DSHOT_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * DShot digital throttle on the RC input pin (PA6, TIM3 CH1)
+ *
+ * A frame is 16 bits, MSB first: throttle (11) | telemetry request (1)
+ *	| CRC (4).  Every bit starts with a rising edge; a 1 is high for
+ *	3/4 of the bit, a 0 for 3/8.  The bit rate (150/300/600 kbit/s)
+ *	is taken from the measured bit period, so no setting is needed.
+ *
+ *	throttle 0					stop
+ *	throttle 1-47				special commands, see DSHOT_CMD_*
+ *	throttle 48-2047			demand 0%-100%
+ *
+ * TIM3 runs in reset mode on the bit-start edge: CCR1 captures the bit
+ *	period and CCR2 the high time.  The update event of each reset has
+ *	DMA1 channel 3 copy CCR2 (the previous bit) into a ring, so edges
+ *	cost no interrupt.  CC3 fires once the line has been quiet for two
+ *	bit periods, which ends the frame: the ISR decodes the last 15
+ *	bits from the ring and the 16th from CCR2.  (TIM3 CH1 DMA would be
+ *	channel 6, which the I2C slave uses.)
+ *
+ * Bidirectional DShot inverts the line (idle high, bits are low
+ *	pulses) and the CRC.  About 30us after each frame the drive
+ *	answers on the same wire with its electrical period: 21 bits at
+ *	5/4 of the bit rate, GCR encoded, clocked out to the pin's BSRR by
+ *	the same DMA channel from TIM3 update events.
+ */
+#define DSHOT_FRAME_BITS			16
+#define DSHOT_MIN_THROTTLE			48
+#define DSHOT_MAX_THROTTLE			2047
+
+// Direction and settings commands only act after this many identical
+//	frames, and only while the motor is stopped
+#define DSHOT_COMMAND_REPEATS		6
+
+#define DSHOT_CMD_MOTOR_STOP		0
+#define DSHOT_CMD_SPIN_DIRECTION_1	7
+#define DSHOT_CMD_SPIN_DIRECTION_2	8
+#define DSHOT_CMD_SPIN_NORMAL		20
+#define DSHOT_CMD_SPIN_REVERSED		21
+
+void DSHOT_initDshot(bool bidirectional);
+void DSHOT_stopDshot(void);
+void DSHOT_frameInterrupt(void);
+bool DSHOT_isReversed(void);
+uint32_t DSHOT_getCrcErrors(void);
+
+#endif
@@ -0,0 +1,421 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <stdio.h>
+#include <string.h>
+#include "stm32f10x.h"
+#include "stm32f10x_bkp.h"
+#include "stm32f10x_pwr.h"
+#include "stm32f10x_rcc.h"
+
+/* User-generated libs */
+#include "fault.h"
+#include "milliSecTimer.h"
+#include "motor.h"
+#include "scope.h"
+
+#define FLT_RECORD_MAGIC	0xFA175AFE
+
+// Backup register layout.  The backup domain survives the reset, so it
+//	holds the restart flag, the restart count and a short copy of the
+//	record in case the RAM copy is lost.
+#define FLT_BKP_WARM		BKP_DR1		// FLT_BKP_WARM_FLAG (fault.h) when the last reset was a warm restart
+#define FLT_BKP_RESTARTS	BKP_DR2		// warm restarts without FLT_STABLE_MS of clean running
+#define FLT_BKP_RECORD		BKP_DR3		// FLT_BKP_RECORD_FLAG when a record is present
+#define FLT_BKP_PC_LO		BKP_DR4
+#define FLT_BKP_PC_HI		BKP_DR5
+#define FLT_BKP_SOURCE		BKP_DR6		// source | trapCode << 8
+#define FLT_BKP_ISR			BKP_DR7
+
+#define FLT_BKP_RECORD_FLAG	0xFA17
+
+// The stacked frame is only read when it lies completely within SRAM
+#define FLT_SRAM_START		0x20000000
+#define FLT_SRAM_END		(0x20000000 + 0x2800)
+#define FLT_FRAME_BYTES		32
+
+/* Global variables */
+typedef struct
+{
+	bool warmRestart;
+	bool safeMode;
+	bool hasRecord;
+	uint16_t restarts;
+} _fault;
+
+_fault fault;
+
+// .co_stack is a NOLOAD section, so the start-up code neither copies nor
+//	zeroes it and the record survives the warm restart
+_FLT_record fltRecord __attribute__((section(".co_stack")));
+
+/* Private function declarations */
+void FLT_handleFault(uint32_t *frame, uint32_t excReturn) __attribute__((used, noreturn));
+void FLT_saveRecord(void);
+uint32_t FLT_getIpsr(void);
+
+/***************************************************************
+ * Function:	void FLT_initFault(void)
+ *
+ * Purpose:		To find out whether this start-up follows a warm
+ * 					restart and to validate the fault record left
+ * 					behind by it.  Call after OSC_initClock().
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	fault, fltRecord
+ **************************************************************/
+void
+FLT_initFault(void)
+{
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR | RCC_APB1Periph_BKP, ENABLE);
+	PWR_BackupAccessCmd(ENABLE);
+
+	fault.warmRestart = (RCC_GetFlagStatus(RCC_FLAG_SFTRST) == SET)
+			&& (BKP_ReadBackupRegister(FLT_BKP_WARM) == FLT_BKP_WARM_FLAG);
+
+	// Any later reset that is not a warm restart must not look like one
+	BKP_WriteBackupRegister(FLT_BKP_WARM, 0);
+	RCC_ClearFlag();
+
+	fault.restarts = BKP_ReadBackupRegister(FLT_BKP_RESTARTS);
+	fault.safeMode = (fault.restarts > FLT_MAX_WARM_RESTARTS);
+
+	if(BKP_ReadBackupRegister(FLT_BKP_RECORD) == FLT_BKP_RECORD_FLAG)
+	{
+		fault.hasRecord = true;
+
+		if((fltRecord.magic != FLT_RECORD_MAGIC) || (fltRecord.check != ~fltRecord.pc))
+		{
+			// RAM did not survive (power was lost but the backup domain
+			//	was not), rebuild what the backup registers still hold
+			memset(&fltRecord, 0, sizeof(fltRecord));
+			fltRecord.magic = FLT_RECORD_MAGIC;
+			fltRecord.pc = ((uint32_t)BKP_ReadBackupRegister(FLT_BKP_PC_HI) << 16)
+					| BKP_ReadBackupRegister(FLT_BKP_PC_LO);
+			fltRecord.source = (uint8_t)BKP_ReadBackupRegister(FLT_BKP_SOURCE);
+			fltRecord.trapCode = (uint8_t)(BKP_ReadBackupRegister(FLT_BKP_SOURCE) >> 8);
+			fltRecord.activeIsr = BKP_ReadBackupRegister(FLT_BKP_ISR);
+			fltRecord.check = ~fltRecord.pc;
+		}
+	}
+	else
+	{
+		fault.hasRecord = false;
+		memset(&fltRecord, 0, sizeof(fltRecord));
+	}
+
+	return;
+} // END FLT_initFault()
+
+/***************************************************************
+ * Function:	void FLT_process(uint32_t now)
+ *
+ * Purpose:		To clear the restart count once the drive has run
+ * 					cleanly for FLT_STABLE_MS.  Call once per
+ * 					millisecond from the main loop.
+ *
+ * Parameters:	uint32_t now	current time in milliseconds
+ *
+ * Returns:		none
+ *
+ * Globals affected:	fault.restarts
+ **************************************************************/
+void
+FLT_process(uint32_t now)
+{
+	// Safe mode is left only by a power cycle or FLT_clearRecord()
+	if((fault.restarts != 0) && !fault.safeMode && (now >= FLT_STABLE_MS))
+	{
+		fault.restarts = 0;
+		BKP_WriteBackupRegister(FLT_BKP_RESTARTS, 0);
+	}
+
+	return;
+} // END FLT_process()
+
+bool
+FLT_hasRecord(void)
+{
+	return fault.hasRecord;
+}
+
+bool
+FLT_isWarmRestart(void)
+{
+	return fault.warmRestart;
+}
+
+bool
+FLT_isSafeMode(void)
+{
+	return fault.safeMode;
+}
+
+const _FLT_record*
+FLT_getRecord(void)
+{
+	return &fltRecord;
+}
+
+/***************************************************************
+ * Function:	void FLT_printRecord(void)
+ *
+ * Purpose:		To print the fault record to stdout (USB)
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+FLT_printRecord(void)
+{
+	if(!fault.hasRecord)
+	{
+		printf("FAULT none\r\n");
+		return;
+	}
+
+	printf("FAULT %s code=%u pc=0x%08x lr=0x%08x psr=0x%08x isr=%u\r\n",
+			(fltRecord.source == FLT_SOURCE_TRAP) ? "trap" : "hard",
+			fltRecord.trapCode,
+			(unsigned int)fltRecord.pc, (unsigned int)fltRecord.lr,
+			(unsigned int)fltRecord.xpsr, fltRecord.activeIsr);
+	printf("FAULT cfsr=0x%08x hfsr=0x%08x mmfar=0x%08x bfar=0x%08x exc=0x%08x\r\n",
+			(unsigned int)fltRecord.cfsr, (unsigned int)fltRecord.hfsr,
+			(unsigned int)fltRecord.mmfar, (unsigned int)fltRecord.bfar,
+			(unsigned int)fltRecord.excReturn);
+	printf("FAULT r0=0x%08x r1=0x%08x r2=0x%08x r3=0x%08x r12=0x%08x\r\n",
+			(unsigned int)fltRecord.r0, (unsigned int)fltRecord.r1,
+			(unsigned int)fltRecord.r2, (unsigned int)fltRecord.r3,
+			(unsigned int)fltRecord.r12);
+	printf("FAULT t=%ums motor=%u pwm=%u/%u/%u restarts=%u%s\r\n",
+			(unsigned int)fltRecord.timeMs, fltRecord.motorState,
+			fltRecord.pwm[0], fltRecord.pwm[1], fltRecord.pwm[2],
+			fault.restarts, fault.safeMode ? " safe mode" : "");
+
+	return;
+} // END FLT_printRecord()
+
+/***************************************************************
+ * Function:	void FLT_clearRecord(void)
+ *
+ * Purpose:		To discard the fault record and leave safe mode
+ * 					at the next start-up
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	fault, fltRecord
+ **************************************************************/
+void
+FLT_clearRecord(void)
+{
+	BKP_WriteBackupRegister(FLT_BKP_RECORD, 0);
+	BKP_WriteBackupRegister(FLT_BKP_RESTARTS, 0);
+
+	memset(&fltRecord, 0, sizeof(fltRecord));
+	fault.hasRecord = false;
+	fault.restarts = 0;
+
+	return;
+} // END FLT_clearRecord()
+
+/***************************************************************
+ * Function:	void FLT_trap(_FLT_trapCode code)
+ *
+ * Purpose:		Programmer's trap.  Records the caller's address
+ * 					and the trap code, then restarts the drive.
+ *
+ * Parameters:	_FLT_trapCode code
+ *
+ * Returns:		does not return
+ *
+ * Globals affected:	fltRecord
+ **************************************************************/
+void __attribute__((noinline))
+FLT_trap(_FLT_trapCode code)
+{
+	__disable_irq();
+
+	// Bridge outputs off before anything else
+	TIM1->BDTR &= (uint16_t)~TIM_BDTR_MOE;
+
+	memset(&fltRecord, 0, sizeof(fltRecord));
+	fltRecord.source = FLT_SOURCE_TRAP;
+	fltRecord.trapCode = (uint8_t)code;
+	fltRecord.pc = (uint32_t)__builtin_return_address(0);
+	fltRecord.activeIsr = (uint16_t)(FLT_getIpsr() & 0x1FF);
+	FLT_saveRecord();
+
+	FLT_warmRestart();
+} // END FLT_trap()
+
+/***************************************************************
+ * Function:	void FLT_warmRestart(void)
+ *
+ * Purpose:		To restart the drive through a system reset.  The
+ * 					reset returns every peripheral and the NVIC to
+ * 					its reset state, which is the only way to leave
+ * 					an active fault handler cleanly; the flag left
+ * 					in the backup domain lets start-up keep the
+ * 					clock the bootloader brought up (SystemInit())
+ * 					and skip the ADC calibration (ADC_initAdc()).
+ *
+ * Parameters:	none
+ *
+ * Returns:		does not return
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+FLT_warmRestart(void)
+{
+	__disable_irq();
+
+	TIM1->BDTR &= (uint16_t)~TIM_BDTR_MOE;
+
+	RCC->APB1ENR |= RCC_APB1ENR_PWREN | RCC_APB1ENR_BKPEN;
+	PWR->CR |= PWR_CR_DBP;
+	BKP_WriteBackupRegister(FLT_BKP_WARM, FLT_BKP_WARM_FLAG);
+
+	NVIC_SystemReset();
+
+	while(1);
+} // END FLT_warmRestart()
+
+/***************************************************************
+ * Function:	void HardFault_Handler(void)
+ *
+ * Purpose:		Hard fault entry.  Passes the stack frame of the
+ * 					faulting code (MSP or PSP, from EXC_RETURN bit 2)
+ * 					and EXC_RETURN itself to FLT_handleFault().
+ * 					MemManage, BusFault and UsageFault are left
+ * 					disabled so they all escalate to here; CFSR still
+ * 					tells them apart.
+ *
+ * Parameters:	none
+ *
+ * Returns:		does not return
+ *
+ * Globals affected:	none
+ **************************************************************/
+void __attribute__((naked))
+HardFault_Handler(void)
+{
+	__asm volatile(
+		"  tst   lr, #4\n"
+		"  ite   eq\n"
+		"  mrseq r0, msp\n"
+		"  mrsne r0, psp\n"
+		"  mov   r1, lr\n"
+		"  b     FLT_handleFault\n");
+}
+
+/***************************************************************
+ * Function:	void FLT_handleFault(uint32_t *frame, uint32_t excReturn)
+ *
+ * Purpose:		To make the bridge safe, record the fault and
+ * 					restart the drive
+ *
+ * Parameters:	uint32_t *frame			stacked r0-r3, r12, lr, pc, xpsr
+ * 				uint32_t excReturn		LR on fault entry
+ *
+ * Returns:		does not return
+ *
+ * Globals affected:	fltRecord
+ **************************************************************/
+void
+FLT_handleFault(uint32_t *frame, uint32_t excReturn)
+{
+	// Bridge outputs off first, the record can wait a few cycles
+	TIM1->BDTR &= (uint16_t)~TIM_BDTR_MOE;
+
+	memset(&fltRecord, 0, sizeof(fltRecord));
+	fltRecord.source = FLT_SOURCE_HARD_FAULT;
+	fltRecord.excReturn = excReturn;
+	fltRecord.cfsr = SCB->CFSR;
+	fltRecord.hfsr = SCB->HFSR;
+	fltRecord.mmfar = SCB->MMFAR;
+	fltRecord.bfar = SCB->BFAR;
+
+	// A stack pointer outside SRAM would fault again on the first read
+	if(((uint32_t)frame >= FLT_SRAM_START) && ((uint32_t)frame <= FLT_SRAM_END - FLT_FRAME_BYTES))
+	{
+		fltRecord.r0 = frame[0];
+		fltRecord.r1 = frame[1];
+		fltRecord.r2 = frame[2];
+		fltRecord.r3 = frame[3];
+		fltRecord.r12 = frame[4];
+		fltRecord.lr = frame[5];
+		fltRecord.pc = frame[6];
+		fltRecord.xpsr = frame[7];
+		fltRecord.activeIsr = (uint16_t)(frame[7] & 0x1FF);
+	}
+
+	FLT_saveRecord();
+
+	FLT_warmRestart();
+} // END FLT_handleFault()
+
+/***************************************************************
+ * Function:	void FLT_saveRecord(void)
+ *
+ * Purpose:		To complete the fault record with the time and the
+ * 					control-state snapshot, seal it and copy the key
+ * 					fields to the backup registers
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	fltRecord, backup registers
+ **************************************************************/
+void
+FLT_saveRecord(void)
+{
+	fltRecord.magic = FLT_RECORD_MAGIC;
+	fltRecord.timeMs = MSTMR_getMilliSeconds();
+	fltRecord.motorState = MOT_getMotorState();
+	fltRecord.pwm[0] = TIM1->CCR1;
+	fltRecord.pwm[1] = TIM1->CCR2;
+	fltRecord.pwm[2] = TIM1->CCR3;
+	fltRecord.check = ~fltRecord.pc;
+
+	// Keep the waveform leading up to the fault
+	SCP_faultTrigger();
+
+	// The backup interface may not be clocked yet if the fault hit early
+	RCC->APB1ENR |= RCC_APB1ENR_PWREN | RCC_APB1ENR_BKPEN;
+	PWR->CR |= PWR_CR_DBP;
+
+	BKP_WriteBackupRegister(FLT_BKP_RECORD, FLT_BKP_RECORD_FLAG);
+	BKP_WriteBackupRegister(FLT_BKP_PC_LO, (uint16_t)fltRecord.pc);
+	BKP_WriteBackupRegister(FLT_BKP_PC_HI, (uint16_t)(fltRecord.pc >> 16));
+	BKP_WriteBackupRegister(FLT_BKP_SOURCE, (uint16_t)(fltRecord.source | (fltRecord.trapCode << 8)));
+	BKP_WriteBackupRegister(FLT_BKP_ISR, fltRecord.activeIsr);
+	BKP_WriteBackupRegister(FLT_BKP_RESTARTS, BKP_ReadBackupRegister(FLT_BKP_RESTARTS) + 1);
+
+	return;
+} // END FLT_saveRecord()
+
+uint32_t
+FLT_getIpsr(void)
+{
+	uint32_t ipsr;
+
+	__asm volatile("mrs %0, ipsr" : "=r" (ipsr));
+
+	return ipsr;
+}
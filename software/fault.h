@@ -0,0 +1,77 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef FAULT_H
+#define FAULT_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+// After this many faults in a row without FLT_STABLE_MS of clean running
+//	the drive still restarts, but in safe mode: the motor is not driven
+//	and the fault record stays readable over USB
+#define FLT_MAX_WARM_RESTARTS		3
+#define FLT_STABLE_MS				5000
+
+// Left in backup register 1 by FLT_warmRestart(); SystemInit() reads it
+//	before anything else runs, to keep the clock the bootloader set up
+#define FLT_BKP_WARM_FLAG			0x57A3
+
+// What caused the last restart
+typedef enum
+{
+	FLT_SOURCE_NONE,
+	FLT_SOURCE_HARD_FAULT,
+	FLT_SOURCE_TRAP
+} _FLT_source;
+
+// Codes passed to FLT_trap() by programmer's traps
+typedef enum
+{
+	FLT_TRAP_NONE,
+	FLT_TRAP_GPIO_PIN,
+	FLT_TRAP_GPIO_PORT,
+	FLT_TRAP_CLI_TABLE
+} _FLT_trapCode;
+
+// Fault record, kept in RAM that is not cleared at start-up
+typedef struct
+{
+	uint32_t magic;
+	uint32_t r0, r1, r2, r3, r12;	// stacked registers
+	uint32_t lr, pc, xpsr;
+	uint32_t excReturn;				// LR value on fault entry
+	uint32_t cfsr;					// fault status registers
+	uint32_t hfsr;
+	uint32_t mmfar;
+	uint32_t bfar;
+	uint32_t timeMs;				// milliseconds since start-up
+	uint16_t activeIsr;				// exception number that was running, 0 = main()
+	uint8_t source;					// _FLT_source
+	uint8_t trapCode;				// _FLT_trapCode
+	uint8_t motorState;				// control-state snapshot
+	uint16_t pwm[3];				// TIM1 CCR1..CCR3 at the time of the fault
+	uint32_t check;
+} _FLT_record;
+
+void FLT_initFault(void);
+void FLT_process(uint32_t now);
+bool FLT_hasRecord(void);
+bool FLT_isWarmRestart(void);
+bool FLT_isSafeMode(void);
+const _FLT_record* FLT_getRecord(void);
+void FLT_printRecord(void);
+void FLT_clearRecord(void);
+
+// Programmer's trap: records the caller and restarts the drive
+void FLT_trap(_FLT_trapCode code) __attribute__((noreturn));
+
+void FLT_warmRestart(void) __attribute__((noreturn));
+
+#endif
@@ -0,0 +1,256 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <string.h>
+#include "stm32f10x.h"
+#include "stm32f10x_crc.h"
+#include "stm32f10x_rcc.h"
+#include "buffer.h"
+#include "hw_config.h"
+
+/* User-generated libs */
+#include "frame.h"
+
+#define FRM_CRC_WORDS		((1 + FRM_MAX_PAYLOAD + 3) / 4)
+
+EXTERN_BUFFER(USB_TX, 512);
+
+/***************************************************************
+ * Function:	void FRM_initFrame(void)
+ *
+ * Purpose:		To clock the hardware CRC unit
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+FRM_initFrame(void)
+{
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_CRC, ENABLE);
+
+	return;
+} // END FRM_initFrame()
+
+/***************************************************************
+ * Function:	uint32_t FRM_crc(const uint8_t *data, uint16_t length)
+ *
+ * Purpose:		To calculate the frame CRC with the hardware CRC
+ * 					unit.  The data is zero-padded to whole words.
+ * 					Main-loop context only, the CRC unit is not
+ * 					shared with interrupts.
+ *
+ * Parameters:	const uint8_t *data		type and payload
+ * 				uint16_t length			at most 1 + FRM_MAX_PAYLOAD
+ *
+ * Returns:		CRC
+ *
+ * Globals affected:	CRC unit
+ **************************************************************/
+uint32_t
+FRM_crc(const uint8_t *data, uint16_t length)
+{
+	uint32_t words[FRM_CRC_WORDS];
+
+	words[(length - 1) / 4] = 0;
+	memcpy(words, data, length);
+
+	CRC_ResetDR();
+	return CRC_CalcBlockCRC(words, (length + 3) / 4);
+} // END FRM_crc()
+
+/***************************************************************
+ * Function:	uint16_t FRM_cobsEncode(const uint8_t *source, uint16_t length,
+ * 						uint8_t *destination)
+ *
+ * Purpose:		To COBS-encode a block so that it contains no 0x00
+ *
+ * Parameters:	const uint8_t *source
+ * 				uint16_t length
+ * 				uint8_t *destination	length + length / 254 + 1 bytes
+ *
+ * Returns:		encoded length
+ *
+ * Globals affected:	none
+ **************************************************************/
+uint16_t
+FRM_cobsEncode(const uint8_t *source, uint16_t length, uint8_t *destination)
+{
+	uint8_t *code = destination;		// where the current block length goes
+	uint8_t *next = destination + 1;
+	uint8_t blockLength = 1;
+
+	while(length--)
+	{
+		if(*source == 0)
+		{
+			*code = blockLength;
+			code = next++;
+			blockLength = 1;
+		}
+		else
+		{
+			*next++ = *source;
+
+			if(++blockLength == 0xFF)
+			{
+				*code = blockLength;
+				code = next++;
+				blockLength = 1;
+			}
+		}
+
+		source++;
+	}
+
+	*code = blockLength;
+
+	return (uint16_t)(next - destination);
+} // END FRM_cobsEncode()
+
+/***************************************************************
+ * Function:	bool FRM_sendFrame(uint8_t type, const void *payload,
+ * 						uint16_t length)
+ *
+ * Purpose:		To queue one frame on the USB link.  A frame is
+ * 					queued whole or not at all.
+ *
+ * Parameters:	uint8_t type			_FRM_type
+ * 				const void *payload
+ * 				uint16_t length			at most FRM_MAX_PAYLOAD
+ *
+ * Returns:		false when the frame did not fit and was dropped
+ *
+ * Globals affected:	USB_TX
+ **************************************************************/
+bool
+FRM_sendFrame(uint8_t type, const void *payload, uint16_t length)
+{
+	uint8_t raw[1 + FRM_MAX_PAYLOAD + 4];
+	uint8_t encoded[FRM_MAX_ENCODED];
+	uint16_t encodedLength;
+	uint32_t crc;
+
+	if(length > FRM_MAX_PAYLOAD)
+	{
+		return false;
+	}
+
+	raw[0] = type;
+	memcpy(&raw[1], payload, length);
+	crc = FRM_crc(raw, 1 + length);
+	raw[1 + length] = (uint8_t)crc;
+	raw[2 + length] = (uint8_t)(crc >> 8);
+	raw[3 + length] = (uint8_t)(crc >> 16);
+	raw[4 + length] = (uint8_t)(crc >> 24);
+
+	encoded[0] = FRM_DELIMITER;
+	encodedLength = 1 + FRM_cobsEncode(raw, 5 + length, &encoded[1]);
+	encoded[encodedLength++] = FRM_DELIMITER;
+
+	if(BUFFER_FREE_SPACE(USB_TX) < encodedLength)
+	{
+		return false;
+	}
+
+	USB_TX_Put(encoded, encodedLength);
+	Handle_USBAsynchXfer();
+
+	return true;
+} // END FRM_sendFrame()
+
+/***************************************************************
+ * Function:	int16_t FRM_cobsDecode(const uint8_t *source, uint16_t length,
+ * 						uint8_t *destination)
+ *
+ * Purpose:		To undo FRM_cobsEncode()
+ *
+ * Parameters:	const uint8_t *source	without delimiters
+ * 				uint16_t length
+ * 				uint8_t *destination	length bytes
+ *
+ * Returns:		decoded length, -1 if the block is not valid COBS
+ *
+ * Globals affected:	none
+ **************************************************************/
+int16_t
+FRM_cobsDecode(const uint8_t *source, uint16_t length, uint8_t *destination)
+{
+	const uint8_t *end = source + length;
+	uint8_t *next = destination;
+	uint8_t code;
+	uint8_t i;
+
+	while(source < end)
+	{
+		code = *source++;
+		if((code == 0) || ((source + code - 1) > end))
+		{
+			return -1;
+		}
+
+		for(i = 1; i < code; i++)
+		{
+			*next++ = *source++;
+		}
+
+		// A full block has no implicit zero, nor has the last one
+		if((code != 0xFF) && (source < end))
+		{
+			*next++ = 0;
+		}
+	}
+
+	return (int16_t)(next - destination);
+} // END FRM_cobsDecode()
+
+/***************************************************************
+ * Function:	int16_t FRM_unpackFrame(const uint8_t *encoded, uint16_t length,
+ * 						uint8_t *raw)
+ *
+ * Purpose:		To decode a received frame and check its CRC
+ *
+ * Parameters:	const uint8_t *encoded	between the delimiters
+ * 				uint16_t length			at most FRM_MAX_ENCODED - 2
+ * 				uint8_t *raw			type then payload, length bytes
+ *
+ * Returns:		payload length, -1 for a broken frame
+ *
+ * Globals affected:	CRC unit
+ **************************************************************/
+int16_t
+FRM_unpackFrame(const uint8_t *encoded, uint16_t length, uint8_t *raw)
+{
+	int16_t rawLength;
+	uint32_t crc;
+
+	if(length > (FRM_MAX_ENCODED - 2))
+	{
+		return -1;
+	}
+
+	rawLength = FRM_cobsDecode(encoded, length, raw);
+	if(rawLength < 5)
+	{
+		return -1;
+	}
+
+	rawLength -= 4;
+	crc = (uint32_t)raw[rawLength] | ((uint32_t)raw[rawLength + 1] << 8)
+		| ((uint32_t)raw[rawLength + 2] << 16) | ((uint32_t)raw[rawLength + 3] << 24);
+
+	if(FRM_crc(raw, rawLength) != crc)
+	{
+		return -1;
+	}
+
+	return rawLength - 1;
+} // END FRM_unpackFrame()
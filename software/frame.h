@@ -0,0 +1,54 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef FRAME_H
+#define FRAME_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Binary frames on the USB serial link
+ *
+ *	0x00 | COBS( type | payload | crc32 ) | 0x00
+ *
+ * COBS removes every 0x00 from the frame so 0x00 only ever delimits
+ *	frames; the leading delimiter also cuts off any text printed
+ *	just before.  crc32 is little-endian and comes from the hardware
+ *	CRC unit: CRC-32/MPEG-2 (poly 0x04C11DB7, init 0xFFFFFFFF, no
+ *	reflection, no final XOR) over type and payload zero-padded to a
+ *	multiple of 4 bytes, fed as little-endian 32-bit words; on a
+ *	byte-wise CRC that is each group of 4 bytes in reverse order.
+ */
+#define FRM_DELIMITER			0x00
+#define FRM_MAX_PAYLOAD			64
+
+// Bytes on the wire for a full frame: two delimiters, one COBS code
+//	byte (frames stay below 254 bytes), type, payload and CRC
+#define FRM_MAX_ENCODED			(2 + 1 + 1 + FRM_MAX_PAYLOAD + 4)
+
+typedef enum
+{
+	FRM_TYPE_TELEMETRY = 0x01,
+	FRM_TYPE_LOG = 0x02,
+	FRM_TYPE_SCOPE = 0x03,
+	FRM_TYPE_PARAM_REQUEST = 0x10,		// host to drive, see param.h
+	FRM_TYPE_PARAM_RESPONSE = 0x11,
+	FRM_TYPE_BOOT_REQUEST = 0x20,		// host to bootloader, see bootloader.h
+	FRM_TYPE_BOOT_RESPONSE = 0x21
+} _FRM_type;
+
+void FRM_initFrame(void);
+uint32_t FRM_crc(const uint8_t *data, uint16_t length);
+uint16_t FRM_cobsEncode(const uint8_t *source, uint16_t length, uint8_t *destination);
+bool FRM_sendFrame(uint8_t type, const void *payload, uint16_t length);
+int16_t FRM_cobsDecode(const uint8_t *source, uint16_t length, uint8_t *destination);
+int16_t FRM_unpackFrame(const uint8_t *encoded, uint16_t length, uint8_t *raw);
+
+#endif
@@ -9,6 +9,37 @@
 #include "stm32f10x_gpio.h"
 
 #include "gpio.h"
+#include "fault.h"
+#include "pinMap.h"
+
+/***************************************************************
+ * Function:	void GPIO_initPins(void)
+ *
+ * Purpose:		To set up every pin that keeps its mode, as the
+ * 					board revision's pin map (pinMap.h) lists them:
+ * 					the analog inputs, the hall sensors, the tach
+ * 					output and the TIM1 outputs.  The pins a module
+ * 					switches at run time are left to that module.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	GPIOA, GPIOB
+ **************************************************************/
+void
+GPIO_initPins(void)
+{
+	GPIOA->CRL = (GPIOA->CRL & ~PIN_INIT_A_CRL_MASK) | PIN_INIT_A_CRL;
+	GPIOA->CRH = (GPIOA->CRH & ~PIN_INIT_A_CRH_MASK) | PIN_INIT_A_CRH;
+	GPIOA->BSRR = PIN_INIT_A_BSRR;
+
+	GPIOB->CRL = (GPIOB->CRL & ~PIN_INIT_B_CRL_MASK) | PIN_INIT_B_CRL;
+	GPIOB->CRH = (GPIOB->CRH & ~PIN_INIT_B_CRH_MASK) | PIN_INIT_B_CRH;
+	GPIOB->BSRR = PIN_INIT_B_BSRR;
+
+	return;
+} // END GPIO_initPins()
 
 void
 GPIO_pinSetup(_port port, uint16_t pin, uint8_t pinState)
@@ -27,10 +58,10 @@ GPIO_pinSetup(_port port, uint16_t pin, uint8_t pinState)
 				GPIOA->CRH |= (uint32_t)(pinState << ((pin - 8) * 4));
 			}else{
 				/*
-				 * This is a programmer's trap.  If the code gets to this while loop,
-				 * then an invalid pin within this port has been specified.
+				 * This is a programmer's trap.  If the code gets here, then an
+				 * invalid pin within this port has been specified.
 				 */
-				while(1);
+				FLT_trap(FLT_TRAP_GPIO_PIN);
 			}
 			break;
 		} // END case GPIO_PORT_A
@@ -47,10 +78,10 @@ GPIO_pinSetup(_port port, uint16_t pin, uint8_t pinState)
 				GPIOB->CRH |= (uint32_t)(pinState << ((pin - 8) * 4));
 			}else{
 				/*
-				 * This is a programmer's trap.  If the code gets to this while loop,
-				 * then an invalid pin within this port has been specified.
+				 * This is a programmer's trap.  If the code gets here, then an
+				 * invalid pin within this port has been specified.
 				 */
-				while(1);
+				FLT_trap(FLT_TRAP_GPIO_PIN);
 			}
 
 			break;
@@ -59,117 +90,13 @@ GPIO_pinSetup(_port port, uint16_t pin, uint8_t pinState)
 		default:
 		{
 			/*
-			 * This is a programmer's trap.  If the code gets to this while loop,
-			 * then an invalid port has been specified.
+			 * This is a programmer's trap.  If the code gets here, then an
+			 * invalid port has been specified.
 			 */
-			while(1);
+			FLT_trap(FLT_TRAP_GPIO_PORT);
 			break;
 		}
 	} // END switch
 
 	return;
 } // END GPIO_pinSetup()
-
-void
-GPIO_setOutputPin(_port port, uint16_t pin)
-{
-	switch(port)
-	{
-		case GPIO_PORT_A:
-		{
-			//GPIOA->BSSR |= (uint32_t)(0b1 << pin);
-			GPIOA->ODR |= (uint32_t)(0b1 << pin);
-
-			break;
-		}
-
-		case GPIO_PORT_B:
-		{
-			//GPIOB->BSSR |= (uint32_t)(0b1 << pin);
-			GPIOB->ODR |= (uint32_t)(0b1 << pin);
-
-			break;
-		}
-
-		default:
-		{
-			/*
-			 * This is a programmer's trap.  If the code gets to this while loop,
-			 * then an invalid port has been specified.
-			 */
-			while(1);
-			break;
-		}
-	} // END switch
-
-	return;
-} // END GPIO_setOutputPin()
-
-void
-GPIO_clearOutputPin(_port port, uint16_t pin)
-{
-	switch(port)
-	{
-		case GPIO_PORT_A:
-		{
-			//GPIOA->BSSR |= (uint32_t)(0b1 << (pin + 16));
-			GPIOA->ODR &= (uint32_t)~(0b1 << pin);
-
-			break;
-		}
-
-		case GPIO_PORT_B:
-		{
-			//GPIOB->BSSR |= (uint32_t)(0b1 << (pin + 16));
-			GPIOB->ODR &= (uint32_t)~(0b1 << pin);
-
-			break;
-		}
-
-		default:
-		{
-			/*
-			 * This is a programmer's trap.  If the code gets to this while loop,
-			 * then an invalid port has been specified.
-			 */
-			while(1);
-			break;
-		}
-	} // END switch
-
-	return;
-} // END GPIO_clearOutputPin()
-
-bool
-GPIO_readInput(_port port, uint16_t pin)
-{
-	bool pinState = 0;
-
-	switch(port)
-	{
-		case GPIO_PORT_A:
-		{
-			pinState = (bool)((GPIOA->IDR & (uint32_t)(0b1 << pin)) >> pin);
-			break;
-		}
-
-		case GPIO_PORT_B:
-		{
-			pinState = (bool)((GPIOB->IDR & (uint32_t)(0b1 << pin)) >> pin);
-
-			break;
-		}
-
-		default:
-		{
-			/*
-			 * This is a programmer's trap.  If the code gets to this while loop,
-			 * then an invalid port has been specified.
-			 */
-			while(1);
-			break;
-		}
-	} // END switch
-
-	return pinState;
-} // END GPIO_readInput()
@@ -8,6 +8,7 @@
 *************************************************/
 #include <stdbool.h>
 #include <stdint.h>
+#include "stm32f10x.h"
 
 #ifndef GPIO_H
 #define GPIO_H
@@ -29,9 +30,43 @@ typedef enum
 #define GPIO_LO	0
 #define GPIO_HI	1
 
+void GPIO_initPins(void);
 void GPIO_pinSetup(_port port, uint16_t pin, uint8_t pinState);
-void GPIO_setOutputPin(_port port, uint16_t pin);
-void GPIO_clearOutputPin(_port port, uint16_t pin);
-bool GPIO_readInput(_port port, uint16_t pin);
+
+/*
+ * Pin access, by GPIO block (GPIOA, or PIN_<name>_GPIO of pinMap.h)
+ *	and pin mask.  Outputs change through BSRR/BRR, a single store, so
+ *	an interrupt between the read and the write of ODR cannot undo
+ *	another pin's change; a group of inputs is one IDR read.  Always
+ *	inlined, so that a -O0 debug build has no calls on the ISR paths
+ *	either.
+ */
+#define GPIO_INLINE		static inline __attribute__((always_inline))
+
+GPIO_INLINE void
+GPIO_setPins(GPIO_TypeDef *gpio, uint16_t mask)
+{
+	gpio->BSRR = mask;
+}
+
+GPIO_INLINE void
+GPIO_clearPins(GPIO_TypeDef *gpio, uint16_t mask)
+{
+	gpio->BRR = mask;
+}
+
+// Sets and clears in the same store; a pin in both masks is set
+GPIO_INLINE void
+GPIO_writePins(GPIO_TypeDef *gpio, uint16_t setMask, uint16_t clearMask)
+{
+	gpio->BSRR = ((uint32_t)clearMask << 16) | setMask;
+}
+
+// The pins of mask, shifted down by shift (a group's lowest pin)
+GPIO_INLINE uint16_t
+GPIO_readPins(GPIO_TypeDef *gpio, uint16_t mask, uint8_t shift)
+{
+	return (uint16_t)((gpio->IDR & mask) >> shift);
+}
 
 #endif
@@ -0,0 +1,472 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include "stm32f10x.h"
+#include "stm32f10x_rcc.h"
+
+/* User-generated libs */
+#include "i2cSlave.h"
+#include "adc.h"
+#include "fault.h"
+#include "gpio.h"
+#include "milliSecTimer.h"
+#include "motor.h"
+#include "perfMon.h"
+#include "pinMap.h"
+
+// I2C1 SR1/SR2 and CR1/CR2 bits
+#define I2CS_SR1_ADDR			(1 << 1)
+#define I2CS_SR1_BTF			(1 << 2)
+#define I2CS_SR1_STOPF			(1 << 4)
+#define I2CS_SR1_BERR			(1 << 8)
+#define I2CS_SR1_ARLO			(1 << 9)
+#define I2CS_SR1_AF				(1 << 10)
+#define I2CS_SR1_OVR			(1 << 11)
+#define I2CS_SR2_TRA			(1 << 2)
+#define I2CS_CR1_PE				(1 << 0)
+#define I2CS_CR1_ACK			(1 << 10)
+#define I2CS_CR2_ITERREN		(1 << 8)
+#define I2CS_CR2_ITEVTEN		(1 << 9)
+#define I2CS_CR2_DMAEN			(1 << 11)
+
+// DMA1 channel CCR bits; I2C1 TX is channel 6, RX channel 7
+#define I2CS_DMA_EN				(1 << 0)
+#define I2CS_DMA_FROM_MEMORY	(1 << 4)
+#define I2CS_DMA_MINC			(1 << 7)
+#define I2CS_DMA_PRIORITY_HIGH	(0b10 << 12)
+
+#define I2CS_NO_BUFFER			0xFF
+
+/* Global variables */
+typedef struct
+{
+	// Snapshots for the master to read.  The main loop fills the one
+	//	that is neither published nor being read, then publishes it.
+	uint8_t snapshot[2][I2CS_MAP_SIZE];
+	volatile uint8_t published;
+	volatile uint8_t reading;			// snapshot locked by a read transfer
+
+	// Pointer byte plus a full map written in one transfer
+	uint8_t received[1 + I2CS_MAP_SIZE];
+
+	// Written by the I2C ISR, read by the main loop
+	volatile uint8_t pointer;
+	volatile uint8_t mode;
+	volatile uint16_t setpoint;
+	volatile uint16_t timeoutMs;
+	volatile uint32_t setpointTime;
+
+	uint8_t address;
+	uint16_t sequence;
+	bool timedOut;
+} _i2cSlave;
+
+_i2cSlave i2cSlave;
+
+/* Private function declarations */
+void I2CS_startTransfer(void);
+void I2CS_endWrite(void);
+void I2CS_endRead(void);
+void I2CS_put16(uint8_t *snapshot, uint8_t reg, uint16_t value);
+
+/***************************************************************
+ * Function:	void I2CS_initI2cSlave(void)
+ *
+ * Purpose:		To set up I2C1 as a slave at I2CS_DEFAULT_ADDRESS,
+ * 					with DMA for the data and interrupts on the
+ * 					address match, the stop condition and errors.
+ * 					The interrupts sit below the control ISR.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	I2C1, DMA1 channels 6 and 7, i2cSlave
+ **************************************************************/
+void
+I2CS_initI2cSlave(void)
+{
+	i2cSlave.published = 0;
+	i2cSlave.reading = I2CS_NO_BUFFER;
+	i2cSlave.pointer = 0;
+	i2cSlave.mode = I2CS_MODE_MONITOR;
+	i2cSlave.setpoint = 0;
+	i2cSlave.timeoutMs = I2CS_DEFAULT_TIMEOUT_MS;
+	i2cSlave.sequence = 0;
+	i2cSlave.timedOut = false;
+	I2CS_process();
+
+	// I2C1 is not remapped
+	GPIO_pinSetup(PIN_I2C_SCL_PORT, PIN_I2C_SCL_PIN, GPIO_OUTPUT_ALT_OPEN_DR);
+	GPIO_pinSetup(PIN_I2C_SDA_PORT, PIN_I2C_SDA_PIN, GPIO_OUTPUT_ALT_OPEN_DR);
+
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_I2C1, ENABLE);
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+	// Peripheral clock in MHz (APB1 @36MHz), needed for the bus timing
+	//	even as a slave
+	I2C1->CR2 = 36 | I2CS_CR2_ITERREN | I2CS_CR2_ITEVTEN | I2CS_CR2_DMAEN;
+
+	DMA1_Channel6->CPAR = (uint32_t)&I2C1->DR;
+	DMA1_Channel7->CPAR = (uint32_t)&I2C1->DR;
+
+	I2CS_setAddress(I2CS_DEFAULT_ADDRESS);
+
+	I2C1->CR1 = I2CS_CR1_PE;
+	I2C1->CR1 = I2CS_CR1_PE | I2CS_CR1_ACK;		// ACK can only be set once enabled
+
+	NVIC_SetPriority(I2C1_EV_IRQn, 8);
+	NVIC_SetPriority(I2C1_ER_IRQn, 8);
+	NVIC_EnableIRQ(I2C1_EV_IRQn);
+	NVIC_EnableIRQ(I2C1_ER_IRQn);
+
+	return;
+} // END I2CS_initI2cSlave()
+
+/***************************************************************
+ * Function:	void I2CS_setAddress(uint8_t address)
+ *
+ * Purpose:		To move the drive to another 7-bit address, so
+ * 					that several drives can share one bus
+ *
+ * Parameters:	uint8_t address		I2CS_MIN_ADDRESS to I2CS_MAX_ADDRESS
+ *
+ * Returns:		none
+ *
+ * Globals affected:	I2C1->OAR1, i2cSlave.address
+ **************************************************************/
+void
+I2CS_setAddress(uint8_t address)
+{
+	if((address < I2CS_MIN_ADDRESS) || (address > I2CS_MAX_ADDRESS))
+	{
+		return;
+	}
+
+	i2cSlave.address = address;
+
+	// Bit 14 of OAR1 must be kept at 1
+	I2C1->OAR1 = (uint16_t)((1 << 14) | (address << 1));
+
+	return;
+} // END I2CS_setAddress()
+
+uint8_t
+I2CS_getAddress(void)
+{
+	return i2cSlave.address;
+}
+
+/***************************************************************
+ * Function:	bool I2CS_getSpeedDemand(uint16_t *speedDemand)
+ *
+ * Purpose:		To get the duty demand written by the master
+ *
+ * Parameters:	uint16_t *speedDemand	set while the mode is I2CS_MODE_DUTY
+ *
+ * Returns:		true while the mode is I2CS_MODE_DUTY and the
+ * 					setpoint timeout has not expired
+ *
+ * Globals affected:	i2cSlave.timedOut
+ **************************************************************/
+bool
+I2CS_getSpeedDemand(uint16_t *speedDemand)
+{
+	uint16_t timeoutMs = i2cSlave.timeoutMs;
+
+	if(i2cSlave.mode != I2CS_MODE_DUTY)
+	{
+		return false;
+	}
+
+	i2cSlave.timedOut = (timeoutMs != 0)
+			&& ((MSTMR_getMilliSeconds() - i2cSlave.setpointTime) > timeoutMs);
+
+	*speedDemand = i2cSlave.timedOut ? 0 : i2cSlave.setpoint;
+
+	return !i2cSlave.timedOut;
+} // END I2CS_getSpeedDemand()
+
+/***************************************************************
+ * Function:	void I2CS_process(void)
+ *
+ * Purpose:		To publish a fresh snapshot of the register map.
+ * 					Skipped when the free snapshot is still being
+ * 					read by the master; the next call catches up.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	i2cSlave.snapshot, i2cSlave.published
+ **************************************************************/
+void
+I2CS_process(void)
+{
+	uint8_t back = i2cSlave.published ^ 1;
+	uint8_t *snapshot = i2cSlave.snapshot[back];
+	uint8_t status = 0;
+
+	// A read that starts now locks the published snapshot, never this one
+	if(i2cSlave.reading == back)
+	{
+		return;
+	}
+
+	if(FLT_isSafeMode())
+		status |= I2CS_STATUS_SAFE_MODE;
+	if(FLT_hasRecord())
+		status |= I2CS_STATUS_FAULT_RECORD;
+	if((i2cSlave.mode == I2CS_MODE_DUTY) && !i2cSlave.timedOut)
+		status |= I2CS_STATUS_IN_CONTROL;
+	if(i2cSlave.timedOut)
+		status |= I2CS_STATUS_TIMED_OUT;
+
+	snapshot[I2CS_REG_WHO_AM_I] = I2CS_WHO_AM_I_VALUE;
+	snapshot[I2CS_REG_VERSION] = I2CS_MAP_VERSION;
+	snapshot[I2CS_REG_MODE] = i2cSlave.mode;
+	snapshot[I2CS_REG_MODE + 1] = 0;
+	I2CS_put16(snapshot, I2CS_REG_SETPOINT, i2cSlave.setpoint);
+	I2CS_put16(snapshot, I2CS_REG_TIMEOUT, i2cSlave.timeoutMs);
+	snapshot[I2CS_REG_STATUS] = status;
+	snapshot[I2CS_REG_MOTOR_STATE] = MOT_getMotorState();
+	snapshot[I2CS_REG_SECTOR] = (uint8_t)MOT_getSector();
+	snapshot[I2CS_REG_SECTOR + 1] = 0;
+	I2CS_put16(snapshot, I2CS_REG_DUTY, MOT_getDutyCycle());
+	I2CS_put16(snapshot, I2CS_REG_BUS_VOLTAGE, ADC_getVoltage(ADC_V_BUS));
+	I2CS_put16(snapshot, I2CS_REG_BUS_CURRENT, ADC_getVoltage(ADC_I_BUS));
+	I2CS_put16(snapshot, I2CS_REG_SEQUENCE, i2cSlave.sequence++);
+
+	// The snapshot must be complete before the ISR can pick it up
+	__asm volatile("" ::: "memory");
+	i2cSlave.published = back;
+
+	return;
+} // END I2CS_process()
+
+/***************************************************************
+ * Function:	void I2C1_EV_IRQHandler(void)
+ *
+ * Purpose:		To start the DMA on an address match and to
+ * 					finish a write transfer on the stop condition.
+ * 					BTF only fires when the master goes past the
+ * 					DMA buffer: extra writes are dropped and extra
+ * 					reads return 0xFF.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	I2C1, DMA1 channels 6 and 7, i2cSlave
+ **************************************************************/
+void
+I2C1_EV_IRQHandler(void)
+{
+	uint16_t sr1;
+
+	PERF_isrEnter();
+
+	sr1 = I2C1->SR1;
+
+	if(sr1 & I2CS_SR1_ADDR)
+	{
+		// A repeated start ends a write without a stop condition
+		if(DMA1_Channel7->CCR & I2CS_DMA_EN)
+		{
+			I2CS_endWrite();
+		}
+
+		I2CS_startTransfer();
+	}
+	else if(sr1 & I2CS_SR1_STOPF)
+	{
+		// Cleared by reading SR1, then writing CR1
+		I2C1->CR1 |= I2CS_CR1_PE;
+		I2CS_endWrite();
+		I2CS_endRead();
+	}
+	else if(sr1 & I2CS_SR1_BTF)
+	{
+		if(I2C1->SR2 & I2CS_SR2_TRA)
+			I2C1->DR = 0xFF;
+		else
+			(void)I2C1->DR;
+	}
+
+	PERF_isrExit();
+
+	return;
+} // END I2C1_EV_IRQHandler()
+
+/***************************************************************
+ * Function:	void I2C1_ER_IRQHandler(void)
+ *
+ * Purpose:		To end a read transfer on the master's NACK, and
+ * 					to recover from bus errors
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	I2C1, DMA1 channels 6 and 7, i2cSlave
+ **************************************************************/
+void
+I2C1_ER_IRQHandler(void)
+{
+	uint16_t sr1;
+
+	PERF_isrEnter();
+
+	sr1 = I2C1->SR1;
+	I2C1->SR1 = sr1 & (uint16_t)~(I2CS_SR1_BERR | I2CS_SR1_ARLO | I2CS_SR1_AF | I2CS_SR1_OVR);
+
+	// AF is the normal end of a read: the master NACKs its last byte
+	I2CS_endRead();
+
+	if(sr1 & (I2CS_SR1_BERR | I2CS_SR1_ARLO | I2CS_SR1_OVR))
+	{
+		DMA1_Channel7->CCR = 0;
+	}
+
+	PERF_isrExit();
+
+	return;
+} // END I2C1_ER_IRQHandler()
+
+void
+I2CS_startTransfer(void)
+{
+	uint8_t pointer = i2cSlave.pointer;
+	uint8_t locked;
+
+	// ADDR is cleared by reading SR2 after SR1
+	if(I2C1->SR2 & I2CS_SR2_TRA)
+	{
+		locked = i2cSlave.published;
+		i2cSlave.reading = locked;
+
+		DMA1_Channel6->CCR = 0;
+		if(pointer < I2CS_MAP_SIZE)
+		{
+			DMA1_Channel6->CMAR = (uint32_t)&i2cSlave.snapshot[locked][pointer];
+			DMA1_Channel6->CNDTR = I2CS_MAP_SIZE - pointer;
+			DMA1_Channel6->CCR = I2CS_DMA_PRIORITY_HIGH | I2CS_DMA_MINC | I2CS_DMA_FROM_MEMORY | I2CS_DMA_EN;
+		}
+	}
+	else
+	{
+		DMA1_Channel7->CCR = 0;
+		DMA1_Channel7->CMAR = (uint32_t)i2cSlave.received;
+		DMA1_Channel7->CNDTR = sizeof(i2cSlave.received);
+		DMA1_Channel7->CCR = I2CS_DMA_PRIORITY_HIGH | I2CS_DMA_MINC | I2CS_DMA_EN;
+	}
+
+	return;
+}
+
+/***************************************************************
+ * Function:	void I2CS_endWrite(void)
+ *
+ * Purpose:		To apply a write transfer: the first byte moves
+ * 					the pointer, the rest go to the writable
+ * 					registers.  Writes to read-only registers are
+ * 					ignored.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	i2cSlave
+ **************************************************************/
+void
+I2CS_endWrite(void)
+{
+	uint8_t count = sizeof(i2cSlave.received) - DMA1_Channel7->CNDTR;
+	const uint8_t *data = &i2cSlave.received[1];
+	uint8_t setpoint[2];
+	uint8_t timeout[2];
+	bool setpointWritten = false;
+	bool timeoutWritten = false;
+	uint8_t reg;
+	uint8_t i;
+
+	DMA1_Channel7->CCR = 0;
+
+	if(count == 0)
+	{
+		return;
+	}
+
+	i2cSlave.pointer = i2cSlave.received[0];
+
+	setpoint[0] = (uint8_t)i2cSlave.setpoint;
+	setpoint[1] = (uint8_t)(i2cSlave.setpoint >> 8);
+	timeout[0] = (uint8_t)i2cSlave.timeoutMs;
+	timeout[1] = (uint8_t)(i2cSlave.timeoutMs >> 8);
+
+	for(i = 0; i < (count - 1); i++)
+	{
+		reg = i2cSlave.pointer + i;
+
+		switch(reg)
+		{
+			case I2CS_REG_MODE:
+				if(data[i] <= I2CS_MODE_DUTY)
+				{
+					i2cSlave.mode = data[i];
+				}
+				break;
+
+			case I2CS_REG_SETPOINT:
+			case I2CS_REG_SETPOINT + 1:
+				setpoint[reg - I2CS_REG_SETPOINT] = data[i];
+				setpointWritten = true;
+				break;
+
+			case I2CS_REG_TIMEOUT:
+			case I2CS_REG_TIMEOUT + 1:
+				timeout[reg - I2CS_REG_TIMEOUT] = data[i];
+				timeoutWritten = true;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	// Whole halfwords, so the main loop never reads half a value
+	if(setpointWritten)
+	{
+		i2cSlave.setpoint = setpoint[0] | (setpoint[1] << 8);
+		i2cSlave.setpointTime = MSTMR_getMilliSeconds();
+	}
+
+	if(timeoutWritten)
+	{
+		i2cSlave.timeoutMs = timeout[0] | (timeout[1] << 8);
+	}
+
+	return;
+} // END I2CS_endWrite()
+
+void
+I2CS_endRead(void)
+{
+	DMA1_Channel6->CCR = 0;
+	i2cSlave.reading = I2CS_NO_BUFFER;
+	return;
+}
+
+void
+I2CS_put16(uint8_t *snapshot, uint8_t reg, uint16_t value)
+{
+	snapshot[reg] = (uint8_t)value;
+	snapshot[reg + 1] = (uint8_t)(value >> 8);
+	return;
+}
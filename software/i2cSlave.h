@@ -0,0 +1,79 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef I2CSLAVE_H
+#define I2CSLAVE_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * I2C slave control interface on I2C1 (PB6 SCL, PB7 SDA)
+ *
+ * The drive is a byte-addressed register map.  A write transfer
+ *	starts with the register pointer, any bytes after it are written
+ *	from there on; a read transfer reads from the pointer.  The
+ *	pointer is not moved by reads, so a master can set it once and
+ *	then poll a block with plain reads.  Multi-byte registers are
+ *	little-endian.
+ *
+ *	write:	S addr+W | pointer | data ... P
+ *	read:	S addr+R | data ... P		(or Sr after a pointer write)
+ *
+ * Bytes move by DMA; the CPU only sees the address match and the end
+ *	of each transfer.  A read returns one snapshot, published by the
+ *	main loop every millisecond, so multi-byte values never tear.
+ *	Reads past the end of the map return 0xFF.
+ */
+#define I2CS_DEFAULT_ADDRESS		0x28		// 7-bit, see the i2c.address parameter
+#define I2CS_MIN_ADDRESS			0x08		// 0x00-0x07 and 0x78-0x7F are reserved
+#define I2CS_MAX_ADDRESS			0x77
+
+// Setpoint timeout from start-up, as on CAN: a master that stops
+//	writing drops out of the demand arbitration.  It can write 0 to
+//	I2CS_REG_TIMEOUT to run without one.
+#define I2CS_DEFAULT_TIMEOUT_MS		100
+
+#define I2CS_WHO_AM_I_VALUE			0xD5
+#define I2CS_MAP_VERSION			1
+
+// Register addresses
+#define I2CS_REG_WHO_AM_I			0x00		// u8, read-only
+#define I2CS_REG_VERSION			0x01		// u8, read-only
+#define I2CS_REG_MODE				0x02		// u8, _I2CS_mode
+#define I2CS_REG_SETPOINT			0x04		// u16, duty demand 0-65535
+#define I2CS_REG_TIMEOUT			0x06		// u16, ms without a setpoint write before
+												//	I2C goes stale; 0 disables
+#define I2CS_REG_STATUS				0x08		// u8, I2CS_STATUS_* bits, read-only
+#define I2CS_REG_MOTOR_STATE		0x09		// u8, read-only
+#define I2CS_REG_SECTOR				0x0A		// i8, read-only
+#define I2CS_REG_DUTY				0x0C		// u16, applied duty, read-only
+#define I2CS_REG_BUS_VOLTAGE		0x0E		// u16, ADC counts, read-only
+#define I2CS_REG_BUS_CURRENT		0x10		// u16, ADC counts, read-only
+#define I2CS_REG_SEQUENCE			0x12		// u16, counts snapshots, read-only
+#define I2CS_MAP_SIZE				0x14
+
+typedef enum
+{
+	I2CS_MODE_MONITOR,					// registers readable, demand from elsewhere
+	I2CS_MODE_DUTY						// I2CS_REG_SETPOINT is the duty demand
+} _I2CS_mode;
+
+#define I2CS_STATUS_SAFE_MODE		0x01
+#define I2CS_STATUS_FAULT_RECORD	0x02
+#define I2CS_STATUS_IN_CONTROL		0x04		// mode is DUTY and the setpoint is fresh
+#define I2CS_STATUS_TIMED_OUT		0x08
+
+void I2CS_initI2cSlave(void);
+void I2CS_setAddress(uint8_t address);
+uint8_t I2CS_getAddress(void);
+bool I2CS_getSpeedDemand(uint16_t *speedDemand);
+void I2CS_process(void);
+
+#endif
@@ -0,0 +1,168 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include "stm32f10x.h"
+
+/* User-generated libs */
+#include "log.h"
+#include "frame.h"
+#include "perfMon.h"
+
+#define LOG_RING_MASK		(LOG_RING_WORDS - 1)
+
+/* Global variables */
+typedef struct
+{
+	// Producers in any context reserve words by moving head with
+	//	LDREX/STREX, fill them and write the header word last; a zero
+	//	header tells LOG_process() that the record is not complete yet.
+	//	LOG_process() zeroes every word it consumes.  The ring starts
+	//	zeroed with .bss, so no init is needed before the first LOG().
+	volatile uint32_t ring[LOG_RING_WORDS];
+	uint32_t head;
+	volatile uint32_t tail;
+	volatile uint32_t dropped;			// approximate when producers preempt each other
+} _logger;
+
+_logger logger;
+
+/***************************************************************
+ * Function:	void LOG_write(uint32_t header, uint32_t a, uint32_t b,
+ * 						uint32_t c, uint32_t d)
+ *
+ * Purpose:		To store one record; called by LOG().  Lock-free
+ * 					and safe from interrupts.  A record that does
+ * 					not fit is counted and dropped.
+ *
+ * Parameters:	uint32_t header		format address and argument count
+ * 				uint32_t a-d		arguments, unused ones ignored
+ *
+ * Returns:		none
+ *
+ * Globals affected:	logger
+ **************************************************************/
+void
+LOG_write(uint32_t header, uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+	uint32_t argc = header >> LOG_ARGC_SHIFT;
+	uint32_t words = LOG_HEADER_WORDS + argc;
+	uint32_t head;
+
+	do
+	{
+		head = __LDREXW(&logger.head);
+
+		if((head - logger.tail) > (LOG_RING_WORDS - words))
+		{
+			__CLREX();
+			logger.dropped++;
+			return;
+		}
+	} while(__STREXW(head + words, &logger.head));
+
+	logger.ring[(head + 1) & LOG_RING_MASK] = PERF_getCycles();
+
+	switch(argc)
+	{
+		case 4:	logger.ring[(head + 5) & LOG_RING_MASK] = d;	// no break
+		case 3:	logger.ring[(head + 4) & LOG_RING_MASK] = c;	// no break
+		case 2:	logger.ring[(head + 3) & LOG_RING_MASK] = b;	// no break
+		case 1:	logger.ring[(head + 2) & LOG_RING_MASK] = a;	// no break
+		default: break;
+	}
+
+	// Publish the record only after it is complete
+	__asm volatile("" ::: "memory");
+	logger.ring[head & LOG_RING_MASK] = header;
+
+	return;
+} // END LOG_write()
+
+/***************************************************************
+ * Function:	bool LOG_process(void)
+ *
+ * Purpose:		To send complete records as FRM_TYPE_LOG frames.
+ * 					Call on every pass through the main loop, so
+ * 					that a burst of records from the ISRs leaves
+ * 					before the ring fills.  Records that do not fit
+ * 					in the USB buffer stay in the ring.
+ *
+ * 					Frame payload, little-endian 32-bit words:
+ * 					dropped count, then whole records of
+ * 					header | cycles | arguments.
+ *
+ * Parameters:	none
+ *
+ * Returns:		true if a frame was sent
+ *
+ * Globals affected:	logger
+ **************************************************************/
+bool
+LOG_process(void)
+{
+	uint32_t payload[FRM_MAX_PAYLOAD / 4];
+	uint32_t tail = logger.tail;
+	uint32_t next;
+	uint32_t header;
+	uint32_t words;
+	uint8_t length;
+	uint8_t i;
+	bool sent = false;
+
+	while(1)
+	{
+		payload[0] = logger.dropped;
+		length = 1;
+		next = tail;
+
+		while(next != logger.head)
+		{
+			header = logger.ring[next & LOG_RING_MASK];
+			if(header == 0)
+			{
+				break;
+			}
+
+			words = LOG_HEADER_WORDS + (header >> LOG_ARGC_SHIFT);
+			if((length + words) > (FRM_MAX_PAYLOAD / 4))
+			{
+				break;
+			}
+
+			for(i = 0; i < words; i++)
+			{
+				payload[length++] = logger.ring[(next + i) & LOG_RING_MASK];
+			}
+
+			next += words;
+		}
+
+		if((next == tail) || !FRM_sendFrame(FRM_TYPE_LOG, payload, length * 4))
+		{
+			break;
+		}
+
+		// Hand the words back to the producers zeroed
+		for(; tail != next; tail++)
+		{
+			logger.ring[tail & LOG_RING_MASK] = 0;
+		}
+
+		logger.tail = tail;
+		sent = true;
+	}
+
+	return sent;
+} // END LOG_process()
+
+uint32_t
+LOG_getDropped(void)
+{
+	return logger.dropped;
+}
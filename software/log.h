@@ -0,0 +1,87 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef LOG_H
+#define LOG_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Deferred binary logging
+ *
+ *	LOG("sector %d forced after %u ms", sector, elapsed);
+ *
+ * Nothing is formatted on the target.  A log call stores the flash
+ *	address of its format string and up to LOG_MAX_ARGS raw 32-bit
+ *	arguments in a ring; LOG_process() sends the records as
+ *	FRM_TYPE_LOG frames and tools/logDecode.py formats them on the
+ *	host, reading the format strings out of the ELF.  LOG() may be
+ *	used from any context, interrupts included.
+ *
+ * Arguments are converted to uint32_t.  %s takes a pointer to a string
+ *	in flash, %f/%e/%g take LOG_FLOAT(x).
+ */
+#ifndef LOG_ENABLED
+#define LOG_ENABLED				1
+#endif
+
+#define LOG_MAX_ARGS			4
+
+// Ring size in 32-bit words, must be a power of two.  A record is
+//	LOG_HEADER_WORDS plus one word per argument.
+#define LOG_RING_WORDS			128
+#define LOG_HEADER_WORDS		2			// format address, CPU cycles
+
+// The argument count is kept in the top bits of the format address,
+//	which are zero for the STM32 flash at 0x08000000
+#define LOG_ARGC_SHIFT			28
+
+#if LOG_ENABLED
+#define LOG(...)				LOG_SELECT(__VA_ARGS__, LOG_4, LOG_3, LOG_2, LOG_1, LOG_0, )(__VA_ARGS__)
+#else
+#define LOG(...)				do { } while(0)
+#endif
+
+#define LOG_SELECT(format, a, b, c, d, name, ...)	name
+#define LOG_0(format)				LOG_EMIT(format, 0, 0, 0, 0, 0)
+#define LOG_1(format, a)			LOG_EMIT(format, 1, a, 0, 0, 0)
+#define LOG_2(format, a, b)			LOG_EMIT(format, 2, a, b, 0, 0)
+#define LOG_3(format, a, b, c)		LOG_EMIT(format, 3, a, b, c, 0)
+#define LOG_4(format, a, b, c, d)	LOG_EMIT(format, 4, a, b, c, d)
+
+// The format strings are grouped in .rodata.log so they are easy to
+//	find in the map file; only their addresses go over the link
+#define LOG_EMIT(format, argc, a, b, c, d)											\
+	do																				\
+	{																				\
+		static const char logFormat[] __attribute__((section(".rodata.log"))) = format;	\
+		LOG_write((uint32_t)logFormat | ((uint32_t)(argc) << LOG_ARGC_SHIFT),		\
+				(uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d));		\
+	} while(0)
+
+#define LOG_FLOAT(x)			LOG_floatBits(x)
+
+static inline uint32_t
+LOG_floatBits(float x)
+{
+	union
+	{
+		float f;
+		uint32_t u;
+	} bits = { x };
+
+	return bits.u;
+}
+
+void LOG_write(uint32_t header, uint32_t a, uint32_t b, uint32_t c, uint32_t d);
+bool LOG_process(void);
+uint32_t LOG_getDropped(void);
+
+#endif
@@ -15,55 +15,139 @@
 #include "osc.h"
 #include "milliSecTimer.h"
 #include "motor.h"
+#include "motorProfile.h"
 #include "rcPwm.h"
+#include "dshot.h"
 #include "adc.h"
+#include "perfMon.h"
+#include "memMon.h"
+#include "fault.h"
+#include "telemetry.h"
+#include "cli.h"
+#include "log.h"
+#include "scope.h"
+#include "param.h"
+#include "paramStore.h"
+#include "i2cSlave.h"
+#include "canNode.h"
+#include "analogInput.h"
+#include "demand.h"
+#include "uart.h"
+#include "boot.h"
 
 #include "stdio.h"
 double f;
 
-void initDio(void);
-
 int
 main(void)
 {
+	// Paint the stacks for high-water mark tracking before anything else runs
+	MEM_paintStacks();
+
 	// Initialize oscillator
 	OSC_initClock();
 
+	// Pick up the fault record and restart count left by a warm restart
+	FLT_initFault();
+
 	// Initialize the milliSecond timer
 	MSTMR_initMilliSecTimer();
 
+	// Initialize the jitter and CPU load monitor
+	PERF_initPerfMon();
+
 	// Initialize timing variables
 	uint32_t now = MSTMR_getMilliSeconds();
 	uint32_t lastExecutionTime = now;
+	bool faultReported = false;
 
-	// Initialize General-purpose I/O (when code is more complete,
-	//	this will be done in the individual software modules
-	initDio();
+	// Initialize General-purpose I/O from the board's pin map; the
+	//	pins switched at run time are set up by their modules
+	GPIO_initPins();
 
 	// Initialize ADC
 	ADC_initAdc();
 
+	// Index the parameter store, read by the modules below
+	PST_initStore();
+
 	// Initialize RC PWM module
 	RCPWM_initRcPwm();
 
 	// Initialize motor
 	MOT_defineMotorType(MOT_BLDC);
 
+#if CANN_ENABLED
+	// Initialize the CAN node, which takes the place of USB
+	CANN_initCanNode();
+#else
 	// init USB
 	Set_USBClock();
 	USB_Interrupts_Config();
 	USB_Init();
+#endif
+
+	// Initialize the binary telemetry stream (enabled on request)
+	TLM_initTelemetry();
+
+	// Initialize the RAM scope; keeps a capture frozen by a fault
+	SCP_initScope();
 
-	// Initialize UART/CLI
+	// Fingerprint the parameter map served over USB
+	PRM_initParam();
 
-	// Initialize bootloader
+	// Look up the parameters the motor profiles set
+	MPRF_initProfile();
+
+#if UART_ENABLED
+	// Initialize the UART link, which takes the I2C slave's pins
+	UART_initUart();
+#else
+	// Initialize the I2C register interface
+	I2CS_initI2cSlave();
+#endif
+
+	// Initialize the command-line interface on USB (and the UART)
+	CLI_initCli();
+
+	// Initialize the analog control input and the demand arbitration
+	AIN_initAnalogInput();
+	DMD_initDemand();
+
+	// Apply the stored parameters over the defaults
+	PRM_loadStored();
+
+	// Everything is up: the bootloader keeps starting this image
+	BOOT_initBoot();
 
 	// Infinite loop
     while(1)
     {
+    	// Passes through the loop that do no work are counted as idle time
+    	PERF_loopStart();
+
     	// Use the millisecond timer to time all operations within the main loop
     	now = MSTMR_getMilliSeconds();
 
+    	// Frame the telemetry samples captured by the control ISR, which
+    	//	queues more than one per millisecond at low decimation
+    	if(TLM_process())
+    	{
+    		PERF_loopBusy();
+    	}
+
+    	// Send the log records, formatted on the host
+    	if(LOG_process())
+    	{
+    		PERF_loopBusy();
+    	}
+
+    	// Send a requested scope dump
+    	if(SCP_process())
+    	{
+    		PERF_loopBusy();
+    	}
+
     	// Error checking to ensure that the lastExecutionTime
     	//	is not somehow much greater than the now variable
     	//	through some unforeseen event
@@ -76,44 +160,75 @@ main(void)
     	if(now > lastExecutionTime)
     	{
     		lastExecutionTime = now;
-
-         	// Get requested duty cycle from rcPwm/USB/UART/I2C
-    		uint32_t speedDemand = RCPWM_getSpeedDemand();
-    		if(speedDemand > 15000)
-    			speedDemand = 15000;
-
-        	// Pass requested duty cycle to the motor
-    		MOT_commandDirection(MOT_POS);
-    		MOT_commandDutyCycle(speedDemand);
+    		PERF_loopBusy();
+
+    		// Hand the serial link between USB and the UART
+#if UART_ENABLED
+    		UART_process();
+#endif
+
+    		// Handle commands received on USB or the UART
+    		CLI_process();
+
+         	// Get requested duty cycle from the freshest source by
+    		//	priority (limited by MOT_commandDutyCycle() to motor.maxDuty)
+    		uint16_t speedDemand;
+    		AIN_process();
+    		DMD_process(now);
+    		bool rcDemand = (DMD_getDemand(&speedDemand) == DMD_SOURCE_RC);
+
+    		// Fast RC pulses reach the running motor straight from the
+    		//	capture ISR instead, between these ticks
+    		bool directDrive = rcDemand && !FLT_isSafeMode();
+    		RCPWM_setDirectDrive(directDrive);
+
+        	// Pass requested duty cycle to the motor, unless repeated
+    		//	faults have put the drive in safe mode.  Under direct
+    		//	drive only start and stop it here, as the ISR may have
+    		//	passed on a newer pulse since speedDemand was read.
+    		if(!FLT_isSafeMode())
+    		{
+    			MOT_commandDirection((rcDemand && DSHOT_isReversed()) ? MOT_NEG : MOT_POS);
+
+    			if(directDrive)
+    			{
+    				MOT_commandRunning(speedDemand);
+    			}
+    			else
+    			{
+    				MOT_commandDutyCycle(speedDemand);
+    			}
+    		}
+
+    		// Report the last fault once the host can read it
+    		if(!faultReported && ((bDeviceState == CONFIGURED) || UART_isActive()))
+    		{
+    			faultReported = true;
+
+    			if(FLT_hasRecord())
+    			{
+    				FLT_printRecord();
+    			}
+    		}
+
+    		FLT_process(now);
+
+    		// Publish the I2C register snapshot
+    		I2CS_process();
+
+    		// Send the CAN telemetry and status frames when due
+    		CANN_process(now);
+
+    		// Close the jitter/CPU load window when it expires
+    		PERF_process(now);
+
+    		// Program written parameters; the flash stalls the CPU, so
+    		//	only while the motor is idle
+    		PST_process(MOT_isStopped());
     	} // END if statement
+
+    	PERF_loopEnd();
     } //END while loop
 
     return 0;
 }
-
-void
-initDio(void)
-{
-	// Setup analog input pins
-	// Analog input pins are not remapped
-	GPIO_pinSetup(GPIO_PORT_A, 0, GPIO_INPUT_ANALOG);	// PHA FBK
-	GPIO_pinSetup(GPIO_PORT_A, 1, GPIO_INPUT_ANALOG);	// PHB FBK
-	GPIO_pinSetup(GPIO_PORT_A, 2, GPIO_INPUT_ANALOG);	// PHC FBK
-	GPIO_pinSetup(GPIO_PORT_A, 3, GPIO_INPUT_ANALOG);	// Bus Voltage
-	GPIO_pinSetup(GPIO_PORT_A, 7, GPIO_INPUT_ANALOG);	// Bus Current
-	GPIO_pinSetup(GPIO_PORT_A, 4, GPIO_INPUT_ANALOG);	// Speed control
-
-	// Setup output tach pin
-	GPIO_pinSetup(GPIO_PORT_A, 5, GPIO_OUTPUT_PP);
-
-	// Setup hall sensors
-	GPIO_pinSetup(GPIO_PORT_B, 0, GPIO_FLOATING_INPUT);
-	GPIO_pinSetup(GPIO_PORT_B, 1, GPIO_FLOATING_INPUT);
-	GPIO_pinSetup(GPIO_PORT_B, 2, GPIO_FLOATING_INPUT);
-
-	// Setup current fault as a pull-up to eliminate external pull-ups
-	// Overcurrent sensing pin is not remapped
-	GPIO_pinSetup(GPIO_PORT_A, 7, GPIO_INPUT_PU_OR_PD);	// Overcurrent
-
-	return;
-} // END initDio()
@@ -0,0 +1,182 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <stdio.h>
+#include "stm32f10x.h"
+
+/* User-generated libs */
+#include "memMon.h"
+
+// Leave this many words below the current stack pointer unpainted so
+//	that the painting loop never overwrites the frame it is running in
+#define MEM_PAINT_MARGIN_WORDS	8
+
+/* Stacks, defined in startup_stm32f10x_ld.c */
+extern unsigned long pulStack[];			// exception stack (MSP)
+extern unsigned long pulProcessStack[];		// main() stack (PSP)
+extern const unsigned long ulStackWords;
+extern const unsigned long ulProcessStackWords;
+
+/* Symbols defined in the linker script */
+extern unsigned long _sdata;
+extern unsigned long _edata;
+extern unsigned long _sbss;
+extern unsigned long _ebss;
+
+/* Private function declarations */
+void MEM_paintRegion(unsigned long *bottom, unsigned long *limit);
+uint16_t MEM_highWater(const unsigned long *bottom, unsigned long words);
+
+/***************************************************************
+ * Function:	void MEM_paintStacks(void)
+ *
+ * Purpose:		To fill the unused part of both stacks with a known
+ * 					pattern so that their high-water marks can be
+ * 					found later.  Call this first in main(), before
+ * 					any interrupt is enabled.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	pulStack[], pulProcessStack[]
+ **************************************************************/
+void
+MEM_paintStacks(void)
+{
+	// Only the reset handler's frame is on the exception stack at this point
+	MEM_paintRegion(pulStack, (unsigned long *)__get_MSP() - MEM_PAINT_MARGIN_WORDS);
+
+	// main() and this function are running on the process stack
+	MEM_paintRegion(pulProcessStack, (unsigned long *)__get_PSP() - MEM_PAINT_MARGIN_WORDS);
+
+	return;
+} // END MEM_paintStacks()
+
+/***************************************************************
+ * Function:	uint16_t MEM_getMainStackHighWater(void)
+ *
+ * Purpose:		To find the deepest point ever reached by the
+ * 					main() (process) stack
+ *
+ * Parameters:	none
+ *
+ * Returns:		bytes used at the high-water mark
+ *
+ * Globals affected:	none
+ **************************************************************/
+uint16_t
+MEM_getMainStackHighWater(void)
+{
+	return MEM_highWater(pulProcessStack, ulProcessStackWords);
+} // END MEM_getMainStackHighWater()
+
+/***************************************************************
+ * Function:	uint16_t MEM_getExceptionStackHighWater(void)
+ *
+ * Purpose:		To find the deepest point ever reached by the
+ * 					exception (main) stack, i.e. the worst case of
+ * 					nested interrupt handlers
+ *
+ * Parameters:	none
+ *
+ * Returns:		bytes used at the high-water mark
+ *
+ * Globals affected:	none
+ **************************************************************/
+uint16_t
+MEM_getExceptionStackHighWater(void)
+{
+	return MEM_highWater(pulStack, ulStackWords);
+} // END MEM_getExceptionStackHighWater()
+
+/***************************************************************
+ * Function:	void MEM_getUsage(_MEM_usage *usage)
+ *
+ * Purpose:		To collect the stack and static RAM figures
+ *
+ * Parameters:	_MEM_usage *usage	filled in by this function
+ *
+ * Returns:		none
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+MEM_getUsage(_MEM_usage *usage)
+{
+	usage->mainStackSize = (uint16_t)(ulProcessStackWords * sizeof(unsigned long));
+	usage->mainStackHighWater = MEM_getMainStackHighWater();
+	usage->exceptionStackSize = (uint16_t)(ulStackWords * sizeof(unsigned long));
+	usage->exceptionStackHighWater = MEM_getExceptionStackHighWater();
+	usage->dataBytes = (uint16_t)((uint32_t)&_edata - (uint32_t)&_sdata);
+	usage->bssBytes = (uint16_t)((uint32_t)&_ebss - (uint32_t)&_sbss);
+
+	return;
+} // END MEM_getUsage()
+
+/***************************************************************
+ * Function:	void MEM_printUsage(void)
+ *
+ * Purpose:		To print the RAM usage over the USB virtual COM port.
+ * 					The per-module breakdown of the static RAM comes
+ * 					from the linker map, see tools/ramUsage.py.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+MEM_printUsage(void)
+{
+	_MEM_usage usage;
+	MEM_getUsage(&usage);
+
+	printf("MEM main stack %u/%u exc stack %u/%u data %u bss %u\r\n",
+			usage.mainStackHighWater, usage.mainStackSize,
+			usage.exceptionStackHighWater, usage.exceptionStackSize,
+			usage.dataBytes, usage.bssBytes);
+
+	return;
+} // END MEM_printUsage()
+
+/***************************************************************
+ * Function:	void MEM_paintRegion(unsigned long *bottom, unsigned long *limit)
+ ***************************************************************/
+void
+MEM_paintRegion(unsigned long *bottom, unsigned long *limit)
+{
+	for(volatile unsigned long *word = bottom; word < limit; word++)
+	{
+		*word = MEM_PAINT_PATTERN;
+	}
+
+	return;
+} // END MEM_paintRegion()
+
+/***************************************************************
+ * Function:	uint16_t MEM_highWater(const unsigned long *bottom,
+ * 										unsigned long words)
+ *
+ * Purpose:		Stacks grow down, so the untouched paint is a run
+ * 					of pattern words starting at the bottom
+ ***************************************************************/
+uint16_t
+MEM_highWater(const unsigned long *bottom, unsigned long words)
+{
+	unsigned long unused = 0;
+
+	while((unused < words) && (bottom[unused] == MEM_PAINT_PATTERN))
+	{
+		unused++;
+	}
+
+	return (uint16_t)((words - unused) * sizeof(unsigned long));
+} // END MEM_highWater()
@@ -0,0 +1,34 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef MEMMON_H
+#define MEMMON_H
+
+/* Standard or provided libs */
+#include <stdint.h>
+
+#define MEM_PAINT_PATTERN		0xA5A5A5A5
+
+// Stack and static RAM usage, all values in bytes
+typedef struct
+{
+	uint16_t mainStackSize;				// main() thread, process stack (PSP)
+	uint16_t mainStackHighWater;
+	uint16_t exceptionStackSize;		// ISRs and faults, main stack (MSP)
+	uint16_t exceptionStackHighWater;
+	uint16_t dataBytes;					// initialized static RAM
+	uint16_t bssBytes;					// zeroed static RAM
+} _MEM_usage;
+
+void MEM_paintStacks(void);
+uint16_t MEM_getMainStackHighWater(void);
+uint16_t MEM_getExceptionStackHighWater(void);
+void MEM_getUsage(_MEM_usage *usage);
+void MEM_printUsage(void);
+
+#endif
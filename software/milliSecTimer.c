@@ -12,6 +12,7 @@
 /* User-generated libs */
 #include "osc.h"
 #include "milliSecTimer.h"
+#include "perfMon.h"
 
 typedef struct{
 	uint32_t milliSeconds;
@@ -83,8 +84,10 @@ MSTMR_initMilliSecTimer(void)
 void
 TIM2_IRQHandler(void)
 {
+	PERF_isrEnter();
 	MSTMR_timer.milliSeconds++;
 	TIM2->SR = 0;
+	PERF_isrExit();
 	return;
 } // END TIM2_IRQHandler
 
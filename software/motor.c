@@ -7,52 +7,206 @@
  *	or FITNESS FOR A PARTICULAR PURPOSE.
 *************************************************/
 
+/* Standard or provided libs */
+#include <stddef.h>
+
+/* User-generated libs */
+#include "log.h"
 #include "motor.h"
 #include "motorBldc.h"
 #include "motorDc.h"
+#include "mpwm.h"
 
 #define MOT_MIN_DUTY_CYCLE	BLDC_MIN_DUTY_CYCLE
 
+#if !MOT_DC_ENABLED && !MOT_BLDC_ENABLED
+#error "motor.h: no motor library enabled"
+#endif
+
+// The interface of a motor library, bound once by MOT_defineMotorType()
+//	so the calls made every millisecond and from the RC interrupts go
+//	straight to the library instead of through a switch on the type.
+//	A library without sectors or commutation leaves those NULL.
+typedef struct
+{
+	void (*initMotor)(void);
+	void (*deinitMotor)(void);
+	void (*startMotor)(void);
+	void (*stopMotor)(void);
+	void (*commandDutyCycle)(uint16_t dutyCycle);
+	void (*commandDirection)(_MOT_motorDirection direction);
+	uint8_t (*getMotorState)(void);
+	int8_t (*getSector)(void);
+	uint16_t (*getDutyCycle)(void);
+	uint32_t (*getElectricalPeriod)(void);
+	uint8_t stoppedStates;				// bit per state that counts as stopped
+} _MOT_driver;
+
+/* Private function declarations */
+void MOT_commandDcDirection(_MOT_motorDirection direction);
+void MOT_commandBldcDirection(_MOT_motorDirection direction);
+void MOT_doNothing(void);
+void MOT_ignoreDutyCycle(uint16_t dutyCycle);
+void MOT_ignoreDirection(_MOT_motorDirection direction);
+uint8_t MOT_getNoState(void);
+
+// Bound from reset until MOT_defineMotorType() picks a library, so
+//	that the accessors are safe before then: a fault during the early
+//	init still reads the motor state for its record
+const _MOT_driver motNoDriver =
+{
+	MOT_doNothing,
+	MOT_doNothing,
+	MOT_doNothing,
+	MOT_doNothing,
+	MOT_ignoreDutyCycle,
+	MOT_ignoreDirection,
+	MOT_getNoState,
+	NULL,
+	NULL,
+	NULL,
+	(1 << MOT_STATE_NONE)
+};
+
+#if MOT_DC_ENABLED
+const _MOT_driver motDcDriver =
+{
+	MDC_initMotor,
+	MDC_stopMotor,
+	MDC_startMotor,
+	MDC_stopMotor,
+	MDC_commandDutyCycle,
+	MOT_commandDcDirection,
+	MDC_getMotorState,
+	NULL,
+	MDC_getDutyCycle,
+	NULL,
+	(1 << MDC_STOPPED)
+};
+#endif
+
+#if MOT_BLDC_ENABLED
+const _MOT_driver motBldcDriver =
+{
+	BLDC_initMotor,
+	BLDC_deinitMotor,
+	BLDC_startMotor,
+	BLDC_stopMotor,
+	BLDC_commandDutyCycle,
+	MOT_commandBldcDirection,
+	BLDC_getMotorState,
+	BLDC_getSector,
+	BLDC_getDutyCycle,
+	BLDC_getElectricalPeriod,
+	(1 << BLDC_STOPPED) | (1 << BLDC_LOCKED)
+};
+#endif
+
+// Indexed by _MOT_motorType, NULL for a library left out of the build
+const _MOT_driver *const motDrivers[] =
+{
+#if MOT_DC_ENABLED
+	[MOT_DC] = &motDcDriver,
+#endif
+#if MOT_BLDC_ENABLED
+	[MOT_BLDC] = &motBldcDriver,
+#endif
+};
+
+#define MOT_DRIVER_COUNT	(sizeof(motDrivers) / sizeof(motDrivers[0]))
+
 /* Global variables */
 typedef struct
 {
 	_MOT_motorType type;
+	const _MOT_driver *driver;			// motNoDriver until a type is defined
+	uint16_t maxDutyCycle;
+	bool running;						// started by MOT_commandDutyCycle()
 } _motor;
 
-_motor motor;
+_motor motor = {.driver = &motNoDriver, .maxDutyCycle = MOT_DEFAULT_MAX_DUTY_CYCLE};
 
 /***************************************************************
  * Function:	void MOT_defineMotorType(_MOT_motorType motorType)
  *
- * Purpose:		This defines the motor type to be used, which chooses
- * 					the motor library to be utilized
+ * Purpose:		This defines the motor type to be used, which binds
+ * 					the motor library to be utilized.  The PWM timer
+ * 					is set up by the first call only; later calls
+ * 					hand the timer and the ADC interrupt from one
+ * 					library to the other, and do nothing when the
+ * 					type does not change.  A type left out of the
+ * 					build keeps the library in use (or takes the
+ * 					one built, on the first call).
  *
  * Parameters:	_MOT_motorType motorType
  *
  * Returns:		none
  *
- * Globals affected:	motor.type
+ * Globals affected:	motor.type, motor.driver, motor.running
  **************************************************************/
 void
 MOT_defineMotorType(_MOT_motorType motorType)
 {
-	// Stop all motor activity
-	BLDC_stopMotor();
-	MDC_stopMotor();
+	const _MOT_driver *driver = NULL;
+	uint8_t type;
+
+	if((motorType < MOT_DRIVER_COUNT) && (motDrivers[motorType] != NULL))
+	{
+		driver = motDrivers[motorType];
+	}
+	else
+	{
+		LOG("motor: type %u is not built", motorType);
+
+		if(motor.driver != &motNoDriver)
+		{
+			return;
+		}
+
+		for(type = 0; driver == NULL; type++)
+		{
+			driver = motDrivers[type];
+			motorType = (_MOT_motorType)type;
+		}
+	}
+
+	if(driver == motor.driver)
+	{
+		return;
+	}
+
+	if(motor.driver == &motNoDriver)
+	{
+		MPWM_initMotorPwm();
+		MPWM_setMotorPwmFreq(MOT_DEFAULT_PWM_FREQ);
+	}
+	else
+	{
+		motor.driver->deinitMotor();
+	}
 
 	// Change the motor type
 	motor.type = motorType;
+	motor.driver = driver;
+	motor.running = false;
 
 	MOT_initMotor();
 
 	return;
 } // END MOT_defineMotorType()
 
+_MOT_motorType
+MOT_getMotorType(void)
+{
+	return motor.type;
+}
+
 /***************************************************************
  * Function:	void MOT_initMotor(void)
  *
- * Purpose:		To initialize the appropriate motor based on the
- * 					previously defined motor type
+ * Purpose:		To initialize the motor library bound by
+ * 					MOT_defineMotorType().  The PWM timer is left as
+ * 					MOT_defineMotorType() set it up.
  *
  * Parameters:	none
  *
@@ -63,29 +217,15 @@ MOT_defineMotorType(_MOT_motorType motorType)
 void
 MOT_initMotor(void)
 {
-	switch(motor.type)
-	{
-		case MOT_DC:
-			MDC_initMotor();
-			break;
-
-		case MOT_BLDC:
-			BLDC_initMotor();
-			break;
-
-		default:
-			BLDC_initMotor();
-			break;
-	}
-
+	motor.driver->initMotor();
 	return;
 } // END MOT_initMotor()
 
 /***************************************************************
  * Function:	void MOT_startMotor(void)
  *
- * Purpose:		To start the appropriate motor based on the
- * 					previously defined motor type
+ * Purpose:		To start the motor with the library bound by
+ * 					MOT_defineMotorType()
  *
  * Parameters:	none
  *
@@ -96,29 +236,15 @@ MOT_initMotor(void)
 void
 MOT_startMotor(void)
 {
-	switch(motor.type)
-	{
-		case MOT_DC:
-			MDC_startMotor();
-			break;
-
-		case MOT_BLDC:
-			BLDC_startMotor();
-			break;
-
-		default:
-			BLDC_startMotor();
-			break;
-	}
-
+	motor.driver->startMotor();
 	return;
 } // END MOT_startMotor()
 
 /***************************************************************
  * Function:	void MOT_stopMotor(void)
  *
- * Purpose:		To stop the appropriate motor based on the
- * 					previously defined motor type
+ * Purpose:		To stop the motor with the library bound by
+ * 					MOT_defineMotorType()
  *
  * Parameters:	none
  *
@@ -129,29 +255,59 @@ MOT_startMotor(void)
 void
 MOT_stopMotor(void)
 {
-	switch(motor.type)
+	motor.driver->stopMotor();
+	return;
+} // END MOT_stopMotor()
+
+/***************************************************************
+ * Function:	bool MOT_commandRunning(uint16_t dutyCycle)
+ *
+ * Purpose:		To start and stop the motor as the duty required
+ * 					by higher-level software crosses the minimum,
+ * 					without passing the duty on.  The main loop
+ * 					calls this alone while the RC capture ISR
+ * 					passes every pulse on (MOT_updateDutyCycle()),
+ * 					so that an older duty never overwrites a newer
+ * 					one.
+ *
+ * Parameters:	uint16_t dutyCycle		0%-100% scaled to 0-65535
+ *
+ * Returns:		true if the motor is running
+ *
+ * Globals affected:	motor.running
+ **************************************************************/
+bool
+MOT_commandRunning(uint16_t dutyCycle)
+{
+	const _MOT_driver *driver = motor.driver;
+
+	if(dutyCycle < MOT_MIN_DUTY_CYCLE)
 	{
-		case MOT_DC:
-			MDC_stopMotor();
-			break;
+		if(motor.running)
+		{
+			motor.running = false;
+			driver->stopMotor();
+		}
 
-		case MOT_BLDC:
-			BLDC_stopMotor();
-			break;
+		return false;
+	}
 
-		default:
-			BLDC_stopMotor();
-			break;
+	if(!motor.running)
+	{
+		motor.running = true;
+		driver->startMotor();
 	}
 
-	return;
-} // END MOT_stopMotor()
+	return true;
+} // END MOT_commandRunning()
 
 /***************************************************************
  * Function:	void MOT_commandDutyCycle(uint16_t dutyCycle)
  *
  * Purpose:		To update the duty cycle required by higher-
- * 					level software
+ * 					level software.  The motor is started and
+ * 					stopped only when the duty crosses the minimum;
+ * 					a stopped motor is not passed a duty at all.
  *
  * Parameters:	uint16_t dutyCycle		This is the fixed-point representation
  * 										of the motor duty cycle.  0%-100% is scaled
@@ -159,47 +315,90 @@ MOT_stopMotor(void)
  *
  * Returns:		none
  *
- * Globals affected:	none
+ * Globals affected:	motor.running
  **************************************************************/
 void
 MOT_commandDutyCycle(uint16_t dutyCycle)
 {
-	if(dutyCycle < MOT_MIN_DUTY_CYCLE)
+	if(dutyCycle > motor.maxDutyCycle)
 	{
-		dutyCycle = 0;
-		MOT_stopMotor();
+		dutyCycle = motor.maxDutyCycle;
 	}
-	else
+
+	if(MOT_commandRunning(dutyCycle))
 	{
-		MOT_startMotor();
+		motor.driver->commandDutyCycle(dutyCycle);
 	}
 
-	switch(motor.type)
-	{
-		case MOT_DC:
-			MDC_commandDutyCycle(dutyCycle);
-			break;
+	return;
+} // END MOT_commandDutyCycle
 
-		case MOT_BLDC:
-			BLDC_commandDutyCycle(dutyCycle);
-			break;
+/***************************************************************
+ * Function:	void MOT_updateDutyCycle(uint16_t dutyCycle)
+ *
+ * Purpose:		To pass a new duty cycle to a motor that is
+ * 					already starting or running, from interrupt
+ * 					context (fast RC pulses).  Starting and
+ * 					stopping is left to MOT_commandRunning() in the
+ * 					main loop, so a duty below the minimum is
+ * 					ignored here.
+ *
+ * Parameters:	uint16_t dutyCycle		0%-100% scaled to 0-65535
+ *
+ * Returns:		none
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+MOT_updateDutyCycle(uint16_t dutyCycle)
+{
+	const _MOT_driver *driver = motor.driver;
+
+	if(dutyCycle > motor.maxDutyCycle)
+	{
+		dutyCycle = motor.maxDutyCycle;
+	}
 
-		default:
-			BLDC_stopMotor();
-			break;
+	if((dutyCycle >= MOT_MIN_DUTY_CYCLE) && !MOT_isStopped())
+	{
+		driver->commandDutyCycle(dutyCycle);
 	}
 
 	return;
-} // END MOT_commandDutyCycle
+} // END MOT_updateDutyCycle()
+
+/***************************************************************
+ * Function:	void MOT_setMaxDutyCycle(uint16_t maxDutyCycle)
+ *
+ * Purpose:		To limit the duty cycle that MOT_commandDutyCycle()
+ * 					passes on, whatever the source of the demand
+ *
+ * Parameters:	uint16_t maxDutyCycle	0%-100% scaled to 0-65535
+ *
+ * Returns:		none
+ *
+ * Globals affected:	motor.maxDutyCycle
+ **************************************************************/
+void
+MOT_setMaxDutyCycle(uint16_t maxDutyCycle)
+{
+	motor.maxDutyCycle = maxDutyCycle;
+	return;
+} // END MOT_setMaxDutyCycle()
+
+uint16_t
+MOT_getMaxDutyCycle(void)
+{
+	return motor.maxDutyCycle;
+}
 
 /***************************************************************
  * Function:	void MOT_commandDirection(_MOT_motorDirection direction)
  *
- * Purpose:		To load the appropriate motor direction based on
- * 					the desired direction and on the motor type
- * 					chose previously
+ * Purpose:		To load the motor direction into the library bound
+ * 					by MOT_defineMotorType()
  *
- * Parameters:	none
+ * Parameters:	_MOT_motorDirection direction
  *
  * Returns:		none
  *
@@ -208,21 +407,145 @@ MOT_commandDutyCycle(uint16_t dutyCycle)
 void
 MOT_commandDirection(_MOT_motorDirection direction)
 {
-	switch(motor.type)
-	{
-		case MOT_DC:
-			MDC_commandDirection(direction);
-			break;
+	motor.driver->commandDirection(direction);
+	return;
+} // END MOT_commandDirection()
 
-		case MOT_BLDC:
-			BLDC_commandDirection(direction);
-			break;
+// The libraries name the directions themselves
+#if MOT_DC_ENABLED
+void
+MOT_commandDcDirection(_MOT_motorDirection direction)
+{
+	MDC_commandDirection((direction == MOT_POS) ? MDC_POS : MDC_NEG);
+	return;
+}
+#endif
 
-		default:
-			BLDC_commandDirection(direction);
-			break;
-	}
+#if MOT_BLDC_ENABLED
+void
+MOT_commandBldcDirection(_MOT_motorDirection direction)
+{
+	BLDC_commandDirection((direction == MOT_POS) ? BLDC_POS : BLDC_NEG);
+	return;
+}
+#endif
+
+/***************************************************************
+ * Function:	bool MOT_isStopped(void)
+ *
+ * Purpose:		To find out whether the motor library bound is
+ * 					neither starting nor running the motor
+ *
+ * Parameters:	none
+ *
+ * Returns:		true when stopped (or locked, for a BLDC motor, or
+ * 					before MOT_defineMotorType())
+ *
+ * Globals affected:	none
+ **************************************************************/
+bool
+MOT_isStopped(void)
+{
+	return (motor.driver->stoppedStates >> motor.driver->getMotorState()) & 1;
+} // END MOT_isStopped()
+
+/***************************************************************
+ * Function:	uint8_t MOT_getMotorState(void)
+ *
+ * Purpose:		To retrieve the state of the motor library bound by
+ * 					MOT_defineMotorType()
+ *
+ * Parameters:	none
+ *
+ * Returns:		uint8_t motor state (_BLDC_motorState or the DC
+ * 					equivalent), MOT_STATE_NONE before
+ * 					MOT_defineMotorType()
+ *
+ * Globals affected:	none
+ **************************************************************/
+uint8_t
+MOT_getMotorState(void)
+{
+	return motor.driver->getMotorState();
+} // END MOT_getMotorState()
 
+/***************************************************************
+ * Function:	int8_t MOT_getSector(void)
+ *
+ * Purpose:		To retrieve the rotor sector of the motor library
+ * 					bound by MOT_defineMotorType()
+ *
+ * Parameters:	none
+ *
+ * Returns:		int8_t sector (0-5), 0 for motors without sectors
+ *
+ * Globals affected:	none
+ **************************************************************/
+int8_t
+MOT_getSector(void)
+{
+	return (motor.driver->getSector != NULL) ? motor.driver->getSector() : 0;
+} // END MOT_getSector()
+
+/***************************************************************
+ * Function:	uint16_t MOT_getDutyCycle(void)
+ *
+ * Purpose:		To retrieve the duty cycle applied by the motor
+ * 					library bound by MOT_defineMotorType()
+ *
+ * Parameters:	none
+ *
+ * Returns:		uint16_t duty cycle, 0%-100% scaled to 0-65535,
+ * 					0 when stopped
+ *
+ * Globals affected:	none
+ **************************************************************/
+uint16_t
+MOT_getDutyCycle(void)
+{
+	return MOT_isStopped() ? 0 : motor.driver->getDutyCycle();
+} // END MOT_getDutyCycle()
+
+/***************************************************************
+ * Function:	uint32_t MOT_getElectricalPeriod(void)
+ *
+ * Purpose:		To retrieve the electrical revolution time of the
+ * 					motor library bound by MOT_defineMotorType()
+ *
+ * Parameters:	none
+ *
+ * Returns:		uint32_t period in microseconds, 0 when stopped or
+ * 					for motors without commutation
+ *
+ * Globals affected:	none
+ **************************************************************/
+uint32_t
+MOT_getElectricalPeriod(void)
+{
+	return (motor.driver->getElectricalPeriod != NULL) ? motor.driver->getElectricalPeriod() : 0;
+} // END MOT_getElectricalPeriod()
+
+// The library bound before MOT_defineMotorType(), see motNoDriver
+void
+MOT_doNothing(void)
+{
 	return;
-} // END MOT_commandDirection()
+}
+
+void
+MOT_ignoreDutyCycle(uint16_t dutyCycle)
+{
+	return;
+}
 
+void
+MOT_ignoreDirection(_MOT_motorDirection direction)
+{
+	return;
+}
+
+uint8_t
+MOT_getNoState(void)
+{
+	return MOT_STATE_NONE;
+}
@@ -6,11 +6,34 @@
  *	even the implied warranty of MERCHANTABILITY
  *	or FITNESS FOR A PARTICULAR PURPOSE.
 *************************************************/
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifndef MOTOR_H
 #define MOTOR_H
 
+// Highest duty cycle passed on to the motor libraries, 0%-100% scaled
+//	to 0-65535; tunable with MOT_setMaxDutyCycle()
+#define MOT_DEFAULT_MAX_DUTY_CYCLE		15000
+
+// Motor libraries built in; MOT_defineMotorType() binds one of them.
+//	With one left out (and unused sections discarded by the linker)
+//	its code stays out of the flash.
+#ifndef MOT_DC_ENABLED
+#define MOT_DC_ENABLED					1
+#endif
+
+#ifndef MOT_BLDC_ENABLED
+#define MOT_BLDC_ENABLED				1
+#endif
+
+// PWM frequency until a parameter or a profile sets another
+#define MOT_DEFAULT_PWM_FREQ			16000
+
+// State reported until MOT_defineMotorType() binds a library; no
+//	library uses it and it counts as stopped
+#define MOT_STATE_NONE					7
+
 typedef enum
 {
 	MOT_DC,
@@ -24,11 +47,21 @@ typedef enum
 } _MOT_motorDirection;
 
 void MOT_defineMotorType(_MOT_motorType motorType);
+_MOT_motorType MOT_getMotorType(void);
 
 void MOT_initMotor(void);
 void MOT_startMotor(void);
 void MOT_stopMotor(void);
+bool MOT_commandRunning(uint16_t dutyCycle);
 void MOT_commandDutyCycle(uint16_t dutyCycle);
+void MOT_updateDutyCycle(uint16_t dutyCycle);
 void MOT_commandDirection(_MOT_motorDirection direction);
+void MOT_setMaxDutyCycle(uint16_t maxDutyCycle);
+uint16_t MOT_getMaxDutyCycle(void);
+uint8_t MOT_getMotorState(void);
+bool MOT_isStopped(void);
+int8_t MOT_getSector(void);
+uint16_t MOT_getDutyCycle(void);
+uint32_t MOT_getElectricalPeriod(void);
 
 #endif
@@ -12,6 +12,9 @@
 #include "gpio.h"
 #include "adc.h"
 #include "milliSecTimer.h"
+#include "log.h"
+#include "perfMon.h"
+#include "pinMap.h"
 
 #define NULL	0
 
@@ -24,6 +27,8 @@ typedef struct
 	volatile uint32_t startTimeAbs;
 	volatile uint32_t startCommutationTimeAbs;
 	volatile uint32_t lockUntilTimeAbs;
+	volatile uint32_t lastCommutationCycles;	// CPU cycle count of the last commutation
+	volatile uint32_t commutationCycles;		// between the last two, 0 until measured
 	volatile uint16_t phaseA, phaseB, phaseC;
 	volatile uint16_t *dormantPhasePtr;
 	_BLDC_motorDirection direction;
@@ -38,18 +43,26 @@ typedef struct{
 	uint16_t dutyCycle;
 }_bldc_motor_command;
 
+// Start-up settings, tunable at run time
+typedef struct{
+	uint16_t startDutyCycle;
+	uint16_t forcedCommutationMs;
+}_bldc_tuning;
+
 volatile _bldc_motor BLDC_motor;
 _bldc_motor_command BLDC_command;
+_bldc_tuning BLDC_tuning = {BLDC_MIN_DUTY_CYCLE, BLDC_FORCED_COMMUTATION_MS};
 
 // Used internally to motor.c, "private"
 void BLDC_commutate(void);
+void BLDC_applyDutyCycle(void);
 void BLDC_initPositionSensors(void);
 void BLDC_determineSector(void);
 void BLDC_adcInterrupt(void);
 
 /* This is a complete table that lists all of the possible translations
  * from hall sensor inputs to sectors. */
-const uint8_t hallToSector[12][8] = {	{6,1,3,2,5,0,4,6},
+const uint8_t hallToSector[BLDC_HALL_TABLES][8] = {	{6,1,3,2,5,0,4,6},
 										{6,0,2,1,4,5,3,6},
 										{6,5,1,0,3,4,2,6},
 										{6,4,0,5,2,3,1,6},
@@ -62,6 +75,21 @@ const uint8_t hallToSector[12][8] = {	{6,1,3,2,5,0,4,6},
 										{6,0,4,5,2,1,3,6},
 										{6,5,3,4,1,0,2,6}};
 
+/* Lookup tables to determine which phase should be high, low, and
+ * dormant based on the current sector (as defined by the positive
+ * direction).
+ *
+ *		sector	hiPhase	loPhase	dormantPhase
+ *		0		PH_A	PH_B	PH_C
+ *		1		PH_A	PH_C	PH_B
+ *		2		PH_B	PH_C	PH_A
+ *		3		PH_B	PH_A	PH_C
+ *		4		PH_C	PH_A	PH_B
+ *		5		PH_C	PH_B	PH_A */
+const uint8_t hiPhaseTable[] = {MPWM_PH_A, MPWM_PH_A, MPWM_PH_B, MPWM_PH_B, MPWM_PH_C, MPWM_PH_C};
+const uint8_t loPhaseTable[] = {MPWM_PH_B, MPWM_PH_C, MPWM_PH_C, MPWM_PH_A, MPWM_PH_A, MPWM_PH_B};
+const uint8_t dormantPhaseTable[] = {MPWM_PH_C, MPWM_PH_B, MPWM_PH_A, MPWM_PH_C, MPWM_PH_B, MPWM_PH_A};
+
 /* This specifies which line is to be used from the hallToSector table */
 uint8_t hallTableUtilized = 0;
 
@@ -70,6 +98,7 @@ uint8_t hallTableUtilized = 0;
  *
  * Purpose:		This function is called by higher-level software in order
  * 					to initialize the motor in preparation for operation.
+ * 					The PWM timer is set up by motor.c.
  *
  * Parameters:	none
  *
@@ -80,9 +109,6 @@ uint8_t hallTableUtilized = 0;
 void
 BLDC_initMotor(void)
 {
-	MPWM_initMotorPwm();
-	MPWM_setMotorPwmFreq(16000);
-
 	BLDC_stopMotor();
 	BLDC_commandDirection(BLDC_POS);
 
@@ -113,15 +139,9 @@ BLDC_initPositionSensors(void)
 {
 	unsigned int hallValue = 0;
 
-	/* Hall sensors to inputs */
-	GPIO_pinSetup(GPIO_PORT_B, 0, GPIO_FLOATING_INPUT);
-	GPIO_pinSetup(GPIO_PORT_B, 1, GPIO_FLOATING_INPUT);
-	GPIO_pinSetup(GPIO_PORT_B, 2, GPIO_FLOATING_INPUT);
-
-	/* Read the current hall sensor values */
-	hallValue += (uint16_t)GPIO_readInput(GPIO_PORT_B, 0);
-	hallValue += (uint16_t)GPIO_readInput(GPIO_PORT_B, 1) << 1;
-	hallValue += (uint16_t)GPIO_readInput(GPIO_PORT_B, 2) << 2;
+	/* The hall sensor inputs are set up by GPIO_initPins();
+	 * read the current hall sensor values */
+	hallValue = GPIO_readPins(PIN_HALL_GPIO, PIN_HALL_MASK, PIN_HALL_SHIFT);
 
 	/* If the hall sensor values is valid, then
 	 * hall sensors are utilized for sensors */
@@ -139,6 +159,28 @@ BLDC_initPositionSensors(void)
 	return;
 } // END BLDC_initPositionSensors
 
+/***************************************************************
+ * Function:	void BLDC_deinitMotor(void)
+ *
+ * Purpose:		This function is called by higher-level software
+ * 					before another motor library takes the PWM
+ * 					timer, so the ADC interrupt stops commutating
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+BLDC_deinitMotor(void)
+{
+	BLDC_stopMotor();
+	ADC_deinitAdc1Interrupt();
+
+	return;
+} // END BLDC_deinitMotor()
+
 /***************************************************************
  * Function:	void BLDC_startMotor(void)
  *
@@ -163,11 +205,15 @@ BLDC_startMotor(void)
 
 		BLDC_motor.startTimeAbs = MSTMR_getMilliSeconds();
 
-		BLDC_motor.dutyCycle = BLDC_MIN_DUTY_CYCLE;
+		BLDC_motor.dutyCycle = BLDC_tuning.startDutyCycle;
 		BLDC_motor.direction = BLDC_command.direction;
 
 		BLDC_determineSector();
+		BLDC_motor.lastCommutationCycles = PERF_getCycles();
 		BLDC_commutate();
+		BLDC_motor.commutationCycles = 0;
+
+		LOG("bldc: starting in sector %d", BLDC_motor.sector);
 	}
 
 	return;
@@ -188,13 +234,21 @@ BLDC_startMotor(void)
 void
 BLDC_stopMotor(void)
 {
+	uint8_t state = BLDC_motor.state;
+
+	// Place the motor in the STOPPED state first, so that a duty
+	//	command from an interrupt cannot turn the phases back on
+	BLDC_motor.state = BLDC_STOPPED;
+
 	// Place each phase in the DORMANT state
 	MPWM_setPhaseDutyCycle(MPWM_PH_A, MPWM_DORMANT, 0);
 	MPWM_setPhaseDutyCycle(MPWM_PH_B, MPWM_DORMANT, 0);
 	MPWM_setPhaseDutyCycle(MPWM_PH_C, MPWM_DORMANT, 0);
 
-	// Place the motor in the STOPPED state
-	BLDC_motor.state = BLDC_STOPPED;
+	if(state != BLDC_STOPPED)
+	{
+		LOG("bldc: stopped from state %u", state);
+	}
 
 	return;
 } // END BLDC_stopMotor()
@@ -224,11 +278,7 @@ BLDC_determineSector(void)
 
 		case BLDC_HALL:
 		{
-			unsigned int hallValue = 0;
-
-			hallValue += (uint16_t)GPIO_readInput(GPIO_PORT_B, 0);
-			hallValue += (uint16_t)GPIO_readInput(GPIO_PORT_B, 1) << 1;
-			hallValue += (uint16_t)GPIO_readInput(GPIO_PORT_B, 2) << 2;
+			unsigned int hallValue = GPIO_readPins(PIN_HALL_GPIO, PIN_HALL_MASK, PIN_HALL_SHIFT);
 
 			/* Uses a lookup table to determine the current
 			 * sector based on the current hall value */
@@ -250,7 +300,10 @@ BLDC_determineSector(void)
  * Function:	void BLDC_commandDutyCycle(unsigned int dutyCycle);
  *
  * Purpose:		This function is called by higher-level software
- * 					to modify the duty cycle.
+ * 					to modify the duty cycle.  A turning motor takes
+ * 					it at once, not at the next commutation; while
+ * 					starting, the start duty cycle is the least
+ * 					applied.  May be called from an interrupt.
  *
  * Parameters:	uint16_t dutyCycle		This is the fixed-point representation
  * 										of the motor duty cycle.  0%-100% is scaled
@@ -258,12 +311,30 @@ BLDC_determineSector(void)
  *
  * Returns:		none
  *
- * Globals affected:	BLDC_command.dutyCycle
+ * Globals affected:	BLDC_command.dutyCycle, BLDC_motor.dutyCycle
  **************************************************************/
 void
 BLDC_commandDutyCycle(uint16_t dutyCycle)
 {
 	BLDC_command.dutyCycle = dutyCycle;
+
+	// The commutation in the ADC interrupt must not change the
+	//	phases while the duty is loaded into them
+	__disable_irq();
+
+	if((BLDC_motor.state == BLDC_STARTING) && (dutyCycle < BLDC_tuning.startDutyCycle))
+	{
+		dutyCycle = BLDC_tuning.startDutyCycle;
+	}
+
+	if((BLDC_motor.state == BLDC_STARTING) || (BLDC_motor.state == BLDC_RUNNING))
+	{
+		BLDC_motor.dutyCycle = dutyCycle;
+		BLDC_applyDutyCycle();
+	}
+
+	__enable_irq();
+
 	return;
 }
 
@@ -298,11 +369,16 @@ BLDC_commandDirection(bool direction)
  *
  * Returns:		none
  *
- * Globals affected:	BLDC_motor.sector
+ * Globals affected:	BLDC_motor.sector, BLDC_motor.commutationCycles
  **************************************************************/
 void
 BLDC_commutate(void)
 {
+	uint32_t cycles = PERF_getCycles();
+
+	BLDC_motor.commutationCycles = cycles - BLDC_motor.lastCommutationCycles;
+	BLDC_motor.lastCommutationCycles = cycles;
+
 	// Move to the next step in the 6-step scheme
 	if(BLDC_motor.direction == BLDC_POS)
 	{
@@ -320,30 +396,9 @@ BLDC_commutate(void)
 	}
 
 
-	// Use lookup tables to determine which phase should be high,
-	//	low, and dormant based on the current sector (as defined by
-	//	the positive direction).
-	//
-	//		sector	hiPhase	loPhase	dormantPhase
-	//		0		PH_A	PH_B	PH_C
-	//		1		PH_A	PH_C	PH_B
-	//		2		PH_B	PH_C	PH_A
-	//		3		PH_B	PH_A	PH_C
-	//		4		PH_C	PH_A	PH_B
-	//		5		PH_C	PH_B	PH_A
-	const uint8_t hiPhaseTable[] = {MPWM_PH_A, MPWM_PH_A, MPWM_PH_B, MPWM_PH_B, MPWM_PH_C, MPWM_PH_C};
-	const uint8_t loPhaseTable[] = {MPWM_PH_B, MPWM_PH_C, MPWM_PH_C, MPWM_PH_A, MPWM_PH_A, MPWM_PH_B};
-	const uint8_t dormantPhaseTable[] = {MPWM_PH_C, MPWM_PH_B, MPWM_PH_A, MPWM_PH_C, MPWM_PH_B, MPWM_PH_A};
-
-	// Calculate the high side and low side duty cycles
-	uint16_t halfDutyCycle = (BLDC_motor.dutyCycle >> 1);
-	uint16_t highSideDutyCycle = 32767 + halfDutyCycle;
-	uint16_t lowSideDutyCycle = 32767 - halfDutyCycle;
-
 	// Load each phase with the appropriate duty cycle
 	MPWM_setPhaseDutyCycle(dormantPhaseTable[BLDC_motor.sector], MPWM_DORMANT, BLDC_motor.dutyCycle);
-	MPWM_setPhaseDutyCycle(hiPhaseTable[BLDC_motor.sector], MPWM_HI_STATE, highSideDutyCycle);
-	MPWM_setPhaseDutyCycle(loPhaseTable[BLDC_motor.sector], MPWM_HI_STATE, lowSideDutyCycle);
+	BLDC_applyDutyCycle();
 	//MPWM_setAdcSamplingTime(highSideDutyCycle);
 
 
@@ -383,6 +438,32 @@ BLDC_commutate(void)
 	return;
 } //END BLDC_commutate
 
+/***************************************************************
+ * Function:	void BLDC_applyDutyCycle(void)
+ *
+ * Purpose:		To load BLDC_motor.dutyCycle into the high and low
+ * 					phases of the current sector
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+BLDC_applyDutyCycle(void)
+{
+	// Calculate the high side and low side duty cycles
+	uint16_t halfDutyCycle = (BLDC_motor.dutyCycle >> 1);
+	uint16_t highSideDutyCycle = 32767 + halfDutyCycle;
+	uint16_t lowSideDutyCycle = 32767 - halfDutyCycle;
+
+	MPWM_setPhaseDutyCycle(hiPhaseTable[BLDC_motor.sector], MPWM_HI_STATE, highSideDutyCycle);
+	MPWM_setPhaseDutyCycle(loPhaseTable[BLDC_motor.sector], MPWM_HI_STATE, lowSideDutyCycle);
+
+	return;
+} // END BLDC_applyDutyCycle()
+
 /***************************************************************
  * Function:	uint8_t BLDC_getMotorState(void)
  *
@@ -401,6 +482,174 @@ BLDC_getMotorState(void)
 	return BLDC_motor.state;
 }
 
+/***************************************************************
+ * Function:	int8_t BLDC_getSector(void)
+ *
+ * Purpose:		This function is called by higher-level software
+ * 					to retrieve the current rotor sector.
+ *
+ * Parameters:	none
+ *
+ * Returns:		int8_t BLDC_motor.sector
+ *
+ * Globals affected:	none
+ **************************************************************/
+int8_t
+BLDC_getSector(void)
+{
+	return BLDC_motor.sector;
+}
+
+/***************************************************************
+ * Function:	uint16_t BLDC_getDutyCycle(void)
+ *
+ * Purpose:		This function is called by higher-level software
+ * 					to retrieve the duty cycle being applied.
+ *
+ * Parameters:	none
+ *
+ * Returns:		uint16_t BLDC_motor.dutyCycle
+ *
+ * Globals affected:	none
+ **************************************************************/
+uint16_t
+BLDC_getDutyCycle(void)
+{
+	return BLDC_motor.dutyCycle;
+}
+
+/***************************************************************
+ * Function:	uint32_t BLDC_getElectricalPeriod(void)
+ *
+ * Purpose:		This function is called by higher-level software
+ * 					to retrieve the time of one electrical revolution
+ * 					(six commutations).  A motor that has gone longer
+ * 					than that since its last commutation is slowing
+ * 					down, so the longer time is used.
+ *
+ * Parameters:	none
+ *
+ * Returns:		uint32_t period in microseconds, 0 if the motor is
+ * 					not turning or not yet measured
+ *
+ * Globals affected:	none
+ **************************************************************/
+uint32_t
+BLDC_getElectricalPeriod(void)
+{
+	uint32_t commutationCycles = BLDC_motor.commutationCycles;
+	uint32_t sinceLast = PERF_getCycles() - BLDC_motor.lastCommutationCycles;
+
+	if(((BLDC_motor.state != BLDC_STARTING) && (BLDC_motor.state != BLDC_RUNNING))
+			|| (commutationCycles == 0))
+	{
+		return 0;
+	}
+
+	if(sinceLast > commutationCycles)
+	{
+		commutationCycles = sinceLast;
+	}
+
+	// 6 commutations of 72 cycles per microsecond
+	return commutationCycles / 12;
+} // END BLDC_getElectricalPeriod()
+
+/***************************************************************
+ * Function:	void BLDC_setStartDutyCycle(uint16_t dutyCycle)
+ *
+ * Purpose:		This function is called by higher-level software
+ * 					to set the duty cycle applied when starting.
+ *
+ * Parameters:	uint16_t dutyCycle		0%-100% scaled to 0-65535
+ *
+ * Returns:		none
+ *
+ * Globals affected:	BLDC_tuning.startDutyCycle
+ **************************************************************/
+void
+BLDC_setStartDutyCycle(uint16_t dutyCycle)
+{
+	BLDC_tuning.startDutyCycle = dutyCycle;
+	return;
+}
+
+uint16_t
+BLDC_getStartDutyCycle(void)
+{
+	return BLDC_tuning.startDutyCycle;
+}
+
+/***************************************************************
+ * Function:	void BLDC_setHallTable(uint8_t table)
+ *
+ * Purpose:		This function is called by higher-level software
+ * 					to choose the line of hallToSector that matches
+ * 					the wiring of the hall sensors.  Takes effect
+ * 					at once when hall sensors are fitted.
+ *
+ * Parameters:	uint8_t table		0 to BLDC_HALL_TABLES - 1
+ *
+ * Returns:		none
+ *
+ * Globals affected:	hallTableUtilized, BLDC_motor.hallToSector
+ **************************************************************/
+void
+BLDC_setHallTable(uint8_t table)
+{
+	if(table >= BLDC_HALL_TABLES)
+	{
+		return;
+	}
+
+	hallTableUtilized = table;
+
+	if(BLDC_motor.sensor == BLDC_HALL)
+	{
+		// The commutation ISR must not see half of each table
+		__disable_irq();
+		for(uint8_t i = 0; i < 8; i++)
+		{
+			BLDC_motor.hallToSector[i] = hallToSector[hallTableUtilized][i];
+		}
+		__enable_irq();
+	}
+
+	return;
+}
+
+uint8_t
+BLDC_getHallTable(void)
+{
+	return hallTableUtilized;
+}
+
+/***************************************************************
+ * Function:	void BLDC_setForcedCommutationTime(uint16_t milliSeconds)
+ *
+ * Purpose:		This function is called by higher-level software
+ * 					to set how long starting may go without a zero
+ * 					crossing before a commutation is forced.
+ *
+ * Parameters:	uint16_t milliSeconds
+ *
+ * Returns:		none
+ *
+ * Globals affected:	BLDC_tuning.forcedCommutationMs
+ **************************************************************/
+void
+BLDC_setForcedCommutationTime(uint16_t milliSeconds)
+{
+	BLDC_tuning.forcedCommutationMs = milliSeconds;
+	return;
+}
+
+uint16_t
+BLDC_getForcedCommutationTime(void)
+{
+	return BLDC_tuning.forcedCommutationMs;
+}
+
 /***************************************************************
  * Function:	uint8_t BLDC_adcInterrupt(void)
  *
@@ -433,6 +682,7 @@ BLDC_adcInterrupt(void)
 			if(MSTMR_getMilliSeconds() > BLDC_motor.lockUntilTimeAbs)
 			{
 				BLDC_motor.state = BLDC_STOPPED;
+				LOG("bldc: unlocked");
 			}
 
 			break;
@@ -466,8 +716,9 @@ BLDC_adcInterrupt(void)
 			// If a few milliseconds have passed without a commutation,
 			//	then apply a commutation so that the motor isn't stuck
 			//	in one position
-			if((BLDC_motor.startCommutationTimeAbs + 25) < MSTMR_getMilliSeconds())
+			if((BLDC_motor.startCommutationTimeAbs + BLDC_tuning.forcedCommutationMs) < MSTMR_getMilliSeconds())
 			{
+				LOG("bldc: no zero crossing, forced commutation from sector %d", BLDC_motor.sector);
 				BLDC_commutate();
 			}
 
@@ -16,6 +16,8 @@
 
 #define BLDC_DEFAULT_PWM_FREQ		16000
 #define BLDC_MIN_DUTY_CYCLE			5000
+#define BLDC_FORCED_COMMUTATION_MS	25		// commutate when starting stalls this long
+#define BLDC_HALL_TABLES			12		// hall sensor wirings, see bldc.hallTable
 
 // Use these to keep track of the
 //	current state of the motor
@@ -44,11 +46,22 @@ typedef enum
 // These are the motor interface functions,
 //	or the "public" functions
 void BLDC_initMotor(void);
+void BLDC_deinitMotor(void);
 void BLDC_startMotor(void);
 void BLDC_stopMotor(void);
 void BLDC_commandDutyCycle(uint16_t dutyCycle);
 void BLDC_commandDirection(bool direction);
 
 uint8_t BLDC_getMotorState(void);
+int8_t BLDC_getSector(void);
+uint16_t BLDC_getDutyCycle(void);
+uint32_t BLDC_getElectricalPeriod(void);
+
+void BLDC_setStartDutyCycle(uint16_t dutyCycle);
+uint16_t BLDC_getStartDutyCycle(void);
+void BLDC_setForcedCommutationTime(uint16_t milliSeconds);
+uint16_t BLDC_getForcedCommutationTime(void);
+void BLDC_setHallTable(uint8_t table);
+uint8_t BLDC_getHallTable(void);
 
 #endif
@@ -36,6 +36,7 @@ _motor_command MDC_command;
  *
  * Purpose:		This function is called by higher-level software in order
  * 					to initialize the motor in preparation for operation.
+ * 					The PWM timer is set up by motor.c.
  *
  * Parameters:	none
  *
@@ -46,9 +47,6 @@ _motor_command MDC_command;
 void
 MDC_initMotor(void)
 {
-	MPWM_initMotorPwm();
-	MPWM_setMotorPwmFreq(16000);
-
 	MDC_stopMotor();
 	MDC_commandDirection(MDC_POS);
 
@@ -94,14 +92,15 @@ MDC_startMotor(void)
 void
 MDC_stopMotor(void)
 {
+	// Place the motor in the STOPPED state first, so that a duty
+	//	command from an interrupt cannot turn the phases back on
+	MDC_motor.state = MDC_STOPPED;
+
 	// Place each phase in the DORMANT state
 	MPWM_setPhaseDutyCycle(MPWM_PH_A, MPWM_DORMANT, 0);
 	MPWM_setPhaseDutyCycle(MPWM_PH_B, MPWM_DORMANT, 0);
 	MPWM_setPhaseDutyCycle(MPWM_PH_C, MPWM_DORMANT, 0);
 
-	// Place the motor in the STOPPED state
-	MDC_motor.state = MDC_STOPPED;
-
 	return;
 } // END MDC_stopMotor()
 
@@ -184,4 +183,21 @@ MDC_getMotorState(void){
 	return MDC_motor.state;
 }
 
+/***************************************************************
+ * Function:	uint16_t MDC_getDutyCycle(void)
+ *
+ * Purpose:		This function is called by higher-level software
+ * 					to retrieve the duty cycle being applied.
+ *
+ * Parameters:	none
+ *
+ * Returns:		uint16_t motor.dutyCycle
+ *
+ * Globals affected:	none
+ **************************************************************/
+uint16_t
+MDC_getDutyCycle(void){
+	return MDC_motor.dutyCycle;
+}
+
 
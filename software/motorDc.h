@@ -39,5 +39,6 @@ void MDC_commandDutyCycle(uint16_t dutyCycle);
 void MDC_commandDirection(_MDC_motorDirection direction);
 
 uint8_t MDC_getMotorState(void);
+uint16_t MDC_getDutyCycle(void);
 
 #endif
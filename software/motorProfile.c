@@ -0,0 +1,220 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <string.h>
+
+/* User-generated libs */
+#include "motorProfile.h"
+#include "log.h"
+#include "motor.h"
+#include "motorBldc.h"
+#include "mpwm.h"
+#include "param.h"
+
+// Parameters set by a profile, in the order they are applied: the
+//	motor type first, so the library it selects gets the rest
+#define MPRF_FIELDS				7
+
+const char *const mprfParamNames[MPRF_FIELDS] =
+{
+	"motor.type",
+	"bldc.hallTable",
+	"pwm.frequency",
+	"pwm.deadTimeNs",
+	"bldc.startDuty",
+	"bldc.forceCommMs",
+	"motor.maxDuty"
+};
+
+// The motors fitted in the field.  Values a motor type does not use
+//	are left at the defaults, so switching between profiles changes
+//	as little as possible.
+const _MPRF_profile mprfTable[] =
+{
+	{"default",	MOT_BLDC,	0,	MOT_DEFAULT_PWM_FREQ,	MPWM_DEFAULT_DEAD_TIME_NS,	BLDC_MIN_DUTY_CYCLE,	BLDC_FORCED_COMMUTATION_MS,	MOT_DEFAULT_MAX_DUTY_CYCLE},
+	{"bldc24k",	MOT_BLDC,	0,	24000,					500,						6000,					15,							20000},
+	{"dc",		MOT_DC,		0,	MOT_DEFAULT_PWM_FREQ,	MPWM_DEFAULT_DEAD_TIME_NS,	BLDC_MIN_DUTY_CYCLE,	BLDC_FORCED_COMMUTATION_MS,	MOT_DEFAULT_MAX_DUTY_CYCLE},
+};
+
+#define MPRF_COUNT		(sizeof(mprfTable) / sizeof(mprfTable[0]))
+
+/* Global variables */
+typedef struct
+{
+	uint8_t ids[MPRF_FIELDS];			// parameter id of each field
+} _motorProfile;
+
+_motorProfile motorProfile;
+
+/* Private function declarations */
+void MPRF_getValues(const _MPRF_profile *profile, uint32_t *values);
+
+/***************************************************************
+ * Function:	void MPRF_initProfile(void)
+ *
+ * Purpose:		To look up the parameter behind each profile
+ * 					field once, so applying a profile does no name
+ * 					searches
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	motorProfile.ids
+ **************************************************************/
+void
+MPRF_initProfile(void)
+{
+	uint8_t i;
+
+	for(i = 0; i < MPRF_FIELDS; i++)
+	{
+		motorProfile.ids[i] = (uint8_t)PRM_findParam(mprfParamNames[i]);
+	}
+
+	return;
+} // END MPRF_initProfile()
+
+uint8_t
+MPRF_getCount(void)
+{
+	return MPRF_COUNT;
+}
+
+const _MPRF_profile*
+MPRF_getProfile(uint8_t index)
+{
+	return (index < MPRF_COUNT) ? &mprfTable[index] : NULL;
+}
+
+// Returns the index, -1 if there is no profile of that name
+int8_t
+MPRF_findProfile(const char *name)
+{
+	uint8_t index;
+
+	for(index = 0; index < MPRF_COUNT; index++)
+	{
+		if(strcmp(name, mprfTable[index].name) == 0)
+			return index;
+	}
+
+	return -1;
+}
+
+/***************************************************************
+ * Function:	bool MPRF_isInUse(uint8_t index)
+ *
+ * Purpose:		To find out whether every value of a profile is
+ * 					the one in use
+ *
+ * Parameters:	uint8_t index
+ *
+ * Returns:		true when nothing would change on applying it
+ *
+ * Globals affected:	none
+ **************************************************************/
+bool
+MPRF_isInUse(uint8_t index)
+{
+	uint32_t values[MPRF_FIELDS];
+	uint32_t value;
+	uint8_t i;
+
+	if(index >= MPRF_COUNT)
+	{
+		return false;
+	}
+
+	MPRF_getValues(&mprfTable[index], values);
+
+	for(i = 0; i < MPRF_FIELDS; i++)
+	{
+		if((PRM_read(motorProfile.ids[i], &value) != PRM_OK) || (value != values[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+} // END MPRF_isInUse()
+
+/***************************************************************
+ * Function:	_MPRF_status MPRF_applyProfile(uint8_t index, uint8_t *changed)
+ *
+ * Purpose:		To switch to a profile while the motor is stopped.
+ * 					Every value is checked before any is written, as
+ * 					a parameter write batch, and only the values
+ * 					that differ are written.
+ *
+ * Parameters:	uint8_t index
+ * 				uint8_t *changed		parameters written
+ *
+ * Returns:		_MPRF_status
+ *
+ * Globals affected:	the parameters of the profile
+ **************************************************************/
+_MPRF_status
+MPRF_applyProfile(uint8_t index, uint8_t *changed)
+{
+	uint32_t values[MPRF_FIELDS];
+	uint32_t value;
+	uint8_t i;
+
+	*changed = 0;
+
+	if(index >= MPRF_COUNT)
+	{
+		return MPRF_ERR_PROFILE;
+	}
+
+	if(!MOT_isStopped())
+	{
+		return MPRF_ERR_RUNNING;
+	}
+
+	MPRF_getValues(&mprfTable[index], values);
+
+	for(i = 0; i < MPRF_FIELDS; i++)
+	{
+		if(PRM_check(motorProfile.ids[i], values[i]) != PRM_OK)
+		{
+			return MPRF_ERR_RANGE;
+		}
+	}
+
+	for(i = 0; i < MPRF_FIELDS; i++)
+	{
+		if((PRM_read(motorProfile.ids[i], &value) == PRM_OK) && (value == values[i]))
+		{
+			continue;
+		}
+
+		PRM_write(motorProfile.ids[i], values[i]);
+		(*changed)++;
+	}
+
+	LOG("profile: %s, %u values changed", mprfTable[index].name, *changed);
+
+	return MPRF_OK;
+} // END MPRF_applyProfile()
+
+// Fills values[] in the order of mprfParamNames
+void
+MPRF_getValues(const _MPRF_profile *profile, uint32_t *values)
+{
+	values[0] = profile->motorType;
+	values[1] = profile->hallTable;
+	values[2] = profile->pwmFrequency;
+	values[3] = profile->deadTimeNs;
+	values[4] = profile->startDutyCycle;
+	values[5] = profile->forcedCommutationMs;
+	values[6] = profile->maxDutyCycle;
+	return;
+}
@@ -0,0 +1,55 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef MOTORPROFILE_H
+#define MOTORPROFILE_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Motor calibration profiles
+ *
+ * A profile is a named set of values for the parameters that depend on
+ *	the motor fitted (see mprfTable in motorProfile.c).  Applying one
+ *	writes, through the parameter map, only the values that differ
+ *	from those in use: a parameter that already matches costs nothing,
+ *	the PWM timer is never set up again, and the ADC keeps its
+ *	calibration.  The values are stored like any parameter write, so
+ *	the profile is still in use after a reset.
+ */
+
+typedef struct
+{
+	const char *name;
+	uint8_t motorType;					// _MOT_motorType
+	uint8_t hallTable;					// BLDC hall sensor wiring
+	uint16_t pwmFrequency;				// Hz
+	uint16_t deadTimeNs;
+	uint16_t startDutyCycle;			// BLDC start-up, 0-65535
+	uint16_t forcedCommutationMs;		// BLDC start-up
+	uint16_t maxDutyCycle;				// 0-65535
+} _MPRF_profile;
+
+typedef enum
+{
+	MPRF_OK,
+	MPRF_ERR_PROFILE,					// no such profile
+	MPRF_ERR_RUNNING,					// the motor is not stopped
+	MPRF_ERR_RANGE						// a value the parameter map rejects
+} _MPRF_status;
+
+void MPRF_initProfile(void);
+uint8_t MPRF_getCount(void);
+const _MPRF_profile* MPRF_getProfile(uint8_t index);
+int8_t MPRF_findProfile(const char *name);
+bool MPRF_isInUse(uint8_t index);
+_MPRF_status MPRF_applyProfile(uint8_t index, uint8_t *changed);
+
+#endif
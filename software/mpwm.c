@@ -15,18 +15,15 @@
 #include "mpwm.h"
 #include "gpio.h"
 #include "adc.h"
+#include "perfMon.h"
+#include "pinMap.h"
 
 typedef struct{
 	_phaseState stateA, stateB, stateC;
 } _phase;
 
 _phase MPWM_motorPhase;
-
-/*
- * Private function declarations
- */
-void MPWM_setDeadTime(float deadTimeInUs);
-
+uint16_t MPWM_adcSamplingTime;		// fraction of the period, kept across frequency changes
 
 /*
  * Implementations
@@ -43,14 +40,7 @@ void MPWM_setDeadTime(float deadTimeInUs);
 void
 MPWM_initMotorPwm(void)
 {
-    // Setup TIM1 outputs
-	// TIM1 pins are not remapped
-	GPIO_pinSetup(GPIO_PORT_B, 13, GPIO_OUTPUT_ALT_PP);
-	GPIO_pinSetup(GPIO_PORT_B, 14, GPIO_OUTPUT_ALT_PP);
-	GPIO_pinSetup(GPIO_PORT_B, 15, GPIO_OUTPUT_ALT_PP);
-	GPIO_pinSetup(GPIO_PORT_A, 8, GPIO_OUTPUT_ALT_PP);
-	GPIO_pinSetup(GPIO_PORT_A, 9, GPIO_OUTPUT_ALT_PP);
-	GPIO_pinSetup(GPIO_PORT_A, 10, GPIO_OUTPUT_ALT_PP);
+	// The TIM1 outputs are set up by GPIO_initPins() (pinMap.h)
 
 	DBGMCU->CR |= (uint32_t)(1 << 10);		// Stop TMR1 when in debug mode
 
@@ -73,8 +63,8 @@ MPWM_initMotorPwm(void)
 	MPWM_setPhaseDutyCycle(MPWM_PH_B, MPWM_DORMANT, 0);
 	MPWM_setPhaseDutyCycle(MPWM_PH_C, MPWM_DORMANT, 0);
 
-	// Dead-time generation 1us dead-time
-	MPWM_setDeadTime(1.0);
+	// Dead-time generation, 1us unless the pwm.deadTimeNs parameter says otherwise
+	MPWM_setDeadTimeNs(MPWM_DEFAULT_DEAD_TIME_NS);
 
 	// Set ADC sampling time
 	MPWM_setAdcSamplingTime(35000);
@@ -97,6 +87,9 @@ MPWM_initMotorPwm(void)
 	TIM1->CCER |= (uint16_t)((0b1 << 13)	// Change the polarity CH4 (ADC triggers on falling edge)
 							+ (0b0 << 12)); // Enable the output of CH4
 
+	// Load the preloaded period before the first cycle
+	TIM1->EGR = (uint16_t)(0b1 << 0);
+
 	// Counter enabled
 	TIM1->CR1 |= (uint16_t)(0b1 << 0);
 
@@ -106,60 +99,116 @@ MPWM_initMotorPwm(void)
 /***************************************************************************
  * 	Function:	void MPWM_setMotorPwmFreq(uint16_t pwmFrequency);
  *
- * 	Purpose:	To easily set the pwm frequency for the motor PWM
+ * 	Purpose:	To easily set the pwm frequency for the motor PWM.  The
+ * 					period is preloaded and starts with the next one; the
+ * 					phase duty cycles and the ADC trigger are rescaled to
+ * 					it at once, so the period in progress may end with
+ * 					one pulse of the wrong width.
  *
- * 	Parameters:	uint16_t pwmFrequency	Valid values are 1200 to 65535, which
- * 										determine the pwm frequency in hertz
+ * 	Parameters:	uint16_t pwmFrequency	Valid values are MPWM_MIN_PWM_FREQ to
+ * 										MPWM_MAX_PWM_FREQ, which determine the
+ * 										pwm frequency in hertz
  ***************************************************************************/
 void
 MPWM_setMotorPwmFreq(uint16_t pwmFrequency)
 {
-	// Limit PWM frequency to lower values (in Hz).
-	//	An upper limit is not necessary since the
-	//	value is intrinsically limited by the width
-	if(pwmFrequency < 1200)
-		pwmFrequency = 1200;
+	// Limit PWM frequency (in Hz).  Above the upper limit the
+	//	control interrupt triggered by CCR4 no longer keeps up.
+	if(pwmFrequency < MPWM_MIN_PWM_FREQ)
+		pwmFrequency = MPWM_MIN_PWM_FREQ;
+	else if(pwmFrequency > MPWM_MAX_PWM_FREQ)
+		pwmFrequency = MPWM_MAX_PWM_FREQ;
 
 	uint32_t timerOneFreq = OSC_getClockFreq();
 	uint16_t arrValue = (uint16_t)(timerOneFreq/(uint32_t)pwmFrequency);
+	uint16_t oldArrValue = TIM1->ARR;
 
+	// ARR is loaded at the next update event, so the counter
+	//	can never be left above a shorter period
+	TIM1->CR1 |= (uint16_t)(0b1 << 7);		// ARPE
 	TIM1->ARR = arrValue;
 
+	// Keep each phase at the same fraction of the period
+	if(oldArrValue != 0)
+	{
+		TIM1->CCR1 = (uint16_t)(((uint32_t)TIM1->CCR1 * arrValue) / oldArrValue);
+		TIM1->CCR2 = (uint16_t)(((uint32_t)TIM1->CCR2 * arrValue) / oldArrValue);
+		TIM1->CCR3 = (uint16_t)(((uint32_t)TIM1->CCR3 * arrValue) / oldArrValue);
+	}
+
+	MPWM_setAdcSamplingTime(MPWM_adcSamplingTime);
+
 	return;
 }
 
 /***************************************************************************
- * Function:	void MPWM_setDeadTime(float deadTimeInUs);
+ * 	Function:	uint16_t MPWM_getMotorPwmFreq(void);
+ *
+ * 	Purpose:	To read back the pwm frequency in hertz, as set by the
+ * 				timer period
  ***************************************************************************/
+uint16_t
+MPWM_getMotorPwmFreq(void)
+{
+	return (uint16_t)(OSC_getClockFreq() / TIM1->ARR);
+}
 
+/***************************************************************************
+ * Function:	void MPWM_setDeadTimeNs(uint16_t deadTimeNs);
+ *
+ * Purpose:		To set the dead time inserted between the high and low
+ * 				side switches of each phase, rounded down to whole timer
+ * 				clock cycles
+ *
+ * Parameters:	uint16_t deadTimeNs		limited to MPWM_MIN_DEAD_TIME_NS to
+ * 										MPWM_MAX_DEAD_TIME_NS
+ *
+ * Notes:		The IR2301 gate drivers pass both inputs straight through,
+ * 				with up to 50ns of delay mismatch and 80ns of fall time, and
+ * 				the MOSFETs take longer still to turn off.  Below
+ * 				MPWM_MIN_DEAD_TIME_NS a bridge leg risks shoot-through.
+ ***************************************************************************/
 void
-MPWM_setDeadTime(float deadTimeInUs)
+MPWM_setDeadTimeNs(uint16_t deadTimeNs)
 {
-	float deadTimeInCycles = (uint16_t)((deadTimeInUs/1000000) * (float)OSC_getClockFreq());
+	if(deadTimeNs < MPWM_MIN_DEAD_TIME_NS)
+	{
+		deadTimeNs = MPWM_MIN_DEAD_TIME_NS;
+	}
+
+	uint32_t deadTimeInCycles = ((uint32_t)deadTimeNs * (OSC_getClockFreq() / 1000000)) / 1000;
 
 	// We can only use 7 bits in the dead-time generator register, so the value must be limited
-	if(deadTimeInCycles > 127.0)
+	if(deadTimeInCycles > 127)
 	{
-		deadTimeInCycles = 127.0;
+		deadTimeInCycles = 127;
 	}
 
-	// Convert to a byte value
-	uint16_t deadTimeGeneratorReg = (uint16_t)deadTimeInCycles;
-
 	// Save the BDTR register
 	uint16_t BDTR_reg = TIM1->BDTR;
 
 	// Clear the bits of the dead time register
 	BDTR_reg &= 0xff00;
 
-	BDTR_reg |= deadTimeGeneratorReg;
+	BDTR_reg |= (uint16_t)deadTimeInCycles;
 
 	// Load the dead time register with the new value
 	TIM1->BDTR = BDTR_reg;
 
 	return;
 
-} // END MPWM_setDeadTime()
+} // END MPWM_setDeadTimeNs()
+
+/***************************************************************************
+ * 	Function:	uint16_t MPWM_getDeadTimeNs(void);
+ *
+ * 	Purpose:	To read back the dead time in nanoseconds
+ ***************************************************************************/
+uint16_t
+MPWM_getDeadTimeNs(void)
+{
+	return (uint16_t)(((TIM1->BDTR & 0x7F) * 1000) / (OSC_getClockFreq() / 1000000));
+}
 
 /***************************************************************************
  * 	Function:	void MPWM_setAdcSamplingTime(uint16_t samplingTime);
@@ -171,13 +220,15 @@ MPWM_setDeadTime(float deadTimeInUs)
  * 										65000, that means that the ADC will be triggered near
  * 										the end of the PWM pulse, regardless of the duty cycle.
  *
- * 	Notes:		none
+ * 	Notes:		The fraction is kept, and MPWM_setMotorPwmFreq() reapplies it
  *
  * 	Example:	none
  ***************************************************************************/
 void
 MPWM_setAdcSamplingTime(uint16_t samplingTime)
 {
+	MPWM_adcSamplingTime = samplingTime;
+
 	uint16_t adcSampleTime = (uint16_t)(((uint32_t)samplingTime * (uint32_t)TIM1->ARR) >> 16);
 	TIM1->CCR4 = adcSampleTime;		// Load the adc trigger register
 }
@@ -371,10 +422,14 @@ MPWM_setPhaseDutyCycle(uint8_t phase, uint8_t state, uint16_t dutyCycle)
 void
 TIM1_CC_IRQHandler(void)
 {
+	PERF_controlTrigger();
+
 	ADC_startAdcConversion();
 
 	TIM1->SR = 0;
-	GPIO_clearOutputPin(GPIO_PORT_A, 5);
+	GPIO_clearPins(PIN_TACH_GPIO, 1 << PIN_TACH_PIN);
+
+	PERF_isrExit();
 	return;
 } // END TIM2_IRQHandler
 
@@ -9,6 +9,13 @@
 #ifndef MOTPWM_H
 #define MOTPWM_H
 
+#define MPWM_MIN_PWM_FREQ			1200		// ARR fits 16 bits at 72MHz
+#define MPWM_MAX_PWM_FREQ			24000		// fastest the control interrupt runs at (bldc24k)
+
+#define MPWM_DEFAULT_DEAD_TIME_NS	1000
+#define MPWM_MIN_DEAD_TIME_NS		500			// IR2301: no dead time of its own, see MPWM_setDeadTimeNs()
+#define MPWM_MAX_DEAD_TIME_NS		1763		// 127 cycles of 72MHz
+
 typedef enum
 {
 	MPWM_PH_A,
@@ -25,6 +32,9 @@ typedef enum
 
 void MPWM_initMotorPwm(void);
 void MPWM_setMotorPwmFreq(uint16_t pwmFrequency);
+uint16_t MPWM_getMotorPwmFreq(void);
+void MPWM_setDeadTimeNs(uint16_t deadTimeNs);
+uint16_t MPWM_getDeadTimeNs(void);
 void MPWM_setPhaseDutyCycle(uint8_t phase, uint8_t state, uint16_t dutyCycle);
 void MPWM_setAdcSamplingTime(uint16_t samplingTime);
 
@@ -20,6 +20,7 @@ __osc oscillator;
  */
 void OSC_initHseClock(void);
 void OSC_initHsiClock(void);
+bool OSC_isHsePllRunning(void);
 
 // Function implementations here
 void
@@ -37,51 +38,59 @@ OSC_initClock(void)
 void
 OSC_initHseClock(void)
 {
-	/* SYSCLK, HCLK, PCLK2 and PCLK1 configuration -----------------------------*/
-	/* RCC system reset(for debug purpose) */
-	RCC_DeInit();
+	// SystemInit() has brought up the HSE PLL at 72MHz already, or
+	//	kept the bootloader's after a warm restart (FLT_warmRestart()).
+	//	Only tear the clock tree down and wait for HSE and PLL again
+	//	when it is not running as needed.
+	if(!OSC_isHsePllRunning())
+	{
+		/* SYSCLK, HCLK, PCLK2 and PCLK1 configuration -----------------------------*/
+		/* RCC system reset(for debug purpose) */
+		RCC_DeInit();
 
-	/* Enable Prefetch Buffer */
-	FLASH_PrefetchBufferCmd(FLASH_PrefetchBuffer_Enable);
+		/* Enable Prefetch Buffer */
+		FLASH_PrefetchBufferCmd(FLASH_PrefetchBuffer_Enable);
 
-	/* Flash 2 wait state */
-	FLASH_SetLatency(FLASH_Latency_2);
+		/* Flash 2 wait state */
+		FLASH_SetLatency(FLASH_Latency_2);
 
-	// HSE On
-	RCC->CR |= (uint32_t)(0b1 << 16);
+		// HSE On
+		RCC->CR |= (uint32_t)(0b1 << 16);
 
-	// Wait for HSE to start
-	bool hseRdy = false;
+		// Wait for HSE to start
+		bool hseRdy = false;
 
-	while(!hseRdy){
-		hseRdy = (bool)(0b1 & (RCC->CR  >> 17));
-	}
+		while(!hseRdy){
+			hseRdy = (bool)(0b1 & (RCC->CR  >> 17));
+		}
 
-	// PLLSRC = HSE
-	RCC->CFGR |= (uint32_t)(0b1 << 16);
+		// PLLSRC = HSE
+		RCC->CFGR |= (uint32_t)(0b1 << 16);
 
-	// pllOutput = pllInput x 9 = 8MHz x 9 = 72MHz
-	RCC->CFGR |= (uint32_t)(0b0111 << 18);
+		// pllOutput = pllInput x 9 = 8MHz x 9 = 72MHz
+		RCC->CFGR |= (uint32_t)(0b0111 << 18);
 
-	// PLL ON
-	RCC->CR |= (uint32_t)(0b1 << 24);
+		// PLL ON
+		RCC->CR |= (uint32_t)(0b1 << 24);
 
-	// Wait for PLL to lock
-	bool pllRdy = false;
+		// Wait for PLL to lock
+		bool pllRdy = false;
 
-	while(pllRdy == false){
-		pllRdy = (bool)(0b1 & (RCC->CR >> 25));
-	}
+		while(pllRdy == false){
+			pllRdy = (bool)(0b1 & (RCC->CR >> 25));
+		}
 
-	// Set system clock as PLL
-	RCC->CFGR |= (uint32_t)(0b10 << 0);
+		// Set system clock as PLL
+		RCC->CFGR |= (uint32_t)(0b10 << 0);
 
-	// Wait for system clock to complete switch
-	uint32_t clock = 0;
+		// Wait for system clock to complete switch
+		uint32_t clock = 0;
 
-	while(clock != 0b10){
-		clock = (uint32_t)((RCC->CFGR >> 2) & 0x00000003);
+		while(clock != 0b10){
+			clock = (uint32_t)((RCC->CFGR >> 2) & 0x00000003);
+		}
 	}
+
 	// PLL = HSE (8MHz) x 9 = 72MHz
 	// APB1 = 36MHz, APB2 = 72MHz
 	RCC->CFGR |= (uint32_t)(0b100 << 8);
@@ -164,6 +173,30 @@ OSC_initHsiClock(void)
 	return;
 } // END InitHsiClock()
 
+/***************************************************************
+ * Function:	bool OSC_isHsePllRunning(void)
+ *
+ * Purpose:		To check whether the system clock already runs from
+ * 					the PLL, fed by the undivided HSE and multiplied
+ * 					by 9 (72MHz), with 2 flash wait states
+ *
+ * Parameters:	none
+ *
+ * Returns:		true when the clock tree needs no bring-up
+ *
+ * Globals affected:	none
+ **************************************************************/
+bool
+OSC_isHsePllRunning(void)
+{
+	bool sysclkIsPll = (((RCC->CFGR >> 2) & 0x00000003) == 0b10);
+	bool pllIsHse = ((RCC->CFGR & (uint32_t)(0b11 << 16)) == (uint32_t)(0b1 << 16));
+	bool pllIsX9 = (((RCC->CFGR >> 18) & 0b1111) == 0b0111);
+	bool flashIs2Ws = ((FLASH->ACR & FLASH_ACR_LATENCY) == FLASH_ACR_LATENCY_2);
+
+	return sysclkIsPll && pllIsHse && pllIsX9 && flashIs2Ws;
+} // END OSC_isHsePllRunning()
+
 uint32_t
 OSC_getClockFreq(void)
 {
@@ -0,0 +1,777 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <string.h>
+
+/* User-generated libs */
+#include "param.h"
+#include "analogInput.h"
+#include "canNode.h"
+#include "demand.h"
+#include "frame.h"
+#include "i2cSlave.h"
+#include "log.h"
+#include "motor.h"
+#include "motorBldc.h"
+#include "mpwm.h"
+#include "paramStore.h"
+#include "perfMon.h"
+#include "rcPwm.h"
+#include "telemetry.h"
+
+#define PRM_RESPONSE_HEADER		3			// seq, op, status
+
+/* Global variables */
+typedef struct
+{
+	uint32_t mapHash;
+} _param;
+
+_param param;
+
+/* Private function declarations */
+void PRM_apply(uint8_t id, uint32_t value);
+bool PRM_inRange(const _PRM_param *entry, uint32_t value);
+uint32_t PRM_readWord(const uint8_t *data);
+void PRM_writeWord(uint8_t *data, uint32_t value);
+
+uint32_t PRM_getMaxDuty(void);
+void PRM_setMaxDuty(uint32_t value);
+uint32_t PRM_getStartDuty(void);
+void PRM_setStartDuty(uint32_t value);
+uint32_t PRM_getForcedCommutation(void);
+void PRM_setForcedCommutation(uint32_t value);
+uint32_t PRM_getPwmFrequency(void);
+void PRM_setPwmFrequency(uint32_t value);
+uint32_t PRM_getTlmDecimation(void);
+void PRM_setTlmDecimation(uint32_t value);
+uint32_t PRM_getPerfWindow(void);
+void PRM_setPerfWindow(uint32_t value);
+uint32_t PRM_getI2cAddress(void);
+void PRM_setI2cAddress(uint32_t value);
+uint32_t PRM_getCanNode(void);
+void PRM_setCanNode(uint32_t value);
+uint32_t PRM_getCanGroup(void);
+void PRM_setCanGroup(uint32_t value);
+uint32_t PRM_getCanSlot(void);
+void PRM_setCanSlot(uint32_t value);
+uint32_t PRM_getCanTimeout(void);
+void PRM_setCanTimeout(uint32_t value);
+uint32_t PRM_getCanTelemetry(void);
+void PRM_setCanTelemetry(uint32_t value);
+uint32_t PRM_getCanStatus(void);
+void PRM_setCanStatus(uint32_t value);
+uint32_t PRM_getRcInput(void);
+void PRM_setRcInput(uint32_t value);
+uint32_t PRM_getDemandOrder(void);
+void PRM_setDemandOrder(uint32_t value);
+uint32_t PRM_getAinMin(void);
+void PRM_setAinMin(uint32_t value);
+uint32_t PRM_getAinMax(void);
+void PRM_setAinMax(uint32_t value);
+uint32_t PRM_getAinDeadband(void);
+void PRM_setAinDeadband(uint32_t value);
+uint32_t PRM_getAinHysteresis(void);
+void PRM_setAinHysteresis(uint32_t value);
+uint32_t PRM_getDeadTime(void);
+void PRM_setDeadTime(uint32_t value);
+uint32_t PRM_getHallTable(void);
+void PRM_setHallTable(uint32_t value);
+uint32_t PRM_getMotorType(void);
+void PRM_setMotorType(uint32_t value);
+
+// Ids are indices into this table: append new entries at the end so
+//	that tuning scripts keep working
+const _PRM_param prmTable[] =
+{
+	{"motor.maxDuty",		PRM_TYPE_U16,	0,	0,		0xFFFF,				PRM_getMaxDuty,				PRM_setMaxDuty},
+	{"bldc.startDuty",		PRM_TYPE_U16,	0,	0,		0xFFFF,				PRM_getStartDuty,			PRM_setStartDuty},
+	{"bldc.forceCommMs",	PRM_TYPE_U16,	0,	1,		1000,				PRM_getForcedCommutation,	PRM_setForcedCommutation},
+	{"pwm.frequency",		PRM_TYPE_U16,	0,	MPWM_MIN_PWM_FREQ,	MPWM_MAX_PWM_FREQ,	PRM_getPwmFrequency,	PRM_setPwmFrequency},
+	{"tlm.decimation",		PRM_TYPE_U16,	0,	1,		0xFFFF,				PRM_getTlmDecimation,		PRM_setTlmDecimation},
+	{"perf.window",			PRM_TYPE_U16,	0,	10,		PERF_MAX_WINDOW_MS,	PRM_getPerfWindow,			PRM_setPerfWindow},
+	{"i2c.address",			PRM_TYPE_U8,	0,	I2CS_MIN_ADDRESS,	I2CS_MAX_ADDRESS,	PRM_getI2cAddress,	PRM_setI2cAddress},
+	{"can.node",			PRM_TYPE_U8,	0,	1,		CANN_MAX_NODE,		PRM_getCanNode,				PRM_setCanNode},
+	{"can.group",			PRM_TYPE_U8,	0,	0,		CANN_MAX_GROUP,		PRM_getCanGroup,			PRM_setCanGroup},
+	{"can.slot",			PRM_TYPE_U8,	0,	0,		CANN_GROUP_SLOTS - 1,	PRM_getCanSlot,			PRM_setCanSlot},
+	{"can.timeoutMs",		PRM_TYPE_U16,	0,	0,		0xFFFF,				PRM_getCanTimeout,			PRM_setCanTimeout},
+	{"can.telemetryMs",		PRM_TYPE_U16,	0,	0,		0xFFFF,				PRM_getCanTelemetry,		PRM_setCanTelemetry},
+	{"can.statusMs",		PRM_TYPE_U16,	0,	0,		0xFFFF,				PRM_getCanStatus,			PRM_setCanStatus},
+	{"rc.input",			PRM_TYPE_U8,	0,	0,		RCPWM_INPUT_COUNT - 1,	PRM_getRcInput,			PRM_setRcInput},
+	{"demand.order",		PRM_TYPE_U32,	0,	0,		0xFFFFFFFF,			PRM_getDemandOrder,			PRM_setDemandOrder},
+	{"ain.min",				PRM_TYPE_U16,	0,	0,		AIN_MAX_COUNTS,		PRM_getAinMin,				PRM_setAinMin},
+	{"ain.max",				PRM_TYPE_U16,	0,	1,		AIN_MAX_COUNTS,		PRM_getAinMax,				PRM_setAinMax},
+	{"ain.deadband",		PRM_TYPE_U16,	0,	0,		AIN_MAX_COUNTS,		PRM_getAinDeadband,			PRM_setAinDeadband},
+	{"ain.hysteresis",		PRM_TYPE_U16,	0,	0,		AIN_MAX_COUNTS,		PRM_getAinHysteresis,		PRM_setAinHysteresis},
+	{"pwm.deadTimeNs",		PRM_TYPE_U16,	0,	MPWM_MIN_DEAD_TIME_NS,	MPWM_MAX_DEAD_TIME_NS,	PRM_getDeadTime,	PRM_setDeadTime},
+	{"bldc.hallTable",		PRM_TYPE_U8,	0,	0,		BLDC_HALL_TABLES - 1,	PRM_getHallTable,		PRM_setHallTable},
+	{"motor.type",			PRM_TYPE_U8,	0,	MOT_DC,	MOT_BLDC,			PRM_getMotorType,			PRM_setMotorType},
+};
+
+#define PRM_COUNT		(sizeof(prmTable) / sizeof(prmTable[0]))
+
+// Every parameter needs a key in the store
+typedef char prmStoreKeysCheck[(PRM_COUNT <= PST_PARAM_KEYS) ? 1 : -1];
+
+/***************************************************************
+ * Function:	void PRM_initParam(void)
+ *
+ * Purpose:		To fingerprint the register map (FNV-1a over the
+ * 					names, types, flags and limits) for PRM_OP_INFO
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	param.mapHash
+ **************************************************************/
+void
+PRM_initParam(void)
+{
+	uint32_t hash = 2166136261u;
+	const uint8_t *byte;
+	uint8_t id;
+	uint8_t i;
+
+	for(id = 0; id < PRM_COUNT; id++)
+	{
+		uint8_t fields[10];
+
+		fields[0] = prmTable[id].type;
+		fields[1] = prmTable[id].flags;
+		PRM_writeWord(&fields[2], prmTable[id].min);
+		PRM_writeWord(&fields[6], prmTable[id].max);
+
+		for(i = 0; i < sizeof(fields); i++)
+			hash = (hash ^ fields[i]) * 16777619u;
+
+		for(byte = (const uint8_t *)prmTable[id].name; *byte != '\0'; byte++)
+			hash = (hash ^ *byte) * 16777619u;
+	}
+
+	param.mapHash = hash;
+
+	return;
+} // END PRM_initParam()
+
+/***************************************************************
+ * Function:	void PRM_loadStored(void)
+ *
+ * Purpose:		To apply the values kept in the parameter store
+ * 					over the defaults.  Called once every module is
+ * 					initialized.  A stored value the table no longer
+ * 					accepts is left out.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	every stored parameter
+ **************************************************************/
+void
+PRM_loadStored(void)
+{
+	uint32_t value;
+	uint8_t id;
+
+	for(id = 0; id < PRM_COUNT; id++)
+	{
+		if(!PST_read(PST_KEY_PARAM + id, &value))
+		{
+			continue;
+		}
+
+		if(PRM_check(id, value) == PRM_OK)
+		{
+			prmTable[id].set(value);
+		}
+		else
+		{
+			LOG("param: stored %s=%u rejected", prmTable[id].name, value);
+		}
+	}
+
+	return;
+} // END PRM_loadStored()
+
+uint8_t
+PRM_getCount(void)
+{
+	return PRM_COUNT;
+}
+
+const _PRM_param*
+PRM_getParam(uint8_t id)
+{
+	return (id < PRM_COUNT) ? &prmTable[id] : NULL;
+}
+
+// Returns the id, -1 if there is no parameter of that name
+int16_t
+PRM_findParam(const char *name)
+{
+	uint8_t id;
+
+	for(id = 0; id < PRM_COUNT; id++)
+	{
+		if(strcmp(name, prmTable[id].name) == 0)
+			return id;
+	}
+
+	return -1;
+}
+
+uint32_t
+PRM_getMapHash(void)
+{
+	return param.mapHash;
+}
+
+_PRM_status
+PRM_read(uint8_t id, uint32_t *value)
+{
+	if(id >= PRM_COUNT)
+		return PRM_ERR_ID;
+
+	*value = prmTable[id].get();
+	return PRM_OK;
+}
+
+/***************************************************************
+ * Function:	_PRM_status PRM_check(uint8_t id, uint32_t value)
+ *
+ * Purpose:		To find out whether a value may be written
+ *
+ * Parameters:	uint8_t id
+ * 				uint32_t value		typed, see param.h
+ *
+ * Returns:		PRM_OK, PRM_ERR_ID, PRM_ERR_READ_ONLY or PRM_ERR_RANGE
+ *
+ * Globals affected:	none
+ **************************************************************/
+_PRM_status
+PRM_check(uint8_t id, uint32_t value)
+{
+	if(id >= PRM_COUNT)
+		return PRM_ERR_ID;
+
+	if(prmTable[id].flags & PRM_FLAG_READ_ONLY)
+		return PRM_ERR_READ_ONLY;
+
+	if(!PRM_inRange(&prmTable[id], value))
+		return PRM_ERR_RANGE;
+
+	return PRM_OK;
+} // END PRM_check()
+
+_PRM_status
+PRM_write(uint8_t id, uint32_t value)
+{
+	_PRM_status status = PRM_check(id, value);
+
+	if(status == PRM_OK)
+		PRM_apply(id, value);
+
+	return status;
+}
+
+/***************************************************************
+ * Function:	void PRM_handleRequest(const uint8_t *request, uint16_t length)
+ *
+ * Purpose:		To answer one binary request, see param.h.  Runs in
+ * 					the main loop; the caller makes sure the USB
+ * 					buffer has room for the response frame.
+ *
+ * Parameters:	const uint8_t *request		payload of a FRM_TYPE_PARAM_REQUEST
+ * 				uint16_t length
+ *
+ * Returns:		none
+ *
+ * Globals affected:	parameters written by PRM_OP_WRITE
+ **************************************************************/
+void
+PRM_handleRequest(const uint8_t *request, uint16_t length)
+{
+	uint8_t response[FRM_MAX_PAYLOAD];
+	uint8_t *data = &response[PRM_RESPONSE_HEADER];
+	uint8_t size = PRM_RESPONSE_HEADER;
+	uint8_t status = PRM_OK;
+	const uint8_t *arguments = &request[2];
+	uint16_t argumentLength = length - 2;
+	uint32_t value;
+	uint8_t count;
+	uint8_t nameLength;
+	uint8_t id;
+	uint8_t i;
+
+	if(length < 2)
+	{
+		return;
+	}
+
+	response[0] = request[0];
+	response[1] = request[1];
+
+	switch(request[1])
+	{
+		case PRM_OP_INFO:
+			data[0] = PRM_PROTOCOL_VERSION;
+			data[1] = PRM_COUNT;
+			PRM_writeWord(&data[2], param.mapHash);
+			size += 6;
+			break;
+
+		case PRM_OP_DESCRIBE:
+			if(argumentLength != 1)
+			{
+				status = PRM_ERR_LENGTH;
+				break;
+			}
+
+			for(id = arguments[0]; id < PRM_COUNT; id++)
+			{
+				nameLength = strlen(prmTable[id].name);
+				if((size + 12 + nameLength) > sizeof(response))
+				{
+					break;
+				}
+
+				response[size++] = id;
+				response[size++] = prmTable[id].type;
+				response[size++] = prmTable[id].flags;
+				PRM_writeWord(&response[size], prmTable[id].min);
+				PRM_writeWord(&response[size + 4], prmTable[id].max);
+				size += 8;
+				response[size++] = nameLength;
+				memcpy(&response[size], prmTable[id].name, nameLength);
+				size += nameLength;
+			}
+			break;
+
+		case PRM_OP_READ:
+			if((argumentLength == 0) || (argumentLength > PRM_MAX_READ))
+			{
+				status = PRM_ERR_LENGTH;
+				break;
+			}
+
+			for(i = 0; i < argumentLength; i++)
+			{
+				status = PRM_read(arguments[i], &value);
+				if(status != PRM_OK)
+				{
+					break;
+				}
+
+				PRM_writeWord(&response[size], value);
+				size += 4;
+			}
+			break;
+
+		case PRM_OP_WRITE:
+			count = argumentLength / 5;
+			if((argumentLength == 0) || ((argumentLength % 5) != 0) || (count > PRM_MAX_WRITE))
+			{
+				status = PRM_ERR_LENGTH;
+				break;
+			}
+
+			for(i = 0; i < count; i++)
+			{
+				status = PRM_check(arguments[i * 5], PRM_readWord(&arguments[(i * 5) + 1]));
+				if(status != PRM_OK)
+				{
+					break;
+				}
+			}
+
+			if(status == PRM_OK)
+			{
+				for(i = 0; i < count; i++)
+				{
+					PRM_apply(arguments[i * 5], PRM_readWord(&arguments[(i * 5) + 1]));
+				}
+			}
+
+			response[size++] = i;
+			break;
+
+		default:
+			status = PRM_ERR_OP;
+			break;
+	}
+
+	response[2] = status;
+	FRM_sendFrame(FRM_TYPE_PARAM_RESPONSE, response, size);
+
+	return;
+} // END PRM_handleRequest()
+
+// Applies a checked value and has it stored once the motor is idle
+void
+PRM_apply(uint8_t id, uint32_t value)
+{
+	prmTable[id].set(value);
+	PST_write(PST_KEY_PARAM + id, value);
+	return;
+}
+
+bool
+PRM_inRange(const _PRM_param *entry, uint32_t value)
+{
+	switch(entry->type)
+	{
+		case PRM_TYPE_I8:
+		case PRM_TYPE_I16:
+		case PRM_TYPE_I32:
+			return ((int32_t)value >= (int32_t)entry->min) && ((int32_t)value <= (int32_t)entry->max);
+
+		case PRM_TYPE_FLOAT:
+		{
+			union { uint32_t u; float f; } v = {value}, lo = {entry->min}, hi = {entry->max};
+			return (v.f >= lo.f) && (v.f <= hi.f);		// false for NaN
+		}
+
+		default:
+			return (value >= entry->min) && (value <= entry->max);
+	}
+}
+
+uint32_t
+PRM_readWord(const uint8_t *data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void
+PRM_writeWord(uint8_t *data, uint32_t value)
+{
+	data[0] = (uint8_t)value;
+	data[1] = (uint8_t)(value >> 8);
+	data[2] = (uint8_t)(value >> 16);
+	data[3] = (uint8_t)(value >> 24);
+	return;
+}
+
+/* Parameter accessors, referenced from prmTable */
+uint32_t
+PRM_getMaxDuty(void)
+{
+	return MOT_getMaxDutyCycle();
+}
+
+void
+PRM_setMaxDuty(uint32_t value)
+{
+	MOT_setMaxDutyCycle((uint16_t)value);
+	return;
+}
+
+uint32_t
+PRM_getStartDuty(void)
+{
+	return BLDC_getStartDutyCycle();
+}
+
+void
+PRM_setStartDuty(uint32_t value)
+{
+	BLDC_setStartDutyCycle((uint16_t)value);
+	return;
+}
+
+uint32_t
+PRM_getForcedCommutation(void)
+{
+	return BLDC_getForcedCommutationTime();
+}
+
+void
+PRM_setForcedCommutation(uint32_t value)
+{
+	BLDC_setForcedCommutationTime((uint16_t)value);
+	return;
+}
+
+uint32_t
+PRM_getPwmFrequency(void)
+{
+	return MPWM_getMotorPwmFreq();
+}
+
+void
+PRM_setPwmFrequency(uint32_t value)
+{
+	MPWM_setMotorPwmFreq((uint16_t)value);
+	return;
+}
+
+uint32_t
+PRM_getTlmDecimation(void)
+{
+	return TLM_getDecimation();
+}
+
+void
+PRM_setTlmDecimation(uint32_t value)
+{
+	TLM_setDecimation((uint16_t)value);
+	return;
+}
+
+uint32_t
+PRM_getPerfWindow(void)
+{
+	return PERF_getWindow();
+}
+
+void
+PRM_setPerfWindow(uint32_t value)
+{
+	PERF_setWindow((uint16_t)value);
+	return;
+}
+
+uint32_t
+PRM_getI2cAddress(void)
+{
+	return I2CS_getAddress();
+}
+
+void
+PRM_setI2cAddress(uint32_t value)
+{
+	I2CS_setAddress((uint8_t)value);
+	return;
+}
+
+uint32_t
+PRM_getCanNode(void)
+{
+	return CANN_getConfig()->node;
+}
+
+void
+PRM_setCanNode(uint32_t value)
+{
+	_CANN_config config = *CANN_getConfig();
+
+	config.node = (uint8_t)value;
+	CANN_configure(&config);
+	return;
+}
+
+uint32_t
+PRM_getCanGroup(void)
+{
+	return CANN_getConfig()->group;
+}
+
+void
+PRM_setCanGroup(uint32_t value)
+{
+	_CANN_config config = *CANN_getConfig();
+
+	config.group = (uint8_t)value;
+	CANN_configure(&config);
+	return;
+}
+
+uint32_t
+PRM_getCanSlot(void)
+{
+	return CANN_getConfig()->slot;
+}
+
+void
+PRM_setCanSlot(uint32_t value)
+{
+	_CANN_config config = *CANN_getConfig();
+
+	config.slot = (uint8_t)value;
+	CANN_configure(&config);
+	return;
+}
+
+uint32_t
+PRM_getCanTimeout(void)
+{
+	return CANN_getConfig()->timeoutMs;
+}
+
+void
+PRM_setCanTimeout(uint32_t value)
+{
+	_CANN_config config = *CANN_getConfig();
+
+	config.timeoutMs = (uint16_t)value;
+	CANN_configure(&config);
+	return;
+}
+
+uint32_t
+PRM_getCanTelemetry(void)
+{
+	return CANN_getConfig()->telemetryMs;
+}
+
+void
+PRM_setCanTelemetry(uint32_t value)
+{
+	_CANN_config config = *CANN_getConfig();
+
+	config.telemetryMs = (uint16_t)value;
+	CANN_configure(&config);
+	return;
+}
+
+uint32_t
+PRM_getCanStatus(void)
+{
+	return CANN_getConfig()->statusMs;
+}
+
+void
+PRM_setCanStatus(uint32_t value)
+{
+	_CANN_config config = *CANN_getConfig();
+
+	config.statusMs = (uint16_t)value;
+	CANN_configure(&config);
+	return;
+}
+
+uint32_t
+PRM_getRcInput(void)
+{
+	return RCPWM_getInput();
+}
+
+void
+PRM_setRcInput(uint32_t value)
+{
+	RCPWM_setInput((_RCPWM_input)value);
+	return;
+}
+
+uint32_t
+PRM_getDemandOrder(void)
+{
+	return DMD_getOrder();
+}
+
+void
+PRM_setDemandOrder(uint32_t value)
+{
+	DMD_setOrder(value);
+	return;
+}
+
+uint32_t
+PRM_getAinMin(void)
+{
+	return AIN_getConfig()->minCounts;
+}
+
+void
+PRM_setAinMin(uint32_t value)
+{
+	_AIN_config config = *AIN_getConfig();
+
+	config.minCounts = (uint16_t)value;
+	AIN_configure(&config);
+	return;
+}
+
+uint32_t
+PRM_getAinMax(void)
+{
+	return AIN_getConfig()->maxCounts;
+}
+
+void
+PRM_setAinMax(uint32_t value)
+{
+	_AIN_config config = *AIN_getConfig();
+
+	config.maxCounts = (uint16_t)value;
+	AIN_configure(&config);
+	return;
+}
+
+uint32_t
+PRM_getAinDeadband(void)
+{
+	return AIN_getConfig()->deadband;
+}
+
+void
+PRM_setAinDeadband(uint32_t value)
+{
+	_AIN_config config = *AIN_getConfig();
+
+	config.deadband = (uint16_t)value;
+	AIN_configure(&config);
+	return;
+}
+
+uint32_t
+PRM_getAinHysteresis(void)
+{
+	return AIN_getConfig()->hysteresis;
+}
+
+void
+PRM_setAinHysteresis(uint32_t value)
+{
+	_AIN_config config = *AIN_getConfig();
+
+	config.hysteresis = (uint16_t)value;
+	AIN_configure(&config);
+	return;
+}
+
+uint32_t
+PRM_getDeadTime(void)
+{
+	return MPWM_getDeadTimeNs();
+}
+
+void
+PRM_setDeadTime(uint32_t value)
+{
+	MPWM_setDeadTimeNs((uint16_t)value);
+	return;
+}
+
+uint32_t
+PRM_getHallTable(void)
+{
+	return BLDC_getHallTable();
+}
+
+void
+PRM_setHallTable(uint32_t value)
+{
+	BLDC_setHallTable((uint8_t)value);
+	return;
+}
+
+uint32_t
+PRM_getMotorType(void)
+{
+	return MOT_getMotorType();
+}
+
+void
+PRM_setMotorType(uint32_t value)
+{
+	MOT_defineMotorType((_MOT_motorType)value);
+	return;
+}
@@ -0,0 +1,99 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef PARAM_H
+#define PARAM_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Parameter register map
+ *
+ * Every tunable value is an entry of one const table, addressed by its
+ *	index (the id).  Values travel as 32 bits holding the typed value:
+ *	zero- or sign-extended integers, or IEEE-754 bits for floats.
+ *
+ * Binary protocol, one FRM_TYPE_PARAM_REQUEST frame from the host gets
+ *	one FRM_TYPE_PARAM_RESPONSE frame back.  All fields little-endian.
+ *
+ *	request:	seq u8 | op u8 | arguments
+ *	response:	seq u8 | op u8 | status u8 | data
+ *
+ *	PRM_OP_INFO		-						version u8 | count u8 | mapHash u32
+ *	PRM_OP_DESCRIBE	first id u8				{id u8 | type u8 | flags u8 | min u32 |
+ *											 max u32 | name length u8 | name} ...
+ *											as many entries as fit, none past the end
+ *	PRM_OP_READ		id u8 ...				value u32 ... for each id
+ *	PRM_OP_WRITE	{id u8 | value u32} ...	index u8 of the rejected pair,
+ *											or the pair count when all applied
+ *
+ * A write batch is checked in full before any value is applied, so it
+ *	is applied whole or not at all.  Written values are kept in the
+ *	parameter store (paramStore.h) and applied again at start-up.  mapHash changes whenever the table
+ *	does; hosts can cache the descriptions against it.
+ */
+#define PRM_PROTOCOL_VERSION		1
+#define PRM_MAX_READ				15		// ids per PRM_OP_READ
+#define PRM_MAX_WRITE				12		// pairs per PRM_OP_WRITE
+
+typedef enum
+{
+	PRM_TYPE_U8,
+	PRM_TYPE_I8,
+	PRM_TYPE_U16,
+	PRM_TYPE_I16,
+	PRM_TYPE_U32,
+	PRM_TYPE_I32,
+	PRM_TYPE_FLOAT
+} _PRM_type;
+
+#define PRM_FLAG_READ_ONLY			0x01
+
+typedef enum
+{
+	PRM_OP_INFO,
+	PRM_OP_DESCRIBE,
+	PRM_OP_READ,
+	PRM_OP_WRITE
+} _PRM_op;
+
+typedef enum
+{
+	PRM_OK,
+	PRM_ERR_OP,
+	PRM_ERR_LENGTH,
+	PRM_ERR_ID,
+	PRM_ERR_READ_ONLY,
+	PRM_ERR_RANGE
+} _PRM_status;
+
+typedef struct
+{
+	const char *name;
+	uint8_t type;						// _PRM_type
+	uint8_t flags;						// PRM_FLAG_*
+	uint32_t min;						// typed, as the values
+	uint32_t max;
+	uint32_t (*get)(void);
+	void (*set)(uint32_t value);		// called once the value is in range
+} _PRM_param;
+
+void PRM_initParam(void);
+void PRM_loadStored(void);
+uint8_t PRM_getCount(void);
+const _PRM_param* PRM_getParam(uint8_t id);
+int16_t PRM_findParam(const char *name);
+uint32_t PRM_getMapHash(void);
+_PRM_status PRM_read(uint8_t id, uint32_t *value);
+_PRM_status PRM_check(uint8_t id, uint32_t value);
+_PRM_status PRM_write(uint8_t id, uint32_t value);
+void PRM_handleRequest(const uint8_t *request, uint16_t length);
+
+#endif
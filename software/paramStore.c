@@ -0,0 +1,473 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <stddef.h>
+#include <string.h>
+
+/* User-generated libs */
+#include "paramStore.h"
+#include "bootFlash.h"
+#include "log.h"
+
+#define PST_NONE				0xFF		// index entry of a key not stored
+#define PST_HEADER_WORDS		(sizeof(_PST_header) / sizeof(uint32_t))
+#define PST_RECORD_WORDS		(sizeof(_PST_record) / sizeof(uint32_t))
+
+// Flash work done by PST_process(), one step per call
+typedef enum
+{
+	PST_IDLE,
+	PST_ERASE,				// erase the next page of the ring
+	PST_COPY,				// copy the latest record of each key to it
+	PST_HEADER,				// and make it the active page
+	PST_CLEAR				// erase every page
+} _pstState;
+
+/* Global variables */
+typedef struct
+{
+	// Slot of the latest record of each key in the active page
+	uint8_t index[PST_MAX_KEYS];
+	int8_t page;						// active page, -1 when none
+	uint32_t sequence;					// of the active page
+	uint8_t nextSlot;					// first erased slot of the active page
+
+	// Written, not yet programmed
+	uint32_t pending[PST_MAX_KEYS];
+	bool dirty[PST_MAX_KEYS];
+
+	uint8_t state;						// _pstState
+	int8_t target;						// page being erased or filled
+	uint8_t copyKey;					// next key to copy to the target
+	uint8_t targetSlot;
+	uint8_t targetIndex[PST_MAX_KEYS];
+	bool failed;
+} _paramStore;
+
+_paramStore paramStore;
+
+/* Private function declarations */
+uint32_t PST_pageAddress(int8_t page);
+uint32_t PST_slotAddress(int8_t page, uint8_t slot);
+bool PST_readHeader(int8_t page, uint32_t *sequence);
+bool PST_readRecord(int8_t page, uint8_t slot, _PST_record *record);
+bool PST_programRecord(int8_t page, uint8_t slot, uint8_t key, uint32_t value);
+void PST_stepCompaction(void);
+void PST_fail(uint32_t address);
+
+/***************************************************************
+ * Function:	void PST_initStore(void)
+ *
+ * Purpose:		To find the active page, the valid header with the
+ * 					highest sequence, and index the latest record of
+ * 					each key in it.  The only pass over the flash.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	paramStore
+ **************************************************************/
+void
+PST_initStore(void)
+{
+	_PST_record record;
+	uint32_t sequence;
+	int8_t page;
+	uint8_t slot;
+
+	BFL_initFlash();
+
+	memset(paramStore.index, PST_NONE, sizeof(paramStore.index));
+	memset(paramStore.dirty, false, sizeof(paramStore.dirty));
+	paramStore.page = -1;
+	paramStore.sequence = 0;
+	paramStore.nextSlot = 0;
+	paramStore.state = PST_IDLE;
+	paramStore.failed = false;
+
+	for(page = 0; page < PST_PAGES; page++)
+	{
+		if(PST_readHeader(page, &sequence)
+				&& ((paramStore.page < 0) || ((int32_t)(sequence - paramStore.sequence) > 0)))
+		{
+			paramStore.page = page;
+			paramStore.sequence = sequence;
+		}
+	}
+
+	if(paramStore.page < 0)
+	{
+		return;
+	}
+
+	// Records are appended, so the first erased slot ends the page
+	for(slot = 0; slot < PST_SLOTS; slot++)
+	{
+		if(BFL_readWord(PST_slotAddress(paramStore.page, slot)) == 0xFFFFFFFF)
+		{
+			break;
+		}
+
+		if(PST_readRecord(paramStore.page, slot, &record))
+		{
+			paramStore.index[record.key] = slot;
+		}
+	}
+
+	paramStore.nextSlot = slot;
+
+	return;
+} // END PST_initStore()
+
+/***************************************************************
+ * Function:	void PST_process(bool idle)
+ *
+ * Purpose:		To program one written key, or take one step of a
+ * 					page change, while the motor is idle.  Called
+ * 					from the main loop.
+ *
+ * Parameters:	bool idle		true when a stalled CPU cannot
+ * 								upset the motor
+ *
+ * Returns:		none
+ *
+ * Globals affected:	paramStore, flash
+ **************************************************************/
+void
+PST_process(bool idle)
+{
+	uint8_t key;
+
+	if(!idle || paramStore.failed)
+	{
+		return;
+	}
+
+	if(paramStore.state != PST_IDLE)
+	{
+		PST_stepCompaction();
+		return;
+	}
+
+	for(key = 0; (key < PST_MAX_KEYS) && !paramStore.dirty[key]; key++);
+
+	if(key == PST_MAX_KEYS)
+	{
+		return;
+	}
+
+	// No page yet, or the active one is full: move to the next
+	if((paramStore.page < 0) || (paramStore.nextSlot >= PST_SLOTS))
+	{
+		paramStore.target = (paramStore.page < 0) ? 0 : ((paramStore.page + 1) % PST_PAGES);
+		paramStore.state = PST_ERASE;
+		return;
+	}
+
+	if(!PST_programRecord(paramStore.page, paramStore.nextSlot, key, paramStore.pending[key]))
+	{
+		PST_fail(PST_slotAddress(paramStore.page, paramStore.nextSlot));
+		return;
+	}
+
+	paramStore.index[key] = paramStore.nextSlot++;
+	paramStore.dirty[key] = false;
+
+	return;
+} // END PST_process()
+
+/***************************************************************
+ * Function:	bool PST_read(uint8_t key, uint32_t *value)
+ *
+ * Purpose:		To read the value of a key, as last written
+ *
+ * Parameters:	uint8_t key
+ * 				uint32_t *value
+ *
+ * Returns:		false when the key was never written
+ *
+ * Globals affected:	none
+ **************************************************************/
+bool
+PST_read(uint8_t key, uint32_t *value)
+{
+	if(key >= PST_MAX_KEYS)
+	{
+		return false;
+	}
+
+	if(paramStore.dirty[key])
+	{
+		*value = paramStore.pending[key];
+		return true;
+	}
+
+	if(paramStore.index[key] == PST_NONE)
+	{
+		return false;
+	}
+
+	*value = BFL_readWord(PST_slotAddress(paramStore.page, paramStore.index[key])
+			+ offsetof(_PST_record, value));
+
+	return true;
+} // END PST_read()
+
+/***************************************************************
+ * Function:	bool PST_write(uint8_t key, uint32_t value)
+ *
+ * Purpose:		To have a value stored.  A value equal to the
+ * 					stored one costs no flash.
+ *
+ * Parameters:	uint8_t key
+ * 				uint32_t value
+ *
+ * Returns:		false for a key out of range
+ *
+ * Globals affected:	paramStore.pending, paramStore.dirty
+ **************************************************************/
+bool
+PST_write(uint8_t key, uint32_t value)
+{
+	uint32_t stored;
+
+	if(key >= PST_MAX_KEYS)
+	{
+		return false;
+	}
+
+	paramStore.dirty[key] = false;
+	if(!PST_read(key, &stored) || (stored != value))
+	{
+		paramStore.pending[key] = value;
+		paramStore.dirty[key] = true;
+	}
+
+	return true;
+} // END PST_write()
+
+/***************************************************************
+ * Function:	void PST_clear(void)
+ *
+ * Purpose:		To forget every stored value.  The pages are
+ * 					erased by PST_process(); the values in use stay
+ * 					until the next reset.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	paramStore
+ **************************************************************/
+void
+PST_clear(void)
+{
+	memset(paramStore.index, PST_NONE, sizeof(paramStore.index));
+	memset(paramStore.dirty, false, sizeof(paramStore.dirty));
+	paramStore.page = -1;
+	paramStore.nextSlot = 0;
+	paramStore.target = 0;
+	paramStore.state = PST_CLEAR;
+	paramStore.failed = false;
+
+	return;
+} // END PST_clear()
+
+void
+PST_getStats(_PST_stats *stats)
+{
+	uint8_t key;
+
+	stats->page = paramStore.page;
+	stats->sequence = paramStore.sequence;
+	stats->used = (paramStore.page < 0) ? 0 : paramStore.nextSlot;
+	stats->keys = 0;
+	stats->pending = 0;
+	stats->failed = paramStore.failed;
+
+	for(key = 0; key < PST_MAX_KEYS; key++)
+	{
+		stats->keys += (paramStore.index[key] != PST_NONE);
+		stats->pending += paramStore.dirty[key];
+	}
+
+	return;
+}
+
+/***************************************************************
+ * Function:	void PST_stepCompaction(void)
+ *
+ * Purpose:		To take one step of a page change or a clear.
+ * 					Until the new header is programmed, reads still
+ * 					come from the old page.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	paramStore, flash
+ **************************************************************/
+void
+PST_stepCompaction(void)
+{
+	uint32_t header[PST_HEADER_WORDS];
+	uint32_t value;
+
+	switch(paramStore.state)
+	{
+		case PST_ERASE:
+			if(!BFL_erasePage(PST_pageAddress(paramStore.target)))
+			{
+				PST_fail(PST_pageAddress(paramStore.target));
+				break;
+			}
+
+			memset(paramStore.targetIndex, PST_NONE, sizeof(paramStore.targetIndex));
+			paramStore.copyKey = 0;
+			paramStore.targetSlot = 0;
+			paramStore.state = PST_COPY;
+			break;
+
+		case PST_COPY:
+			while((paramStore.copyKey < PST_MAX_KEYS) && (paramStore.index[paramStore.copyKey] == PST_NONE))
+			{
+				paramStore.copyKey++;
+			}
+
+			if(paramStore.copyKey == PST_MAX_KEYS)
+			{
+				paramStore.state = PST_HEADER;
+				break;
+			}
+
+			value = BFL_readWord(PST_slotAddress(paramStore.page, paramStore.index[paramStore.copyKey])
+					+ offsetof(_PST_record, value));
+			if(!PST_programRecord(paramStore.target, paramStore.targetSlot, paramStore.copyKey, value))
+			{
+				PST_fail(PST_slotAddress(paramStore.target, paramStore.targetSlot));
+				break;
+			}
+
+			paramStore.targetIndex[paramStore.copyKey++] = paramStore.targetSlot++;
+			break;
+
+		case PST_HEADER:
+			header[0] = PST_PAGE_MAGIC;
+			header[1] = paramStore.sequence + 1;
+			header[2] = BFL_crc(header, 2);
+			header[3] = 0xFFFFFFFF;
+
+			if(!BFL_programWords(PST_pageAddress(paramStore.target), header, 3))
+			{
+				PST_fail(PST_pageAddress(paramStore.target));
+				break;
+			}
+
+			memcpy(paramStore.index, paramStore.targetIndex, sizeof(paramStore.index));
+			paramStore.page = paramStore.target;
+			paramStore.sequence++;
+			paramStore.nextSlot = paramStore.targetSlot;
+			paramStore.state = PST_IDLE;
+			break;
+
+		case PST_CLEAR:
+			if(!BFL_erasePage(PST_pageAddress(paramStore.target)))
+			{
+				PST_fail(PST_pageAddress(paramStore.target));
+				break;
+			}
+
+			if(++paramStore.target == PST_PAGES)
+			{
+				paramStore.sequence = 0;
+				paramStore.state = PST_IDLE;
+			}
+			break;
+
+		default:
+			paramStore.state = PST_IDLE;
+			break;
+	}
+
+	return;
+} // END PST_stepCompaction()
+
+uint32_t
+PST_pageAddress(int8_t page)
+{
+	return PST_ADDRESS + (page * BOOT_PAGE_SIZE);
+}
+
+uint32_t
+PST_slotAddress(int8_t page, uint8_t slot)
+{
+	return PST_pageAddress(page) + sizeof(_PST_header) + (slot * sizeof(_PST_record));
+}
+
+bool
+PST_readHeader(int8_t page, uint32_t *sequence)
+{
+	uint32_t header[2];
+
+	header[0] = BFL_readWord(PST_pageAddress(page));
+	header[1] = BFL_readWord(PST_pageAddress(page) + 4);
+	*sequence = header[1];
+
+	return (header[0] == PST_PAGE_MAGIC)
+			&& (BFL_readWord(PST_pageAddress(page) + 8) == BFL_crc(header, 2));
+}
+
+bool
+PST_readRecord(int8_t page, uint8_t slot, _PST_record *record)
+{
+	uint32_t address = PST_slotAddress(page, slot);
+
+	record->key = BFL_readWord(address);
+	record->value = BFL_readWord(address + 4);
+	record->crc = BFL_readWord(address + 8);
+
+	return (record->key < PST_MAX_KEYS) && (record->crc == BFL_crc(&record->key, 2));
+}
+
+bool
+PST_programRecord(int8_t page, uint8_t slot, uint8_t key, uint32_t value)
+{
+	_PST_record record;
+
+	record.key = key;
+	record.value = value;
+	record.crc = BFL_crc(&record.key, 2);
+
+	return BFL_programWords(PST_slotAddress(page, slot), &record.key, PST_RECORD_WORDS);
+}
+
+/***************************************************************
+ * Function:	void PST_fail(uint32_t address)
+ *
+ * Purpose:		To stop using the flash after a failed erase or
+ * 					program.  Written values stay in RAM, and the
+ * 					last good page stays active.
+ *
+ * Parameters:	uint32_t address		where it failed
+ *
+ * Returns:		none
+ *
+ * Globals affected:	paramStore.failed, paramStore.state
+ **************************************************************/
+void
+PST_fail(uint32_t address)
+{
+	paramStore.failed = true;
+	paramStore.state = PST_IDLE;
+
+	LOG("store: flash error at 0x%08x", address);
+
+	return;
+} // END PST_fail()
@@ -0,0 +1,86 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef PARAMSTORE_H
+#define PARAMSTORE_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* User-generated libs */
+#include "boot.h"
+
+/*
+ * Parameter store: EEPROM emulation in the flash pages after the
+ *	application (see boot.h)
+ *
+ * A page starts with a header (magic, sequence, CRC) and fills with
+ *	records of key u32 | value u32 | CRC u32, appended in order, so a
+ *	later record of a key replaces the earlier ones.  The CRCs come
+ *	from the hardware CRC unit; a record torn by a reset fails its
+ *	CRC and is skipped.  When the active page is full, the latest
+ *	record of each key is copied to the next page of the ring and
+ *	that page's header is written last, with the sequence one up:
+ *	the pages are erased in turn, and a copy cut short by a reset
+ *	leaves the old page active.
+ *
+ * PST_initStore() reads the active page once and keeps, for each key,
+ *	the slot of its latest record, so a read is a table look-up.
+ *	PST_write() only reaches RAM, and repeated writes of a key
+ *	coalesce.  PST_process() programs them from the main loop while
+ *	the motor is idle, one flash operation per call: the CPU stalls,
+ *	ISRs included, while the flash is busy (up to 20ms for an erase).
+ */
+#define PST_ADDRESS					BOOT_APP_END
+#define PST_PAGES					2
+#define PST_SLOTS					((BOOT_PAGE_SIZE - sizeof(_PST_header)) / sizeof(_PST_record))
+
+// Keys: parameters are stored under their id (param.h), the rest
+//	after them
+#define PST_KEY_PARAM				0
+#define PST_PARAM_KEYS				32
+#define PST_KEY_RC_SHORTEST			32		// protocol << 16 | TIM3 counts, see rcPwm.c
+#define PST_KEY_RC_LONGEST			33
+#define PST_MAX_KEYS				34
+
+#define PST_PAGE_MAGIC				0x50535431		// "PST1"
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t sequence;					// one up on each page change
+	uint32_t crc;						// of magic and sequence
+	uint32_t reserved;
+} _PST_header;
+
+typedef struct
+{
+	uint32_t key;
+	uint32_t value;
+	uint32_t crc;						// of key and value
+} _PST_record;
+
+typedef struct
+{
+	int8_t page;						// active page, -1 when none
+	uint32_t sequence;					// page changes since the store was cleared
+	uint16_t used;						// slots of the active page
+	uint8_t keys;						// keys stored
+	uint8_t pending;					// keys written and not yet programmed
+	bool failed;						// a flash operation failed; writes stay in RAM
+} _PST_stats;
+
+void PST_initStore(void);
+void PST_process(bool idle);
+bool PST_read(uint8_t key, uint32_t *value);
+bool PST_write(uint8_t key, uint32_t value);
+void PST_clear(void);
+void PST_getStats(_PST_stats *stats);
+
+#endif
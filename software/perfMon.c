@@ -0,0 +1,494 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <stdio.h>
+#include "stm32f10x_tim.h"
+
+/* User-generated libs */
+#include "perfMon.h"
+
+// The Cortex-M3 DWT cycle counter is not described by the CMSIS
+//	version used in this project, so its registers are defined here
+#define PERF_DWT_CTRL		(*(volatile uint32_t *)0xE0001000)
+#define PERF_DWT_CYCCNT		(*(volatile uint32_t *)0xE0001004)
+#define PERF_DEMCR_TRCENA	((uint32_t)1 << 24)
+
+// Statistics accumulated by the ISRs.  There are two banks so that
+//	the main loop can evaluate one while the ISRs fill the other.
+typedef struct
+{
+	uint32_t histogram[PERF_HIST_BINS];
+	uint32_t samples;
+	uint16_t jitterMax;
+	uint32_t isrCyclesSum;
+	uint32_t isrCyclesMax;
+	uint32_t isrCount;
+} _perfBank;
+
+typedef struct
+{
+	_perfBank bank[2];
+	volatile uint8_t activeBank;
+
+	// Cycles spent in any ISR, used to discount ISR time from idle time
+	volatile uint32_t isrCycles;
+	volatile uint8_t isrDepth;
+	uint32_t isrEnterCycles;
+	uint32_t controlStartCycles;
+
+	// Main loop idle accounting (main context only)
+	uint32_t loopStartCycles;
+	uint32_t loopStartIsrCycles;
+	bool loopBusy;
+	uint32_t idleCycles;
+
+	uint16_t windowMs;
+	uint32_t windowStartTimeAbs;
+	uint32_t windowStartCycles;
+	bool reporting;
+
+	_PERF_report report;
+} _perf;
+
+_perf perf;
+
+/* Private function declarations */
+uint16_t PERF_histogramPercentile(const _perfBank *bank, uint32_t permille);
+
+/***************************************************************
+ * Function:	void PERF_initPerfMon(void)
+ *
+ * Purpose:		To start the cycle counter and reset all of the
+ * 					jitter and CPU load statistics
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	perf, DWT cycle counter
+ **************************************************************/
+void
+PERF_initPerfMon(void)
+{
+	// Enable the trace block and start the cycle counter
+	CoreDebug->DEMCR |= PERF_DEMCR_TRCENA;
+	PERF_DWT_CYCCNT = 0;
+	PERF_DWT_CTRL |= (uint32_t)0b1;
+
+	for(uint8_t i = 0; i < PERF_HIST_BINS; i++)
+	{
+		perf.bank[0].histogram[i] = 0;
+		perf.bank[1].histogram[i] = 0;
+	}
+
+	perf.activeBank = 0;
+	perf.isrCycles = 0;
+	perf.isrDepth = 0;
+	perf.idleCycles = 0;
+	perf.windowMs = PERF_DEFAULT_WINDOW_MS;
+	perf.windowStartTimeAbs = 0;
+	perf.windowStartCycles = PERF_DWT_CYCCNT;
+	perf.reporting = false;
+
+	return;
+} // END PERF_initPerfMon()
+
+/***************************************************************
+ * Function:	void PERF_setWindow(uint16_t windowMs)
+ *
+ * Purpose:		To change the length of the measurement window
+ *
+ * Parameters:	uint16_t windowMs	Window length in milliseconds,
+ * 									limited to 10 to PERF_MAX_WINDOW_MS
+ *
+ * Returns:		none
+ *
+ * Globals affected:	perf.windowMs
+ **************************************************************/
+void
+PERF_setWindow(uint16_t windowMs)
+{
+	if(windowMs < 10)
+		windowMs = 10;
+	else if(windowMs > PERF_MAX_WINDOW_MS)
+		windowMs = PERF_MAX_WINDOW_MS;
+
+	perf.windowMs = windowMs;
+
+	return;
+} // END PERF_setWindow()
+
+uint16_t
+PERF_getWindow(void)
+{
+	return perf.windowMs;
+}
+
+/***************************************************************
+ * Function:	void PERF_enableReporting(bool enable)
+ *
+ * Purpose:		To turn the once-per-window report over the USB
+ * 					virtual COM port on or off
+ *
+ * Parameters:	bool enable
+ *
+ * Returns:		none
+ *
+ * Globals affected:	perf.reporting
+ **************************************************************/
+void
+PERF_enableReporting(bool enable)
+{
+	perf.reporting = enable;
+	return;
+} // END PERF_enableReporting()
+
+/***************************************************************
+ * Function:	uint32_t PERF_getCycles(void)
+ *
+ * Purpose:		To read the free-running CPU cycle counter
+ *
+ * Parameters:	none
+ *
+ * Returns:		the current cycle count
+ *
+ * Globals affected:	none
+ **************************************************************/
+uint32_t
+PERF_getCycles(void)
+{
+	return PERF_DWT_CYCCNT;
+} // END PERF_getCycles()
+
+/***************************************************************
+ * Function:	void PERF_isrEnter(void) / void PERF_isrExit(void)
+ *
+ * Purpose:		To account for the time spent in interrupts so
+ * 					that it is not counted as main loop idle time.
+ * 					Only the outermost ISR is timed; nested ISRs
+ * 					always exit before the ISR they interrupted,
+ * 					so the depth counter needs no locking.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	perf.isrDepth, perf.isrCycles
+ **************************************************************/
+void
+PERF_isrEnter(void)
+{
+	if(perf.isrDepth++ == 0)
+	{
+		perf.isrEnterCycles = PERF_DWT_CYCCNT;
+	}
+
+	return;
+} // END PERF_isrEnter()
+
+void
+PERF_isrExit(void)
+{
+	if(--perf.isrDepth == 0)
+	{
+		perf.isrCycles += PERF_DWT_CYCCNT - perf.isrEnterCycles;
+	}
+
+	return;
+} // END PERF_isrExit()
+
+/***************************************************************
+ * Function:	void PERF_controlTrigger(void)
+ *
+ * Purpose:		To measure how late the PWM-synchronous ISR started
+ * 					relative to the ideal schedule.  The ideal start
+ * 					is the TIM1 CC4 compare event, so the deviation
+ * 					is simply how far TIM1 has counted past CCR4.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	perf.bank[perf.activeBank]
+ **************************************************************/
+void
+PERF_controlTrigger(void)
+{
+	uint16_t count = TIM1->CNT;
+	uint16_t compare = TIM1->CCR4;
+
+	PERF_isrEnter();
+
+	// TIM1 counts up to ARR and wraps, so a late ISR may see a
+	//	counter value that is lower than the compare value
+	uint16_t deviation;
+	if(count >= compare)
+		deviation = count - compare;
+	else
+		deviation = (uint16_t)(count + TIM1->ARR + 1 - compare);
+
+	_perfBank *bank = &perf.bank[perf.activeBank];
+
+	uint16_t bin = deviation / PERF_HIST_BIN_TICKS;
+	if(bin >= PERF_HIST_BINS)
+		bin = PERF_HIST_BINS - 1;
+
+	bank->histogram[bin]++;
+	bank->samples++;
+
+	if(deviation > bank->jitterMax)
+		bank->jitterMax = deviation;
+
+	return;
+} // END PERF_controlTrigger()
+
+/***************************************************************
+ * Function:	void PERF_controlIsrStart(void) / PERF_controlIsrEnd(void)
+ *
+ * Purpose:		To measure the execution time of the control ISR
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	perf.bank[perf.activeBank]
+ **************************************************************/
+void
+PERF_controlIsrStart(void)
+{
+	PERF_isrEnter();
+	perf.controlStartCycles = PERF_DWT_CYCCNT;
+
+	return;
+} // END PERF_controlIsrStart()
+
+void
+PERF_controlIsrEnd(void)
+{
+	uint32_t cycles = PERF_DWT_CYCCNT - perf.controlStartCycles;
+	_perfBank *bank = &perf.bank[perf.activeBank];
+
+	bank->isrCyclesSum += cycles;
+	bank->isrCount++;
+
+	if(cycles > bank->isrCyclesMax)
+		bank->isrCyclesMax = cycles;
+
+	PERF_isrExit();
+
+	return;
+} // END PERF_controlIsrEnd()
+
+/***************************************************************
+ * Function:	void PERF_loopStart(void), PERF_loopBusy(void),
+ * 				PERF_loopEnd(void)
+ *
+ * Purpose:		To measure main loop idle time.  A pass through the
+ * 					main loop that did not call PERF_loopBusy() is
+ * 					idle, less any time spent in ISRs during that pass.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	perf.idleCycles
+ **************************************************************/
+void
+PERF_loopStart(void)
+{
+	perf.loopStartCycles = PERF_DWT_CYCCNT;
+	perf.loopStartIsrCycles = perf.isrCycles;
+	perf.loopBusy = false;
+
+	return;
+} // END PERF_loopStart()
+
+void
+PERF_loopBusy(void)
+{
+	perf.loopBusy = true;
+	return;
+} // END PERF_loopBusy()
+
+void
+PERF_loopEnd(void)
+{
+	if(!perf.loopBusy)
+	{
+		uint32_t elapsed = PERF_DWT_CYCCNT - perf.loopStartCycles;
+		uint32_t inIsr = perf.isrCycles - perf.loopStartIsrCycles;
+
+		if(elapsed > inIsr)
+			perf.idleCycles += elapsed - inIsr;
+	}
+
+	return;
+} // END PERF_loopEnd()
+
+/***************************************************************
+ * Function:	void PERF_process(uint32_t now)
+ *
+ * Purpose:		To close the measurement window when it expires,
+ * 					evaluate the statistics and optionally report
+ * 					them over the USB virtual COM port.  Called from
+ * 					the millisecond section of the main loop.
+ *
+ * Parameters:	uint32_t now	current millisecond time stamp
+ *
+ * Returns:		none
+ *
+ * Globals affected:	perf
+ **************************************************************/
+void
+PERF_process(uint32_t now)
+{
+	if((now - perf.windowStartTimeAbs) < perf.windowMs)
+		return;
+
+	// Swap banks so that the ISRs continue into a clean bank while
+	//	the one from the window that just ended is evaluated
+	uint8_t doneBank = perf.activeBank;
+	perf.activeBank = doneBank ^ 1;
+	_perfBank *bank = &perf.bank[doneBank];
+
+	uint32_t cycles = PERF_DWT_CYCCNT;
+	uint32_t windowCycles = cycles - perf.windowStartCycles;
+	uint32_t idleCycles = perf.idleCycles;
+
+	perf.idleCycles = 0;
+	perf.windowStartCycles = cycles;
+	perf.windowStartTimeAbs = now;
+
+	_PERF_report *report = &perf.report;
+
+	report->samples = bank->samples;
+	report->jitterMax = bank->jitterMax;
+	report->jitterP50 = PERF_histogramPercentile(bank, 500);
+	report->jitterP99 = PERF_histogramPercentile(bank, 990);
+	report->controlIsrMaxCycles = bank->isrCyclesMax;
+	report->controlIsrAvgCycles = (bank->isrCount > 0) ? bank->isrCyclesSum / bank->isrCount : 0;
+
+	// Scale down first so that the 32-bit products cannot overflow
+	uint32_t windowScaled = windowCycles / 1000;
+	if(windowScaled == 0)
+		windowScaled = 1;
+
+	uint32_t idle = idleCycles / windowScaled;
+	if(idle > 1000)
+		idle = 1000;
+
+	report->idlePermille = (uint16_t)idle;
+	report->loadPermille = (uint16_t)(1000 - idle);
+	report->windowCount++;
+
+	// Clear the bank so that it is ready for the next swap
+	for(uint8_t i = 0; i < PERF_HIST_BINS; i++)
+	{
+		bank->histogram[i] = 0;
+	}
+	bank->samples = 0;
+	bank->jitterMax = 0;
+	bank->isrCyclesSum = 0;
+	bank->isrCyclesMax = 0;
+	bank->isrCount = 0;
+
+	if(perf.reporting)
+	{
+		PERF_printReport();
+	}
+
+	return;
+} // END PERF_process()
+
+/***************************************************************
+ * Function:	void PERF_printReport(void)
+ *
+ * Purpose:		To print the last completed window to stdout (USB)
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+PERF_printReport(void)
+{
+	const _PERF_report *report = &perf.report;
+
+	printf("PERF n=%u jit50=%u jit99=%u jitMax=%u isrAvg=%u isrMax=%u load=%u.%u%%\r\n",
+			(unsigned int)report->samples,
+			report->jitterP50, report->jitterP99, report->jitterMax,
+			(unsigned int)report->controlIsrAvgCycles,
+			(unsigned int)report->controlIsrMaxCycles,
+			report->loadPermille / 10, report->loadPermille % 10);
+
+	return;
+} // END PERF_printReport()
+
+/***************************************************************
+ * Function:	const _PERF_report* PERF_getReport(void)
+ *
+ * Purpose:		To retrieve the results of the last completed window
+ *
+ * Parameters:	none
+ *
+ * Returns:		pointer to the report
+ *
+ * Globals affected:	none
+ **************************************************************/
+const _PERF_report*
+PERF_getReport(void)
+{
+	return &perf.report;
+} // END PERF_getReport()
+
+/***************************************************************
+ * Function:	uint16_t PERF_histogramPercentile(const _perfBank *bank,
+ * 												uint32_t permille)
+ *
+ * Purpose:		To find the jitter value below which the requested
+ * 					fraction of the samples fall.  The upper edge of
+ * 					the bin is returned, so the result is conservative
+ * 					by at most one bin width.
+ *
+ * Parameters:	const _perfBank *bank
+ * 				uint32_t permille	0-1000
+ *
+ * Returns:		jitter in TIM1 ticks
+ *
+ * Globals affected:	none
+ **************************************************************/
+uint16_t
+PERF_histogramPercentile(const _perfBank *bank, uint32_t permille)
+{
+	if(bank->samples == 0)
+		return 0;
+
+	// Number of samples that must be at or below the result, rounded up
+	uint32_t target = (bank->samples / 1000) * permille
+					+ ((bank->samples % 1000) * permille + 999) / 1000;
+	uint32_t count = 0;
+
+	for(uint8_t i = 0; i < PERF_HIST_BINS; i++)
+	{
+		count += bank->histogram[i];
+		if(count >= target)
+		{
+			// The last bin also holds everything beyond it
+			if(i == PERF_HIST_BINS - 1)
+				return bank->jitterMax;
+
+			uint16_t edge = (uint16_t)((i + 1) * PERF_HIST_BIN_TICKS - 1);
+			return (edge < bank->jitterMax) ? edge : bank->jitterMax;
+		}
+	}
+
+	return bank->jitterMax;
+} // END PERF_histogramPercentile()
@@ -0,0 +1,65 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef PERFMON_H
+#define PERFMON_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PERF_DEFAULT_WINDOW_MS		1000
+#define PERF_MAX_WINDOW_MS			10000	// keeps the cycle counter from wrapping within a window
+
+// The jitter histogram has PERF_HIST_BINS bins, each PERF_HIST_BIN_TICKS
+//	TIM1 ticks wide (8 ticks = 111ns at 72MHz).  Anything beyond the
+//	last bin is counted in the last bin; the exact maximum is kept separately.
+#define PERF_HIST_BINS				64
+#define PERF_HIST_BIN_TICKS			8
+
+// Results of the last completed measurement window
+typedef struct
+{
+	uint16_t jitterP50;				// control ISR start deviation, TIM1 ticks
+	uint16_t jitterP99;
+	uint16_t jitterMax;
+	uint32_t controlIsrMaxCycles;	// longest control ISR, CPU cycles
+	uint32_t controlIsrAvgCycles;
+	uint16_t idlePermille;			// idle fraction, 0-1000
+	uint16_t loadPermille;			// CPU load, 0-1000
+	uint32_t samples;				// control periods in the window
+	uint32_t windowCount;			// incremented once per completed window
+} _PERF_report;
+
+void PERF_initPerfMon(void);
+void PERF_setWindow(uint16_t windowMs);
+uint16_t PERF_getWindow(void);
+void PERF_enableReporting(bool enable);
+void PERF_process(uint32_t now);
+const _PERF_report* PERF_getReport(void);
+void PERF_printReport(void);
+uint32_t PERF_getCycles(void);
+
+// Called first in the PWM-synchronous trigger ISR (TIM1 CC4); it also
+//	counts as PERF_isrEnter(), so that ISR ends with PERF_isrExit()
+void PERF_controlTrigger(void);
+
+// Bracket the control ISR (ADC end of conversion)
+void PERF_controlIsrStart(void);
+void PERF_controlIsrEnd(void);
+
+// Bracket every other ISR so its time is not counted as idle
+void PERF_isrEnter(void);
+void PERF_isrExit(void);
+
+// Bracket each pass through the main loop
+void PERF_loopStart(void);
+void PERF_loopBusy(void);
+void PERF_loopEnd(void);
+
+#endif
@@ -0,0 +1,155 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef PINMAP_H
+#define PINMAP_H
+
+/* User-generated libs */
+#include "gpio.h"
+
+/*
+ * Pin, ADC channel and timer map of each board revision, generated
+ *	from the netlists by tools/pinMap.py: edit its SIGNALS or
+ *	REVISIONS and run it again rather than editing this file.
+ */
+#ifndef BOARD_REVISION
+#define BOARD_REVISION				0
+#endif
+
+#if BOARD_REVISION == 0
+// hardware/lowVoltageDrive/lowVoltageDrive.net (CRC 0x3FB80F19)
+//	rework: I2C_SCL on PB6, the STM32F103C6 has no I2C2 on PB10
+//	rework: I2C_SDA on PB7, the STM32F103C6 has no I2C2 on PB11
+//	rework: CAN_RX on PB8, no transceiver on this revision
+//	rework: CAN_TX on PB9, no transceiver on this revision
+
+#define PIN_PHA_FBK_PORT				GPIO_PORT_A	// analog
+#define PIN_PHA_FBK_PIN					0
+#define PIN_PHA_FBK_GPIO				GPIOA
+#define PIN_PHA_FBK_ADC_CH				0
+
+#define PIN_PHB_FBK_PORT				GPIO_PORT_A	// analog
+#define PIN_PHB_FBK_PIN					1
+#define PIN_PHB_FBK_GPIO				GPIOA
+#define PIN_PHB_FBK_ADC_CH				1
+
+#define PIN_PHC_FBK_PORT				GPIO_PORT_A	// analog
+#define PIN_PHC_FBK_PIN					2
+#define PIN_PHC_FBK_GPIO				GPIOA
+#define PIN_PHC_FBK_ADC_CH				2
+
+#define PIN_VBUS_FBK_PORT				GPIO_PORT_A	// analog
+#define PIN_VBUS_FBK_PIN				3
+#define PIN_VBUS_FBK_GPIO				GPIOA
+#define PIN_VBUS_FBK_ADC_CH				3
+
+#define PIN_I_FBK_PORT					GPIO_PORT_A	// analog
+#define PIN_I_FBK_PIN					7
+#define PIN_I_FBK_GPIO					GPIOA
+#define PIN_I_FBK_ADC_CH				7
+
+#define PIN_CONTROL_IN_PORT				GPIO_PORT_A	// analog
+#define PIN_CONTROL_IN_PIN				4
+#define PIN_CONTROL_IN_GPIO				GPIOA
+#define PIN_CONTROL_IN_ADC_CH			4
+
+#define PIN_TACH_PORT					GPIO_PORT_A	// output
+#define PIN_TACH_PIN					5
+#define PIN_TACH_GPIO					GPIOA
+
+#define PIN_HALL_0_PORT					GPIO_PORT_B	// floating
+#define PIN_HALL_0_PIN					1
+#define PIN_HALL_0_GPIO					GPIOB
+
+#define PIN_HALL_1_PORT					GPIO_PORT_B	// floating
+#define PIN_HALL_1_PIN					2
+#define PIN_HALL_1_GPIO					GPIOB
+
+#define PIN_HALL_2_PORT					GPIO_PORT_B	// floating
+#define PIN_HALL_2_PIN					0
+#define PIN_HALL_2_GPIO					GPIOB
+
+#define PIN_RC_IN_PORT					GPIO_PORT_A	// set up by its module
+#define PIN_RC_IN_PIN					6
+#define PIN_RC_IN_GPIO					GPIOA
+#define PIN_RC_IN_TIM					3			// TIM3_CH1
+#define PIN_RC_IN_TIM_CH				1
+
+#define PIN_AH_PORT						GPIO_PORT_A	// altOutput
+#define PIN_AH_PIN						8
+#define PIN_AH_GPIO						GPIOA
+#define PIN_AH_TIM						1			// TIM1_CH1
+#define PIN_AH_TIM_CH					1
+
+#define PIN_BH_PORT						GPIO_PORT_A	// altOutput
+#define PIN_BH_PIN						9
+#define PIN_BH_GPIO						GPIOA
+#define PIN_BH_TIM						1			// TIM1_CH2
+#define PIN_BH_TIM_CH					2
+
+#define PIN_CH_PORT						GPIO_PORT_A	// altOutput
+#define PIN_CH_PIN						10
+#define PIN_CH_GPIO						GPIOA
+#define PIN_CH_TIM						1			// TIM1_CH3
+#define PIN_CH_TIM_CH					3
+
+#define PIN_AL_PORT						GPIO_PORT_B	// altOutput
+#define PIN_AL_PIN						13
+#define PIN_AL_GPIO						GPIOB
+#define PIN_AL_TIM						1			// TIM1_CH1N
+#define PIN_AL_TIM_CH					1
+
+#define PIN_BL_PORT						GPIO_PORT_B	// altOutput
+#define PIN_BL_PIN						14
+#define PIN_BL_GPIO						GPIOB
+#define PIN_BL_TIM						1			// TIM1_CH2N
+#define PIN_BL_TIM_CH					2
+
+#define PIN_CL_PORT						GPIO_PORT_B	// altOutput
+#define PIN_CL_PIN						15
+#define PIN_CL_GPIO						GPIOB
+#define PIN_CL_TIM						1			// TIM1_CH3N
+#define PIN_CL_TIM_CH					3
+
+#define PIN_I2C_SCL_PORT				GPIO_PORT_B	// set up by its module
+#define PIN_I2C_SCL_PIN					6
+#define PIN_I2C_SCL_GPIO				GPIOB
+
+#define PIN_I2C_SDA_PORT				GPIO_PORT_B	// set up by its module
+#define PIN_I2C_SDA_PIN					7
+#define PIN_I2C_SDA_GPIO				GPIOB
+
+#define PIN_CAN_RX_PORT					GPIO_PORT_B	// set up by its module
+#define PIN_CAN_RX_PIN					8
+#define PIN_CAN_RX_GPIO					GPIOB
+
+#define PIN_CAN_TX_PORT					GPIO_PORT_B	// set up by its module
+#define PIN_CAN_TX_PIN					9
+#define PIN_CAN_TX_GPIO					GPIOB
+
+#define PIN_HALL_PORT					GPIO_PORT_B	// group of 3, read together
+#define PIN_HALL_GPIO					GPIOB
+#define PIN_HALL_SHIFT					0
+#define PIN_HALL_MASK					0x0007
+
+// GPIO_initPins(): CRx = (CRx & ~MASK) | value, then BSRR
+#define PIN_INIT_A_CRL					0x00300000
+#define PIN_INIT_A_CRL_MASK				0xF0FFFFFF
+#define PIN_INIT_A_CRH					0x00000BBB
+#define PIN_INIT_A_CRH_MASK				0x00000FFF
+#define PIN_INIT_A_BSRR					0x00200000
+#define PIN_INIT_B_CRL					0x00000444
+#define PIN_INIT_B_CRL_MASK				0x00000FFF
+#define PIN_INIT_B_CRH					0xBBB00000
+#define PIN_INIT_B_CRH_MASK				0xFFF00000
+#define PIN_INIT_B_BSRR					0x00000000
+#else
+#error "pinMap.h: unknown BOARD_REVISION"
+#endif
+
+#endif
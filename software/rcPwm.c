@@ -6,49 +6,185 @@
  *	even the implied warranty of MERCHANTABILITY
  *	or FITNESS FOR A PARTICULAR PURPOSE.
 *************************************************/
+#include <stddef.h>
 #include "stm32f10x_tim.h"
 #include "misc.h"
 #include "rcPwm.h"
+#include "dshot.h"
 #include "milliSecTimer.h"
 #include "gpio.h"
+#include "log.h"
+#include "motor.h"
+#include "paramStore.h"
+#include "perfMon.h"
+#include "pinMap.h"
 
-typedef struct rcpwm
+#define RCPWM_US(us)		((us) * RCPWM_TICKS_PER_US)
+
+typedef struct
 {
-	uint16_t longestPulseTime;			// Corresponds to 100% speed demand
+	const char *name;
 	uint16_t shortestPulseTime;			// Corresponds to 0% speed demand
-	uint32_t lastPulseReceivedTimeAbs;	// Indicates the time stamp of the last pulse
+	uint16_t longestPulseTime;			// Corresponds to 100% speed demand
+	uint16_t minPulseTime;				// Pulses outside these are not this protocol
+	uint16_t maxPulseTime;
+	uint16_t minPeriod;					// Fastest frame rate of the protocol
+	uint16_t timeoutMs;					// Failsafe: no valid pulse for this long
+} _rcpwmProtocol;
+
+// Indexed by _RCPWM_protocol.  The standard endpoints are the
+//	measured 1ms/2ms of the original transmitter.
+const _rcpwmProtocol rcpwmProtocols[RCPWM_PROTOCOL_COUNT] =
+{
+	{"none",		0,				0,				0,				0,				0,				0},
+	{"pwm",			23975,			47939,			RCPWM_US(900),	RCPWM_US(2100),	RCPWM_US(2000),	50},
+	{"oneshot125",	RCPWM_US(125),	RCPWM_US(250),	RCPWM_US(110),	RCPWM_US(265),	RCPWM_US(250),	10},
+	{"oneshot42",	RCPWM_US(42),	RCPWM_US(84),	RCPWM_US(38),	RCPWM_US(90),	RCPWM_US(80),	5},
+	{"multishot",	RCPWM_US(5),	RCPWM_US(25),	RCPWM_US(4),	RCPWM_US(27),	RCPWM_US(30),	5},
+	{"dshot150",	0,				0,				0,				0,				0,				10},
+	{"dshot300",	0,				0,				0,				0,				0,				10},
+	{"dshot600",	0,				0,				0,				0,				0,				10},
+};
+
+// The last protocol the capture ISR classifies by pulse width
+#define RCPWM_LAST_PULSE_PROTOCOL	RCPWM_MULTISHOT
+
+typedef struct rcpwm
+{
+	uint8_t input;						// _RCPWM_input
+	volatile uint8_t protocol;			// _RCPWM_protocol, RCPWM_NONE until locked
+	uint8_t candidate;					// protocol being detected, TIM3 ISR only
+	uint8_t candidateCount;
+	volatile bool directDrive;			// pass each pulse straight to the motor
+
+	uint16_t lastRisingEdge;			// TIM3 counts
+	uint32_t lastRisingEdgeMs;
+	volatile uint32_t lastPulseReceivedTimeAbs;	// Indicates the time stamp of the last pulse
+
+	volatile uint16_t demand;			// This is the Q16 speed demand
+
+	// Set when a protocol locks, so a pulse costs no division
+	uint16_t shortestPulseTime;
+	uint16_t range;						// longest - shortest pulse time
+	uint32_t scale;						// (65535 << 16) / range
+
+	uint16_t width[RCPWM_MEDIAN_LENGTH];	// last pulses of the locked protocol
+	uint8_t widthIndex;
 
-	uint16_t demand;					// This is the Q16 speed demand
+	volatile bool calibrating;
+	volatile uint16_t calibrationShortest;
+	volatile uint16_t calibrationLongest;
+
+	// Learned endpoints, from the parameter store
+	volatile uint8_t storedProtocol;	// RCPWM_NONE when there are none
+	uint16_t storedShortest;
+	uint16_t storedLongest;
 } _rcpwm;
 
 _rcpwm rcPwm;
 
+/* Private function declarations */
+void RCPWM_startPulseCapture(void);
+void RCPWM_lockProtocol(uint8_t protocol, uint16_t pulseWidth);
+void RCPWM_loadEndpoints(void);
+uint16_t RCPWM_median(const uint16_t *width);
+
 /***************************************************************
  * Function:	void RCPWM_initRcPwm(void)
  *
- * Purpose:		To initialize the RC PWM input so that it will
- * 					measure positive pulse widths, compare them
- * 					to past pulse widths received, and outputs
- * 					a fixed-point representation of a percent
+ * Purpose:		To initialize the RC input as a pulse-width input
  *
  * Parameters:	none
  *
  * Returns:		none
  *
- * Globals affected:	TIM3->...
- * 						rcPwm.longestPulseTime = 31500,
- * 						rcPwm.shortestPulseTime = 22500
+ * Globals affected:	TIM3, rcPwm
  **************************************************************/
 void
 RCPWM_initRcPwm(void)
 {
-	// Setup RC PWM input pin
-	// RC PWM input pin is not remapped
-	GPIO_pinSetup(GPIO_PORT_A, 6, GPIO_FLOATING_INPUT);
-
 	/* TIM3 clock enable @36MHz */
 	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, ENABLE);
 
+	RCPWM_loadEndpoints();
+	RCPWM_setInput(RCPWM_INPUT_PULSE);
+
+	return;
+} // END initRcPwm()
+
+/***************************************************************
+ * Function:	void RCPWM_setInput(_RCPWM_input input)
+ *
+ * Purpose:		To decode the RC input pin as pulse widths or as
+ * 					DShot.  TIM3 is reset and the protocol is
+ * 					detected again.
+ *
+ * Parameters:	_RCPWM_input input
+ *
+ * Returns:		none
+ *
+ * Globals affected:	TIM3, rcPwm
+ **************************************************************/
+void
+RCPWM_setInput(_RCPWM_input input)
+{
+	if(input >= RCPWM_INPUT_COUNT)
+	{
+		return;
+	}
+
+	NVIC_DisableIRQ(TIM3_IRQn);
+	DSHOT_stopDshot();
+	RCC_APB1PeriphResetCmd(RCC_APB1Periph_TIM3, ENABLE);
+	RCC_APB1PeriphResetCmd(RCC_APB1Periph_TIM3, DISABLE);
+
+	// Detect the protocol from the first pulses or frames
+	rcPwm.input = input;
+	rcPwm.protocol = RCPWM_NONE;
+	rcPwm.candidate = RCPWM_NONE;
+	rcPwm.candidateCount = 0;
+	rcPwm.demand = 0;
+	rcPwm.calibrating = false;
+
+	if(input == RCPWM_INPUT_PULSE)
+	{
+		RCPWM_startPulseCapture();
+	}
+	else
+	{
+		DSHOT_initDshot(input == RCPWM_INPUT_DSHOT_BIDIR);
+		NVIC_EnableIRQ(TIM3_IRQn);
+	}
+
+	return;
+} // END RCPWM_setInput()
+
+_RCPWM_input
+RCPWM_getInput(void)
+{
+	return rcPwm.input;
+}
+
+/***************************************************************
+ * Function:	void RCPWM_startPulseCapture(void)
+ *
+ * Purpose:		To set up TIM3 so that it will measure positive
+ * 					pulse widths, detect the protocol from them,
+ * 					and output a fixed-point representation of a
+ * 					percent
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	TIM3->...
+ **************************************************************/
+void
+RCPWM_startPulseCapture(void)
+{
+	// Setup RC PWM input pin, which DShot may have left an output
+	GPIO_pinSetup(PIN_RC_IN_PORT, PIN_RC_IN_PIN, GPIO_FLOATING_INPUT);
+
 	// Enables interrupt in NVIC
 	NVIC_EnableIRQ(TIM3_IRQn);
 
@@ -77,11 +213,12 @@ RCPWM_initRcPwm(void)
 	// Reset the flag
 	TIM3->SR = 0;
 
-	// Prescaler loaded so that input clock is
-	//	divided by two, thus, the clock is at
-	//	18MHz, meaning that any pulse can be
-	//	measured up to a maximum pulse width
-	//	of 3.64ms with a resolution of +/-27ns
+	// Prescaler loaded so that the 72MHz timer
+	//	clock is divided by three, thus, the clock
+	//	is at 24MHz (RCPWM_TICKS_PER_US), meaning
+	//	that any pulse can be measured up to a
+	//	maximum pulse width of 2.73ms with a
+	//	resolution of +/-42ns
 	TIM3->PSC = 2;
 
 	// Initialize interrupts on TIM3
@@ -93,85 +230,465 @@ RCPWM_initRcPwm(void)
 	// Enable the counter
 	TIM3->CR1 |= 0x0001;
 
-	// Initialize rcPwm.longestPulseTime and rcPwm.shortestPulseTime
-	//	to reasonable starting values (maybe 1.25ms and 1.75ms?)
-	rcPwm.longestPulseTime = 47939;
-	rcPwm.shortestPulseTime = 23975;
-
 	return;
-} // END initRcPwm()
+} // END RCPWM_startPulseCapture()
 
 /***************************************************************
- * Function:	uint32_t RCPWM_getSpeedDemand(void)
+ * Function:	bool RCPWM_getSpeedDemand(uint16_t *speedDemand)
  *
  * Purpose:		To get the speed demand in a fixed-point fractional
- * 					format
+ * 					format.  Once no valid pulse has arrived for
+ * 					the protocol's failsafe timeout the demand is 0
+ * 					and the protocol is detected again.
  *
- * Parameters:	none
+ * Parameters:	uint16_t *speedDemand	rcPwm.demand
  *
- * Returns:		rcPwm.demand
+ * Returns:		true while a protocol is locked and its pulses
+ * 					keep arriving
  *
- * Globals affected:	none
+ * Globals affected:	rcPwm.demand, rcPwm.protocol
  **************************************************************/
-uint16_t
-RCPWM_getSpeedDemand(void)
+bool
+RCPWM_getSpeedDemand(uint16_t *speedDemand)
 {
-	// TODO: Check to ensure that pulses are being received
-	//	and, if not, return 0
-	if(MSTMR_getMilliSeconds() > (rcPwm.lastPulseReceivedTimeAbs + 20))
+	uint8_t protocol = rcPwm.protocol;
+
+	*speedDemand = 0;
+
+	if(protocol == RCPWM_NONE)
 	{
+		return false;
+	}
+
+	if((MSTMR_getMilliSeconds() - rcPwm.lastPulseReceivedTimeAbs) > rcpwmProtocols[protocol].timeoutMs)
+	{
+		rcPwm.protocol = RCPWM_NONE;
 		rcPwm.demand = 0;
+		LOG("rc: %s signal lost", rcpwmProtocols[protocol].name);
+		return false;
 	}
 
-	return rcPwm.demand;
+	*speedDemand = rcPwm.demand;
+
+	return true;
 } // END RCPWM_getSpeedDemand()
 
+_RCPWM_protocol
+RCPWM_getProtocol(void)
+{
+	return rcPwm.protocol;
+}
+
+const char*
+RCPWM_getProtocolName(_RCPWM_protocol protocol)
+{
+	return (protocol < RCPWM_PROTOCOL_COUNT) ? rcpwmProtocols[protocol].name : "?";
+}
+
+/***************************************************************
+ * Function:	void RCPWM_setDirectDrive(bool enable)
+ *
+ * Purpose:		To pass every decoded pulse straight on to the
+ * 					running motor from the capture ISR, rather than
+ * 					at the next main-loop tick.  The main loop
+ * 					enables this while the RC input is the demand
+ * 					source.
+ *
+ * Parameters:	bool enable
+ *
+ * Returns:		none
+ *
+ * Globals affected:	rcPwm.directDrive
+ **************************************************************/
+void
+RCPWM_setDirectDrive(bool enable)
+{
+	rcPwm.directDrive = enable;
+	return;
+} // END RCPWM_setDirectDrive()
+
+/***************************************************************
+ * Function:	void RCPWM_receiveDemand(_RCPWM_protocol protocol,
+ * 						uint16_t demand)
+ *
+ * Purpose:		To take the demand from a DShot frame.  The frame
+ * 					has passed its CRC, so the protocol locks at
+ * 					once.  Runs in the TIM3 ISR.
+ *
+ * Parameters:	_RCPWM_protocol protocol
+ * 				uint16_t demand		Q16
+ *
+ * Returns:		none
+ *
+ * Globals affected:	rcPwm
+ **************************************************************/
+void
+RCPWM_receiveDemand(_RCPWM_protocol protocol, uint16_t demand)
+{
+	if(rcPwm.protocol != protocol)
+	{
+		rcPwm.protocol = protocol;
+		LOG("rc: %s detected", rcpwmProtocols[protocol].name);
+	}
+
+	rcPwm.demand = demand;
+	rcPwm.lastPulseReceivedTimeAbs = MSTMR_getMilliSeconds();
+
+	if(rcPwm.directDrive)
+	{
+		MOT_updateDutyCycle(demand);
+	}
+
+	return;
+} // END RCPWM_receiveDemand()
+
 /***************************************************************
  * Function:	void TIM3_IRQHandler(void)
  *
  * Purpose:		To get the absolute time for the rising edge and
- * 					for the falling edge and - using the saved
- * 					history - calculates a fixed-point representation
- * 					of the percentage.
+ * 					for the falling edge, classify the pulse by
+ * 					its width and the frame rate, and - once a
+ * 					protocol is locked - calculate a fixed-point
+ * 					representation of the percentage.
  *
  * Parameters:	none
  *
  * Returns:		none
  *
- * Globals affected:	rcPwm.demand
+ * Globals affected:	rcPwm
  **************************************************************/
 void
 TIM3_IRQHandler(void)
 {
+	PERF_isrEnter();
+
+	// DShot interrupts once per frame, on CC3
+	if(rcPwm.input != RCPWM_INPUT_PULSE)
+	{
+		DSHOT_frameInterrupt();
+		TIM3->SR = 0;
+		PERF_isrExit();
+		return;
+	}
+
 	// Find the current pulse time.
-	//	pulseWidth = risingEdgeTime - fallingEdgeTime
-	uint16_t pulseWidth = TIM3->CCR2 - TIM3->CCR1;
+	//	pulseWidth = fallingEdgeTime - risingEdgeTime
+	uint16_t risingEdge = TIM3->CCR1;
+	uint16_t pulseWidth = TIM3->CCR2 - risingEdge;
+	uint32_t now = MSTMR_getMilliSeconds();
 
-	// Separate the min pulse width from the signal pulse width
-	uint32_t signalPulseWidth;
-	if(pulseWidth > rcPwm.shortestPulseTime)
-		signalPulseWidth = pulseWidth - rcPwm.shortestPulseTime;
-	else
-		signalPulseWidth = 0;
+	// The counter wraps every 2.73ms, so the period is only known
+	//	for frames under 2ms; slower frames suit every protocol
+	uint16_t period = risingEdge - rcPwm.lastRisingEdge;
+	bool periodKnown = (now - rcPwm.lastRisingEdgeMs) <= 1;
+	rcPwm.lastRisingEdge = risingEdge;
+	rcPwm.lastRisingEdgeMs = now;
+
+	uint8_t candidate;
+	for(candidate = RCPWM_LAST_PULSE_PROTOCOL; candidate > RCPWM_NONE; candidate--)
+	{
+		const _rcpwmProtocol *protocol = &rcpwmProtocols[candidate];
+
+		if((pulseWidth >= protocol->minPulseTime) && (pulseWidth <= protocol->maxPulseTime)
+				&& (!periodKnown || (period >= protocol->minPeriod)))
+		{
+			break;
+		}
+	}
 
-	// Determine the range of the pulse widths
-	uint32_t range = rcPwm.longestPulseTime - rcPwm.shortestPulseTime;
+	// Lock onto a protocol after RCPWM_DETECT_PULSES in a row
+	if(rcPwm.protocol == RCPWM_NONE)
+	{
+		if((candidate != RCPWM_NONE) && (candidate == rcPwm.candidate))
+		{
+			if(++rcPwm.candidateCount >= RCPWM_DETECT_PULSES)
+			{
+				rcPwm.candidateCount = 0;
+				RCPWM_lockProtocol(candidate, pulseWidth);
+				LOG("rc: %s detected", rcpwmProtocols[candidate].name);
+			}
+		}
+		else
+		{
+			rcPwm.candidate = candidate;
+			rcPwm.candidateCount = 1;
+		}
+	}
 
-	// Calculate the signal pulse width as a
-	//	percentage of the total range of the pulse
-	uint32_t result = (signalPulseWidth << 16)/range;
-	if(result > 65535)
-		result = 65535;
+	// Pulses outside the protocol's width range or too soon after
+	//	the last one never get here, the median removes the rest
+	if((candidate != RCPWM_NONE) && (candidate == rcPwm.protocol))
+	{
+		rcPwm.width[rcPwm.widthIndex] = pulseWidth;
+		if(++rcPwm.widthIndex >= RCPWM_MEDIAN_LENGTH)
+			rcPwm.widthIndex = 0;
 
-	// Save the result as a 16-bit number
-	rcPwm.demand = (uint16_t)result;
+		pulseWidth = RCPWM_median(rcPwm.width);
 
-	// Save the time that this pulse was received
-	rcPwm.lastPulseReceivedTimeAbs = MSTMR_getMilliSeconds();
+		if(rcPwm.calibrating)
+		{
+			if(pulseWidth < rcPwm.calibrationShortest)
+				rcPwm.calibrationShortest = pulseWidth;
+			if(pulseWidth > rcPwm.calibrationLongest)
+				rcPwm.calibrationLongest = pulseWidth;
+
+			rcPwm.demand = 0;
+		}
+		else
+		{
+			// Separate the min pulse width from the signal pulse width
+			uint32_t signalPulseWidth;
+			if(pulseWidth > rcPwm.shortestPulseTime)
+				signalPulseWidth = pulseWidth - rcPwm.shortestPulseTime;
+			else
+				signalPulseWidth = 0;
+
+			if(signalPulseWidth > rcPwm.range)
+				signalPulseWidth = rcPwm.range;
+
+			// Scale to a 16-bit percentage of the range
+			rcPwm.demand = (uint16_t)((signalPulseWidth * rcPwm.scale) >> 16);
+		}
+
+		// Save the time that this pulse was received
+		rcPwm.lastPulseReceivedTimeAbs = now;
+
+		// Fast protocols update far more often than the main loop
+		if(rcPwm.directDrive && !rcPwm.calibrating)
+		{
+			MOT_updateDutyCycle(rcPwm.demand);
+		}
+	}
 
 	// Reset the flag
 	TIM3->SR = 0;
 
+	PERF_isrExit();
+
 	return;
 } // end TIM3_IRQHandler()
 
+/***************************************************************
+ * Function:	void RCPWM_lockProtocol(uint8_t protocol, uint16_t pulseWidth)
+ *
+ * Purpose:		To start using a detected pulse protocol, with the
+ * 					endpoints learned for it if there are any
+ *
+ * Parameters:	uint8_t protocol		_RCPWM_protocol
+ * 				uint16_t pulseWidth		fills the median history
+ *
+ * Returns:		none
+ *
+ * Globals affected:	rcPwm
+ **************************************************************/
+void
+RCPWM_lockProtocol(uint8_t protocol, uint16_t pulseWidth)
+{
+	uint16_t shortest = rcpwmProtocols[protocol].shortestPulseTime;
+	uint16_t longest = rcpwmProtocols[protocol].longestPulseTime;
+	uint8_t i;
+
+	if(rcPwm.storedProtocol == protocol)
+	{
+		shortest = rcPwm.storedShortest;
+		longest = rcPwm.storedLongest;
+	}
+
+	rcPwm.shortestPulseTime = shortest;
+	rcPwm.range = longest - shortest;
+	rcPwm.scale = (65535ul << 16) / rcPwm.range;
+
+	for(i = 0; i < RCPWM_MEDIAN_LENGTH; i++)
+	{
+		rcPwm.width[i] = pulseWidth;
+	}
+
+	rcPwm.protocol = protocol;
+
+	return;
+} // END RCPWM_lockProtocol()
+
+uint16_t
+RCPWM_median(const uint16_t *width)
+{
+	uint16_t low = (width[0] < width[1]) ? width[0] : width[1];
+	uint16_t high = (width[0] < width[1]) ? width[1] : width[0];
+
+	if(width[2] < low)
+		return low;
+	if(width[2] > high)
+		return high;
+	return width[2];
+}
+
+/***************************************************************
+ * Function:	void RCPWM_loadEndpoints(void)
+ *
+ * Purpose:		To read the learned endpoints from the parameter
+ * 					store.  Both keys carry the protocol, so a pair
+ * 					cut short by a reset is not used.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	rcPwm.storedProtocol, rcPwm.storedShortest,
+ * 						rcPwm.storedLongest
+ **************************************************************/
+void
+RCPWM_loadEndpoints(void)
+{
+	uint32_t shortest;
+	uint32_t longest;
+	uint8_t protocol;
+
+	rcPwm.storedProtocol = RCPWM_NONE;
+
+	if(!PST_read(PST_KEY_RC_SHORTEST, &shortest) || !PST_read(PST_KEY_RC_LONGEST, &longest))
+	{
+		return;
+	}
+
+	protocol = (uint8_t)(shortest >> 16);
+	if((protocol != (uint8_t)(longest >> 16)) || (protocol == RCPWM_NONE)
+			|| (protocol > RCPWM_LAST_PULSE_PROTOCOL)
+			|| ((uint16_t)longest <= (uint16_t)shortest))
+	{
+		return;
+	}
+
+	rcPwm.storedShortest = (uint16_t)shortest;
+	rcPwm.storedLongest = (uint16_t)longest;
+	rcPwm.storedProtocol = protocol;
+
+	return;
+} // END RCPWM_loadEndpoints()
+
+/***************************************************************
+ * Function:	bool RCPWM_startCalibration(void)
+ *
+ * Purpose:		To start learning the endpoints of the locked
+ * 					protocol.  The demand is held at 0 while the
+ * 					transmitter is moved to both ends of its travel.
+ *
+ * Parameters:	none
+ *
+ * Returns:		false unless the input is decoding pulse widths
+ *
+ * Globals affected:	rcPwm.calibrating, rcPwm.calibrationShortest,
+ * 						rcPwm.calibrationLongest
+ **************************************************************/
+bool
+RCPWM_startCalibration(void)
+{
+	if(rcPwm.input != RCPWM_INPUT_PULSE)
+	{
+		return false;
+	}
+
+	rcPwm.calibrating = false;
+	__asm volatile("" ::: "memory");
+
+	rcPwm.calibrationShortest = 0xFFFF;
+	rcPwm.calibrationLongest = 0;
+	rcPwm.demand = 0;
+
+	__asm volatile("" ::: "memory");
+	rcPwm.calibrating = true;
+
+	LOG("rc: calibrating endpoints");
+
+	return true;
+} // END RCPWM_startCalibration()
+
+void
+RCPWM_cancelCalibration(void)
+{
+	rcPwm.calibrating = false;
+	return;
+}
+
+bool
+RCPWM_isCalibrating(void)
+{
+	return rcPwm.calibrating;
+}
+
+/***************************************************************
+ * Function:	bool RCPWM_saveCalibration(void)
+ *
+ * Purpose:		To end calibration and use the learned endpoints
+ * 					at once.  They reach the parameter store once
+ * 					the motor is idle.
+ *
+ * Parameters:	none
+ *
+ * Returns:		false if no protocol is locked, or the learned
+ * 					range is under half the protocol's nominal
+ * 					range; calibration continues
+ *
+ * Globals affected:	rcPwm, parameter store
+ **************************************************************/
+bool
+RCPWM_saveCalibration(void)
+{
+	uint8_t protocol = rcPwm.protocol;
+	uint16_t shortest = rcPwm.calibrationShortest;
+	uint16_t longest = rcPwm.calibrationLongest;
+
+	if(!rcPwm.calibrating || (protocol == RCPWM_NONE) || (protocol > RCPWM_LAST_PULSE_PROTOCOL)
+			|| (longest <= shortest)
+			|| ((longest - shortest) < ((rcpwmProtocols[protocol].longestPulseTime
+					- rcpwmProtocols[protocol].shortestPulseTime) / 2)))
+	{
+		return false;
+	}
+
+	PST_write(PST_KEY_RC_SHORTEST, ((uint32_t)protocol << 16) | shortest);
+	PST_write(PST_KEY_RC_LONGEST, ((uint32_t)protocol << 16) | longest);
+
+	// The capture ISR may lock a protocol meanwhile
+	rcPwm.storedProtocol = RCPWM_NONE;
+	__asm volatile("" ::: "memory");
+	rcPwm.storedShortest = shortest;
+	rcPwm.storedLongest = longest;
+	__asm volatile("" ::: "memory");
+	rcPwm.storedProtocol = protocol;
+
+	rcPwm.calibrating = false;
+	RCPWM_lockProtocol(protocol, shortest);
+
+	LOG("rc: endpoints %u-%u saved", shortest, longest);
+
+	return true;
+} // END RCPWM_saveCalibration()
+
+/***************************************************************
+ * Function:	void RCPWM_getEndpoints(uint16_t *shortest, uint16_t *longest)
+ *
+ * Purpose:		To report the endpoints in use, or while
+ * 					calibrating the range learned so far
+ *
+ * Parameters:	uint16_t *shortest		TIM3 counts
+ * 				uint16_t *longest
+ *
+ * Returns:		none
+ *
+ * Globals affected:	none
+ **************************************************************/
+void
+RCPWM_getEndpoints(uint16_t *shortest, uint16_t *longest)
+{
+	if(rcPwm.calibrating)
+	{
+		*shortest = rcPwm.calibrationShortest;
+		*longest = rcPwm.calibrationLongest;
+	}
+	else
+	{
+		*shortest = rcPwm.shortestPulseTime;
+		*longest = rcPwm.shortestPulseTime + rcPwm.range;
+	}
+
+	return;
+} // END RCPWM_getEndpoints()
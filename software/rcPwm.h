@@ -10,9 +10,63 @@
 #ifndef RCPWM_H
 #define RCPWM_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #define MIN_RC_PULSE_WIDTH	18000
 
+// TIM3 counts at 24MHz
+#define RCPWM_TICKS_PER_US		24
+
+// Consecutive pulses of one protocol, at a plausible frame rate,
+//	before the input locks onto that protocol
+#define RCPWM_DETECT_PULSES		8
+
+// Each pulse is replaced by the median of the last three, so a single
+//	glitch never reaches the motor
+#define RCPWM_MEDIAN_LENGTH		3
+
+// Pulse protocols are told apart by pulse width, the ranges do not
+//	overlap; DShot protocols by their bit period
+typedef enum
+{
+	RCPWM_NONE,				// no signal, or still detecting
+	RCPWM_STANDARD,			// 1000-2000us, up to 490Hz
+	RCPWM_ONESHOT125,		// 125-250us, up to 4kHz
+	RCPWM_ONESHOT42,		// 42-84us, up to 12kHz
+	RCPWM_MULTISHOT,		// 5-25us, up to 32kHz
+	RCPWM_DSHOT150,			// digital, see dshot.h
+	RCPWM_DSHOT300,
+	RCPWM_DSHOT600,
+	RCPWM_PROTOCOL_COUNT
+} _RCPWM_protocol;
+
+// What the RC input pin is decoded as, see the rc.input parameter
+typedef enum
+{
+	RCPWM_INPUT_PULSE,		// pulse width, protocol detected
+	RCPWM_INPUT_DSHOT,		// DShot, bit rate detected
+	RCPWM_INPUT_DSHOT_BIDIR,	// inverted DShot with eRPM replies
+	RCPWM_INPUT_COUNT
+} _RCPWM_input;
+
 void RCPWM_initRcPwm(void);
-uint16_t RCPWM_getSpeedDemand(void);
+void RCPWM_setInput(_RCPWM_input input);
+_RCPWM_input RCPWM_getInput(void);
+bool RCPWM_getSpeedDemand(uint16_t *speedDemand);
+_RCPWM_protocol RCPWM_getProtocol(void);
+const char* RCPWM_getProtocolName(_RCPWM_protocol protocol);
+void RCPWM_setDirectDrive(bool enable);
+
+// Endpoint learning: while calibrating the demand is 0 and the
+//	shortest and longest filtered pulses are recorded
+bool RCPWM_startCalibration(void);
+void RCPWM_cancelCalibration(void);
+bool RCPWM_saveCalibration(void);
+bool RCPWM_isCalibrating(void);
+void RCPWM_getEndpoints(uint16_t *shortest, uint16_t *longest);
+
+// Called by the DShot decoder for every valid frame
+void RCPWM_receiveDemand(_RCPWM_protocol protocol, uint16_t demand);
 
 #endif
@@ -0,0 +1,576 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include <string.h>
+#include "stm32f10x.h"
+
+/* User-generated libs */
+#include "scope.h"
+#include "frame.h"
+#include "adc.h"
+#include "motor.h"
+#include "perfMon.h"
+
+#define SCP_MAGIC				0x5C09E000
+
+// 16-bit sample words after the header of a FRM_TYPE_SCOPE frame
+#define SCP_FRAME_WORDS			((FRM_MAX_PAYLOAD - sizeof(_SCP_frameHeader)) / 2)
+
+/* Global variables */
+typedef struct
+{
+	uint32_t magic;
+	_SCP_config config;
+	uint8_t channelCount;
+	uint16_t depth;						// samples that fit in the buffer
+
+	// Written by the control ISR while ARMED or TRIGGERED, by the
+	//	main loop otherwise; status is always written last
+	volatile uint8_t status;
+	volatile bool triggerRequest;
+	uint16_t countdown;
+	uint16_t writeIndex;				// next sample slot
+	uint16_t filled;					// valid samples, up to depth
+	uint16_t remaining;					// post-trigger samples still to take
+	uint16_t lastValue;					// for the level triggers
+	uint8_t lastState;					// for the state trigger
+
+	// The frozen capture, in buffer order from oldest
+	uint16_t oldest;
+	uint16_t count;
+	uint16_t triggerIndex;
+	uint32_t check;
+
+	uint16_t buffer[SCP_BUFFER_WORDS];
+} _scopeCapture;
+
+// .co_stack is a NOLOAD section, so a capture frozen by a fault
+//	survives the warm restart like the fault record does
+_scopeCapture scopeCapture __attribute__((section(".co_stack")));
+
+typedef struct
+{
+	uint32_t maxCycles;					// longest SCP_capture() so far
+	bool dumping;
+	uint16_t dumpIndex;
+} _scope;
+
+_scope scope;
+
+/* Private function declarations */
+uint8_t SCP_countChannels(const _SCP_config *config);
+void SCP_freeze(uint16_t triggerIndex);
+uint32_t SCP_checkWord(void);
+uint16_t SCP_readPhaseA(void);
+uint16_t SCP_readPhaseB(void);
+uint16_t SCP_readPhaseC(void);
+uint16_t SCP_readBusVoltage(void);
+uint16_t SCP_readBusCurrent(void);
+uint16_t SCP_readDuty(void);
+uint16_t SCP_readSector(void);
+uint16_t SCP_readState(void);
+
+// Indexed by _SCP_channel
+uint16_t (*const scpRead[SCP_CH_COUNT])(void) =
+{
+	SCP_readPhaseA,
+	SCP_readPhaseB,
+	SCP_readPhaseC,
+	SCP_readBusVoltage,
+	SCP_readBusCurrent,
+	SCP_readDuty,
+	SCP_readSector,
+	SCP_readState
+};
+
+/***************************************************************
+ * Function:	void SCP_initScope(void)
+ *
+ * Purpose:		To initialize the scope, idle with the default
+ * 					configuration, unless a frozen capture survived
+ * 					a warm restart.  Call after FLT_initFault().
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	scopeCapture, scope
+ **************************************************************/
+void
+SCP_initScope(void)
+{
+	_SCP_config config =
+	{
+		.channels = {SCP_CH_PHASE_A, SCP_CH_PHASE_B, SCP_CH_PHASE_C, SCP_CH_DUTY},
+		.triggerType = SCP_TRIG_STATE,
+		.triggerChannel = SCP_CH_PHASE_A,
+		.triggerLevel = 2048,
+		.preTrigger = 64,
+		.decimation = 1
+	};
+
+	scope.maxCycles = 0;
+	scope.dumping = false;
+
+	if((scopeCapture.magic == SCP_MAGIC) && (scopeCapture.status == SCP_DONE)
+			&& (scopeCapture.check == SCP_checkWord())
+			&& (SCP_countChannels(&scopeCapture.config) == scopeCapture.channelCount)
+			&& (scopeCapture.count <= scopeCapture.depth))
+	{
+		return;
+	}
+
+	scopeCapture.magic = SCP_MAGIC;
+	scopeCapture.status = SCP_IDLE;
+	SCP_configure(&config);
+
+	return;
+} // END SCP_initScope()
+
+/***************************************************************
+ * Function:	bool SCP_configure(const _SCP_config *config)
+ *
+ * Purpose:		To select the channels and the trigger.  Drops a
+ * 					frozen capture, as its layout would change.
+ *
+ * Parameters:	const _SCP_config *config	preTrigger is limited to
+ * 											the buffer depth
+ *
+ * Returns:		false if the scope is armed or the configuration
+ * 					is not valid
+ *
+ * Globals affected:	scopeCapture
+ **************************************************************/
+bool
+SCP_configure(const _SCP_config *config)
+{
+	uint8_t channelCount = SCP_countChannels(config);
+
+	if((scopeCapture.status == SCP_ARMED) || (scopeCapture.status == SCP_TRIGGERED)
+			|| (channelCount == 0) || (config->triggerType >= SCP_TRIG_COUNT)
+			|| (config->triggerChannel >= SCP_CH_COUNT) || (config->decimation == 0))
+	{
+		return false;
+	}
+
+	scope.dumping = false;
+	scopeCapture.status = SCP_IDLE;
+
+	scopeCapture.config = *config;
+	scopeCapture.channelCount = channelCount;
+	scopeCapture.depth = SCP_BUFFER_WORDS / channelCount;
+	scopeCapture.count = 0;
+
+	// Unused channel slots are always SCP_NO_CHANNEL on the wire
+	memset(&scopeCapture.config.channels[channelCount], SCP_NO_CHANNEL, SCP_MAX_CHANNELS - channelCount);
+
+	if(scopeCapture.config.preTrigger >= scopeCapture.depth)
+	{
+		scopeCapture.config.preTrigger = scopeCapture.depth - 1;
+	}
+
+	return true;
+} // END SCP_configure()
+
+const _SCP_config*
+SCP_getConfig(void)
+{
+	return &scopeCapture.config;
+}
+
+/***************************************************************
+ * Function:	bool SCP_arm(void)
+ *
+ * Purpose:		To start a new capture, dropping the frozen one
+ *
+ * Parameters:	none
+ *
+ * Returns:		false if a capture is already running
+ *
+ * Globals affected:	scopeCapture
+ **************************************************************/
+bool
+SCP_arm(void)
+{
+	if((scopeCapture.status == SCP_ARMED) || (scopeCapture.status == SCP_TRIGGERED))
+	{
+		return false;
+	}
+
+	scope.dumping = false;
+
+	scopeCapture.countdown = scopeCapture.config.decimation;
+	scopeCapture.writeIndex = 0;
+	scopeCapture.filled = 0;
+	scopeCapture.count = 0;
+	scopeCapture.triggerRequest = false;
+	scopeCapture.lastValue = scpRead[scopeCapture.config.triggerChannel]();
+	scopeCapture.lastState = MOT_getMotorState();
+
+	// Hand the capture to the control ISR only once it is set up
+	__asm volatile("" ::: "memory");
+	scopeCapture.status = SCP_ARMED;
+
+	return true;
+} // END SCP_arm()
+
+void
+SCP_stop(void)
+{
+	scope.dumping = false;
+	scopeCapture.status = SCP_IDLE;
+	return;
+}
+
+// Fires as soon as the pre-trigger samples are in the buffer
+void
+SCP_trigger(void)
+{
+	scopeCapture.triggerRequest = true;
+	return;
+}
+
+_SCP_status
+SCP_getStatus(void)
+{
+	return scopeCapture.status;
+}
+
+uint16_t
+SCP_getDepth(void)
+{
+	return scopeCapture.depth;
+}
+
+uint16_t
+SCP_getCount(void)
+{
+	return scopeCapture.count;
+}
+
+uint32_t
+SCP_getMaxCycles(void)
+{
+	return scope.maxCycles;
+}
+
+/***************************************************************
+ * Function:	void SCP_capture(void)
+ *
+ * Purpose:		To take one sample and check the trigger.  Runs in
+ * 					the control ISR; the cost is bounded by
+ * 					SCP_MAX_CHANNELS + 1 reads and kept in
+ * 					scope.maxCycles.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	scopeCapture, scope.maxCycles
+ **************************************************************/
+void
+SCP_capture(void)
+{
+	uint8_t status = scopeCapture.status;
+	uint16_t *sample;
+	uint16_t value;
+	uint8_t state;
+	uint32_t start;
+	uint32_t cycles;
+	bool fire = false;
+	uint8_t i;
+
+	if(((status != SCP_ARMED) && (status != SCP_TRIGGERED)) || (--scopeCapture.countdown != 0))
+	{
+		return;
+	}
+
+	start = PERF_getCycles();
+	scopeCapture.countdown = scopeCapture.config.decimation;
+
+	sample = &scopeCapture.buffer[scopeCapture.writeIndex * scopeCapture.channelCount];
+	for(i = 0; i < scopeCapture.channelCount; i++)
+	{
+		sample[i] = scpRead[scopeCapture.config.channels[i]]();
+	}
+
+	if(++scopeCapture.writeIndex >= scopeCapture.depth)
+	{
+		scopeCapture.writeIndex = 0;
+	}
+
+	if(scopeCapture.filled < scopeCapture.depth)
+	{
+		scopeCapture.filled++;
+	}
+
+	if(status == SCP_ARMED)
+	{
+		switch(scopeCapture.config.triggerType)
+		{
+			case SCP_TRIG_RISING:
+				value = scpRead[scopeCapture.config.triggerChannel]();
+				fire = (scopeCapture.lastValue < scopeCapture.config.triggerLevel)
+						&& (value >= scopeCapture.config.triggerLevel);
+				scopeCapture.lastValue = value;
+				break;
+
+			case SCP_TRIG_FALLING:
+				value = scpRead[scopeCapture.config.triggerChannel]();
+				fire = (scopeCapture.lastValue > scopeCapture.config.triggerLevel)
+						&& (value <= scopeCapture.config.triggerLevel);
+				scopeCapture.lastValue = value;
+				break;
+
+			case SCP_TRIG_STATE:
+				state = MOT_getMotorState();
+				fire = (state != scopeCapture.lastState);
+				scopeCapture.lastState = state;
+				break;
+
+			default:
+				break;
+		}
+
+		// The trigger sample is the first post-trigger sample
+		if((fire || scopeCapture.triggerRequest) && (scopeCapture.filled > scopeCapture.config.preTrigger))
+		{
+			scopeCapture.triggerRequest = false;
+			scopeCapture.remaining = scopeCapture.depth - scopeCapture.config.preTrigger;
+			scopeCapture.status = SCP_TRIGGERED;
+			status = SCP_TRIGGERED;
+		}
+	}
+
+	if((status == SCP_TRIGGERED) && (--scopeCapture.remaining == 0))
+	{
+		SCP_freeze(scopeCapture.config.preTrigger);
+	}
+
+	cycles = PERF_getCycles() - start;
+	if(cycles > scope.maxCycles)
+	{
+		scope.maxCycles = cycles;
+	}
+
+	return;
+} // END SCP_capture()
+
+/***************************************************************
+ * Function:	void SCP_faultTrigger(void)
+ *
+ * Purpose:		To freeze a running capture at a fault, with the
+ * 					fault just after the last sample
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	scopeCapture
+ **************************************************************/
+void
+SCP_faultTrigger(void)
+{
+	if((scopeCapture.status == SCP_ARMED) || (scopeCapture.status == SCP_TRIGGERED))
+	{
+		SCP_freeze(scopeCapture.filled);
+	}
+
+	return;
+} // END SCP_faultTrigger()
+
+void
+SCP_freeze(uint16_t triggerIndex)
+{
+	scopeCapture.count = scopeCapture.filled;
+	scopeCapture.oldest = (scopeCapture.filled < scopeCapture.depth) ? 0 : scopeCapture.writeIndex;
+	scopeCapture.triggerIndex = triggerIndex;
+	scopeCapture.check = SCP_checkWord();
+	scopeCapture.status = SCP_DONE;
+	return;
+}
+
+uint32_t
+SCP_checkWord(void)
+{
+	return ~(((uint32_t)scopeCapture.count << 16) ^ scopeCapture.oldest
+			^ ((uint32_t)scopeCapture.triggerIndex << 8) ^ scopeCapture.depth);
+}
+
+uint8_t
+SCP_countChannels(const _SCP_config *config)
+{
+	uint8_t count;
+
+	for(count = 0; count < SCP_MAX_CHANNELS; count++)
+	{
+		if(config->channels[count] >= SCP_CH_COUNT)
+		{
+			break;
+		}
+	}
+
+	return count;
+}
+
+/***************************************************************
+ * Function:	bool SCP_startDump(void)
+ *
+ * Purpose:		To send the frozen capture with SCP_process(),
+ * 					oldest sample first.  The capture stays frozen
+ * 					and can be dumped again.
+ *
+ * Parameters:	none
+ *
+ * Returns:		false if there is no frozen capture
+ *
+ * Globals affected:	scope
+ **************************************************************/
+bool
+SCP_startDump(void)
+{
+	if((scopeCapture.status != SCP_DONE) || (scopeCapture.count == 0))
+	{
+		return false;
+	}
+
+	scope.dumpIndex = 0;
+	scope.dumping = true;
+
+	return true;
+} // END SCP_startDump()
+
+/***************************************************************
+ * Function:	bool SCP_process(void)
+ *
+ * Purpose:		To send the next FRM_TYPE_SCOPE frames of a dump,
+ * 					as many as the USB buffer takes.  Call on every
+ * 					pass through the main loop, so that a dump
+ * 					keeps up with the USB link.
+ *
+ * Parameters:	none
+ *
+ * Returns:		true if a frame was sent
+ *
+ * Globals affected:	scope
+ **************************************************************/
+bool
+SCP_process(void)
+{
+	uint16_t payload[FRM_MAX_PAYLOAD / 2];
+	_SCP_frameHeader header;
+	uint8_t channelCount;
+	uint16_t perFrame;
+	uint16_t samples;
+	uint16_t index;
+	uint16_t s;
+	uint8_t i;
+	bool sent = false;
+
+	if(!scope.dumping)
+	{
+		return false;
+	}
+
+	channelCount = scopeCapture.channelCount;
+	perFrame = SCP_FRAME_WORDS / channelCount;
+
+	while(scope.dumping)
+	{
+		samples = scopeCapture.count - scope.dumpIndex;
+		if(samples > perFrame)
+		{
+			samples = perFrame;
+		}
+
+		header.index = scope.dumpIndex;
+		header.count = scopeCapture.count;
+		header.trigger = scopeCapture.triggerIndex;
+		header.decimation = scopeCapture.config.decimation;
+		memcpy(header.channels, scopeCapture.config.channels, SCP_MAX_CHANNELS);
+		memcpy(payload, &header, sizeof(header));
+
+		index = scopeCapture.oldest + scope.dumpIndex;
+		for(s = 0; s < samples; s++, index++)
+		{
+			if(index >= scopeCapture.depth)
+			{
+				index -= scopeCapture.depth;
+			}
+
+			for(i = 0; i < channelCount; i++)
+			{
+				payload[(sizeof(header) / 2) + (s * channelCount) + i] = scopeCapture.buffer[(index * channelCount) + i];
+			}
+		}
+
+		if(!FRM_sendFrame(FRM_TYPE_SCOPE, payload, sizeof(header) + (samples * channelCount * 2)))
+		{
+			break;
+		}
+
+		sent = true;
+		scope.dumpIndex += samples;
+		if(scope.dumpIndex >= scopeCapture.count)
+		{
+			scope.dumping = false;
+		}
+	}
+
+	return sent;
+} // END SCP_process()
+
+/* Channel readers, indexed through scpRead */
+uint16_t
+SCP_readPhaseA(void)
+{
+	return ADC_getVoltage(ADC_PH_A);
+}
+
+uint16_t
+SCP_readPhaseB(void)
+{
+	return ADC_getVoltage(ADC_PH_B);
+}
+
+uint16_t
+SCP_readPhaseC(void)
+{
+	return ADC_getVoltage(ADC_PH_C);
+}
+
+uint16_t
+SCP_readBusVoltage(void)
+{
+	return ADC_getVoltage(ADC_V_BUS);
+}
+
+uint16_t
+SCP_readBusCurrent(void)
+{
+	return ADC_getVoltage(ADC_I_BUS);
+}
+
+uint16_t
+SCP_readDuty(void)
+{
+	return MOT_getDutyCycle();
+}
+
+uint16_t
+SCP_readSector(void)
+{
+	return (uint16_t)(int16_t)MOT_getSector();
+}
+
+uint16_t
+SCP_readState(void)
+{
+	return MOT_getMotorState();
+}
@@ -0,0 +1,99 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef SCOPE_H
+#define SCOPE_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+// Sample memory shared by the selected channels: 2KB of the 10KB of
+//	SRAM (about 4KB is used by the rest of the firmware, see
+//	tools/ramUsage.py).  With 4 channels that is 256 PWM periods,
+//	16ms at 16kHz; fewer channels or decimation capture longer.
+#define SCP_BUFFER_WORDS		1024
+#define SCP_MAX_CHANNELS		4
+#define SCP_NO_CHANNEL			0xFF
+
+// Signals that can be captured, one 16-bit word each per sample
+typedef enum
+{
+	SCP_CH_PHASE_A,				// raw ADC counts
+	SCP_CH_PHASE_B,
+	SCP_CH_PHASE_C,
+	SCP_CH_BUS_VOLTAGE,
+	SCP_CH_BUS_CURRENT,
+	SCP_CH_DUTY,				// 0%-100% scaled to 0-65535
+	SCP_CH_SECTOR,				// int8_t, sign-extended
+	SCP_CH_STATE,
+	SCP_CH_COUNT
+} _SCP_channel;
+
+// SCP_trigger() fires with every type.  A hard fault or programmer's
+//	trap always freezes an armed capture, whatever the trigger, and
+//	the capture survives the warm restart.
+typedef enum
+{
+	SCP_TRIG_MANUAL,			// SCP_trigger() only
+	SCP_TRIG_RISING,			// triggerChannel crosses triggerLevel upwards
+	SCP_TRIG_FALLING,
+	SCP_TRIG_STATE,				// any motor state transition
+	SCP_TRIG_FAULT,				// faults only
+	SCP_TRIG_COUNT
+} _SCP_triggerType;
+
+typedef enum
+{
+	SCP_IDLE,
+	SCP_ARMED,					// filling, waiting for the trigger
+	SCP_TRIGGERED,				// filling the post-trigger samples
+	SCP_DONE					// frozen until re-armed
+} _SCP_status;
+
+typedef struct
+{
+	uint8_t channels[SCP_MAX_CHANNELS];	// _SCP_channel, SCP_NO_CHANNEL ends the list
+	uint8_t triggerType;				// _SCP_triggerType
+	uint8_t triggerChannel;				// _SCP_channel, for level triggers
+	uint16_t triggerLevel;
+	uint16_t preTrigger;				// samples kept before the trigger
+	uint16_t decimation;				// 1 = every PWM period
+} _SCP_config;
+
+// Payload of a FRM_TYPE_SCOPE frame, little-endian, followed by whole
+//	samples of channelCount words each, oldest first
+typedef struct __attribute__((packed))
+{
+	uint16_t index;				// of the first sample in this frame
+	uint16_t count;				// samples in the capture
+	uint16_t trigger;			// index of the trigger sample, count if frozen by a fault
+	uint16_t decimation;
+	uint8_t channels[SCP_MAX_CHANNELS];
+} _SCP_frameHeader;
+
+void SCP_initScope(void);
+bool SCP_configure(const _SCP_config *config);
+const _SCP_config* SCP_getConfig(void);
+bool SCP_arm(void);
+void SCP_stop(void);
+void SCP_trigger(void);
+_SCP_status SCP_getStatus(void);
+uint16_t SCP_getDepth(void);
+uint16_t SCP_getCount(void);
+uint32_t SCP_getMaxCycles(void);
+bool SCP_startDump(void);
+bool SCP_process(void);
+
+// Called from the control ISR once per control period
+void SCP_capture(void);
+
+// Called by the fault handler, interrupts may be in any state
+void SCP_faultTrigger(void);
+
+#endif
@@ -10,9 +10,10 @@
 #include "stm32f10x.h"
 #include "stm32f10x_conf.h"
 #include "buffer.h"
+#include "hw_config.h"
 
 EXTERN_BUFFER(USB_RX, 256);
-EXTERN_BUFFER(USB_TX, 256);
+EXTERN_BUFFER(USB_TX, 512);
 
 #undef errno
 extern int errno;
@@ -106,6 +107,7 @@ int _write(int file, char *ptr, int len)
 {
     //VCP_send_buffer((uint8_t*)ptr, len);
 	USB_TX_Put((uint8_t*)ptr, len);
+	Handle_USBAsynchXfer();
 	return len;
 }
 
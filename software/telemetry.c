@@ -0,0 +1,199 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include "stm32f10x.h"
+
+/* User-generated libs */
+#include "telemetry.h"
+#include "frame.h"
+#include "adc.h"
+#include "motor.h"
+#include "perfMon.h"
+
+#define TLM_QUEUE_MASK		(TLM_QUEUE_LENGTH - 1)
+
+/* Global variables */
+typedef struct
+{
+	volatile bool enabled;
+	volatile uint16_t decimation;
+	uint16_t countdown;					// control ISR only
+	uint16_t sequence;					// control ISR only
+	volatile uint32_t dropped;
+
+	// Samples are written by the control ISR at queueHead and read by
+	//	the main loop at queueTail; each index has a single writer
+	_TLM_sample queue[TLM_QUEUE_LENGTH];
+	volatile uint8_t queueHead;
+	volatile uint8_t queueTail;
+} _telemetry;
+
+_telemetry telemetry;
+
+/***************************************************************
+ * Function:	void TLM_initTelemetry(void)
+ *
+ * Purpose:		To initialize the telemetry stream, disabled
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	telemetry
+ **************************************************************/
+void
+TLM_initTelemetry(void)
+{
+	FRM_initFrame();
+
+	telemetry.enabled = false;
+	telemetry.decimation = TLM_DEFAULT_DECIMATION;
+	telemetry.countdown = TLM_DEFAULT_DECIMATION;
+
+	return;
+} // END TLM_initTelemetry()
+
+void
+TLM_enable(bool enable)
+{
+	telemetry.enabled = enable;
+	return;
+}
+
+bool
+TLM_isEnabled(void)
+{
+	return telemetry.enabled;
+}
+
+/***************************************************************
+ * Function:	void TLM_setDecimation(uint16_t decimation)
+ *
+ * Purpose:		To capture one sample every decimation control
+ * 					periods
+ *
+ * Parameters:	uint16_t decimation		1 or more
+ *
+ * Returns:		none
+ *
+ * Globals affected:	telemetry.decimation
+ **************************************************************/
+void
+TLM_setDecimation(uint16_t decimation)
+{
+	if(decimation == 0)
+	{
+		decimation = 1;
+	}
+
+	telemetry.decimation = decimation;
+
+	return;
+} // END TLM_setDecimation()
+
+uint16_t
+TLM_getDecimation(void)
+{
+	return telemetry.decimation;
+}
+
+uint32_t
+TLM_getDropped(void)
+{
+	return telemetry.dropped;
+}
+
+/***************************************************************
+ * Function:	void TLM_capture(void)
+ *
+ * Purpose:		To queue a sample every telemetry.decimation control
+ * 					periods.  Runs in the control ISR, so it only
+ * 					copies values; framing is done by TLM_process().
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	telemetry
+ **************************************************************/
+void
+TLM_capture(void)
+{
+	if(!telemetry.enabled || (--telemetry.countdown != 0))
+	{
+		return;
+	}
+
+	telemetry.countdown = telemetry.decimation;
+	telemetry.sequence++;
+
+	uint8_t head = telemetry.queueHead;
+
+	if((uint8_t)(head - telemetry.queueTail) >= TLM_QUEUE_LENGTH)
+	{
+		telemetry.dropped++;
+		return;
+	}
+
+	_TLM_sample *sample = &telemetry.queue[head & TLM_QUEUE_MASK];
+
+	sample->timestamp = PERF_getCycles();
+	sample->sequence = telemetry.sequence;
+	sample->phaseA = ADC_getVoltage(ADC_PH_A);
+	sample->phaseB = ADC_getVoltage(ADC_PH_B);
+	sample->phaseC = ADC_getVoltage(ADC_PH_C);
+	sample->busVoltage = ADC_getVoltage(ADC_V_BUS);
+	sample->busCurrent = ADC_getVoltage(ADC_I_BUS);
+	sample->dutyCycle = MOT_getDutyCycle();
+	sample->sector = MOT_getSector();
+	sample->state = MOT_getMotorState();
+
+	// Publish the sample only after it is complete
+	__asm volatile("" ::: "memory");
+	telemetry.queueHead = head + 1;
+
+	return;
+} // END TLM_capture()
+
+/***************************************************************
+ * Function:	bool TLM_process(void)
+ *
+ * Purpose:		To frame queued samples onto the USB link.  Call
+ * 					on every pass through the main loop, as the
+ * 					ISR queues several samples per millisecond at
+ * 					low decimation.  A sample that does not fit in
+ * 					the USB buffer stays queued; the ISR drops new
+ * 					ones while the queue is full.
+ *
+ * Parameters:	none
+ *
+ * Returns:		true if a sample was framed
+ *
+ * Globals affected:	telemetry.queueTail
+ **************************************************************/
+bool
+TLM_process(void)
+{
+	uint8_t tail = telemetry.queueTail;
+	bool sent = false;
+
+	while(tail != telemetry.queueHead)
+	{
+		if(!FRM_sendFrame(FRM_TYPE_TELEMETRY, &telemetry.queue[tail & TLM_QUEUE_MASK], sizeof(_TLM_sample)))
+		{
+			break;
+		}
+
+		tail++;
+		telemetry.queueTail = tail;
+		sent = true;
+	}
+
+	return sent;
+} // END TLM_process()
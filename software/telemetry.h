@@ -0,0 +1,50 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+// One sample every TLM_DEFAULT_DECIMATION control periods
+//	(16kHz PWM / 16 = 1kHz)
+#define TLM_DEFAULT_DECIMATION		16
+
+// Samples waiting between the control ISR and the main loop,
+//	must be a power of two
+#define TLM_QUEUE_LENGTH			16
+
+// Payload of a FRM_TYPE_TELEMETRY frame, little-endian
+typedef struct __attribute__((packed))
+{
+	uint32_t timestamp;				// CPU cycles (72MHz), wraps
+	uint16_t sequence;				// increments per captured sample, gaps are drops
+	uint16_t phaseA;				// raw ADC counts
+	uint16_t phaseB;
+	uint16_t phaseC;
+	uint16_t busVoltage;
+	uint16_t busCurrent;
+	uint16_t dutyCycle;				// 0%-100% scaled to 0-65535
+	int8_t sector;
+	uint8_t state;
+} _TLM_sample;
+
+void TLM_initTelemetry(void);
+void TLM_enable(bool enable);
+bool TLM_isEnabled(void);
+void TLM_setDecimation(uint16_t decimation);
+uint16_t TLM_getDecimation(void);
+uint32_t TLM_getDropped(void);
+bool TLM_process(void);
+
+// Called from the control ISR once per control period
+void TLM_capture(void);
+
+#endif
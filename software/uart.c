@@ -0,0 +1,363 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/* Standard or provided libs */
+#include "stm32f10x.h"
+#include "stm32f10x_gpio.h"
+#include "stm32f10x_rcc.h"
+#include "buffer.h"
+#include "usb_lib.h"
+#include "usb_pwr.h"
+
+/* User-generated libs */
+#include "uart.h"
+#include "gpio.h"
+#include "perfMon.h"
+#include "pinMap.h"
+
+// USART1 SR, CR1 and CR3 bits
+#define UART_SR_IDLE			(1 << 4)
+#define UART_CR1_RE				(1 << 2)
+#define UART_CR1_TE				(1 << 3)
+#define UART_CR1_IDLEIE			(1 << 4)
+#define UART_CR1_UE				(1 << 13)
+#define UART_CR3_DMAR			(1 << 6)
+#define UART_CR3_DMAT			(1 << 7)
+
+// DMA1 channel CCR bits; USART1 TX is channel 4, RX channel 5
+#define UART_DMA_EN				(1 << 0)
+#define UART_DMA_TCIE			(1 << 1)
+#define UART_DMA_HTIE			(1 << 2)
+#define UART_DMA_FROM_MEMORY	(1 << 4)
+#define UART_DMA_CIRC			(1 << 5)
+#define UART_DMA_MINC			(1 << 7)
+
+EXTERN_BUFFER(USB_RX, 256);
+EXTERN_BUFFER(USB_TX, 512);
+
+/* Global variables */
+typedef struct
+{
+	uint8_t rxRing[UART_RX_RING];
+	uint16_t rxRead;					// next ring byte to copy to USB_RX
+
+	// Written by the transfer complete ISR and with it masked
+	volatile uint16_t txLength;			// USB_TX bytes in flight, 0 when idle
+
+	volatile bool active;				// the UART owns USB_RX/USB_TX
+	uint32_t dropped;					// received bytes USB_RX had no room for
+} _uart;
+
+_uart uart;
+
+/* Private function declarations */
+void UART_sendSpan(void);
+void UART_receive(void);
+
+/***************************************************************
+ * Function:	void UART_initUart(void)
+ *
+ * Purpose:		To start USART1 on PB6/PB7 at UART_BAUD, 8N1, with
+ * 					DMA in both directions and the idle line
+ * 					interrupt.  The interrupts sit below the
+ * 					control ISR.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	USART1, DMA1 channels 4 and 5, AFIO->MAPR, uart
+ **************************************************************/
+void
+UART_initUart(void)
+{
+	uart.rxRead = 0;
+	uart.txLength = 0;
+	uart.dropped = 0;
+	uart.active = (bDeviceState != CONFIGURED);
+
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO | RCC_APB2Periph_USART1, ENABLE);
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+	// PA9/PA10 belong to the bridge, so USART1 is remapped
+	GPIO_PinRemapConfig(GPIO_Remap_USART1, ENABLE);
+	GPIO_pinSetup(PIN_I2C_SCL_PORT, PIN_I2C_SCL_PIN, GPIO_OUTPUT_ALT_PP);	// TX
+	GPIO_pinSetup(PIN_I2C_SDA_PORT, PIN_I2C_SDA_PIN, GPIO_INPUT_PU_OR_PD);	// RX
+	GPIO_setPins(PIN_I2C_SDA_GPIO, 1 << PIN_I2C_SDA_PIN);	// pull-up, idle when unplugged
+
+	// APB2 @72MHz: 921600 baud is 78 (0.16% fast)
+	USART1->BRR = (72000000 + UART_BAUD / 2) / UART_BAUD;
+	USART1->CR3 = UART_CR3_DMAR | UART_CR3_DMAT;
+
+	DMA1_Channel4->CPAR = (uint32_t)&USART1->DR;
+
+	DMA1_Channel5->CPAR = (uint32_t)&USART1->DR;
+	DMA1_Channel5->CMAR = (uint32_t)uart.rxRing;
+	DMA1_Channel5->CNDTR = UART_RX_RING;
+	DMA1_Channel5->CCR = UART_DMA_MINC | UART_DMA_CIRC | UART_DMA_HTIE
+			| UART_DMA_TCIE | UART_DMA_EN;
+
+	USART1->CR1 = UART_CR1_UE | UART_CR1_TE | UART_CR1_RE | UART_CR1_IDLEIE;
+
+	// One priority for all three, so the receive copy never nests
+	NVIC_SetPriority(USART1_IRQn, 8);
+	NVIC_SetPriority(DMA1_Channel4_IRQn, 8);
+	NVIC_SetPriority(DMA1_Channel5_IRQn, 8);
+	NVIC_EnableIRQ(USART1_IRQn);
+	NVIC_EnableIRQ(DMA1_Channel4_IRQn);
+	NVIC_EnableIRQ(DMA1_Channel5_IRQn);
+
+	return;
+} // END UART_initUart()
+
+/***************************************************************
+ * Function:	void UART_process(void)
+ *
+ * Purpose:		To hand the rings between the UART and USB, and
+ * 					to send anything queued without a call to
+ * 					Handle_USBAsynchXfer().  USB only takes over
+ * 					between two transfers: once it is configured
+ * 					the transfer complete ISR stops chaining spans.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	uart.active
+ **************************************************************/
+void
+UART_process(void)
+{
+	bool usb = (bDeviceState == CONFIGURED);
+
+	NVIC_DisableIRQ(DMA1_Channel4_IRQn);
+
+	if(uart.active && usb && (uart.txLength == 0))
+	{
+		uart.active = false;
+	}
+	else if(!uart.active && !usb)
+	{
+		uart.active = true;
+	}
+
+	UART_sendSpan();
+
+	NVIC_EnableIRQ(DMA1_Channel4_IRQn);
+
+	return;
+} // END UART_process()
+
+/***************************************************************
+ * Function:	void UART_startTransmit(void)
+ *
+ * Purpose:		To start sending USB_TX if no transfer is in
+ * 					flight.  Called from the main loop after queuing
+ * 					data, via Handle_USBAsynchXfer().
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	DMA1 channel 4, uart.txLength
+ **************************************************************/
+void
+UART_startTransmit(void)
+{
+	NVIC_DisableIRQ(DMA1_Channel4_IRQn);
+	UART_sendSpan();
+	NVIC_EnableIRQ(DMA1_Channel4_IRQn);
+
+	return;
+} // END UART_startTransmit()
+
+bool
+UART_isActive(void)
+{
+	return uart.active;
+}
+
+uint32_t
+UART_getDropped(void)
+{
+	return uart.dropped;
+}
+
+/***************************************************************
+ * Function:	void UART_sendSpan(void)
+ *
+ * Purpose:		To send the oldest contiguous span of USB_TX.  The
+ * 					DMA reads the ring in place; the span is only
+ * 					consumed once sent, so the producers cannot
+ * 					reuse it.  A region that wraps goes out in two
+ * 					transfers.  Runs in the transfer complete ISR
+ * 					or with it masked.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	DMA1 channel 4, uart.txLength
+ **************************************************************/
+void
+UART_sendSpan(void)
+{
+	_BUFFER_spans spans;
+
+	if(!uart.active || (uart.txLength != 0) || (bDeviceState == CONFIGURED))
+	{
+		return;
+	}
+
+	if(USB_TX_Peek(&spans, USB_TX_Size) == 0)
+	{
+		return;
+	}
+
+	uart.txLength = spans.span[0].length;
+
+	DMA1_Channel4->CCR = 0;
+	DMA1_Channel4->CMAR = (uint32_t)spans.span[0].data;
+	DMA1_Channel4->CNDTR = spans.span[0].length;
+	DMA1_Channel4->CCR = UART_DMA_MINC | UART_DMA_FROM_MEMORY | UART_DMA_TCIE | UART_DMA_EN;
+
+	return;
+} // END UART_sendSpan()
+
+/***************************************************************
+ * Function:	void UART_receive(void)
+ *
+ * Purpose:		To copy what the DMA has written to the receive
+ * 					ring since the last call into USB_RX.  Bytes
+ * 					that arrive while USB owns the rings, or that
+ * 					USB_RX has no room for, are dropped.
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	uart.rxRead, uart.dropped, USB_RX
+ **************************************************************/
+void
+UART_receive(void)
+{
+	uint16_t write = UART_RX_RING - DMA1_Channel5->CNDTR;
+	uint16_t read = uart.rxRead;
+	uint16_t length;
+	uint16_t put;
+	bool owner = uart.active && (bDeviceState != CONFIGURED);
+
+	// CNDTR reloads at the end of the ring
+	if(write >= UART_RX_RING)
+	{
+		write = 0;
+	}
+
+	while(read != write)
+	{
+		length = (write > read) ? write - read : UART_RX_RING - read;
+		put = owner ? USB_RX_Put(&uart.rxRing[read], length) : length;
+		uart.dropped += length - put;
+
+		read += length;
+		if(read == UART_RX_RING)
+		{
+			read = 0;
+		}
+	}
+
+	uart.rxRead = read;
+
+	return;
+} // END UART_receive()
+
+/***************************************************************
+ * Function:	void USART1_IRQHandler(void)
+ *
+ * Purpose:		To pass a received burst on once the line goes
+ * 					idle, so a command does not wait for the ring
+ * 					to reach half or full
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	uart, USB_RX
+ **************************************************************/
+void
+USART1_IRQHandler(void)
+{
+	PERF_isrEnter();
+
+	// IDLE is cleared by reading SR then DR; the DMA has already
+	//	taken the last byte, so nothing is lost
+	if(USART1->SR & UART_SR_IDLE)
+	{
+		(void)USART1->DR;
+		UART_receive();
+	}
+
+	PERF_isrExit();
+
+	return;
+} // END USART1_IRQHandler()
+
+/***************************************************************
+ * Function:	void DMA1_Channel4_IRQHandler(void)
+ *
+ * Purpose:		To release a sent span of USB_TX and start the
+ * 					next one
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	DMA1 channel 4, uart.txLength, USB_TX
+ **************************************************************/
+void
+DMA1_Channel4_IRQHandler(void)
+{
+	PERF_isrEnter();
+
+	DMA1->IFCR = DMA_IFCR_CGIF4;
+	DMA1_Channel4->CCR = 0;
+
+	USB_TX_Consume(uart.txLength);
+	uart.txLength = 0;
+
+	UART_sendSpan();
+
+	PERF_isrExit();
+
+	return;
+} // END DMA1_Channel4_IRQHandler()
+
+/***************************************************************
+ * Function:	void DMA1_Channel5_IRQHandler(void)
+ *
+ * Purpose:		To empty the receive ring at half and full, so
+ * 					a long burst never laps it
+ *
+ * Parameters:	none
+ *
+ * Returns:		none
+ *
+ * Globals affected:	uart, USB_RX
+ **************************************************************/
+void
+DMA1_Channel5_IRQHandler(void)
+{
+	PERF_isrEnter();
+
+	DMA1->IFCR = DMA_IFCR_CGIF5;
+	UART_receive();
+
+	PERF_isrExit();
+
+	return;
+} // END DMA1_Channel5_IRQHandler()
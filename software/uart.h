@@ -0,0 +1,46 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef UART_H
+#define UART_H
+
+/* Standard or provided libs */
+#include <stdbool.h>
+#include <stdint.h>
+
+// USART1 is remapped to PB6 (TX) and PB7 (RX), the I2C slave pins
+//	(PA9/PA10 drive the bridge, USART2 sits on the ADC inputs): a UART
+//	build starts the UART instead of the I2C slave
+#ifndef UART_ENABLED
+#define UART_ENABLED				0
+#endif
+
+#define UART_BAUD					921600
+
+// Circular DMA receive ring, emptied at half, full and line idle
+#define UART_RX_RING				128
+
+/*
+ * The UART is a second physical link for the USB_RX/USB_TX rings, so
+ *	the command line, framed replies, telemetry and logs all work on
+ *	it unchanged.  It owns the rings while USB is not configured (a
+ *	CAN build never starts USB); USB takes over once the UART has no
+ *	transfer in flight.
+ *
+ * Neither direction interrupts per byte: DMA1 channel 5 receives
+ *	into a ring that is copied to USB_RX on the idle line, half and
+ *	full interrupts; DMA1 channel 4 sends USB_TX in place, one
+ *	contiguous span per transfer complete interrupt.
+ */
+void UART_initUart(void);
+void UART_process(void);
+void UART_startTransmit(void);
+bool UART_isActive(void);
+uint32_t UART_getDropped(void);
+
+#endif
@@ -0,0 +1,382 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/*
+ * Runs the bootloader's update protocol (software/bootloader.c, with the
+ * real frame.c) on a pseudo-terminal in place of USB, against a simulated
+ * flash controller: pages erase to 0xFF, a word can only be programmed
+ * while erased, and the bootloader pages are write protected.  Erase and
+ * program times follow the datasheet, so the report gives the flash time
+ * an update costs on the drive.
+ *
+ *	S=../../software
+ *	gcc -std=gnu99 -Wall -DSTM32F10X_LD -DUSE_STDPERIPH_DRIVER -I$S -I$S/cmsis \
+ *		-I$S/cmsis_boot -I$S/stm_lib/inc -I$S/USB/lib/inc -I$S/USB/vcp/inc \
+ *		-o bootSim bootSim.c $S/bootloader.c $S/frame.c
+ *
+ *	./bootSim [-o old.bin] [-c n] new.bin -- python3 ../bootUpload.py {} new.bin
+ *
+ * {} is replaced by the pty path.  -o starts from a verified old image,
+ * so only the pages that differ should be erased; -c drops about one in
+ * n frames from the host, at random, which the uploader must recover
+ * from.  Once the
+ * uploader exits, the flash must hold new.bin and a valid image record,
+ * and the bootloader must have been told to run it; the exit status is
+ * 0 only then.
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "boot.h"
+#include "bootFlash.h"
+#include "bootloader.h"
+#include "buffer.h"
+#include "frame.h"
+
+#define SIM_FLASH_BASE		BOOT_LOADER_ADDRESS
+#define SIM_FLASH_SIZE		0x8000
+#define SIM_PAGES			(SIM_FLASH_SIZE / BOOT_PAGE_SIZE)
+
+// STM32F103 datasheet, typical
+#define SIM_ERASE_US		20000
+#define SIM_HALFWORD_US		52
+
+BUFFER(USB_RX, 256);
+BUFFER(USB_TX, 512);
+
+static uint8_t simFlash[SIM_FLASH_SIZE];
+static uint16_t simErases[SIM_PAGES];
+static uint32_t simWords;
+static uint32_t simFlashUs;
+static uint32_t simErrors;
+static uint32_t simCrc;
+static int simPty = -1;
+
+/* Software stand-ins for the CRC unit, as tools/frames.py */
+static uint32_t
+crcWord(uint32_t crc, uint32_t word)
+{
+	int bit;
+
+	crc ^= word;
+	for(bit = 0; bit < 32; bit++)
+		crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+	return crc;
+}
+
+void CRC_ResetDR(void) { simCrc = 0xFFFFFFFF; }
+void RCC_AHBPeriphClockCmd(uint32_t peripheral, int state) {}
+
+uint32_t
+CRC_CalcBlockCRC(uint32_t buffer[], uint32_t length)
+{
+	uint32_t i;
+
+	for(i = 0; i < length; i++)
+		simCrc = crcWord(simCrc, buffer[i]);
+	return simCrc;
+}
+
+/* The flash controller */
+static uint32_t
+simOffset(uint32_t address)
+{
+	if((address < SIM_FLASH_BASE) || (address >= SIM_FLASH_BASE + SIM_FLASH_SIZE))
+	{
+		fprintf(stderr, "bootSim: access outside flash at 0x%08x\n", address);
+		exit(2);
+	}
+	return address - SIM_FLASH_BASE;
+}
+
+static int
+simProtected(uint32_t address)
+{
+	// Everything below the record page holds the bootloader
+	return address < BOOT_RECORD_ADDRESS;
+}
+
+void BFL_initFlash(void) {}
+
+uint32_t
+BFL_crc(const uint32_t *words, uint16_t count)
+{
+	CRC_ResetDR();
+	return CRC_CalcBlockCRC((uint32_t *)words, count);
+}
+
+uint32_t
+BFL_readWord(uint32_t address)
+{
+	uint32_t word;
+
+	memcpy(&word, &simFlash[simOffset(address)], sizeof(word));
+	return word;
+}
+
+uint32_t
+BFL_crcFlash(uint32_t address, uint16_t count)
+{
+	uint16_t i;
+
+	CRC_ResetDR();
+	for(i = 0; i < count; i++)
+		simCrc = crcWord(simCrc, BFL_readWord(address + i * 4));
+	return simCrc;
+}
+
+bool
+BFL_erasePage(uint32_t address)
+{
+	uint32_t offset = simOffset(address);
+
+	if((offset % BOOT_PAGE_SIZE) || simProtected(address))
+	{
+		fprintf(stderr, "bootSim: erase refused at 0x%08x\n", address);
+		simErrors++;
+		return false;
+	}
+
+	memset(&simFlash[offset], 0xFF, BOOT_PAGE_SIZE);
+	simErases[offset / BOOT_PAGE_SIZE]++;
+	simFlashUs += SIM_ERASE_US;
+	return true;
+}
+
+bool
+BFL_programWords(uint32_t address, const uint32_t *words, uint16_t count)
+{
+	uint16_t i;
+
+	for(i = 0; i < count; i++, address += 4)
+	{
+		if(words[i] == 0xFFFFFFFF)
+			continue;
+
+		if(simProtected(address) || (address & 3) || (BFL_readWord(address) != 0xFFFFFFFF))
+		{
+			fprintf(stderr, "bootSim: program refused at 0x%08x\n", address);
+			simErrors++;
+			return false;
+		}
+
+		memcpy(&simFlash[simOffset(address)], &words[i], 4);
+		simWords++;
+		simFlashUs += 2 * SIM_HALFWORD_US;
+	}
+	return true;
+}
+
+/* The USB port */
+void EP3_ResumeRx(void) {}
+
+void
+Handle_USBAsynchXfer(void)
+{
+	uint8_t data[512];
+	uint16_t length = USB_TX_Get(data, sizeof(data));
+	uint16_t done = 0;
+	ssize_t count;
+
+	while(done < length)
+	{
+		count = write(simPty, data + done, length - done);
+		if(count <= 0)
+			return;
+		done += count;
+	}
+}
+
+/* Loads an image file padded with 0xFF to whole pages, returns its pages */
+static uint8_t
+loadImage(const char *path, uint8_t *image)
+{
+	FILE *file = fopen(path, "rb");
+	size_t length;
+
+	if(!file)
+	{
+		perror(path);
+		exit(2);
+	}
+
+	memset(image, 0xFF, BOOT_APP_PAGES * BOOT_PAGE_SIZE);
+	length = fread(image, 1, BOOT_APP_PAGES * BOOT_PAGE_SIZE, file);
+	if(!feof(file) || (length == 0))
+	{
+		fprintf(stderr, "%s: empty or larger than %d pages\n", path, BOOT_APP_PAGES);
+		exit(2);
+	}
+
+	fclose(file);
+	return (uint8_t)((length + BOOT_PAGE_SIZE - 1) / BOOT_PAGE_SIZE);
+}
+
+/* Puts a verified image in place, as a previous update would have */
+static void
+installImage(const uint8_t *image, uint8_t pages)
+{
+	_BOOT_record record;
+
+	memcpy(&simFlash[BOOT_APP_ADDRESS - SIM_FLASH_BASE], image, pages * BOOT_PAGE_SIZE);
+	record.magic = BOOT_RECORD_MAGIC;
+	record.pages = pages;
+	record.crc = BFL_crcFlash(BOOT_APP_ADDRESS, pages * BOOT_PAGE_SIZE / 4);
+	record.check = ~record.crc;
+	memcpy(&simFlash[BOOT_RECORD_ADDRESS - SIM_FLASH_BASE], &record, sizeof(record));
+}
+
+/* Feeds host bytes to USB_RX, dropping about one in dropOdds frames */
+static void
+receive(const uint8_t *data, ssize_t length, int dropOdds)
+{
+	static int dropping;
+	ssize_t i;
+
+	for(i = 0; i < length; i++)
+	{
+		if(data[i] == FRM_DELIMITER)
+		{
+			if(dropping)
+			{
+				dropping = 0;
+				continue;
+			}
+			if(dropOdds && (rand() % dropOdds == 0))
+				dropping = 1;
+		}
+
+		if(dropping)
+			continue;
+
+		while(USB_RX_Put(&data[i], 1) == 0)
+			BTL_process();
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	static uint8_t image[BOOT_APP_PAGES * BOOT_PAGE_SIZE];
+	static uint8_t oldImage[BOOT_APP_PAGES * BOOT_PAGE_SIZE];
+	const char *oldPath = NULL;
+	char *command[32];
+	struct termios raw;
+	struct pollfd poller;
+	uint8_t data[256];
+	uint8_t pages, page, erased;
+	int dropOdds = 0;
+	int slave, status, i, n, ok;
+	pid_t child;
+	ssize_t count;
+
+	while((i = getopt(argc, argv, "o:c:")) != -1)
+	{
+		if(i == 'o')
+			oldPath = optarg;
+		else if(i == 'c')
+			dropOdds = atoi(optarg);
+		else
+			return 2;
+	}
+
+	if((optind >= argc) || (argc - optind - 1 >= 31))
+	{
+		fprintf(stderr, "usage: %s [-o old.bin] [-c n] new.bin -- command {} ...\n", argv[0]);
+		return 2;
+	}
+
+	// The bootloader is not part of the simulation, only its pages
+	memset(simFlash, 0xFF, sizeof(simFlash));
+	memset(simFlash, 0xA5, BOOT_RECORD_ADDRESS - SIM_FLASH_BASE);
+	pages = loadImage(argv[optind], image);
+	if(oldPath)
+		installImage(oldImage, loadImage(oldPath, oldImage));
+
+	simPty = posix_openpt(O_RDWR | O_NOCTTY);
+	if((simPty < 0) || grantpt(simPty) || unlockpt(simPty))
+	{
+		perror("pty");
+		return 2;
+	}
+
+	// Holding the slave open keeps the pty up between opens
+	slave = open(ptsname(simPty), O_RDWR | O_NOCTTY);
+	tcgetattr(slave, &raw);
+	cfmakeraw(&raw);
+	tcsetattr(slave, TCSANOW, &raw);
+
+	for(i = optind + 1, n = 0; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--") == 0)
+			continue;
+		command[n++] = strcmp(argv[i], "{}") ? argv[i] : ptsname(simPty);
+	}
+	command[n] = NULL;
+
+	if(n == 0)
+	{
+		printf("%s\n", ptsname(simPty));
+		fflush(stdout);
+	}
+
+	child = (n != 0) ? fork() : -1;
+	if(child == 0)
+	{
+		execvp(command[0], command);
+		perror(command[0]);
+		_exit(127);
+	}
+
+	// The same drops on every run
+	srand(1);
+	BTL_initBootloader();
+
+	poller.fd = simPty;
+	poller.events = POLLIN;
+	while(!BTL_isRunRequested())
+	{
+		if((child > 0) && (waitpid(child, &status, WNOHANG) == child))
+		{
+			child = 0;
+			break;
+		}
+
+		if(poll(&poller, 1, 10) > 0)
+		{
+			count = read(simPty, data, sizeof(data));
+			if(count > 0)
+				receive(data, count, dropOdds);
+		}
+
+		while(!BUFFER_IS_EMPTY(USB_RX) && !BTL_isRunRequested())
+			BTL_process();
+	}
+
+	// Let the uploader see the response to BTL_OP_RUN and exit
+	if(child > 0)
+		waitpid(child, &status, 0);
+
+	for(page = 0, erased = 0; page < BOOT_APP_PAGES; page++)
+		erased += simErases[(BOOT_APP_ADDRESS - SIM_FLASH_BASE) / BOOT_PAGE_SIZE + page] != 0;
+
+	ok = BTL_isRunRequested() && BTL_isImageValid() && (simErrors == 0)
+			&& (memcmp(&simFlash[BOOT_APP_ADDRESS - SIM_FLASH_BASE], image, pages * BOOT_PAGE_SIZE) == 0);
+
+	printf("%d image pages, %d erased, %u words programmed, %.2f s of flash time, %u errors: %s\n",
+			pages, erased, simWords, simFlashUs / 1e6, simErrors, ok ? "PASS" : "FAIL");
+
+	return ok ? 0 : 1;
+}
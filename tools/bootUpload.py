@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+"""Update the drive's application through the bootloader, see software/bootloader.h.
+
+    python3 tools/bootUpload.py /dev/ttyACM0 lowVoltageDrive.bin [--force]
+
+If the application is running, it is asked to restart into the
+bootloader with the "boot" CLI command.  Only the pages whose CRC differs
+from the image are written, so a small change costs a few page erases;
+--force writes every page.  The image is verified as a whole before the
+bootloader records it as the one to start.
+"""
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+from frames import FRM_TYPE_BOOT_REQUEST, FRM_TYPE_BOOT_RESPONSE, cobsDecode, crc32Mpeg2, encodeFrame
+
+BTL_PROTOCOL_VERSION = 1
+BTL_MAX_CRCS = 15
+BTL_MAX_WRITE = 56
+
+OP_INFO, OP_CRCS, OP_WRITE, OP_PROGRAM, OP_VERIFY, OP_RUN = range(6)
+STATUS_NAMES = ['ok', 'unknown operation', 'bad length', 'page out of range', 'CRC mismatch',
+                'flash error', 'not an application image']
+ERR_CRC = 4
+
+
+class BootError(Exception):
+    pass
+
+
+class Bootloader(object):
+    def __init__(self, path, timeout=0.5, retries=3):
+        self.path = path
+        self.timeout = timeout
+        self.retries = retries
+        self.sequence = 0
+        self.pending = bytearray()
+        self.fd = None
+        self.open()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def open(self):
+        self.fd = os.open(self.path, os.O_RDWR | os.O_NOCTTY)
+        if os.isatty(self.fd):
+            tty.setraw(self.fd)
+            termios.tcflush(self.fd, termios.TCIFLUSH)
+        self.pending = bytearray()
+
+    def close(self):
+        if self.fd is not None:
+            os.close(self.fd)
+            self.fd = None
+
+    def send(self, op, arguments=b''):
+        self.sequence = (self.sequence + 1) & 0xFF
+        os.write(self.fd, encodeFrame(FRM_TYPE_BOOT_REQUEST, bytes([self.sequence, op]) + arguments))
+
+    def request(self, op, arguments=b'', retries=None):
+        """Send one request and return (status, data) of its response."""
+        for _ in range(self.retries if retries is None else retries):
+            self.send(op, arguments)
+            response = self.receive(self.sequence, op)
+            if response is not None:
+                return response
+        raise BootError('no response from the bootloader')
+
+    def receive(self, sequence, op):
+        deadline = time.time() + self.timeout
+        while True:
+            while b'\0' in self.pending:
+                part, _, rest = bytes(self.pending).partition(b'\0')
+                self.pending = bytearray(rest)
+                raw = cobsDecode(part) if part else None
+                if raw is None or len(raw) < 8:
+                    continue
+                body, crc = raw[:-4], struct.unpack('<I', raw[-4:])[0]
+                if crc32Mpeg2(body) != crc or body[0] != FRM_TYPE_BOOT_RESPONSE:
+                    continue
+                if body[1] == sequence and body[2] == op:
+                    return body[3], body[4:]
+
+            remaining = deadline - time.time()
+            if remaining <= 0 or not select.select([self.fd], [], [], remaining)[0]:
+                return None
+            try:
+                chunk = os.read(self.fd, 4096)
+            except OSError:
+                chunk = b''
+            if not chunk:
+                raise BootError('the link closed')
+            self.pending += chunk
+
+    def check(self, status, data):
+        if status != 0:
+            name = STATUS_NAMES[status] if status < len(STATUS_NAMES) else 'status %d' % status
+            raise BootError(name)
+        return data
+
+    def enter(self, wait=5.0):
+        """Return the bootloader's INFO, restarting the application into it if needed."""
+        try:
+            return self.info(retries=1)
+        except BootError:
+            pass
+
+        # The application's CLI; the drive resets and USB enumerates again
+        os.write(self.fd, b'\rboot\r')
+        self.close()
+        deadline = time.time() + wait
+        while True:
+            time.sleep(0.2)
+            try:
+                self.open()
+                return self.info()
+            except (OSError, BootError):
+                self.close()
+                if time.time() > deadline:
+                    raise BootError('the bootloader did not come up on %s' % self.path)
+
+    def info(self, retries=None):
+        data = self.check(*self.request(OP_INFO, retries=retries))
+        version, pageSize, appPages, imagePages, imageCrc = struct.unpack('<BHBBI', data[:9])
+        if version != BTL_PROTOCOL_VERSION:
+            raise BootError('protocol version %d, expected %d' % (version, BTL_PROTOCOL_VERSION))
+        return pageSize, appPages, imagePages, imageCrc
+
+    def crcs(self, pages):
+        """Return the CRC of each of the first pages pages of the application area."""
+        crcs = []
+        for first in range(0, pages, BTL_MAX_CRCS):
+            count = min(BTL_MAX_CRCS, pages - first)
+            data = self.check(*self.request(OP_CRCS, bytes([first, count])))
+            crcs += struct.unpack('<%dI' % count, data[:4 * count])
+        return crcs
+
+    def program(self, page, data, attempts=10):
+        """Fill the page buffer and program it; a write lost on the way is sent again."""
+        crc = crc32Mpeg2(data)
+        for _ in range(attempts):
+            for offset in range(0, len(data), BTL_MAX_WRITE):
+                chunk = data[offset:offset + BTL_MAX_WRITE]
+                # The buffer starts erased, so erased chunks need not be sent
+                if chunk.count(0xFF) != len(chunk):
+                    self.send(OP_WRITE, struct.pack('<H', offset) + chunk)
+            status, _ = self.request(OP_PROGRAM, struct.pack('<BI', page, crc))
+            if status != ERR_CRC:
+                self.check(status, b'')
+                return
+        raise BootError('page %d did not arrive intact' % page)
+
+    def verify(self, pages, crc):
+        self.check(*self.request(OP_VERIFY, struct.pack('<BI', pages, crc)))
+
+    def run(self):
+        self.check(*self.request(OP_RUN))
+
+
+def main():
+    arguments = [argument for argument in sys.argv[1:] if argument != '--force']
+    force = '--force' in sys.argv[1:]
+    if len(arguments) != 2:
+        sys.stderr.write(__doc__)
+        return 1
+
+    with open(arguments[1], 'rb') as imageFile:
+        image = imageFile.read()
+
+    try:
+        with Bootloader(arguments[0]) as drive:
+            start = time.time()
+            pageSize, appPages, _, _ = drive.enter()
+
+            pages = (len(image) + pageSize - 1) // pageSize
+            if pages == 0 or pages > appPages:
+                raise BootError('the image needs %d pages, the drive has %d' % (pages, appPages))
+            image += b'\xff' * (pages * pageSize - len(image))
+            images = [image[page * pageSize:(page + 1) * pageSize] for page in range(pages)]
+
+            driveCrcs = [None] * pages if force else drive.crcs(pages)
+            changed = [page for page in range(pages) if crc32Mpeg2(images[page]) != driveCrcs[page]]
+            for page in changed:
+                drive.program(page, images[page])
+
+            drive.verify(pages, crc32Mpeg2(image))
+            drive.run()
+            print('%d of %d pages written in %.1f s' % (len(changed), pages, time.time() - start))
+    except (BootError, OSError) as error:
+        sys.stderr.write('%s\n' % error)
+        return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,261 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/*
+ * Host throughput of the USB ring buffers: the span API of
+ * software/USB/vcp/inc/buffer.h against the byte-at-a-time macros it
+ * replaced (byteBuffer.h), and the C++ Buffer<size> template of the same
+ * header against both.  The rings have the firmware's sizes and are
+ * used the way the firmware uses them, producer and consumer taking
+ * turns as an interrupt and the main loop do on one core:
+ *
+ *	tx		frames of n bytes queued, sent in 64-byte packets to a
+ *			stand-in for packet memory (EP1_FillBuffers())
+ *	rx		64-byte packets received (EP3_OUT_Callback()), read back
+ *			n bytes at a time
+ *	echo	64-byte packets received and copied from USB_RX to USB_TX
+ *
+ *	g++ -std=c++17 -O2 -Wall -I../../software/USB/vcp/inc -o bufferBench bufferBench.cpp
+ *	./bufferBench [megabytes]
+ *
+ * Each case moves the same number of bytes; the figures are MB/s through
+ * the ring, and the ratio is template over span.  The firmware builds
+ * with -Os for a Cortex-M3, so only the ratios carry over.  At -O2 x86
+ * g++ expands the template's inlined memcpy() calls into rep movsq,
+ * which is slow for short copies; add -mmemcpy-strategy=libcall:-1:noalign
+ * to compare like with like (the Cortex-M3 build always calls memcpy()).
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "buffer.h"
+#include "byteBuffer.h"
+
+#define PACKET_SIZE		64			// VIRTUAL_COM_PORT_DATA_SIZE
+
+BUFFER(SPAN_RX, 256);
+BUFFER(SPAN_TX, 512);
+BUFFER_COPY(SPAN_RX, SPAN_TX);
+
+BYTE_BUFFER(BYTE_RX, 256);
+BYTE_BUFFER(BYTE_TX, 512);
+BYTE_BUFFER_COPY(BYTE_RX, BYTE_TX);
+
+static Buffer<256> templateRx;
+static Buffer<512> templateTx;
+
+static uint8_t source[PACKET_SIZE * 4];
+static uint8_t packetMemory[PACKET_SIZE];
+static volatile uint32_t sink;
+
+// Runs step() until total bytes have gone through; step() returns the
+// bytes it moved
+template<typename Step>
+static double
+MegabytesPerSecond(uint64_t total, Step&& step)
+{
+	uint64_t moved = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	while(moved < total)
+		moved += step();
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return (double)moved / 1e6 / elapsed.count();
+}
+
+// The old free-space macro miscounted a full ring, so count it here
+#define BYTE_FREE_SPACE(name)	((uint16_t)((name##_Head > name##_Tail)			\
+			? name##_Head - name##_Tail - 1 : name##_Size - (name##_Tail - name##_Head) - 1))
+
+static void
+ToPacketMemory(const _BUFFER_spans& spans)
+{
+	memcpy(packetMemory, spans.span[0].data, spans.span[0].length);
+	memcpy(packetMemory + spans.span[0].length, spans.span[1].data, spans.span[1].length);
+	sink += packetMemory[0];
+}
+
+/* tx: queue frames while they fit, then send one packet */
+static uint32_t
+TxByte(uint16_t frame)
+{
+	uint32_t moved = 0;
+
+	while(BYTE_FREE_SPACE(BYTE_TX) >= frame)
+		BYTE_TX_Put(source, frame);
+	for(uint16_t count; (count = BYTE_TX_Get(packetMemory, PACKET_SIZE)) != 0; moved += count)
+		sink += packetMemory[0];
+	return moved;
+}
+
+static uint32_t
+TxSpan(uint16_t frame)
+{
+	_BUFFER_spans spans;
+	uint32_t moved = 0;
+
+	while(BUFFER_FREE_SPACE(SPAN_TX) >= frame)
+		SPAN_TX_Put(source, frame);
+	for(; SPAN_TX_Peek(&spans, PACKET_SIZE) != 0; moved += spans.length)
+	{
+		ToPacketMemory(spans);
+		SPAN_TX_Consume(spans.length);
+	}
+	return moved;
+}
+
+static uint32_t
+TxTemplate(uint16_t frame)
+{
+	_BUFFER_spans spans;
+	uint32_t moved = 0;
+
+	while(templateTx.FreeSpace() >= frame)
+		templateTx.Put(source, frame);
+	for(; templateTx.Peek(spans, PACKET_SIZE) != 0; moved += spans.length)
+	{
+		ToPacketMemory(spans);
+		templateTx.Consume(spans.length);
+	}
+	return moved;
+}
+
+/* rx: receive packets while they fit, then read everything back */
+static uint32_t
+RxByte(uint16_t chunk)
+{
+	uint8_t line[PACKET_SIZE];
+	uint32_t moved = 0;
+
+	while(BYTE_FREE_SPACE(BYTE_RX) >= PACKET_SIZE)
+		BYTE_RX_Put(source, PACKET_SIZE);
+	for(uint16_t count; (count = BYTE_RX_Get(line, chunk)) != 0; moved += count)
+		sink += line[0];
+	return moved;
+}
+
+static uint32_t
+RxSpan(uint16_t chunk)
+{
+	_BUFFER_spans spans;
+	uint8_t line[PACKET_SIZE];
+	uint32_t moved = 0;
+
+	while(BUFFER_FREE_SPACE(SPAN_RX) >= PACKET_SIZE)
+	{
+		SPAN_RX_Reserve(&spans, PACKET_SIZE);
+		memcpy(spans.span[0].data, source, spans.span[0].length);
+		memcpy(spans.span[1].data, source + spans.span[0].length, spans.span[1].length);
+		SPAN_RX_Commit(spans.length);
+	}
+	for(uint16_t count; (count = SPAN_RX_Get(line, chunk)) != 0; moved += count)
+		sink += line[0];
+	return moved;
+}
+
+static uint32_t
+RxTemplate(uint16_t chunk)
+{
+	_BUFFER_spans spans;
+	uint8_t line[PACKET_SIZE];
+	uint32_t moved = 0;
+
+	while(templateRx.FreeSpace() >= PACKET_SIZE)
+	{
+		templateRx.Reserve(spans, PACKET_SIZE);
+		memcpy(spans.span[0].data, source, spans.span[0].length);
+		memcpy(spans.span[1].data, source + spans.span[0].length, spans.span[1].length);
+		templateRx.Commit(spans.length);
+	}
+	for(uint16_t count; (count = templateRx.Get(line, chunk)) != 0; moved += count)
+		sink += line[0];
+	return moved;
+}
+
+/* echo: one packet in, copied across, one packet out */
+static uint32_t
+EchoByte(void)
+{
+	BYTE_RX_Put(source, PACKET_SIZE);
+	uint16_t moved = BYTE_RX_BYTE_TX_Copy(PACKET_SIZE);
+	BYTE_TX_Get(packetMemory, PACKET_SIZE);
+	sink += packetMemory[0];
+	return moved;
+}
+
+static uint32_t
+EchoSpan(void)
+{
+	_BUFFER_spans spans;
+
+	SPAN_RX_Put(source, PACKET_SIZE);
+	uint16_t moved = SPAN_RX_SPAN_TX_Copy(PACKET_SIZE);
+	SPAN_TX_Peek(&spans, PACKET_SIZE);
+	ToPacketMemory(spans);
+	SPAN_TX_Consume(spans.length);
+	return moved;
+}
+
+static uint32_t
+EchoTemplate(void)
+{
+	_BUFFER_spans spans;
+	uint16_t moved;
+
+	templateRx.Put(source, PACKET_SIZE);
+	templateRx.Peek(spans, PACKET_SIZE);
+	moved = templateTx.Put(spans.span[0].data, spans.span[0].length);
+	if(moved == spans.span[0].length)
+		moved += templateTx.Put(spans.span[1].data, spans.span[1].length);
+	templateRx.Consume(moved);
+	templateTx.Peek(spans, PACKET_SIZE);
+	ToPacketMemory(spans);
+	templateTx.Consume(spans.length);
+	return moved;
+}
+
+int
+main(int argc, char** argv)
+{
+	uint64_t total = (uint64_t)((argc > 1) ? atoi(argv[1]) : 256) * 1000000;
+	const uint16_t sizes[] = {1, 8, 24, 64};
+
+	for(size_t i = 0; i < sizeof(source); i++)
+		source[i] = (uint8_t)(i * 7 + 1);
+
+	printf("%-10s %12s %12s %14s %8s\n", "case", "byte MB/s", "span MB/s", "template MB/s", "ratio");
+
+	for(uint16_t size : sizes)
+	{
+		double byteRate = MegabytesPerSecond(total, [&] { return TxByte(size); });
+		double spanRate = MegabytesPerSecond(total, [&] { return TxSpan(size); });
+		double templateRate = MegabytesPerSecond(total, [&] { return TxTemplate(size); });
+		printf("tx %-7u %12.0f %12.0f %14.0f %8.1f\n", size, byteRate, spanRate, templateRate,
+				templateRate / spanRate);
+	}
+
+	for(uint16_t size : sizes)
+	{
+		double byteRate = MegabytesPerSecond(total, [&] { return RxByte(size); });
+		double spanRate = MegabytesPerSecond(total, [&] { return RxSpan(size); });
+		double templateRate = MegabytesPerSecond(total, [&] { return RxTemplate(size); });
+		printf("rx %-7u %12.0f %12.0f %14.0f %8.1f\n", size, byteRate, spanRate, templateRate,
+				templateRate / spanRate);
+	}
+
+	double byteRate = MegabytesPerSecond(total, EchoByte);
+	double spanRate = MegabytesPerSecond(total, EchoSpan);
+	double templateRate = MegabytesPerSecond(total, EchoTemplate);
+	printf("%-10s %12.0f %12.0f %14.0f %8.1f\n", "echo", byteRate, spanRate, templateRate,
+			templateRate / spanRate);
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef BYTE_BUFFER_H
+#define BYTE_BUFFER_H
+
+/*
+ * The byte-at-a-time ring macros that software/USB/vcp/inc/buffer.h had
+ * before the span API, renamed so that both can be built side by side.
+ * Only Put(), Get() and the copy between two rings are kept.
+ */
+#include <stdint.h>
+
+#define BYTE_BUFFER(name, size)											\
+const uint16_t name##_Size = size;										\
+uint8_t name##_Buffer[size];											\
+uint8_t *name##_Head = name##_Buffer, *name##_Tail = name##_Buffer;		\
+uint32_t name##_BytesRead, name##_BytesWritten;							\
+																		\
+uint16_t name##_Put(const uint8_t* buffer, uint16_t length)			\
+{																		\
+	uint16_t count;														\
+	uint8_t *next;														\
+																		\
+	count = 0;															\
+	while(count < length)												\
+	{																	\
+		next = name##_Tail + 1;											\
+		if(next - name##_Buffer >= name##_Size)							\
+			next = name##_Buffer;										\
+		if(next == name##_Head)											\
+		{																\
+			name##_BytesWritten += count;								\
+			return count;												\
+		}																\
+		*name##_Tail = *(buffer + count);								\
+		name##_Tail = next;												\
+		count++;														\
+	}																	\
+	name##_BytesWritten += count;										\
+	return count;														\
+}																		\
+																		\
+uint16_t name##_Get(uint8_t* buffer, uint16_t length)					\
+{																		\
+	uint16_t count;														\
+																		\
+	count = 0;															\
+	while(count < length)												\
+	{																	\
+		if(name##_Head == name##_Tail)									\
+		{																\
+			name##_BytesRead += count;									\
+			return count;												\
+		}																\
+		*(buffer + count) = *name##_Head;								\
+		name##_Head++;													\
+		if(name##_Head - name##_Buffer >= name##_Size)					\
+			name##_Head = name##_Buffer;								\
+		count++;														\
+	}																	\
+	name##_BytesRead += count;											\
+	return count;														\
+}
+
+#define BYTE_BUFFER_COPY(source, dest)									\
+uint16_t source##_##dest##_Copy(uint16_t length)						\
+{																		\
+	uint16_t count;														\
+	uint8_t *next;														\
+																		\
+	count = 0;															\
+	while(count < length)												\
+	{																	\
+		if(source##_Head == source##_Tail)								\
+			return count;												\
+		next = dest##_Tail + 1;											\
+		if(next - dest##_Buffer >= dest##_Size)							\
+			next = dest##_Buffer;										\
+		if(next == dest##_Head)											\
+		{																\
+			source##_BytesRead += count;								\
+			dest##_BytesWritten += count;								\
+			return count;												\
+		}																\
+		*dest##_Tail = *source##_Head;									\
+		dest##_Tail = next;												\
+		source##_Head++;												\
+		if(source##_Head - source##_Buffer >= source##_Size)			\
+			source##_Head = source##_Buffer;							\
+		count++;														\
+	}																	\
+	source##_BytesRead += count;										\
+	dest##_BytesWritten += count;										\
+	return count;														\
+}
+
+#endif
@@ -0,0 +1,185 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/*
+ * Runs the drive's CAN node (software/canNode.c) on Linux SocketCAN, in
+ * place of bxCAN: the kernel's CAN_RAW_FILTER list stands in for the
+ * hardware filter bank, and the motor simply follows the duty demand.
+ *
+ *	sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+ *	gcc -std=gnu99 -Wall -I../../software -o canSim canSim.c ../../software/canNode.c
+ *	./canSim vcan0 5 [group] [slot]		node 5
+ *
+ *	cansend vcan0 205#3412				setpoint 0x1234 to node 5
+ *	cansend vcan0 100#0100020003000400	group 0, slot n gets the n-th u16
+ *	cansend vcan0 000#					stop all
+ *	candump vcan0						telemetry 0x305, status 0x385
+ *
+ * The demand is printed whenever it changes, including when the
+ * setpoint times out.
+ */
+#include <errno.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "canNode.h"
+#include "canPort.h"
+
+static int canSocket = -1;
+static uint16_t simDutyCycle;
+
+/* The parts of the drive that the CAN node reads */
+uint32_t
+MSTMR_getMilliSeconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+uint8_t MOT_getMotorState(void) { return simDutyCycle ? 2 : 0; }
+int8_t MOT_getSector(void) { return simDutyCycle ? (int8_t)(MSTMR_getMilliSeconds() / 10 % 6) : -1; }
+uint16_t MOT_getDutyCycle(void) { return simDutyCycle; }
+uint16_t ADC_getVoltage(int source) { return source == 4 ? 3000 : 400 + simDutyCycle / 64; }
+bool FLT_isSafeMode(void) { return false; }
+bool FLT_hasRecord(void) { return false; }
+
+/* canPort.h on SocketCAN */
+void
+CANP_initPort(uint16_t bitrateKbps)
+{
+	(void)bitrateKbps;					// set on the interface, e.g. ip link ... bitrate 500000
+}
+
+void
+CANP_setFilters(const uint16_t ids[CANP_FILTER_IDS])
+{
+	struct can_filter filters[CANP_FILTER_IDS];
+
+	for(int i = 0; i < CANP_FILTER_IDS; i++)
+	{
+		filters[i].can_id = ids[i];
+		filters[i].can_mask = CAN_SFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG;
+	}
+
+	if(setsockopt(canSocket, SOL_CAN_RAW, CAN_RAW_FILTER, filters, sizeof(filters)) != 0)
+		perror("CAN_RAW_FILTER");
+}
+
+bool
+CANP_transmit(uint16_t id, const uint8_t *data, uint8_t length)
+{
+	struct can_frame frame;
+
+	memset(&frame, 0, sizeof(frame));
+	frame.can_id = id;
+	frame.can_dlc = length;
+	memcpy(frame.data, data, length);
+
+	return write(canSocket, &frame, sizeof(frame)) == sizeof(frame);
+}
+
+int
+main(int argc, char** argv)
+{
+	if(argc < 3 || argc > 5)
+	{
+		fprintf(stderr, "usage: %s <can interface> <node> [group] [slot]\n", argv[0]);
+		return 1;
+	}
+
+	canSocket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+	if(canSocket < 0)
+	{
+		perror("socket");
+		return 1;
+	}
+
+	struct ifreq request;
+	memset(&request, 0, sizeof(request));
+	strncpy(request.ifr_name, argv[1], IFNAMSIZ - 1);
+	if(ioctl(canSocket, SIOCGIFINDEX, &request) != 0)
+	{
+		fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+		return 1;
+	}
+
+	struct sockaddr_can address;
+	memset(&address, 0, sizeof(address));
+	address.can_family = AF_CAN;
+	address.can_ifindex = request.ifr_ifindex;
+	if(bind(canSocket, (struct sockaddr*)&address, sizeof(address)) != 0)
+	{
+		perror("bind");
+		return 1;
+	}
+
+	CANN_initCanNode();
+
+	_CANN_config config = *CANN_getConfig();
+	config.node = (uint8_t)strtoul(argv[2], NULL, 0);
+	config.group = (argc > 3) ? (uint8_t)strtoul(argv[3], NULL, 0) : 0;
+	config.slot = (argc > 4) ? (uint8_t)strtoul(argv[4], NULL, 0) : 0;
+	if(!CANN_configure(&config))
+	{
+		fprintf(stderr, "node is 1-%d, group 0-%d, slot 0-%d\n", CANN_MAX_NODE,
+				CANN_MAX_GROUP, CANN_GROUP_SLOTS - 1);
+		return 1;
+	}
+
+	printf("node %u group %u slot %u, timeout %u ms\n", config.node, config.group,
+			config.slot, config.timeoutMs);
+
+	uint32_t lastMs = MSTMR_getMilliSeconds();
+	int lastDemand = -1;
+
+	while(1)
+	{
+		struct pollfd descriptor = {canSocket, POLLIN, 0};
+
+		if(poll(&descriptor, 1, 1) > 0)
+		{
+			struct can_frame frame;
+
+			// The filters already dropped everything that is not ours
+			if(read(canSocket, &frame, sizeof(frame)) == sizeof(frame)
+					&& !(frame.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG)))
+			{
+				CANN_receive((uint16_t)frame.can_id, frame.data, frame.can_dlc);
+			}
+		}
+
+		// The main loop's millisecond tick
+		uint32_t now = MSTMR_getMilliSeconds();
+		if(now != lastMs)
+		{
+			lastMs = now;
+
+			uint16_t demand;
+			simDutyCycle = CANN_getSpeedDemand(&demand) ? demand : 0;
+			if(simDutyCycle != lastDemand)
+			{
+				printf("demand %u\n", simDutyCycle);
+				fflush(stdout);
+				lastDemand = simDutyCycle;
+			}
+
+			CANN_process(now);
+		}
+	}
+}
@@ -0,0 +1,133 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/*
+ * Builds the bidirectional DShot reply of software/dshot.c for every
+ * electrical period a motor can report, and reads each waveform back the
+ * way a flight controller does: line levels to GCR by XOR with the
+ * previous level, GCR to nibbles, then the inverted CRC and the
+ * exponent/mantissa period.  TIM3, DMA1 channel 3 and GPIOA are plain
+ * structs here, so the BSRR words the DMA would send are read straight
+ * out of the reply buffer.
+ *
+ *	S=../../software
+ *	gcc -std=gnu99 -Wall -Wno-pointer-to-int-cast -DLOG_ENABLED=0 \
+ *		-DSTM32F10X_LD -DUSE_STDPERIPH_DRIVER \
+ *		-I$S -I$S/cmsis -I$S/cmsis_boot -I$S/stm_lib/inc -o dshotReply dshotReply.c
+ *	./dshotReply
+ *
+ * The exit status is 0 only if every period decodes to what was sent.
+ */
+#include <stdio.h>
+
+#include "stm32f10x.h"
+
+static TIM_TypeDef simTim3;
+static DMA_Channel_TypeDef simDma1Channel3;
+static GPIO_TypeDef simGpioA;
+
+#undef TIM3
+#undef DMA1_Channel3
+#undef GPIOA
+#define TIM3				(&simTim3)
+#define DMA1_Channel3		(&simDma1Channel3)
+#define GPIOA				(&simGpioA)
+
+#include "dshot.c"
+
+static uint32_t simPeriod;
+
+/* The parts of the drive that the reply reads */
+uint32_t MOT_getElectricalPeriod(void) { return simPeriod; }
+uint16_t MOT_getDutyCycle(void) { return 0; }
+void GPIO_pinSetup(_port port, uint16_t pin, uint8_t pinState) {}
+void RCC_AHBPeriphClockCmd(uint32_t peripheral, FunctionalState state) {}
+void RCPWM_receiveDemand(_RCPWM_protocol protocol, uint16_t demand) {}
+void PERF_isrEnter(void) {}
+void PERF_isrExit(void) {}
+
+/*
+ * Reference decoder, as in the flight controller firmware.  Returns the
+ * period in microseconds, 0 for stopped, or -1 for a bad frame.
+ */
+static int32_t
+decodeReply(const uint32_t *words)
+{
+	static const int8_t nibbles[32] =
+	{
+		-1, -1, -1, -1, -1, -1, -1, -1, -1,  9, 10, 11, -1, 13, 14, 15,
+		-1, -1,  2,  3, -1,  5,  6,  7, -1,  0,  8,  1, -1,  4, 12, -1
+	};
+	uint32_t levels = 0;
+	uint32_t gcr;
+	uint32_t value = 0;
+	uint32_t check;
+	int i;
+
+	// A low line is a 1; the line idles high
+	for(i = 0; i < DSHOT_REPLY_BITS; i++)
+	{
+		if(words[i] == DSHOT_PIN_LOW)
+			levels = (levels << 1) | 1;
+		else if(words[i] == DSHOT_PIN_HIGH)
+			levels <<= 1;
+		else
+			return -1;
+	}
+	if(words[DSHOT_REPLY_BITS] != DSHOT_PIN_HIGH)
+		return -1;
+
+	gcr = (levels ^ (levels >> 1)) & 0xFFFFF;
+	for(i = 15; i >= 0; i -= 5)
+	{
+		if(nibbles[(gcr >> i) & 0x1F] < 0)
+			return -1;
+		value = (value << 4) | nibbles[(gcr >> i) & 0x1F];
+	}
+
+	check = value ^ (value >> 8);
+	check ^= check >> 4;
+	if((check & 0x0F) != 0x0F)
+		return -1;
+
+	value >>= 4;
+	if(value == 0xFFF)
+		return 0;
+	return (int32_t)((value & 0x1FF) << (value >> 9));
+}
+
+int
+main(void)
+{
+	uint32_t errors = 0;
+	uint32_t sent;
+	int32_t decoded;
+	uint8_t shift;
+
+	for(simPeriod = 0; simPeriod <= (0x1FFul << 7) + 1; simPeriod++)
+	{
+		DSHOT_startReply(RCPWM_TICKS_PER_US * 10 / 3);
+		decoded = decodeReply(dshot.reply);
+
+		// The mantissa keeps the top 9 bits of the period; 0x1FF << 7
+		//	would read as 0xFFF, stopped
+		sent = (simPeriod >= (0x1FFul << 7)) ? 0 : simPeriod;
+		for(shift = 0; (sent >> shift) > 0x1FF; shift++);
+		sent = (sent >> shift) << shift;
+
+		if(decoded != (int32_t)sent)
+		{
+			if(errors++ < 10)
+				printf("period %lu: decoded %ld, sent %lu\n", (unsigned long)simPeriod,
+						(long)decoded, (unsigned long)sent);
+		}
+	}
+
+	printf("%lu periods, %lu errors\n", (unsigned long)simPeriod, (unsigned long)errors);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Stand in for the drive on a pseudo-terminal, replaying synthetic frames.
+
+Host tools that read the USB serial port can be run end to end without
+hardware.  The pty slave path replaces {} in the command, which is started
+once the pty exists; the frames are then written and the pty is closed,
+which the reader sees as end of file:
+
+    python3 tools/framePty.py --samples 100000 -- tools/recorder/tlmRecord {} run1
+
+Without a command the slave path is printed and the frames are written as
+soon as something opens it.  The stream mixes in text lines (as printed by
+the CLI), a corrupted frame every --corrupt frames and a skipped sequence
+number every --gap samples, so the reader's error counters can be checked:
+it should report the number of samples written minus the corrupted ones.
+"""
+import argparse
+import math
+import os
+import struct
+import subprocess
+import sys
+import time
+import tty
+
+from frames import FRM_TYPE_TELEMETRY, encodeFrame
+
+CPU_HZ = 72000000
+
+
+def telemetry(index, sequence, rateHz):
+    timestamp = (index * CPU_HZ // rateHz) & 0xFFFFFFFF
+    angle = 2 * math.pi * index / 50.0
+    phases = [int(2048 + 1500 * math.sin(angle - k * 2 * math.pi / 3)) for k in range(3)]
+    sector = (index // 8) % 6
+    return struct.pack('<IHHHHHHHbB', timestamp, sequence & 0xFFFF, phases[0], phases[1],
+                       phases[2], 3000, 400 + index % 100, 20000, sector, 3)
+
+
+def stream(args):
+    chunk = bytearray()
+    sequence = 0
+    corrupted = 0
+
+    for index in range(args.samples):
+        if args.gap and index and index % args.gap == 0:
+            sequence += 1
+        frame = bytearray(encodeFrame(FRM_TYPE_TELEMETRY, telemetry(index, sequence, args.sample_rate)))
+        sequence += 1
+
+        if args.corrupt and index % args.corrupt == args.corrupt - 1:
+            frame[len(frame) // 2] ^= 0x55
+            if frame[len(frame) // 2] == 0:
+                frame[len(frame) // 2] = 0x55
+            corrupted += 1
+        chunk += frame
+
+        if index % 1000 == 999:
+            chunk += b'usb in=123456B/s\r\n> '
+
+        if len(chunk) >= 4096:
+            yield bytes(chunk)
+            chunk = bytearray()
+
+    yield bytes(chunk)
+    sys.stderr.write('%d samples written, %d corrupted\n' % (args.samples, corrupted))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--samples', type=int, default=10000)
+    parser.add_argument('--sample-rate', type=int, default=1000, help='telemetry rate the timestamps follow')
+    parser.add_argument('--throttle', type=float, default=0,
+                        help='bytes per second to write at, 0 for as fast as the reader takes them')
+    parser.add_argument('--corrupt', type=int, default=997)
+    parser.add_argument('--gap', type=int, default=5003)
+    parser.add_argument('command', nargs=argparse.REMAINDER)
+    args = parser.parse_args()
+
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    path = os.ttyname(slave)
+
+    command = [part.replace('{}', path) for part in args.command if part != '--']
+    reader = subprocess.Popen(command) if command else None
+    if reader is None:
+        print(path)
+        sys.stdout.flush()
+
+    start = time.time()
+    written = 0
+    for chunk in stream(args):
+        view = memoryview(chunk)
+        while view:
+            count = os.write(master, view)
+            view = view[count:]
+            written += count
+        if args.throttle:
+            time.sleep(max(0, written / args.throttle - (time.time() - start)))
+
+    # Let the reader drain the pty before hanging up
+    os.close(slave)
+    time.sleep(0.5)
+    os.close(master)
+
+    elapsed = time.time() - start
+    sys.stderr.write('%d bytes in %.2f s, %.0f kB/s\n' % (written, elapsed, written / elapsed / 1000))
+    return reader.wait() if reader else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,85 @@
+"""Binary frames on the USB serial link, see software/frame.h.
+
+    0x00 | COBS( type | payload | crc32 ) | 0x00
+
+Shared by the host tools that read the firmware's binary output.
+"""
+import struct
+
+FRM_TYPE_TELEMETRY = 0x01
+FRM_TYPE_LOG = 0x02
+FRM_TYPE_SCOPE = 0x03
+FRM_TYPE_PARAM_REQUEST = 0x10
+FRM_TYPE_PARAM_RESPONSE = 0x11
+FRM_TYPE_BOOT_REQUEST = 0x20
+FRM_TYPE_BOOT_RESPONSE = 0x21
+
+
+def crc32Mpeg2(data):
+    # The STM32 CRC unit fed little-endian words, see frame.h
+    data = data + b'\0' * (-len(data) % 4)
+    crc = 0xFFFFFFFF
+    for index in range(0, len(data), 4):
+        for byte in reversed(data[index:index + 4]):
+            crc ^= byte << 24
+            for _ in range(8):
+                crc = ((crc << 1) ^ 0x04C11DB7) if crc & 0x80000000 else (crc << 1)
+                crc &= 0xFFFFFFFF
+    return crc
+
+
+def cobsDecode(data):
+    out = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        if code == 0 or index + code > len(data) + 1:
+            return None
+        out += data[index + 1:index + code]
+        index += code
+        if code < 0xFF and index < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frames(stream):
+    """Yield (type, payload) for every frame with a good CRC."""
+    pending = bytearray()
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            return
+        pending += chunk
+        parts = pending.split(b'\0')
+        pending = bytearray(parts.pop())
+        for part in parts:
+            raw = cobsDecode(bytes(part)) if part else None
+            if raw is None or len(raw) < 5:
+                continue
+            body, crc = raw[:-4], struct.unpack('<I', raw[-4:])[0]
+            if crc32Mpeg2(body) == crc:
+                yield body[0], body[1:]
+
+
+def cobsEncode(data):
+    out = bytearray([0])
+    code = 0
+    for byte in data:
+        if byte == 0:
+            out[code] = len(out) - code
+            code = len(out)
+            out.append(0)
+        else:
+            out.append(byte)
+            if len(out) - code == 0xFF:
+                out[code] = 0xFF
+                code = len(out)
+                out.append(0)
+    out[code] = len(out) - code
+    return bytes(out)
+
+
+def encodeFrame(frameType, payload):
+    """The bytes the firmware sends for one frame, delimiters included."""
+    body = bytes([frameType]) + payload
+    return b'\0' + cobsEncode(body + struct.pack('<I', crc32Mpeg2(body))) + b'\0'
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Decode the binary log records sent by the firmware (see log.h).
+
+The firmware only sends the flash address of each format string and the raw
+arguments; the strings are read back out of the ELF that was flashed, e.g.
+software/lowVoltageDrive/Debug/bin/lowVoltageDrive.elf.  Run:
+
+    python3 tools/logDecode.py path/to/lowVoltageDrive.elf capture.bin
+    python3 tools/logDecode.py path/to/lowVoltageDrive.elf /dev/ttyACM0
+
+The input is the raw byte stream of the USB serial port, read until end of
+file.  A serial device must be in raw mode first (stty -F /dev/ttyACM0 raw).
+Text and other frame types on the link are skipped.
+
+Timestamps are CPU cycles at 72MHz, shown in seconds since the first record;
+they stay monotonic as long as records arrive at least every 59 s.
+"""
+import re
+import struct
+import sys
+
+from frames import FRM_TYPE_LOG, frames
+
+CPU_HZ = 72000000
+
+LOG_ARGC_SHIFT = 28
+LOG_HEADER_WORDS = 2
+
+# printf conversions, with the C length modifiers that Python does not take
+CONVERSION = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t)?([diouxXcspfeEgG%])')
+
+
+class Elf(object):
+    """The loadable sections of a 32-bit little-endian ELF, by address."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as elfFile:
+            data = elfFile.read()
+
+        if data[:4] != b'\x7fELF' or data[4] != 1 or data[5] != 1:
+            raise ValueError('%s is not a 32-bit little-endian ELF' % path)
+
+        shoff, = struct.unpack_from('<I', data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', data, 0x2E)
+
+        self.sections = []
+        for index in range(shnum):
+            fields = struct.unpack_from('<IIIIIIIIII', data, shoff + index * shentsize)
+            shType, flags, address, offset, size = fields[1], fields[2], fields[3], fields[4], fields[5]
+            # SHT_PROGBITS sections that are loaded (SHF_ALLOC)
+            if shType == 1 and (flags & 0x2) and size > 0:
+                self.sections.append((address, data[offset:offset + size]))
+
+    def string(self, address):
+        for start, contents in self.sections:
+            if start <= address < start + len(contents):
+                end = contents.find(b'\0', address - start)
+                if end < 0:
+                    end = len(contents)
+                return contents[address - start:end].decode('ascii', 'replace')
+        return None
+
+
+def formatRecord(elf, address, args):
+    text = elf.string(address)
+    if text is None:
+        return '<unknown format 0x%08x> %s' % (address, ' '.join('0x%x' % arg for arg in args))
+
+    remaining = list(args)
+
+    def convert(match):
+        flags, kind = match.groups()
+        if kind == '%':
+            return '%'
+        if not remaining:
+            return '<missing>'
+        value = remaining.pop(0)
+        if kind in 'di':
+            value = struct.unpack('<i', struct.pack('<I', value))[0]
+        elif kind in 'feEgG':
+            value = struct.unpack('<f', struct.pack('<I', value))[0]
+        elif kind == 's':
+            value = elf.string(value) or '<0x%08x>' % value
+        elif kind == 'p':
+            kind, flags = 'x', '#' + flags
+        return ('%' + flags + kind) % value
+
+    return CONVERSION.sub(convert, text)
+
+
+def decode(elf, stream, out):
+    dropped = 0
+    start = None
+    last = 0
+    wraps = 0
+
+    for frameType, payload in frames(stream):
+        if frameType != FRM_TYPE_LOG or len(payload) < 4 or len(payload) % 4:
+            continue
+
+        words = struct.unpack('<%dI' % (len(payload) // 4), payload)
+        if words[0] != dropped:
+            out.write('[%d records dropped]\n' % ((words[0] - dropped) & 0xFFFFFFFF))
+            dropped = words[0]
+
+        index = 1
+        while index + LOG_HEADER_WORDS <= len(words):
+            header, cycles = words[index], words[index + 1]
+            argc = header >> LOG_ARGC_SHIFT
+            args = words[index + LOG_HEADER_WORDS:index + LOG_HEADER_WORDS + argc]
+            index += LOG_HEADER_WORDS + argc
+
+            if cycles < last:
+                wraps += 1
+            last = cycles
+            cycles += wraps << 32
+            if start is None:
+                start = cycles
+
+            address = header & ((1 << LOG_ARGC_SHIFT) - 1)
+            out.write('%12.6f %s\n' % ((cycles - start) / float(CPU_HZ),
+                                       formatRecord(elf, address, args)))
+        out.flush()
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.stderr.write(__doc__)
+        return 1
+
+    elf = Elf(sys.argv[1])
+    with open(sys.argv[2], 'rb', buffering=0) as stream:
+        decode(elf, stream, sys.stdout)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""Read and write drive parameters over the binary protocol of param.h.
+
+    python3 tools/params.py /dev/ttyACM0 list
+    python3 tools/params.py /dev/ttyACM0 get motor.maxDuty pwm.frequency
+    python3 tools/params.py /dev/ttyACM0 set pwm.frequency=16000 bldc.startDuty=3000
+
+The values of one "set" are written as a single batch, which the drive
+checks in full before applying any of them.  Scripts can use the Params
+class directly, e.g. for a sweep:
+
+    with Params('/dev/ttyACM0') as drive:
+        for frequency in range(8000, 32001, 2000):
+            drive.write({'pwm.frequency': frequency})
+            ...
+
+Telemetry, log and scope frames, and CLI text, may share the link; they
+are skipped while waiting for a response.
+"""
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+from frames import FRM_TYPE_PARAM_REQUEST, FRM_TYPE_PARAM_RESPONSE, cobsDecode, crc32Mpeg2, encodeFrame
+
+PRM_PROTOCOL_VERSION = 1
+PRM_MAX_READ = 15
+PRM_MAX_WRITE = 12
+
+OP_INFO, OP_DESCRIBE, OP_READ, OP_WRITE = range(4)
+STATUS_NAMES = ['ok', 'unknown operation', 'bad length', 'unknown parameter', 'read-only', 'out of range']
+
+# Indexed by _PRM_type: struct format of the value in its 32 bits
+TYPE_NAMES = ['u8', 'i8', 'u16', 'i16', 'u32', 'i32', 'float']
+TYPE_FORMATS = ['<I', '<i', '<I', '<i', '<I', '<i', '<f']
+PRM_FLAG_READ_ONLY = 0x01
+
+
+class ParamError(Exception):
+    pass
+
+
+class Param(object):
+    def __init__(self, ident, paramType, flags, minimum, maximum, name):
+        self.id = ident
+        self.type = paramType
+        self.flags = flags
+        self.min = self.unpack(minimum)
+        self.max = self.unpack(maximum)
+        self.name = name
+
+    def unpack(self, word):
+        return struct.unpack(TYPE_FORMATS[self.type], struct.pack('<I', word))[0]
+
+    def pack(self, value):
+        if TYPE_NAMES[self.type] == 'float':
+            value = float(value)
+        elif isinstance(value, str):
+            value = int(value, 0)
+        return struct.unpack('<I', struct.pack(TYPE_FORMATS[self.type], value))[0]
+
+
+class Params(object):
+    def __init__(self, path, timeout=0.5, retries=3):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        if os.isatty(self.fd):
+            tty.setraw(self.fd)
+            termios.tcflush(self.fd, termios.TCIFLUSH)
+        self.timeout = timeout
+        self.retries = retries
+        self.sequence = 0
+        self.pending = bytearray()
+        self.params = None
+        self.mapHash = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def close(self):
+        os.close(self.fd)
+
+    def request(self, op, arguments=b''):
+        """Send one request and return (status, data) of its response."""
+        for _ in range(self.retries):
+            self.sequence = (self.sequence + 1) & 0xFF
+            os.write(self.fd, encodeFrame(FRM_TYPE_PARAM_REQUEST, bytes([self.sequence, op]) + arguments))
+            response = self.receive(self.sequence, op)
+            if response is not None:
+                return response
+        raise ParamError('no response from the drive')
+
+    def receive(self, sequence, op):
+        deadline = time.time() + self.timeout
+        while True:
+            while b'\0' in self.pending:
+                part, _, rest = bytes(self.pending).partition(b'\0')
+                self.pending = bytearray(rest)
+                raw = cobsDecode(part) if part else None
+                if raw is None or len(raw) < 8:
+                    continue
+                body, crc = raw[:-4], struct.unpack('<I', raw[-4:])[0]
+                if crc32Mpeg2(body) != crc or body[0] != FRM_TYPE_PARAM_RESPONSE:
+                    continue
+                if body[1] == sequence and body[2] == op:
+                    return body[3], body[4:]
+
+            remaining = deadline - time.time()
+            if remaining <= 0 or not select.select([self.fd], [], [], remaining)[0]:
+                return None
+            try:
+                chunk = os.read(self.fd, 4096)
+            except OSError:
+                chunk = b''
+            if not chunk:
+                raise ParamError('the link closed')
+            self.pending += chunk
+
+    def check(self, status, data):
+        if status != 0:
+            name = STATUS_NAMES[status] if status < len(STATUS_NAMES) else 'status %d' % status
+            raise ParamError(name)
+        return data
+
+    def describe(self):
+        """Fetch the map once; it is kept while the drive's map hash stays the same."""
+        version, count, mapHash = struct.unpack('<BBI', self.check(*self.request(OP_INFO))[:6])
+        if version != PRM_PROTOCOL_VERSION:
+            raise ParamError('protocol version %d, expected %d' % (version, PRM_PROTOCOL_VERSION))
+        if self.params is not None and mapHash == self.mapHash:
+            return self.params
+
+        params = {}
+        while len(params) < count:
+            data = self.check(*self.request(OP_DESCRIBE, bytes([len(params)])))
+            if not data:
+                raise ParamError('short parameter description')
+            while data:
+                ident, paramType, flags, minimum, maximum, nameLength = struct.unpack_from('<BBBIIB', data)
+                name = data[12:12 + nameLength].decode('ascii')
+                params[name] = Param(ident, paramType, flags, minimum, maximum, name)
+                data = data[12 + nameLength:]
+
+        self.params = params
+        self.mapHash = mapHash
+        return params
+
+    def lookup(self, name):
+        params = self.describe() if self.params is None else self.params
+        if name not in params:
+            raise ParamError('unknown parameter %s' % name)
+        return params[name]
+
+    def read(self, names):
+        """Return {name: value}, PRM_MAX_READ parameters per request."""
+        params = [self.lookup(name) for name in names]
+        values = {}
+        for first in range(0, len(params), PRM_MAX_READ):
+            batch = params[first:first + PRM_MAX_READ]
+            data = self.check(*self.request(OP_READ, bytes(param.id for param in batch)))
+            for index, param in enumerate(batch):
+                values[param.name] = param.unpack(struct.unpack_from('<I', data, 4 * index)[0])
+        return values
+
+    def write(self, values):
+        """Write {name: value} in one batch, applied whole or not at all."""
+        if len(values) > PRM_MAX_WRITE:
+            raise ParamError('at most %d parameters per write' % PRM_MAX_WRITE)
+        pairs = [(self.lookup(name), value) for name, value in values.items()]
+        arguments = b''.join(struct.pack('<BI', param.id, param.pack(value)) for param, value in pairs)
+        status, data = self.request(OP_WRITE, arguments)
+        if status != 0:
+            param, value = pairs[data[0]] if data and data[0] < len(pairs) else (None, None)
+            where = ' (%s=%s, range %s to %s)' % (param.name, value, param.min, param.max) if param else ''
+            raise ParamError(STATUS_NAMES[status] + where)
+
+
+def main():
+    if len(sys.argv) < 3 or sys.argv[2] not in ('list', 'get', 'set'):
+        sys.stderr.write(__doc__)
+        return 1
+
+    try:
+        with Params(sys.argv[1]) as drive:
+            params = drive.describe()
+            command, names = sys.argv[2], sys.argv[3:]
+
+            if command == 'list':
+                values = drive.read(list(params))
+                for param in sorted(params.values(), key=lambda param: param.id):
+                    print('%3d %-20s %-5s %12s  [%s, %s]%s' % (param.id, param.name, TYPE_NAMES[param.type],
+                          values[param.name], param.min, param.max,
+                          ' read-only' if param.flags & PRM_FLAG_READ_ONLY else ''))
+            elif command == 'get':
+                for name, value in drive.read(names or list(params)).items():
+                    print('%s=%s' % (name, value))
+            else:
+                drive.write(dict(pair.split('=', 1) for pair in names))
+                print('OK')
+    except (ParamError, ValueError) as error:
+        sys.stderr.write('%s\n' % error)
+        return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
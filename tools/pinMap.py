@@ -0,0 +1,297 @@
+#!/usr/bin/env python3
+"""Generate software/pinMap.h, the pin, ADC channel and timer map, from the netlists.
+
+    python3 tools/pinMap.py             write software/pinMap.h
+    python3 tools/pinMap.py --check     fail if it is out of date
+
+SIGNALS lists what the firmware connects to, by the net it sits on.  The
+pin of each net comes from the netlist of each board revision in
+REVISIONS, after that revision's rework (nets wired to other pins than
+the netlist shows).  Generation stops with an error, and writes
+nothing, when:
+
+  - a net is on no MCU pin, or on more than one
+  - two signals land on the same pin
+  - an analog signal is on a pin without an ADC channel
+  - a signal's peripheral function is not available on its pin
+  - the pins of a group are not adjacent on one port
+
+The header gives each signal PIN_<name>_PORT/_PIN/_GPIO, _ADC_CH and
+_TIM/_TIM_CH where they apply, and the CRL/CRH/BSRR values with which
+GPIO_initPins() sets up, at once, every pin the firmware does not
+switch at run time.
+"""
+import os
+import re
+import sys
+import zlib
+
+ROOT = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+OUTPUT = os.path.join(ROOT, 'software', 'pinMap.h')
+MCU_REFERENCE = 'U2'
+
+# STM32F103Cx, LQFP48: pad number -> pin (None for supplies, NRST, BOOT0)
+LQFP48 = [None, None, 'PC13', 'PC14', 'PC15', 'PD0', 'PD1', None, None, None,
+          'PA0', 'PA1', 'PA2', 'PA3', 'PA4', 'PA5', 'PA6', 'PA7', 'PB0', 'PB1',
+          'PB2', 'PB10', 'PB11', None, None, 'PB12', 'PB13', 'PB14', 'PB15', 'PA8',
+          'PA9', 'PA10', 'PA11', 'PA12', 'PA13', None, None, 'PA14', 'PA15', 'PB3',
+          'PB4', 'PB5', 'PB6', 'PB7', None, 'PB8', 'PB9', None, None]
+
+ADC_CHANNELS = {'PA0': 0, 'PA1': 1, 'PA2': 2, 'PA3': 3, 'PA4': 4, 'PA5': 5, 'PA6': 6,
+                'PA7': 7, 'PB0': 8, 'PB1': 9}
+
+# The peripheral functions used, by pin, with the remaps the firmware sets
+FUNCTIONS = {
+    'PA6': ['TIM3_CH1'],
+    'PA8': ['TIM1_CH1'], 'PA9': ['TIM1_CH2'], 'PA10': ['TIM1_CH3'],
+    'PB13': ['TIM1_CH1N'], 'PB14': ['TIM1_CH2N'], 'PB15': ['TIM1_CH3N'],
+    'PB6': ['I2C1_SCL', 'USART1_TX'], 'PB7': ['I2C1_SDA', 'USART1_RX'],
+    'PB8': ['CAN_RX'], 'PB9': ['CAN_TX'],
+}
+
+# CNF/MODE nibble of each mode, and the ODR bit it needs (None: any)
+MODES = {
+    'analog': (0x0, None),
+    'floating': (0x4, None),
+    'pullUp': (0x8, 1),
+    'pullDown': (0x8, 0),
+    'output': (0x3, 0),                 # push-pull, 50MHz, starts low
+    'altOutput': (0xB, None),
+    'altOpenDrain': (0xF, None),
+}
+
+# name, net, mode, peripheral functions, group.  The mode None leaves the
+#	pin to its module, which sets it up (and changes it) at run time.
+SIGNALS = [
+    ('PHA_FBK', 'ANALOG_PHA_FBK', 'analog', [], None),
+    ('PHB_FBK', 'ANALOG_PHB_FBK', 'analog', [], None),
+    ('PHC_FBK', 'ANALOG_PHC_FBK', 'analog', [], None),
+    ('VBUS_FBK', 'ANALOG_VBUS_FBK', 'analog', [], None),
+    ('I_FBK', 'ANALOG_I_FBK', 'analog', [], None),
+    ('CONTROL_IN', 'DIG_IN_PWM', 'analog', [], None),        # analog control input
+    ('TACH', 'OUT_TACH', 'output', [], None),
+    ('HALL_0', 'DIG_HALL_0', 'floating', [], 'HALL'),
+    ('HALL_1', 'DIG_HALL_1', 'floating', [], 'HALL'),
+    ('HALL_2', 'DIG_HALL_2', 'floating', [], 'HALL'),
+    ('RC_IN', 'DIG_OUT_DAC', None, ['TIM3_CH1'], None),     # RC pulses and DShot
+    ('AH', 'DIG_AH', 'altOutput', ['TIM1_CH1'], None),
+    ('BH', 'DIG_BH', 'altOutput', ['TIM1_CH2'], None),
+    ('CH', 'DIG_CH', 'altOutput', ['TIM1_CH3'], None),
+    ('AL', 'DIG_AL', 'altOutput', ['TIM1_CH1N'], None),
+    ('BL', 'DIG_BL', 'altOutput', ['TIM1_CH2N'], None),
+    ('CL', 'DIG_CL', 'altOutput', ['TIM1_CH3N'], None),
+    ('I2C_SCL', 'I2C_SCL', None, ['I2C1_SCL', 'USART1_TX'], None),
+    ('I2C_SDA', 'I2C_SDA', None, ['I2C1_SDA', 'USART1_RX'], None),
+    ('CAN_RX', 'CAN_RX', None, ['CAN_RX'], None),
+    ('CAN_TX', 'CAN_TX', None, ['CAN_TX'], None),
+]
+
+# BOARD_REVISION -> netlist and rework: pin -> (net, why)
+REVISIONS = {
+    0: ('hardware/lowVoltageDrive/lowVoltageDrive.net', {
+        'PB6': ('I2C_SCL', 'the STM32F103C6 has no I2C2 on PB10'),
+        'PB7': ('I2C_SDA', 'the STM32F103C6 has no I2C2 on PB11'),
+        'PB8': ('CAN_RX', 'no transceiver on this revision'),
+        'PB9': ('CAN_TX', 'no transceiver on this revision'),
+    }),
+}
+
+
+class MapError(Exception):
+    pass
+
+
+def readNetlist(path):
+    """Return {pin: net} of the MCU in an EESchema netlist."""
+    pins = {}
+    inMcu = False
+    with open(path) as netlist:
+        for line in netlist:
+            component = re.match(r'\s*\( /\S+ \S+\s+(\S+) ', line)
+            if component:
+                inMcu = component.group(1) == MCU_REFERENCE
+                continue
+            pad = re.match(r'\s*\(\s*(\d+) (\S+) \)', line)
+            if inMcu and pad and pad.group(2) != '?':
+                pin = LQFP48[int(pad.group(1))]
+                if pin is not None:
+                    pins[pin] = pad.group(2)
+    if not pins:
+        raise MapError('%s: no pins of %s' % (path, MCU_REFERENCE))
+    return pins
+
+
+def mapRevision(path, rework):
+    pins = readNetlist(path)
+    for pin, (net, _) in rework.items():
+        for other in [other for other, name in pins.items() if name == net]:
+            del pins[other]
+        pins[pin] = net
+
+    errors = []
+    assigned = {}
+    signals = []
+    for name, net, mode, functions, group in SIGNALS:
+        found = sorted(pin for pin, pinNet in pins.items() if pinNet == net)
+        if len(found) != 1:
+            errors.append('%s: net %s is on %s' % (name, net, ', '.join(found) or 'no MCU pin'))
+            continue
+        pin = found[0]
+        if pin in assigned:
+            errors.append('%s and %s are both on %s' % (assigned[pin], name, pin))
+        assigned[pin] = name
+        if mode == 'analog' and pin not in ADC_CHANNELS:
+            errors.append('%s: %s has no ADC channel' % (name, pin))
+        for function in functions:
+            if function not in FUNCTIONS.get(pin, []):
+                errors.append('%s: %s is not available on %s' % (name, function, pin))
+        signals.append((name, pin, mode, functions, group))
+
+    groups = {}
+    for name, pin, _, _, group in signals:
+        if group:
+            groups.setdefault(group, []).append(pin)
+    for group, groupPins in groups.items():
+        numbers = sorted(int(pin[2:]) for pin in groupPins)
+        if len(set(pin[:2] for pin in groupPins)) != 1 or numbers != list(range(numbers[0], numbers[0] + len(numbers))):
+            errors.append('group %s: %s are not adjacent on one port' % (group, ', '.join(sorted(groupPins))))
+
+    if errors:
+        raise MapError('%s:\n  %s' % (path, '\n  '.join(errors)))
+    return signals, groups
+
+
+def tabTo(text, column):
+    """Pad text with tabs (4 columns) to column, as the sources are laid out."""
+    width = len(text.expandtabs(4))
+    tabs = max(1, (column - width + 3) // 4)
+    return text + '\t' * tabs
+
+
+def define(name, value, comment=None):
+    line = tabTo('#define ' + name, 40) + str(value)
+    if comment:
+        line = tabTo(line, 52) + '// ' + comment
+    return line
+
+
+def revisionBlock(revision, path, rework):
+    signals, groups = mapRevision(os.path.join(ROOT, path), rework)
+    with open(os.path.join(ROOT, path), 'rb') as netlist:
+        crc = zlib.crc32(netlist.read()) & 0xFFFFFFFF
+
+    lines = ['// %s (CRC 0x%08X)' % (path, crc)]
+    for pin, (net, why) in sorted(rework.items()):
+        lines.append('//	rework: %s on %s, %s' % (net, pin, why))
+    lines.append('')
+
+    registers = {}
+    for name, pin, mode, functions, _ in signals:
+        port, number = pin[1], int(pin[2:])
+        lines.append(define('PIN_%s_PORT' % name, 'GPIO_PORT_%s' % port, mode or 'set up by its module'))
+        lines.append(define('PIN_%s_PIN' % name, number))
+        lines.append(define('PIN_%s_GPIO' % name, 'GPIO%s' % port))
+        if mode == 'analog':
+            lines.append(define('PIN_%s_ADC_CH' % name, ADC_CHANNELS[pin]))
+        for function in functions:
+            timer = re.match(r'TIM(\d+)_CH(\d)(N?)', function)
+            if timer:
+                lines.append(define('PIN_%s_TIM' % name, timer.group(1), function))
+                lines.append(define('PIN_%s_TIM_CH' % name, timer.group(2)))
+        lines.append('')
+
+        if mode is not None:
+            nibble, level = MODES[mode]
+            crl, crh, bsrr, crlMask, crhMask = registers.get(port, (0, 0, 0, 0, 0))
+            if number < 8:
+                crl |= nibble << (number * 4)
+                crlMask |= 0xF << (number * 4)
+            else:
+                crh |= nibble << ((number - 8) * 4)
+                crhMask |= 0xF << ((number - 8) * 4)
+            if level is not None:
+                bsrr |= (1 << number) if level else (1 << (number + 16))
+            registers[port] = (crl, crh, bsrr, crlMask, crhMask)
+
+    for group, groupPins in sorted(groups.items()):
+        first = min(int(pin[2:]) for pin in groupPins)
+        lines.append(define('PIN_%s_PORT' % group, 'GPIO_PORT_%s' % groupPins[0][1],
+                            'group of %u, read together' % len(groupPins)))
+        lines.append(define('PIN_%s_GPIO' % group, 'GPIO%s' % groupPins[0][1]))
+        lines.append(define('PIN_%s_SHIFT' % group, first))
+        lines.append(define('PIN_%s_MASK' % group, '0x%04X' % (((1 << len(groupPins)) - 1) << first)))
+        lines.append('')
+
+    lines.append('// GPIO_initPins(): CRx = (CRx & ~MASK) | value, then BSRR')
+    for port in ('A', 'B'):
+        crl, crh, bsrr, crlMask, crhMask = registers.get(port, (0, 0, 0, 0, 0))
+        lines.append(define('PIN_INIT_%s_CRL' % port, '0x%08X' % crl))
+        lines.append(define('PIN_INIT_%s_CRL_MASK' % port, '0x%08X' % crlMask))
+        lines.append(define('PIN_INIT_%s_CRH' % port, '0x%08X' % crh))
+        lines.append(define('PIN_INIT_%s_CRH_MASK' % port, '0x%08X' % crhMask))
+        lines.append(define('PIN_INIT_%s_BSRR' % port, '0x%08X' % bsrr))
+    return lines
+
+
+def generate():
+    lines = ['/**************************************************',
+             ' * This file is Public Domain',
+             ' *',
+             ' * This file is distributed in the hope that it will',
+             ' *\tbe useful, but WITHOUT ANY WARRANTY; without',
+             ' *\teven the implied warranty of MERCHANTABILITY',
+             ' *\tor FITNESS FOR A PARTICULAR PURPOSE.',
+             '*************************************************/',
+             '#ifndef PINMAP_H',
+             '#define PINMAP_H',
+             '',
+             '/* User-generated libs */',
+             '#include "gpio.h"',
+             '',
+             '/*',
+             ' * Pin, ADC channel and timer map of each board revision, generated',
+             ' *\tfrom the netlists by tools/pinMap.py: edit its SIGNALS or',
+             ' *\tREVISIONS and run it again rather than editing this file.',
+             ' */',
+             '#ifndef BOARD_REVISION',
+             '#define BOARD_REVISION\t\t\t\t%d' % min(REVISIONS),
+             '#endif',
+             '']
+    for index, (revision, (path, rework)) in enumerate(sorted(REVISIONS.items())):
+        lines.append('#%s BOARD_REVISION == %d' % ('if' if index == 0 else 'elif', revision))
+        lines += revisionBlock(revision, path, rework)
+    lines += ['#else',
+              '#error "pinMap.h: unknown BOARD_REVISION"',
+              '#endif',
+              '',
+              '#endif',
+              '']
+    return '\n'.join(lines)
+
+
+def main():
+    check = sys.argv[1:] == ['--check']
+    if sys.argv[1:] and not check:
+        sys.stderr.write(__doc__)
+        return 1
+
+    try:
+        text = generate()
+    except (MapError, IOError) as error:
+        sys.stderr.write('%s\n' % error)
+        return 1
+
+    if check:
+        with open(OUTPUT, 'rb') as header:
+            if header.read().decode() != text:
+                sys.stderr.write('%s is out of date, run tools/pinMap.py\n' % OUTPUT)
+                return 1
+        return 0
+
+    with open(OUTPUT, 'wb') as header:
+        header.write(text.encode())
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
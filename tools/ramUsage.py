@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""RAM usage per module from a GNU ld map file.
+
+The firmware is linked by CoIDE with the map file written next to the elf,
+e.g. software/lowVoltageDrive/Debug/bin/lowVoltageDrive.map.  Run:
+
+    python3 tools/ramUsage.py path/to/lowVoltageDrive.map
+
+Every input section that lands in SRAM is charged to the object file (or
+library member) it came from and reported as .data, .bss (including COMMON),
+stack or noinit.  .co_stack holds the start-up stacks but, being NOLOAD, also
+the RAM that must survive a warm restart (the fault record, the scope
+capture); those are told apart by the symbols the map lists in each input
+section, and the noinit symbols are listed with their sizes below the table.
+The stack high-water marks at run time come from the firmware itself, see
+memMon.c.
+"""
+import os
+import re
+import sys
+
+RAM_START = 0x20000000
+RAM_END = 0x20000000 + 0x2800    # STM32F103C6: 10KB
+
+SECTION = re.compile(r'^ (\.[\w.]+|COMMON)\s*$')
+SECTION_INLINE = re.compile(r'^ (\.[\w.]+|COMMON)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+CONTINUATION = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+SYMBOL = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+([A-Za-z_.$][\w.$]*)\s*$')
+
+# The stacks of startup_stm32f10x_ld.c; anything else in .co_stack is noinit
+STACK_SYMBOLS = ('pulStack', 'pulProcessStack')
+KINDS = ('data', 'bss', 'stack', 'noinit')
+
+
+def classify(section, symbols):
+    if section.startswith('.co_stack'):
+        if any(name in STACK_SYMBOLS for _, name in symbols):
+            return 'stack'
+        return 'noinit'
+    if section == 'COMMON' or section.startswith('.bss'):
+        return 'bss'
+    if section.startswith('.data'):
+        return 'data'
+    return None
+
+
+def module_name(path):
+    # "lib.a(member.o)" is kept as the member, plain objects by basename
+    match = re.search(r'\(([^)]+)\)\s*$', path)
+    if match:
+        return match.group(1)
+    return os.path.basename(path.strip())
+
+
+def sections(lines):
+    # Yields (section, address, size, origin, [(address, symbol)]) for every
+    # input section, with the symbols the map lists under it
+    pending = None
+    entry = None
+
+    for line in lines:
+        match = SYMBOL.match(line)
+        if entry is not None and match:
+            entry[4].append((int(match.group(1), 16), match.group(2)))
+            continue
+
+        match = SECTION_INLINE.match(line)
+        if match:
+            found = match.groups()
+        elif pending is not None and CONTINUATION.match(line):
+            found = (pending,) + CONTINUATION.match(line).groups()
+        else:
+            match = SECTION.match(line)
+            pending = match.group(1) if match else None
+            if entry is not None:
+                yield entry
+                entry = None
+            continue
+
+        if entry is not None:
+            yield entry
+        pending = None
+        section, address, size, origin = found
+        entry = (section, int(address, 16), int(size, 16), origin, [])
+
+    if entry is not None:
+        yield entry
+
+
+def parse(lines):
+    usage = {}
+    noinit = []
+
+    for section, address, size, origin, symbols in sections(lines):
+        kind = classify(section, symbols)
+
+        if kind is None or size == 0 or not (RAM_START <= address < RAM_END):
+            continue
+
+        name = module_name(origin)
+        module = usage.setdefault(name, dict.fromkeys(KINDS, 0))
+        module[kind] += size
+
+        if kind == 'noinit':
+            # Each symbol runs to the next one or to the end of the section
+            ends = [symbolAddress for symbolAddress, _ in symbols[1:]] + [address + size]
+            for (symbolAddress, symbol), end in zip(symbols, ends):
+                noinit.append((symbol, name, end - symbolAddress))
+            if not symbols:
+                noinit.append(('?', name, size))
+
+    return usage, noinit
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.stderr.write(__doc__)
+        return 1
+
+    with open(sys.argv[1]) as mapFile:
+        usage, noinit = parse(mapFile.readlines())
+
+    rows = sorted(usage.items(), key=lambda item: -sum(item[1].values()))
+    totals = dict.fromkeys(KINDS, 0)
+
+    print('%-32s %7s %7s %7s %7s %7s' % (('module',) + KINDS + ('total',)))
+    for name, module in rows:
+        for kind in totals:
+            totals[kind] += module[kind]
+        print('%-32s %7d %7d %7d %7d %7d' % ((name,) + tuple(module[kind] for kind in KINDS)
+                                             + (sum(module.values()),)))
+
+    total = sum(totals.values())
+    print('%-32s %7d %7d %7d %7d %7d' % (('TOTAL',) + tuple(totals[kind] for kind in KINDS)
+                                         + (total,)))
+    print('free: %d of %d bytes' % (RAM_END - RAM_START - total, RAM_END - RAM_START))
+
+    if noinit:
+        print()
+        print('noinit (kept across a warm restart):')
+        for symbol, name, size in sorted(noinit, key=lambda item: -item[2]):
+            print('  %-30s %-20s %7d' % (symbol, name, size))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,149 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#include <cstddef>
+#include <cstring>
+#include <sys/stat.h>
+
+#include "columnStore.h"
+
+#define COLUMN(field, type)		{#field, type, sizeof(TelemetrySample::field), offsetof(TelemetrySample, field)}
+
+const ColumnInfo TelemetryColumns[] =
+{
+	COLUMN(timestamp, "u64"),
+	COLUMN(sequence, "u16"),
+	COLUMN(phaseA, "u16"),
+	COLUMN(phaseB, "u16"),
+	COLUMN(phaseC, "u16"),
+	COLUMN(busVoltage, "u16"),
+	COLUMN(busCurrent, "u16"),
+	COLUMN(dutyCycle, "u16"),
+	COLUMN(sector, "i8"),
+	COLUMN(state, "u8"),
+};
+
+const size_t TelemetryColumnCount = sizeof(TelemetryColumns) / sizeof(TelemetryColumns[0]);
+
+static uint16_t
+ReadU16(const uint8_t* data)
+{
+	return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+bool
+DecodeTelemetry(const uint8_t* payload, size_t length, TelemetrySample& sample)
+{
+	if(length != TelemetryPayloadSize)
+		return false;
+
+	sample.timestamp = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8)
+			| ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+	sample.sequence = ReadU16(&payload[4]);
+	sample.phaseA = ReadU16(&payload[6]);
+	sample.phaseB = ReadU16(&payload[8]);
+	sample.phaseC = ReadU16(&payload[10]);
+	sample.busVoltage = ReadU16(&payload[12]);
+	sample.busCurrent = ReadU16(&payload[14]);
+	sample.dutyCycle = ReadU16(&payload[16]);
+	sample.sector = (int8_t)payload[18];
+	sample.state = payload[19];
+
+	return true;
+}
+
+ColumnWriter::ColumnWriter() : _buffered(0), _rows(0)
+{
+}
+
+ColumnWriter::~ColumnWriter()
+{
+	Close();
+}
+
+bool
+ColumnWriter::Open(const std::string& directory)
+{
+	Close();
+	mkdir(directory.c_str(), 0755);
+
+	FILE* schema = fopen((directory + "/columns.txt").c_str(), "w");
+	if(schema == nullptr)
+		return false;
+
+	for(size_t i = 0; i < TelemetryColumnCount; i++)
+	{
+		const ColumnInfo& column = TelemetryColumns[i];
+		std::string path = directory + "/" + column.name + "." + column.type;
+
+		fprintf(schema, "%s %s\n", column.name, column.type);
+
+		File file;
+		file.file = fopen(path.c_str(), "wb");
+		if(file.file == nullptr)
+		{
+			fclose(schema);
+			Close();
+			return false;
+		}
+
+		file.buffer.reserve(BufferRows * column.width);
+		_files.push_back(std::move(file));
+	}
+
+	fclose(schema);
+	return true;
+}
+
+void
+ColumnWriter::Append(const TelemetrySample& sample)
+{
+	const uint8_t* row = reinterpret_cast<const uint8_t*>(&sample);
+
+	// Little-endian host assumed, as the files are mapped as they are
+	for(size_t i = 0; i < _files.size(); i++)
+	{
+		const ColumnInfo& column = TelemetryColumns[i];
+		_files[i].buffer.insert(_files[i].buffer.end(), row + column.offset, row + column.offset + column.width);
+	}
+
+	_rows++;
+	if(++_buffered >= BufferRows)
+		Flush();
+}
+
+// Writes every column up to the same row, so a reader never sees
+//	columns more than one buffer apart
+bool
+ColumnWriter::Flush()
+{
+	bool ok = true;
+
+	for(File& file : _files)
+	{
+		if(fwrite(file.buffer.data(), 1, file.buffer.size(), file.file) != file.buffer.size())
+			ok = false;
+		fflush(file.file);
+		file.buffer.clear();
+	}
+
+	_buffered = 0;
+	return ok;
+}
+
+void
+ColumnWriter::Close()
+{
+	if(_files.empty())
+		return;
+
+	Flush();
+	for(File& file : _files)
+		fclose(file.file);
+	_files.clear();
+}
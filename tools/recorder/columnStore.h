@@ -0,0 +1,90 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef COLUMN_STORE_H
+#define COLUMN_STORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * Columnar telemetry files
+ *
+ * A recording is a directory with one file per signal, named
+ * <signal>.<type> (type u8, i8, u16, u64), holding a bare little-endian
+ * array: row n of every file is the same sample.  The files can be
+ * memory-mapped as they are, see tlmReader.h; columns.txt lists the
+ * signals in order.
+ *
+ * timestamp.u64 is the firmware cycle counter (72MHz) unwrapped to 64
+ * bits and is non-decreasing, so it can be searched.
+ */
+
+// One decoded FRM_TYPE_TELEMETRY payload, see software/telemetry.h
+struct TelemetrySample
+{
+	uint64_t timestamp;
+	uint16_t sequence;
+	uint16_t phaseA;
+	uint16_t phaseB;
+	uint16_t phaseC;
+	uint16_t busVoltage;
+	uint16_t busCurrent;
+	uint16_t dutyCycle;
+	int8_t sector;
+	uint8_t state;
+};
+
+struct ColumnInfo
+{
+	const char* name;
+	const char* type;
+	size_t width;
+	size_t offset;			// in TelemetrySample
+};
+
+extern const ColumnInfo TelemetryColumns[];
+extern const size_t TelemetryColumnCount;
+
+// Size of the _TLM_sample payload on the link
+constexpr size_t TelemetryPayloadSize = 20;
+
+// Decodes a payload; the 32-bit firmware timestamp is left in
+//	sample.timestamp for the caller to unwrap
+bool DecodeTelemetry(const uint8_t* payload, size_t length, TelemetrySample& sample);
+
+class ColumnWriter
+{
+public:
+	ColumnWriter();
+	~ColumnWriter();
+
+	bool Open(const std::string& directory);
+	void Append(const TelemetrySample& sample);
+	bool Flush();
+	void Close();
+
+	uint64_t Rows() const { return _rows; }
+
+private:
+	static constexpr size_t BufferRows = 4096;
+
+	struct File
+	{
+		FILE* file;
+		std::vector<uint8_t> buffer;
+	};
+
+	std::vector<File> _files;
+	size_t _buffered;
+	uint64_t _rows;
+};
+
+#endif
@@ -0,0 +1,153 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef FRAME_DECODER_H
+#define FRAME_DECODER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Streaming decoder for the frames of software/frame.h
+ *
+ *	0x00 | COBS( type | payload | crc32 ) | 0x00
+ *
+ * Bytes are pushed as they come off the tty; every frame with a good CRC
+ * is handed to the callback with its type and payload.  Anything else on
+ * the link (text, partial frames at start-up) is counted and skipped.
+ */
+class FrameDecoder
+{
+public:
+	static constexpr size_t MaxPayload = 64;				// FRM_MAX_PAYLOAD
+	static constexpr size_t MaxEncoded = 1 + 1 + MaxPayload + 4;
+
+	FrameDecoder() : _overflow(false), _frames(0), _crcErrors(0), _malformed(0)
+	{
+		_encoded.reserve(MaxEncoded);
+
+		// CRC-32/MPEG-2, MSB first, as computed by the STM32 CRC unit
+		for(uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t crc = i << 24;
+			for(int bit = 0; bit < 8; bit++)
+				crc = (crc & 0x80000000) ? ((crc << 1) ^ 0x04C11DB7) : (crc << 1);
+			_crcTable[i] = crc;
+		}
+	}
+
+	// handler(uint8_t type, const uint8_t* payload, size_t length)
+	template<typename Handler>
+	void Push(const uint8_t* data, size_t length, Handler&& handler)
+	{
+		for(size_t i = 0; i < length; i++)
+		{
+			uint8_t byte = data[i];
+
+			if(byte != 0)
+			{
+				if(_encoded.size() < MaxEncoded)
+					_encoded.push_back(byte);
+				else
+					_overflow = true;
+				continue;
+			}
+
+			if(!_encoded.empty())
+			{
+				if(_overflow)
+					_malformed++;
+				else
+					Decode(handler);
+			}
+
+			_encoded.clear();
+			_overflow = false;
+		}
+	}
+
+	uint64_t Frames() const { return _frames; }
+	uint64_t CrcErrors() const { return _crcErrors; }
+	uint64_t Malformed() const { return _malformed; }
+
+	// The firmware feeds the CRC unit little-endian words of zero-padded
+	//	data, so each group of four bytes goes in reverse order
+	uint32_t Crc(const uint8_t* data, size_t length) const
+	{
+		uint32_t crc = 0xFFFFFFFF;
+
+		for(size_t word = 0; word < length; word += 4)
+		{
+			for(int i = 3; i >= 0; i--)
+			{
+				uint8_t byte = (word + i < length) ? data[word + i] : 0;
+				crc = (crc << 8) ^ _crcTable[(crc >> 24) ^ byte];
+			}
+		}
+
+		return crc;
+	}
+
+private:
+	template<typename Handler>
+	void Decode(Handler& handler)
+	{
+		size_t length = 0;
+		size_t index = 0;
+
+		// COBS: each code byte gives the distance to the next zero
+		while(index < _encoded.size())
+		{
+			uint8_t code = _encoded[index];
+
+			if(index + code > _encoded.size() + 1)
+			{
+				_malformed++;
+				return;
+			}
+
+			for(size_t i = index + 1; i < index + code && i < _encoded.size(); i++)
+				_raw[length++] = _encoded[i];
+
+			index += code;
+			if(code < 0xFF && index < _encoded.size())
+				_raw[length++] = 0;
+		}
+
+		// type, CRC and at most MaxPayload bytes
+		if(length < 5 || length > MaxPayload + 5)
+		{
+			_malformed++;
+			return;
+		}
+
+		uint32_t crc = (uint32_t)_raw[length - 4] | ((uint32_t)_raw[length - 3] << 8)
+				| ((uint32_t)_raw[length - 2] << 16) | ((uint32_t)_raw[length - 1] << 24);
+
+		if(Crc(_raw.data(), length - 4) != crc)
+		{
+			_crcErrors++;
+			return;
+		}
+
+		_frames++;
+		handler(_raw[0], &_raw[1], length - 5);
+	}
+
+	std::vector<uint8_t> _encoded;
+	std::array<uint8_t, MaxEncoded> _raw;
+	std::array<uint32_t, 256> _crcTable;
+	bool _overflow;
+	uint64_t _frames;
+	uint64_t _crcErrors;
+	uint64_t _malformed;
+};
+
+#endif
@@ -0,0 +1,68 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/*
+ * Prints rows of a recording from a point in time, as an example of the
+ * reader library
+ *
+ *	g++ -std=c++17 -O2 -Wall -o tlmQuery tlmQuery.cpp tlmReader.cpp
+ *	./tlmQuery run1 12.5 20			20 rows from 12.5 s
+ */
+#include <cstdio>
+#include <cstdlib>
+
+#include "tlmReader.h"
+
+int
+main(int argc, char** argv)
+{
+	if(argc < 2 || argc > 4)
+	{
+		fprintf(stderr, "usage: %s <recording> [seconds] [rows]\n", argv[0]);
+		return 1;
+	}
+
+	TelemetryReader reader;
+	if(!reader.Open(argv[1]))
+	{
+		fprintf(stderr, "%s: not a recording\n", argv[1]);
+		return 1;
+	}
+
+	if(reader.Size() == 0)
+	{
+		printf("empty recording\n");
+		return 0;
+	}
+
+	size_t first = (argc > 2) ? reader.IndexAtSeconds(atof(argv[2])) : 0;
+	size_t rows = (argc > 3) ? strtoul(argv[3], nullptr, 0) : 10;
+
+	const uint16_t* sequence = reader.Column<uint16_t>("sequence");
+	const uint16_t* phaseA = reader.Column<uint16_t>("phaseA");
+	const uint16_t* phaseB = reader.Column<uint16_t>("phaseB");
+	const uint16_t* phaseC = reader.Column<uint16_t>("phaseC");
+	const uint16_t* busVoltage = reader.Column<uint16_t>("busVoltage");
+	const uint16_t* busCurrent = reader.Column<uint16_t>("busCurrent");
+	const uint16_t* dutyCycle = reader.Column<uint16_t>("dutyCycle");
+	const int8_t* sector = reader.Column<int8_t>("sector");
+	const uint8_t* state = reader.Column<uint8_t>("state");
+
+	printf("%zu rows, %.3f s\n", reader.Size(), reader.Seconds(reader.Size() - 1));
+	printf("%12s %6s %6s %6s %6s %6s %6s %6s %6s %5s\n", "seconds", "seq", "phA", "phB", "phC",
+			"vBus", "iBus", "duty", "sector", "state");
+
+	for(size_t i = first; i < reader.Size() && i < first + rows; i++)
+	{
+		printf("%12.6f %6u %6u %6u %6u %6u %6u %6u %6d %5u\n", reader.Seconds(i), sequence[i],
+				phaseA[i], phaseB[i], phaseC[i], busVoltage[i], busCurrent[i], dutyCycle[i],
+				sector[i], state[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,118 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#include <algorithm>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tlmReader.h"
+
+TelemetryReader::TelemetryReader() : _timestamp(nullptr), _rows(0)
+{
+}
+
+TelemetryReader::~TelemetryReader()
+{
+	Close();
+}
+
+bool
+TelemetryReader::Open(const std::string& directory)
+{
+	Close();
+
+	std::ifstream schema(directory + "/columns.txt");
+	std::string name;
+	std::string type;
+
+	if(!schema)
+		return false;
+
+	bool first = true;
+	while(schema >> name >> type)
+	{
+		size_t width = (type == "u64") ? 8 : (type == "u16") ? 2 : 1;
+		std::string path = directory + "/" + name + "." + type;
+
+		int fd = open(path.c_str(), O_RDONLY);
+		if(fd < 0)
+		{
+			Close();
+			return false;
+		}
+
+		struct stat status;
+		fstat(fd, &status);
+
+		Mapping mapping = {nullptr, (size_t)status.st_size, width};
+		if(mapping.bytes > 0)
+		{
+			void* data = mmap(nullptr, mapping.bytes, PROT_READ, MAP_SHARED, fd, 0);
+			if(data == MAP_FAILED)
+			{
+				close(fd);
+				Close();
+				return false;
+			}
+			mapping.data = data;
+		}
+		close(fd);
+
+		size_t rows = mapping.bytes / width;
+		_rows = first ? rows : std::min(_rows, rows);
+		first = false;
+
+		_columns[name] = mapping;
+	}
+
+	_timestamp = Column<uint64_t>("timestamp");
+	if(_timestamp == nullptr && _rows > 0)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void
+TelemetryReader::Close()
+{
+	for(auto& column : _columns)
+	{
+		if(column.second.data != nullptr)
+			munmap(const_cast<void*>(column.second.data), column.second.bytes);
+	}
+
+	_columns.clear();
+	_timestamp = nullptr;
+	_rows = 0;
+}
+
+size_t
+TelemetryReader::IndexAt(uint64_t timestamp) const
+{
+	return std::lower_bound(_timestamp, _timestamp + _rows, timestamp) - _timestamp;
+}
+
+double
+TelemetryReader::Seconds(size_t index) const
+{
+	return (_timestamp[index] - _timestamp[0]) / CyclesPerSecond;
+}
+
+size_t
+TelemetryReader::IndexAtSeconds(double seconds) const
+{
+	if(_rows == 0)
+		return 0;
+	return IndexAt(_timestamp[0] + (uint64_t)(seconds * CyclesPerSecond));
+}
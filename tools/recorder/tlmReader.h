@@ -0,0 +1,70 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+#ifndef TLM_READER_H
+#define TLM_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+/*
+ * Random access to a recording written by tlmRecord, see columnStore.h.
+ * Every column is memory-mapped read-only; nothing is copied, so opening
+ * a long recording is instant and only the pages that are touched are
+ * read from disk.  A recording that is still being written can be
+ * opened; it shows the rows flushed so far.
+ */
+class TelemetryReader
+{
+public:
+	static constexpr double CyclesPerSecond = 72e6;
+
+	TelemetryReader();
+	~TelemetryReader();
+	TelemetryReader(const TelemetryReader&) = delete;
+	TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+	bool Open(const std::string& directory);
+	void Close();
+
+	// Rows present in every column
+	size_t Size() const { return _rows; }
+
+	// nullptr if the column does not exist or T has the wrong width
+	template<typename T>
+	const T* Column(const std::string& name) const
+	{
+		auto column = _columns.find(name);
+		if(column == _columns.end() || column->second.width != sizeof(T))
+			return nullptr;
+		return static_cast<const T*>(column->second.data);
+	}
+
+	// First row at or after timestamp (cycles), Size() if none
+	size_t IndexAt(uint64_t timestamp) const;
+
+	// Seconds since the first row
+	double Seconds(size_t index) const;
+	size_t IndexAtSeconds(double seconds) const;
+
+private:
+	struct Mapping
+	{
+		const void* data;
+		size_t bytes;
+		size_t width;
+	};
+
+	std::map<std::string, Mapping> _columns;
+	const uint64_t* _timestamp;
+	size_t _rows;
+};
+
+#endif
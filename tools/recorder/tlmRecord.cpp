@@ -0,0 +1,214 @@
+/**************************************************
+ * This file is Public Domain
+ *
+ * This file is distributed in the hope that it will
+ *	be useful, but WITHOUT ANY WARRANTY; without
+ *	even the implied warranty of MERCHANTABILITY
+ *	or FITNESS FOR A PARTICULAR PURPOSE.
+*************************************************/
+/*
+ * Records the telemetry stream of the drive into columnar files
+ *
+ *	g++ -std=c++17 -O2 -Wall -pthread -I../../software/USB/vcp/inc \
+ *		-o tlmRecord tlmRecord.cpp columnStore.cpp
+ *	./tlmRecord /dev/ttyACM0 run1
+ *
+ * Enable the stream on the drive with "tlm on".  Recording stops at end
+ * of file (the device went away, or the pty stand-in finished, see
+ * tools/framePty.py) or on Ctrl-C; the files are complete either way.
+ * Text and other frame types on the link are skipped.
+ *
+ * A reader thread moves the tty into a Buffer<> ring (the firmware's
+ * software/USB/vcp/inc/buffer.h) and the main thread decodes and writes
+ * the columns from it, so a slow column flush does not leave the tty
+ * unread while the drive keeps sending.
+ */
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "columnStore.h"
+#include "frameDecoder.h"
+
+static constexpr uint8_t FRM_TYPE_TELEMETRY = 0x01;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+// A whole USB full-speed second is about 1MB; 32KB, the largest ring the
+//	16-bit indices allow, holds 30ms of it while the columns are flushed
+static Buffer<32768> ring;
+static std::atomic<bool> readerDone(false);
+
+static void
+OnSignal(int)
+{
+	stopRequested = 1;
+}
+
+// Raw mode, so that no byte of a frame is translated or eaten
+static void
+MakeRaw(int fd)
+{
+	struct termios settings;
+
+	if(tcgetattr(fd, &settings) != 0)
+		return;
+
+	cfmakeraw(&settings);
+	settings.c_cc[VMIN] = 1;
+	settings.c_cc[VTIME] = 0;
+	tcsetattr(fd, TCSANOW, &settings);
+}
+
+// Producer: reads the tty straight into the free space of the ring until
+//	end of file or a stop request
+static void
+ReadTty(int fd)
+{
+	_BUFFER_spans spans;
+	sigset_t signals;
+
+	// Ctrl-C lands here, so that it interrupts the blocking read()
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
+
+	while(!stopRequested)
+	{
+		if(ring.Reserve(spans, ring.Size) == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		ssize_t count = read(fd, spans.span[0].data, spans.span[0].length);
+
+		if(count > 0)
+			ring.Commit((uint16_t)count);
+		else if(count == 0 || (errno != EINTR && errno != EAGAIN))
+			break;						// EOF, or EIO once a pty master closes
+	}
+
+	readerDone.store(true, std::memory_order_release);
+}
+
+int
+main(int argc, char** argv)
+{
+	if(argc != 3)
+	{
+		fprintf(stderr, "usage: %s <tty> <output directory>\n", argv[0]);
+		return 1;
+	}
+
+	int fd = open(argv[1], O_RDONLY | O_NOCTTY);
+	if(fd < 0)
+	{
+		fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+		return 1;
+	}
+	MakeRaw(fd);
+
+	ColumnWriter writer;
+	if(!writer.Open(argv[2]))
+	{
+		fprintf(stderr, "%s: cannot create the column files\n", argv[2]);
+		return 1;
+	}
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = OnSignal;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+
+	// Only the reader thread takes the signals, see ReadTty()
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+	FrameDecoder decoder;
+	TelemetrySample sample;
+	uint64_t otherFrames = 0;
+	uint64_t badPayloads = 0;
+	uint64_t gaps = 0;
+	uint64_t wraps = 0;
+	uint32_t lastCycles = 0;
+	uint16_t nextSequence = 0;
+	bool first = true;
+
+	auto handler = [&](uint8_t type, const uint8_t* payload, size_t length)
+	{
+		if(type != FRM_TYPE_TELEMETRY)
+		{
+			otherFrames++;
+			return;
+		}
+
+		if(!DecodeTelemetry(payload, length, sample))
+		{
+			badPayloads++;
+			return;
+		}
+
+		// The firmware counter wraps every 59 s; samples come far faster
+		uint32_t cycles = (uint32_t)sample.timestamp;
+		if(!first && cycles < lastCycles)
+			wraps++;
+		lastCycles = cycles;
+		sample.timestamp = (wraps << 32) | cycles;
+
+		if(!first && sample.sequence != nextSequence)
+			gaps++;
+		nextSequence = sample.sequence + 1;
+		first = false;
+
+		writer.Append(sample);
+	};
+
+	std::thread reader(ReadTty, fd);
+	_BUFFER_spans spans;
+
+	// Consumer: decodes whatever the reader has queued, in place
+	while(true)
+	{
+		// Read the flag first, so that nothing committed before it is missed
+		bool done = readerDone.load(std::memory_order_acquire);
+
+		if(ring.Peek(spans, ring.Size) == 0)
+		{
+			if(done)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		decoder.Push(spans.span[0].data, spans.span[0].length, handler);
+		decoder.Push(spans.span[1].data, spans.span[1].length, handler);
+		ring.Consume(spans.length);
+	}
+
+	reader.join();
+	writer.Close();
+	close(fd);
+
+	fprintf(stderr, "%llu samples, %llu sequence gaps, %llu other frames, "
+			"%llu CRC errors, %llu malformed or text, %llu bad payloads\n",
+			(unsigned long long)writer.Rows(), (unsigned long long)gaps,
+			(unsigned long long)otherFrames, (unsigned long long)decoder.CrcErrors(),
+			(unsigned long long)decoder.Malformed(), (unsigned long long)badPayloads);
+
+	return 0;
+}
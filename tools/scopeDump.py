@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Write a RAM scope capture (see scope.h) as CSV.
+
+Start the dump with the "scope dump" command, then read the USB serial
+port in raw mode (stty -F /dev/ttyACM0 raw):
+
+    python3 tools/scopeDump.py /dev/ttyACM0 capture.csv
+    python3 tools/scopeDump.py capture.bin capture.csv
+
+The first complete capture on the input is written and the tool exits.
+Time is in microseconds from the trigger at the 16kHz PWM rate; the last
+sample is the fault itself when the capture was frozen by a fault.
+"""
+import struct
+import sys
+
+from frames import FRM_TYPE_SCOPE, frames
+
+PWM_HZ = 16000
+
+HEADER = struct.Struct('<HHHH4B')
+CHANNEL_NAMES = ['phaseA', 'phaseB', 'phaseC', 'busVoltage', 'busCurrent',
+                 'duty', 'sector', 'state']
+SCP_CH_SECTOR = 6
+SCP_NO_CHANNEL = 0xFF
+
+
+def capture(stream):
+    """Return (header fields, samples) for the first complete capture."""
+    samples = {}
+    current = None
+
+    for frameType, payload in frames(stream):
+        if frameType != FRM_TYPE_SCOPE or len(payload) < HEADER.size:
+            continue
+
+        fields = HEADER.unpack_from(payload)
+        index, count, trigger, decimation = fields[:4]
+        channels = [channel for channel in fields[4:] if channel != SCP_NO_CHANNEL]
+
+        # A frame from another dump starts over
+        if (count, trigger, decimation, channels) != current:
+            current = (count, trigger, decimation, channels)
+            samples = {}
+
+        words = struct.unpack('<%dH' % ((len(payload) - HEADER.size) // 2), payload[HEADER.size:])
+        for offset in range(len(words) // len(channels)):
+            samples[index + offset] = words[offset * len(channels):(offset + 1) * len(channels)]
+
+        if len(samples) >= count:
+            return current, [samples[i] for i in range(count)]
+
+    return None
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.stderr.write(__doc__)
+        return 1
+
+    with open(sys.argv[1], 'rb', buffering=0) as stream:
+        result = capture(stream)
+
+    if result is None:
+        sys.stderr.write('no complete capture on the input\n')
+        return 1
+
+    (count, trigger, decimation, channels), samples = result
+    names = [CHANNEL_NAMES[channel] if channel < len(CHANNEL_NAMES) else 'ch%d' % channel
+             for channel in channels]
+
+    with open(sys.argv[2], 'w') as out:
+        out.write('sample,time_us,%s\n' % ','.join(names))
+        for index, values in enumerate(samples):
+            values = [struct.unpack('<h', struct.pack('<H', value))[0]
+                      if channel == SCP_CH_SECTOR else value
+                      for channel, value in zip(channels, values)]
+            timeUs = (index - trigger) * decimation * 1e6 / PWM_HZ
+            out.write('%d,%.1f,%s\n' % (index, timeUs, ','.join(str(value) for value in values)))
+
+    print('%d samples, trigger at %d, %d channels' % (count, trigger, len(channels)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())